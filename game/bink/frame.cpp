@@ -3,6 +3,11 @@
 #include <algorithm>
 #include <cstring>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define BINK_SSE2 1
+#include <emmintrin.h>
+#endif
+
 using namespace Bink;
 
 void Frame::Plane::setSize(uint32_t iw, uint32_t ih) {
@@ -16,13 +21,9 @@ void Frame::Plane::setSize(uint32_t iw, uint32_t ih) {
   }
 
 void Frame::Plane::getPixels8x8(uint32_t rx, uint32_t ry, uint8_t* out) const {
-  const uint8_t* d = dat.data();
-
-  for(uint32_t y=0; y<8; ++y) {
-    for(uint32_t x=0; x<8; ++x) {
-      out[x+y*8] = d[(x+rx) + (y+ry)*stride];
-      }
-    }
+  const uint8_t* d = dat.data() + rx + ry*stride;
+  for(uint32_t y=0; y<8; ++y)
+    std::memcpy(out+y*8, d+y*stride, 8);
   }
 
 void Frame::Plane::getBlock8x8(uint32_t bx, uint32_t by, uint8_t* out) const {
@@ -30,22 +31,24 @@ void Frame::Plane::getBlock8x8(uint32_t bx, uint32_t by, uint8_t* out) const {
   }
 
 void Frame::Plane::putBlock8x8(uint32_t bx, uint32_t by, const uint8_t* in) {
-  uint8_t* d = dat.data();
-
-  for(uint32_t y=0; y<8; ++y) {
-    for(uint32_t x=0; x<8; ++x) {
-      d[(x+bx*8) + (y+by*8)*stride] = in[x+y*8];
-      }
-    }
+  uint8_t* d = dat.data() + bx*8 + by*8*stride;
+  for(uint32_t y=0; y<8; ++y)
+    std::memcpy(d+y*stride, in+y*8, 8);
   }
 
 void Frame::Plane::putScaledBlock(uint32_t bx, uint32_t by, const uint8_t* in) {
-  uint8_t* d = dat.data();
-  for(uint32_t y=0; y<16; ++y) {
-    uint32_t y2 = y/2;
-    for(uint32_t x=0; x<16; ++x) {
-      d[(x+bx*8) + (y+by*8)*stride] = in[(x/2)+y2*8];
-      }
+  uint8_t* d = dat.data() + bx*8 + by*8*stride;
+  for(uint32_t y=0; y<16; y+=2) {
+    uint8_t row[16];
+#if defined(BINK_SSE2)
+    const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in+(y/2)*8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(row),_mm_unpacklo_epi8(v,v));
+#else
+    for(uint32_t x=0; x<16; ++x)
+      row[x] = in[(x/2)+(y/2)*8];
+#endif
+    std::memcpy(d+(y+0)*stride, row, 16);
+    std::memcpy(d+(y+1)*stride, row, 16);
     }
   }
 
@@ -25,6 +25,7 @@ class Frame final {
 
         uint8_t        at(uint32_t x, uint32_t y) const;
         const uint8_t* data() const { return dat.data(); }
+        const uint8_t* row(uint32_t y) const { return dat.data() + y*stride; }
 
       private:
         void setSize(uint32_t w, uint32_t h);
@@ -10,8 +10,18 @@
 #include <cmath>
 #include <cstring>
 #include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
 #include <limits>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define BINK_SSE2 1
+#include <emmintrin.h>
+#endif
+
 using namespace Bink;
 
 static const float    sqrthalf = std::sqrt(0.5f);
@@ -624,6 +634,7 @@ static void idctRow(T* dest, const int* src) {
   idctTransform(dest,src,0,1,2,3,4,5,6,7,0,1,2,3,4,5,6,7,munge);
   }
 
+#if !defined(BINK_SSE2)
 static void bink_idct_col(int *dest, const int32_t *src) {
   if((src[8]|src[16]|src[24]|src[32]|src[40]|src[48]|src[56])==0) {
     dest[0]  =
@@ -638,6 +649,152 @@ static void bink_idct_col(int *dest, const int32_t *src) {
     idctCol(dest, src);
     }
   }
+#endif
+
+#if defined(BINK_SSE2)
+// low 32 bits of product, SSE2 has no pmulld
+static __m128i mul32(__m128i a, int b) {
+  const __m128i bv   = _mm_set1_epi32(b);
+  const __m128i even = _mm_mul_epu32(a,bv);
+  const __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(a,32),bv);
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even,_MM_SHUFFLE(0,0,2,0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+  }
+
+static __m128i idctMul(int a, __m128i x) {
+  return _mm_srai_epi32(mul32(x,a),11);
+  }
+
+// same as idctTransform, for 4 independent lanes
+static void idctTransform(__m128i* v) {
+  enum {
+    A1 = 2896,
+    A2 = 2217,
+    A3 = 3784,
+    A4 = -5352
+    };
+  const __m128i a0 = _mm_add_epi32(v[0],v[4]);
+  const __m128i a1 = _mm_sub_epi32(v[0],v[4]);
+  const __m128i a2 = _mm_add_epi32(v[2],v[6]);
+  const __m128i a3 = idctMul(A1,_mm_sub_epi32(v[2],v[6]));
+  const __m128i a4 = _mm_add_epi32(v[5],v[3]);
+  const __m128i a5 = _mm_sub_epi32(v[5],v[3]);
+  const __m128i a6 = _mm_add_epi32(v[1],v[7]);
+  const __m128i a7 = _mm_sub_epi32(v[1],v[7]);
+  const __m128i b0 = _mm_add_epi32(a4,a6);
+  const __m128i b1 = idctMul(A3,_mm_add_epi32(a5,a7));
+  const __m128i b2 = _mm_add_epi32(_mm_sub_epi32(idctMul(A4,a5),b0),b1);
+  const __m128i b3 = _mm_sub_epi32(idctMul(A1,_mm_sub_epi32(a6,a4)),b2);
+  const __m128i b4 = _mm_sub_epi32(_mm_add_epi32(idctMul(A2,a7),b3),b1);
+
+  const __m128i p02 = _mm_add_epi32(a0,a2), m02 = _mm_sub_epi32(a0,a2);
+  const __m128i p13 = _mm_sub_epi32(_mm_add_epi32(a1,a3),a2);
+  const __m128i m13 = _mm_add_epi32(_mm_sub_epi32(a1,a3),a2);
+  v[0] = _mm_add_epi32(p02,b0);
+  v[1] = _mm_add_epi32(p13,b2);
+  v[2] = _mm_add_epi32(m13,b3);
+  v[3] = _mm_sub_epi32(m02,b4);
+  v[4] = _mm_add_epi32(m02,b4);
+  v[5] = _mm_sub_epi32(m13,b3);
+  v[6] = _mm_sub_epi32(p13,b2);
+  v[7] = _mm_sub_epi32(p02,b0);
+  }
+
+static void transpose4(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3) {
+  const __m128i t0 = _mm_unpacklo_epi32(r0,r1);
+  const __m128i t1 = _mm_unpacklo_epi32(r2,r3);
+  const __m128i t2 = _mm_unpackhi_epi32(r0,r1);
+  const __m128i t3 = _mm_unpackhi_epi32(r2,r3);
+  r0 = _mm_unpacklo_epi64(t0,t1);
+  r1 = _mm_unpackhi_epi64(t0,t1);
+  r2 = _mm_unpacklo_epi64(t2,t3);
+  r3 = _mm_unpackhi_epi64(t2,t3);
+  }
+#endif
+
+// 8x8 inverse DCT: columns, then rows with rounding; equal to bink_idct_col + idctRow
+static void idct8x8(const int32_t* in, int32_t* out) {
+#if defined(BINK_SSE2)
+  alignas(16) int32_t tmp[64];
+  for(int h=0; h<8; h+=4) {
+    __m128i v[8];
+    for(int k=0; k<8; ++k)
+      v[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in+8*k+h));
+    // dc-only shortcut of bink_idct_col gives same result as full transform
+    idctTransform(v);
+    for(int k=0; k<8; ++k)
+      _mm_store_si128(reinterpret_cast<__m128i*>(tmp+8*k+h),v[k]);
+    }
+
+  const __m128i round = _mm_set1_epi32(0x7F);
+  for(int h=0; h<8; h+=4) {
+    // 4 rows at once: transpose, so lane is a row
+    __m128i v[8];
+    for(int q=0; q<8; q+=4) {
+      for(int j=0; j<4; ++j)
+        v[q+j] = _mm_load_si128(reinterpret_cast<const __m128i*>(tmp+8*(h+j)+q));
+      transpose4(v[q+0],v[q+1],v[q+2],v[q+3]);
+      }
+    idctTransform(v);
+    for(int k=0; k<8; ++k)
+      v[k] = _mm_srai_epi32(_mm_add_epi32(v[k],round),8);
+    for(int q=0; q<8; q+=4) {
+      transpose4(v[q+0],v[q+1],v[q+2],v[q+3]);
+      for(int j=0; j<4; ++j)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out+8*(h+j)+q),v[q+j]);
+      }
+    }
+#else
+  int temp[64]={};
+  for(int i=0; i<8; i++)
+    bink_idct_col(&temp[i], &in[i]);
+  for(int i=0; i<8; i++)
+    idctRow(&out[i*8], &temp[8*i]);
+#endif
+  }
+
+// dst = v, wrapped to 8 bits
+static void storeBlock(uint8_t* dst, const int32_t* v) {
+#if defined(BINK_SSE2)
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  for(int i=0; i<64; i+=16) {
+    __m128i x0 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v+i+ 0)),mask);
+    __m128i x1 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v+i+ 4)),mask);
+    __m128i x2 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v+i+ 8)),mask);
+    __m128i x3 = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v+i+12)),mask);
+    __m128i lo = _mm_packs_epi32(x0,x1);
+    __m128i hi = _mm_packs_epi32(x2,x3);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i),_mm_packus_epi16(lo,hi));
+    }
+#else
+  for(int i=0; i<64; ++i)
+    dst[i] = uint8_t(v[i]);
+#endif
+  }
+
+// dst = prev + v, wrapped to 8 bits
+static void addBlock(uint8_t* dst, const uint8_t* prev, const int32_t* v) {
+#if defined(BINK_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  for(int i=0; i<64; i+=16) {
+    const __m128i p   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev+i));
+    const __m128i p16[2] = {_mm_unpacklo_epi8(p,zero), _mm_unpackhi_epi8(p,zero)};
+    __m128i x[4];
+    for(int j=0; j<4; ++j) {
+      const __m128i pj = (j%2)==0 ? _mm_unpacklo_epi16(p16[j/2],zero) : _mm_unpackhi_epi16(p16[j/2],zero);
+      const __m128i vj = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v+i+4*j));
+      x[j] = _mm_and_si128(_mm_add_epi32(pj,vj),mask);
+      }
+    __m128i lo = _mm_packs_epi32(x[0],x[1]);
+    __m128i hi = _mm_packs_epi32(x[2],x[3]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i),_mm_packus_epi16(lo,hi));
+    }
+#else
+  for(int i=0; i<64; ++i)
+    dst[i] = uint8_t(prev[i]+v[i]);
+#endif
+  }
 
 template<class T>
 static void BF(T& x, T& y, const T& a, const T& b) {
@@ -825,6 +982,68 @@ Video::AudioCtx::AudioCtx(uint16_t sampleRate, uint8_t channels, bool isDct)
   :sampleRate(sampleRate), channelsCnt(channels), isDct(isDct) {
   }
 
+// decodes chroma of a frame, while caller decodes luma; one thread for lifetime of video
+struct Video::ChromaThread final {
+  explicit ChromaThread(Video& owner):owner(owner), thr([this](){ loop(); }) {}
+  ~ChromaThread() {
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    stop = true;
+    }
+    cv.notify_all();
+    thr.join();
+    }
+
+  void start(BitStream& gb) {
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    job  = &gb;
+    err  = nullptr;
+    busy = true;
+    }
+    cv.notify_all();
+    }
+
+  // rethrows decoding error
+  void wait() {
+    std::unique_lock<std::mutex> guard(sync);
+    cv.wait(guard,[this](){ return !busy; });
+    if(err!=nullptr)
+      std::rethrow_exception(std::exchange(err,nullptr));
+    }
+
+  private:
+    void loop() {
+      std::unique_lock<std::mutex> guard(sync);
+      while(true) {
+        cv.wait(guard,[this](){ return busy || stop; });
+        if(stop)
+          return;
+        guard.unlock();
+        std::exception_ptr e;
+        try {
+          owner.decodeChroma(*job,owner.planeCtx[1]);
+          }
+        catch(...) {
+          e = std::current_exception();
+          }
+        guard.lock();
+        err  = e;
+        busy = false;
+        cv.notify_all();
+        }
+      }
+
+    Video&                  owner;
+    std::mutex              sync;
+    std::condition_variable cv;
+    BitStream*              job  = nullptr;
+    std::exception_ptr      err;
+    bool                    busy = false;
+    bool                    stop = false;
+    std::thread             thr;
+  };
+
 Video::Video(Input* file) : fin(file) {
   packet.reserve(4*1024*1024);
 
@@ -940,6 +1159,10 @@ const Frame& Video::nextFrame() {
   return f;
   }
 
+void Video::setPlaneSplit(bool enable) {
+  split = enable ? SPLIT_UNKNOWN : SPLIT_DISABLED;
+  }
+
 size_t Video::frameCount() const {
   return index.size();
   }
@@ -1069,12 +1292,15 @@ void Video::decodeInit() {
   for(auto& i:frames)
     i.setSize(width,height);
 
-  const int bw     = (width  + 7) >> 3;
-  const int bh     = (height + 7) >> 3;
-  const int blocks = bw * bh;
-  for(auto& b:bundle) {
-    b.data.resize(blocks * 64);
-    b.data_end = b.data.data() + blocks * 64;
+  const int blocks[2] = {
+    int((width + 7) >> 3) * int((height + 7) >> 3),
+    int((width + 15) >> 4) * int((height + 15) >> 4),
+    };
+  for(int i=0; i<2; ++i) {
+    for(auto& b:planeCtx[i].bundle) {
+      b.data.resize(blocks[i] * 64);
+      b.data_end = b.data.data() + blocks[i] * 64;
+      }
     }
 
 /*
@@ -1122,23 +1348,22 @@ uint8_t Video::getHuff(BitStream& gb, const Tree& tree) {
   return tree.syms[vlc];
   }
 
-void Video::initLengths(int width, int bw) {
+void Video::initLengths(PlaneCtx& ctx, int width, int bw) {
   width = ((width+7)/8)*8;
 
-  bundle[BINK_SRC_BLOCK_TYPES].len     = av_log2((width >> 3) + 511) + 1;
-  bundle[BINK_SRC_SUB_BLOCK_TYPES].len = av_log2((width >> 4) + 511) + 1;
-  bundle[BINK_SRC_COLORS].len          = av_log2(bw*64 + 511) + 1;
-  bundle[BINK_SRC_INTRA_DC].len =
-      bundle[BINK_SRC_INTER_DC].len =
-      bundle[BINK_SRC_X_OFF].len =
-      bundle[BINK_SRC_Y_OFF].len = av_log2((width >> 3) + 511) + 1;
+  ctx.bundle[BINK_SRC_BLOCK_TYPES].len     = av_log2((width >> 3) + 511) + 1;
+  ctx.bundle[BINK_SRC_SUB_BLOCK_TYPES].len = av_log2((width >> 4) + 511) + 1;
+  ctx.bundle[BINK_SRC_COLORS].len          = av_log2(bw*64 + 511) + 1;
+  ctx.bundle[BINK_SRC_INTRA_DC].len =
+      ctx.bundle[BINK_SRC_INTER_DC].len =
+      ctx.bundle[BINK_SRC_X_OFF].len =
+      ctx.bundle[BINK_SRC_Y_OFF].len = av_log2((width >> 3) + 511) + 1;
 
-  bundle[BINK_SRC_PATTERN].len = av_log2((bw << 3) + 511) + 1;
-  bundle[BINK_SRC_RUN].len     = av_log2(bw*48 + 511) + 1;
+  ctx.bundle[BINK_SRC_PATTERN].len = av_log2((bw << 3) + 511) + 1;
+  ctx.bundle[BINK_SRC_RUN].len     = av_log2(bw*48 + 511) + 1;
   }
 
 void Video::parseFrame(const std::vector<uint8_t>& data) {
-  const bool   swap_planes = (revision >= 'h');
   const size_t bits_count  = data.size()<<3;
 
   BitStream gb(data.data(),bits_count);
@@ -1146,27 +1371,85 @@ void Video::parseFrame(const std::vector<uint8_t>& data) {
   if((flags&BINK_FLAG_ALPHA) == BINK_FLAG_ALPHA) {
     if(revision >= 'i')
       gb.skip(32);
-    decodePlane(gb,3,false);
+    decodePlane(gb,planeCtx[0],3,false);
     }
-  if(revision >= 'i')
-    gb.skip(32);
 
-  for(int plane=0; plane<3; plane++) {
-    const int planeId = (!plane || !swap_planes) ? plane : (plane ^ 3);
+  if(revision<='b') {
+    //decodePlaneB(gb, planeId, frameCounter==0, plane!=0);
+    throw std::runtime_error("not implemented");
+    }
 
-    if(revision>'b') {
-      decodePlane(gb, planeId, plane!=0);
-      } else {
-      //decodePlaneB(gb, planeId, frameCounter==0, plane!=0);
-      throw std::runtime_error("not implemented");
+  uint32_t offset = 0;
+  if(revision >= 'i') {
+    offset  = gb.getBits(16);
+    offset |= gb.getBits(16) << 16;
+    }
+
+  const int64_t chromaAt = int64_t(offset)*8 + splitBias;
+  if(split==SPLIT_ENABLED && chromaAt>int64_t(gb.position()) && chromaAt<int64_t(bits_count)) {
+    // luma on this thread, chroma concurrently
+    BitStream gc(data.data(),bits_count);
+    gc.skip(size_t(chromaAt));
+    if(chromaThr==nullptr)
+      chromaThr.reset(new ChromaThread(*this));
+    chromaThr->start(gc);
+
+    // chroma must be complete before gc goes out of scope, even if luma has failed
+    try {
+      decodePlane(gb,planeCtx[0],0,false);
+      }
+    catch(...) {
+      try { chromaThr->wait(); } catch(...) {}
+      throw;
+      }
+    if(int64_t(gb.position())==chromaAt) {
+      chromaThr->wait();
+      return;
+      }
+    // offset is not what it was on first frames
+    try {
+      chromaThr->wait();
+      }
+    catch(...) {
+      }
+    split = SPLIT_DISABLED;
+    if(gb.position()<bits_count)
+      decodeChroma(gb,planeCtx[0]);
+    return;
+    }
+
+  decodePlane(gb,planeCtx[0],0,false);
+  if(revision>='i' && (split==SPLIT_UNKNOWN || split==SPLIT_PROBE)) {
+    // same relation on two frames in a row, with different size of luma
+    const int64_t bias = int64_t(gb.position()) - int64_t(offset)*8;
+    if(bias<0 || (split==SPLIT_PROBE && bias!=splitBias)) {
+      split = SPLIT_DISABLED;
+      }
+    else if(split==SPLIT_UNKNOWN) {
+      split       = SPLIT_PROBE;
+      splitBias   = bias;
+      splitProbe  = gb.position();
+      }
+    else if(gb.position()!=splitProbe) {
+      split       = SPLIT_ENABLED;
       }
+    }
+  if(gb.position()<bits_count)
+    decodeChroma(gb,planeCtx[0]);
+  }
 
+void Video::decodeChroma(BitStream& gb, PlaneCtx& ctx) {
+  const bool   swap_planes = (revision >= 'h');
+  const size_t bits_count  = gb.bitCount;
+  for(int plane=1; plane<3; plane++) {
+    const int planeId = !swap_planes ? plane : (plane ^ 3);
+    decodePlane(gb, ctx, planeId, true);
     if(gb.position()>=bits_count)
       break;
     }
   }
 
-void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
+void Video::decodePlane(BitStream& gb, PlaneCtx& ctx, int planeId, bool chroma) {
   const int bw     = chroma ? (this->width  + 15) >> 4 : (this->width  + 7) >> 3;
   const int bh     = chroma ? (this->height + 15) >> 4 : (this->height + 7) >> 3;
   const int width  = this->width  >> (chroma ? 1 : 0);
@@ -1182,24 +1465,24 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
     return;
     }
 
-  initLengths(std::max(width,8),bw);
+  initLengths(ctx,std::max(width,8),bw);
   for(int i=0; i<BINK_NB_SRC; i++)
-    readBundle(gb,i);
+    readBundle(gb,ctx,i);
 
   uint8_t dst[8*8] = {};
   for(int by = 0; by < bh; by++) {
-    readBlockTypes  (gb,bundle[BINK_SRC_BLOCK_TYPES]);
-    readBlockTypes  (gb,bundle[BINK_SRC_SUB_BLOCK_TYPES]);
-    readColors      (gb,bundle[BINK_SRC_COLORS]);
-    readPatterns    (gb,bundle[BINK_SRC_PATTERN]);
-    readMotionValues(gb,bundle[BINK_SRC_X_OFF]);
-    readMotionValues(gb,bundle[BINK_SRC_Y_OFF]);
-    readDcs         (gb,bundle[BINK_SRC_INTRA_DC], DC_START_BITS, 0);
-    readDcs         (gb,bundle[BINK_SRC_INTER_DC], DC_START_BITS, 1);
-    readRuns        (gb,bundle[BINK_SRC_RUN]);
+    readBlockTypes  (gb,ctx.bundle[BINK_SRC_BLOCK_TYPES]);
+    readBlockTypes  (gb,ctx.bundle[BINK_SRC_SUB_BLOCK_TYPES]);
+    readColors      (gb,ctx,ctx.bundle[BINK_SRC_COLORS]);
+    readPatterns    (gb,ctx.bundle[BINK_SRC_PATTERN]);
+    readMotionValues(gb,ctx.bundle[BINK_SRC_X_OFF]);
+    readMotionValues(gb,ctx.bundle[BINK_SRC_Y_OFF]);
+    readDcs         (gb,ctx.bundle[BINK_SRC_INTRA_DC], DC_START_BITS, 0);
+    readDcs         (gb,ctx.bundle[BINK_SRC_INTER_DC], DC_START_BITS, 1);
+    readRuns        (gb,ctx.bundle[BINK_SRC_RUN]);
 
     for(int bx=0; bx<bw; ++bx) {
-      BlockTypes blk = BlockTypes(getValue(BINK_SRC_BLOCK_TYPES));
+      BlockTypes blk = BlockTypes(getValue(ctx,BINK_SRC_BLOCK_TYPES));
       // 16x16 block type on odd line means part of the already decoded block, so skip it
       if((by & 1) && blk == SCALED_BLOCK) {
         bx++;
@@ -1208,7 +1491,7 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
 
       bool isScaled = false;
       if(blk==SCALED_BLOCK){
-        blk = BlockTypes(getValue(BINK_SRC_SUB_BLOCK_TYPES));
+        blk = BlockTypes(getValue(ctx,BINK_SRC_SUB_BLOCK_TYPES));
         isScaled = true;
         }
 
@@ -1219,14 +1502,14 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
           last.getBlock8x8(bx,by,dst);
           break;
         case FILL_BLOCK:    {
-          const uint8_t v = uint8_t(getValue(BINK_SRC_COLORS));
+          const uint8_t v = uint8_t(getValue(ctx,BINK_SRC_COLORS));
           std::memset(dst,v,sizeof(dst));
           break;
           }
         case RESIDUE_BLOCK: {
           uint8_t prev[8*8] = {};
-          const int xoff = getValue(BINK_SRC_X_OFF);
-          const int yoff = getValue(BINK_SRC_Y_OFF);
+          const int xoff = getValue(ctx,BINK_SRC_X_OFF);
+          const int yoff = getValue(ctx,BINK_SRC_Y_OFF);
           last.getPixels8x8(bx*8+xoff, by*8+yoff, prev);
 
           int16_t block[64] = {};
@@ -1238,81 +1521,75 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
           }
         case INTRA_BLOCK:   {
           int32_t dctblock[64] = {};
-          dctblock[0] = getValue(BINK_SRC_INTRA_DC);
+          dctblock[0] = getValue(ctx,BINK_SRC_INTRA_DC);
           int coef_count=0, coef_idx[64]={};
           int quant_idx = readDctCoeffs(gb, dctblock, bink_scan, coef_count, coef_idx, -1);
           unquantizeDctCoeffs(dctblock, bink_intra_quant[quant_idx], coef_count, coef_idx, bink_scan);
-          int temp[64]={};
-          for(int i=0; i<8; i++)
-            bink_idct_col(&temp[i], &dctblock[i]);
-          for(int i=0; i<8; i++)
-            idctRow(&dst[i*8], &temp[8*i]);
+          int32_t res[64];
+          idct8x8(dctblock,res);
+          storeBlock(dst,res);
           break;
           }
         case INTER_BLOCK:   {
           uint8_t prev[8*8] = {};
-          const int xoff = getValue(BINK_SRC_X_OFF);
-          const int yoff = getValue(BINK_SRC_Y_OFF);
+          const int xoff = getValue(ctx,BINK_SRC_X_OFF);
+          const int yoff = getValue(ctx,BINK_SRC_Y_OFF);
           last.getPixels8x8(bx*8+xoff, by*8+yoff, prev);
 
           int32_t dctblock[64] = {};
-          dctblock[0] = getValue(BINK_SRC_INTER_DC);
+          dctblock[0] = getValue(ctx,BINK_SRC_INTER_DC);
           int coef_count=0, coef_idx[64]={};
           int quant_idx = readDctCoeffs(gb, dctblock, bink_scan, coef_count, coef_idx, -1);
           unquantizeDctCoeffs(dctblock, bink_inter_quant[quant_idx], coef_count, coef_idx, bink_scan);
 
-          int temp[64]={};
-          for(int i=0; i<8; i++)
-            bink_idct_col(&temp[i], &dctblock[i]);
-          for(int i = 0; i < 8; i++)
-            idctRow(&dctblock[i*8], &temp[8*i]);
-          for(int i=0; i<64; ++i)
-            dst[i] = uint8_t(prev[i]+dctblock[i]);
+          int32_t res[64];
+          idct8x8(dctblock,res);
+          addBlock(dst,prev,res);
           break;
           }
         case RUN_BLOCK:     {
           const uint8_t* scan = bink_patterns[gb.getBits(4)];
           int i = 0;
           do {
-            const int run = getValue(BINK_SRC_RUN) + 1;
+            const int run = getValue(ctx,BINK_SRC_RUN) + 1;
             i += run;
             if(i > 64)
               throw VideoDecodingException("Run went out of bounds");
             if(gb.getBit()) {
-              int v = getValue(BINK_SRC_COLORS);
+              int v = getValue(ctx,BINK_SRC_COLORS);
               for(int j = 0; j < run; j++)
                 dst[*scan++] = uint8_t(v);
               } else {
               for(int j = 0; j < run; j++)
-                dst[*scan++] = uint8_t(getValue(BINK_SRC_COLORS));
+                dst[*scan++] = uint8_t(getValue(ctx,BINK_SRC_COLORS));
               }
             } while (i < 63);
           if(i == 63)
-            dst[*scan++] = uint8_t(getValue(BINK_SRC_COLORS));
+            dst[*scan++] = uint8_t(getValue(ctx,BINK_SRC_COLORS));
           break;
           }
         case MOTION_BLOCK:  {
           if(isScaled)
             throw VideoDecodingException("unsupported type of superblock");
-          const int xoff = getValue(BINK_SRC_X_OFF);
-          const int yoff = getValue(BINK_SRC_Y_OFF);
+          const int xoff = getValue(ctx,BINK_SRC_X_OFF);
+          const int yoff = getValue(ctx,BINK_SRC_Y_OFF);
           last.getPixels8x8(bx*8+xoff, by*8+yoff, dst);
           break;
           }
         case PATTERN_BLOCK: {
           uint8_t col[2] = {};
           for(int i=0; i<2; i++)
-            col[i] = uint8_t(getValue(BINK_SRC_COLORS));
+            col[i] = uint8_t(getValue(ctx,BINK_SRC_COLORS));
           for(int i=0; i<8; i++) {
-            int v = getValue(BINK_SRC_PATTERN);
+            int v = getValue(ctx,BINK_SRC_PATTERN);
             for(int j=0; j<8; j++, v >>= 1)
               dst[i*8+j] = col[v & 1];
             }
           break;
           }
         case RAW_BLOCK:     {
-          std::memcpy(dst,bundle[BINK_SRC_COLORS].cur_ptr,64);
-          bundle[BINK_SRC_COLORS].cur_ptr += 64;
+          std::memcpy(dst,ctx.bundle[BINK_SRC_COLORS].cur_ptr,64);
+          ctx.bundle[BINK_SRC_COLORS].cur_ptr += 64;
           break;
           }
         default:
@@ -1332,18 +1609,18 @@ void Video::decodePlane(BitStream& gb, int planeId, bool chroma) {
   gb.align32();
   }
 
-void Video::readBundle(BitStream& gb, int bundle_num) {
+void Video::readBundle(BitStream& gb, PlaneCtx& ctx, int bundle_num) {
   if(bundle_num == BINK_SRC_COLORS) {
     for(int i=0; i<16; i++)
-      readTree(gb, col_high[i]);
-    col_lastval = 0;
+      readTree(gb, ctx.col_high[i]);
+    ctx.col_lastval = 0;
     }
 
   if(bundle_num != BINK_SRC_INTRA_DC && bundle_num != BINK_SRC_INTER_DC)
-    readTree(gb, bundle[bundle_num].tree);
+    readTree(gb, ctx.bundle[bundle_num].tree);
 
-  bundle[bundle_num].cur_dec =
-      bundle[bundle_num].cur_ptr = bundle[bundle_num].data.data();
+  ctx.bundle[bundle_num].cur_dec =
+      ctx.bundle[bundle_num].cur_ptr = ctx.bundle[bundle_num].data.data();
   }
 
 void Video::readTree(BitStream& gb, Tree& tree) {
@@ -1433,7 +1710,7 @@ void Video::readBlockTypes(BitStream& gb, Bundle& b) {
     }
   }
 
-void Video::readColors(BitStream& gb, Bundle& b) {
+void Video::readColors(BitStream& gb, PlaneCtx& ctx, Bundle& b) {
   int t=0, sign=0, v=0;
   const uint8_t *dec_end = nullptr;
 
@@ -1445,9 +1722,9 @@ void Video::readColors(BitStream& gb, Bundle& b) {
     throw VideoDecodingException("Too many color values");
 
   if(gb.getBit()) {
-    col_lastval = getHuff(gb, col_high[col_lastval]);
+    ctx.col_lastval = getHuff(gb, ctx.col_high[ctx.col_lastval]);
     v = getHuff(gb, b.tree);
-    v = (col_lastval << 4) | v;
+    v = (ctx.col_lastval << 4) | v;
     if(revision<'i') {
       sign = ((int8_t) v) >> 7;
       v = ((v & 0x7F) ^ sign) - sign;
@@ -1457,9 +1734,9 @@ void Video::readColors(BitStream& gb, Bundle& b) {
     b.cur_dec += t;
     } else {
     while(b.cur_dec<dec_end) {
-      col_lastval = getHuff(gb, col_high[col_lastval]);
+      ctx.col_lastval = getHuff(gb, ctx.col_high[ctx.col_lastval]);
       v = getHuff(gb, b.tree);
-      v = (col_lastval << 4) | v;
+      v = (ctx.col_lastval << 4) | v;
       if(revision<'i') {
         sign = ((int8_t) v) >> 7;
         v = ((v & 0x7F) ^ sign) - sign;
@@ -1581,7 +1858,8 @@ void Video::readRuns(BitStream& gb, Bundle& b) {
     }
   }
 
-int Video::getValue(Sources b) {
+int Video::getValue(PlaneCtx& ctx, Sources b) {
+  auto& bundle = ctx.bundle;
   if(b<BINK_SRC_X_OFF || b==BINK_SRC_RUN)
     return *bundle[int(b)].cur_ptr++;
   if(b==BINK_SRC_X_OFF || b==BINK_SRC_Y_OFF)
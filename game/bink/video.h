@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -59,6 +60,10 @@ class Video final {
 
     const FrameRate& fps() const { return fRate; }
 
+    // luma and chroma planes are decoded concurrently, once bitstream layout is learned; enabled by default
+    void         setPlaneSplit(bool enable);
+    bool         isPlaneSplit() const { return split==SPLIT_ENABLED; }
+
     size_t       audioCount()     const { return aud.size(); }
     const Audio& audio(uint8_t i) const { return audProp[i]; }
 
@@ -137,6 +142,22 @@ class Video final {
       uint8_t*             cur_ptr  = nullptr; // pointer to the data that is not read from buffer yet
       };
 
+    // bitstream state of a plane decoder; luma and chroma have own one, to be decoded concurrently
+    struct PlaneCtx final {
+      Bundle               bundle[BINK_NB_SRC] = {};
+      Tree                 col_high[16];         // trees for decoding high nibble in "colours" data type
+      int                  col_lastval = 0;      // value of last decoded high nibble in "colours" data type
+      };
+
+    // since revision 'i' frame has offset of chroma planes; relation between offset and bit position is
+    // learned on first frames, then luma and chroma are decoded in parallel
+    enum PlaneSplit : uint8_t {
+      SPLIT_UNKNOWN,
+      SPLIT_PROBE,
+      SPLIT_ENABLED,
+      SPLIT_DISABLED,
+      };
+
     struct AudioCtx final {
       AudioCtx(uint16_t sampleRate, uint8_t channelsCnt, bool isDct);
 
@@ -167,6 +188,7 @@ class Video final {
       };
 
     struct BitStream;
+    struct ChromaThread;
 
     uint32_t rl32();
     uint16_t rl16();
@@ -180,13 +202,14 @@ class Video final {
     int      getVlc2(BitStream& gb, int16_t (*table)[2], int bits, int max_depth);
     void     readPacket();
     void     parseFrame(const std::vector<uint8_t>& data);
-    void     decodePlane(BitStream& gb, int planeId, bool chroma);
-    void     initLengths(int width, int bw);
-    void     readBundle(BitStream& gb, int bundle_num);
+    void     decodeChroma(BitStream& gb, PlaneCtx& ctx);
+    void     decodePlane(BitStream& gb, PlaneCtx& ctx, int planeId, bool chroma);
+    void     initLengths(PlaneCtx& ctx, int width, int bw);
+    void     readBundle(BitStream& gb, PlaneCtx& ctx, int bundle_num);
     void     readTree(BitStream& gb, Tree& tree);
 
     void     readBlockTypes  (BitStream& gb, Bundle& b);
-    void     readColors      (BitStream& gb, Bundle& b);
+    void     readColors      (BitStream& gb, PlaneCtx& ctx, Bundle& b);
     void     readPatterns    (BitStream& gb, Bundle& b);
     void     readMotionValues(BitStream& gb, Bundle& b);
     void     readDcs         (BitStream& gb, Bundle& b, int start_bits, int has_sign);
@@ -196,7 +219,7 @@ class Video final {
     void     unquantizeDctCoeffs(int32_t block[], const uint32_t quant[],
                                  int coef_count, int coef_idx[], const uint8_t* scan);
     void     readResidue     (BitStream& gb, int16_t block[], int masks_count);
-    int      getValue(Sources bundle);
+    int      getValue(PlaneCtx& ctx, Sources bundle);
     template<class T>
     static bool checkReadVal(BitStream& gb, Bundle& b, T& t);
 
@@ -228,9 +251,11 @@ class Video final {
     uint32_t                frameCounter = 0;
 
     // video
-    Bundle                  bundle[BINK_NB_SRC] = {};
-    Tree                    col_high[16];         // trees for decoding high nibble in "colours" data type
-    int                     col_lastval = 0;      // value of last decoded high nibble in "colours" data type
+    PlaneCtx                planeCtx[2];          // luma and alpha, chroma
+    PlaneSplit              split      = SPLIT_UNKNOWN;
+    int64_t                 splitBias  = 0;       // chroma bit position minus 8*offset
+    size_t                  splitProbe = 0;       // chroma bit position on first probed frame
+    std::unique_ptr<ChromaThread> chromaThr;      // persistent, started on first split frame
 
     // sound
     float                   quantTable[96] = {};
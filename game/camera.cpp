@@ -792,7 +792,7 @@ Vec3 Camera::calcCameraColision(const Vec3& target, const Vec3& origin, const Ve
 
   //static float minDist = 20;
   static float padding = 50;
-  static int n = 1, nn=1;
+  static const int n = 1, nn=1;
 
   Matrix4x4 vinv=projective();
   vinv.mul(mkView(origin,rotSpin));
@@ -801,28 +801,38 @@ Vec3 Camera::calcCameraColision(const Vec3& target, const Vec3& origin, const Ve
   auto& physic = *world->physic();
   auto  dview  = (origin - target);
 
-  raysCasted = 0;
-  float distM = dist;
+  DynamicWorld::RaySegment    rays[(2*n+1)*(2*n+1)];
+  DynamicWorld::RayLandResult hits[(2*n+1)*(2*n+1)];
+
+  size_t count = 0;
   for(int i=-n;i<=n;++i)
     for(int r=-n;r<=n;++r) {
-      raysCasted++;
       float u = float(i)/float(nn),v = float(r)/float(nn);
       Tempest::Vec3 r1 = {u,v,depthNear};
       vinv.project(r1);
       auto dr = (r1 - target);
       dr = dr * (dist+padding) / (dr.length()+0.00001f);
 
-      auto rc = physic.ray(target, target+dr);
-      if(!rc.hasCol)
-        continue;
+      rays[count].from = target;
+      rays[count].to   = target+dr;
+      count++;
+      }
+  physic.rayBatch(std::span(rays,count),std::span(hits,count));
+  raysCasted = int(count);
 
-      auto  tr    = (rc.v - target);
-      float dist1 = Vec3::dotProduct(dview,tr)/dist;
+  float distM = dist;
+  for(size_t i=0; i<count; ++i) {
+    auto& rc = hits[i];
+    if(!rc.hasCol)
+      continue;
 
-      dist1 = std::max<float>(dist1-padding, 0);
-      if(dist1<distM)
-        distM = dist1;
-      }
+    auto  tr    = (rc.v - target);
+    float dist1 = Vec3::dotProduct(dview,tr)/dist;
+
+    dist1 = std::max<float>(dist1-padding, 0);
+    if(dist1<distM)
+      distM = dist1;
+    }
 
   auto  dp = Vec3::normalize(origin-target)*distM;
   static float dd = 100.f;
@@ -88,6 +88,38 @@ CommandLine::CommandLine(int argc, const char** argv) {
     else if(arg=="-g2") {
       forceG2NR = true;
       }
+    else if(arg=="-prebuild-cache") {
+      prebuildCache = true;
+      }
+    else if(arg=="-headless") {
+      headless = true;
+      }
+    else if(arg=="-frames") {
+      ++i;
+      if(i<argc) {
+        try {
+          numFrames = uint32_t(std::stoul(std::string(argv[i])));
+          }
+        catch (const std::exception&) {
+          Log::i("failed to read frame count: \"", std::string(argv[i]), "\"");
+          }
+        }
+      }
+    else if(arg=="-bench") {
+      ++i;
+      if(i<argc)
+        benchCmd.emplace_back(argv[i]);
+      }
+    else if(arg=="-record") {
+      ++i;
+      if(i<argc)
+        demoRecord = argv[i];
+      }
+    else if(arg=="-timedemo") {
+      ++i;
+      if(i<argc)
+        demoReplay = argv[i];
+      }
     else if(arg=="-dx12") {
       graphics = GraphicBackend::DirectX12;
       }
@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "game/constants.h"
 
@@ -44,6 +45,12 @@ class CommandLine {
     bool                doForceG1()        const { return forceG1;      }
     bool                doForceG2()        const { return forceG2;      }
     bool                doForceG2NR()      const { return forceG2NR;    }
+    bool                doPrebuildCache()  const { return prebuildCache; }
+    bool                isHeadless()       const { return headless;     }
+    uint32_t            headlessFrames()   const { return numFrames;    }
+    auto                headlessBench()    const -> const std::vector<std::string>& { return benchCmd; }
+    std::string_view    recordDemo()       const { return demoRecord;   }
+    std::string_view    replayDemo()       const { return demoReplay;   }
     bool                aaPreset()         const { return aaPresetId;   }
     std::string_view    defaultSave()      const { return saveDef;    }
 
@@ -57,6 +64,9 @@ class CommandLine {
     std::u16string      gscript;
     std::u16string      gcutscene;
     std::string         saveDef;
+    std::string         demoRecord;
+    std::string         demoReplay;
+    std::vector<std::string> benchCmd;
     bool                devmode      = false;
     bool                noMenu       = false;
     bool                isWindow     = false;
@@ -74,6 +84,9 @@ class CommandLine {
     bool                forceG1      = false;
     bool                forceG2      = false;
     bool                forceG2NR    = false;
+    bool                prebuildCache = false;
+    bool                headless      = false;
+    uint32_t            numFrames     = 1000;
     uint32_t            aaPresetId = 0;
   };
 
@@ -321,6 +321,18 @@ void Hydra::setOutput(tsf* f, int samplerate, float gain) {
   tsf_set_output(f, TSF_STEREO_INTERLEAVED, samplerate, gain);
   }
 
+void Hydra::reserveVoices(tsf* f, int num) {
+  if(num<=f->voiceNum)
+    return;
+  auto v = reinterpret_cast<tsf_voice*>(TSF_REALLOC(f->voices, size_t(num)*sizeof(tsf_voice)));
+  if(v==nullptr)
+    return;
+  for(int i=f->voiceNum; i<num; ++i)
+    v[i].playingPreset = -1;
+  f->voices   = v;
+  f->voiceNum = num;
+  }
+
 tsf *Hydra::toTsf() {
   tsf_hydra hydra={};
   toTsf(hydra);
@@ -70,6 +70,8 @@ class Hydra {
     static void renderFloat(tsf* f, float* buffer, int samples, int flag);
     static int  channelSetPan(tsf* f, int channel, float pan);
     static void setOutput(tsf* f, int samplerate, float gain);
+    // preallocates idle voices, so note-on doesn't realloc voice array; array still grows, if more voices are needed
+    static void reserveVoices(tsf* f, int num);
 
     tsf* toTsf   ();
     void toTsf   (tsf_hydra& out);
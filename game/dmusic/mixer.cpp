@@ -4,9 +4,15 @@
 #include <Tempest/SoundEffect>
 #include <Tempest/Sound>
 #include <Tempest/Log>
+#include <algorithm>
 #include <cmath>
 #include <set>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define DX8_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #include "soundfont.h"
 #include "wave.h"
 
@@ -17,12 +23,125 @@ static int64_t toSamples(uint64_t time) {
   return int64_t(time*SoundFont::SampleRate)/1000;
   }
 
+// dst += src*gain, over interleaved stereo samples
+static void mixConst(float* dst, const float* src, float gain, size_t cnt2) {
+  size_t i = 0;
+#if defined(DX8_SSE2)
+  const __m128 g = _mm_set1_ps(gain);
+  for(; i+8<=cnt2; i+=8) {
+    __m128 a = _mm_add_ps(_mm_loadu_ps(dst+i  ),_mm_mul_ps(_mm_loadu_ps(src+i  ),g));
+    __m128 b = _mm_add_ps(_mm_loadu_ps(dst+i+4),_mm_mul_ps(_mm_loadu_ps(src+i+4),g));
+    _mm_storeu_ps(dst+i,  a);
+    _mm_storeu_ps(dst+i+4,b);
+    }
+#endif
+  for(; i<cnt2; ++i)
+    dst[i] += src[i]*gain;
+  }
+
+// dst += src*gain*vol^2, vol is per stereo frame
+static void mixCurve(float* dst, const float* src, const float* vol, float gain, size_t cnt) {
+  size_t i = 0;
+#if defined(DX8_SSE2)
+  const __m128 g = _mm_set1_ps(gain);
+  for(; i+4<=cnt; i+=4) {
+    __m128 v  = _mm_loadu_ps(vol+i);
+    __m128 k  = _mm_mul_ps(_mm_mul_ps(v,v),g);
+    __m128 k0 = _mm_unpacklo_ps(k,k);
+    __m128 k1 = _mm_unpackhi_ps(k,k);
+    __m128 a  = _mm_add_ps(_mm_loadu_ps(dst+i*2  ),_mm_mul_ps(_mm_loadu_ps(src+i*2  ),k0));
+    __m128 b  = _mm_add_ps(_mm_loadu_ps(dst+i*2+4),_mm_mul_ps(_mm_loadu_ps(src+i*2+4),k1));
+    _mm_storeu_ps(dst+i*2,  a);
+    _mm_storeu_ps(dst+i*2+4,b);
+    }
+#endif
+  for(; i<cnt; ++i) {
+    const float k = vol[i]*vol[i]*gain;
+    dst[i*2  ] += src[i*2  ]*k;
+    dst[i*2+1] += src[i*2+1]*k;
+    }
+  }
+
+// out = saturate(src*volume), truncated toward zero
+static void toPcm16(int16_t* out, const float* src, float volume, size_t cnt2) {
+  const float k = volume*32767.5f;
+  size_t      i = 0;
+#if defined(DX8_SSE2)
+  const __m128 vk = _mm_set1_ps(k);
+  const __m128 lo = _mm_set1_ps(-32768.f);
+  const __m128 hi = _mm_set1_ps( 32767.f);
+  for(; i+8<=cnt2; i+=8) {
+    // clamp in float: cvtt turns out of range values into INT_MIN
+    __m128  a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src+i  ),vk),lo),hi);
+    __m128  b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src+i+4),vk),lo),hi);
+    __m128i r = _mm_packs_epi32(_mm_cvttps_epi32(a),_mm_cvttps_epi32(b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out+i),r);
+    }
+#endif
+  for(; i<cnt2; ++i) {
+    const float v = std::min(std::max(src[i]*k,-32768.f),32767.f);
+    out[i] = int16_t(v);
+    }
+  }
+
+// v[i] = startV + shape((i-s)/range)*(endV-startV), for i in [begin,end)
+static void fillCurve(float* v, size_t begin, size_t end, float s, float range, float startV, float endV, Shape shape) {
+  if(end<=begin)
+    return;
+  const float diffV = endV-startV;
+  size_t      i     = begin;
+  switch(shape) {
+    case DMUS_CURVES_INSTANT:
+      std::fill(v+begin,v+end,endV);
+      return;
+    case DMUS_CURVES_SINE:
+      for(; i<end; ++i) {
+        float linear = (float(i)-s)/range;
+        float val    = std::sin(float(M_PI)*linear*0.5f);
+        v[i] = val*diffV+startV;
+        }
+      return;
+    case DMUS_CURVES_LINEAR:
+    case DMUS_CURVES_EXP:
+    case DMUS_CURVES_LOG:
+      break;
+    default:
+      return;
+    }
+
+#if defined(DX8_SSE2)
+  const __m128 vs    = _mm_set1_ps(s);
+  const __m128 vr    = _mm_set1_ps(range);
+  const __m128 vd    = _mm_set1_ps(diffV);
+  const __m128 vb    = _mm_set1_ps(startV);
+  const __m128 step  = _mm_set1_ps(4.f);
+  __m128       index = _mm_add_ps(_mm_set1_ps(float(begin)),_mm_setr_ps(0,1,2,3));
+  for(; i+4<=end; i+=4) {
+    __m128 val = _mm_div_ps(_mm_sub_ps(index,vs),vr);
+    if(shape==DMUS_CURVES_EXP)
+      val = _mm_mul_ps(val,val); else
+    if(shape==DMUS_CURVES_LOG)
+      val = _mm_sqrt_ps(val);
+    _mm_storeu_ps(v+i,_mm_add_ps(_mm_mul_ps(val,vd),vb));
+    index = _mm_add_ps(index,step);
+    }
+#endif
+  for(; i<end; ++i) {
+    float val = (float(i)-s)/range;
+    if(shape==DMUS_CURVES_EXP)
+      val = val*val; else
+    if(shape==DMUS_CURVES_LOG)
+      val = std::sqrt(val);
+    v[i] = val*diffV+startV;
+    }
+  }
+
 Mixer::Mixer() {
   const size_t reserve=2048;
   pcm.reserve(reserve*2);
   pcmMix.reserve(reserve*2);
   vol.reserve(reserve);
-  // uniqInstr.reserve(32);
+  uniqInstr.reserve(32);
   }
 
 Mixer::~Mixer() {
@@ -88,25 +207,21 @@ void Mixer::noteOn(std::shared_ptr<PatternInternal>& pattern, PatternList::Note
   Active a;
   a.at      = sampleCursor + toSamples(r->duration);
   a.ticket  = r->inst->font.noteOn(r->note,r->velosity);
+  a.inst    = r->inst;
   if(a.ticket==nullptr)
     return;
+  active.push_back(a);
 
-  for(auto& i:uniqInstr)
-    if(i.ptr==r->inst) {
-      a.parent = &i;
-      a.parent->counter++;
-      active.push_back(a);
-      return;
-      }
+  if(auto i = findInstr(r->inst)) {
+    i->counter++;
+    return;
+    }
   Instr u;
   u.ptr     = r->inst;
+  u.gain    = r->inst->volume*r->inst->volume;
+  u.counter = 1;
   u.pattern = pattern;
-  uniqInstr.push_back(u);
-
-  a.parent = &uniqInstr.back();
-  a.parent->counter++;
-
-  active.push_back(a);
+  uniqInstr.push_back(std::move(u));
   }
 
 void Mixer::noteOn(std::shared_ptr<PatternInternal>& pattern, int64_t time) {
@@ -132,12 +247,20 @@ void Mixer::noteOff(int64_t time) {
       sz++;
       } else {
       SoundFont::noteOff(active[i].ticket);
-      active[i].parent->counter--;
+      if(auto ins = findInstr(active[i].inst))
+        ins->counter--;
       }
     }
   active.resize(sz);
   }
 
+Mixer::Instr* Mixer::findInstr(const PatternList::InsInternal* ins) {
+  for(auto& i:uniqInstr)
+    if(i.ptr==ins)
+      return &i;
+  return nullptr;
+  }
+
 void Mixer::nextPattern() {
   auto mus = current;
   if(mus->pptn.size()==0) {
@@ -299,9 +422,9 @@ void Mixer::mix(int16_t *out, size_t samples) {
       }
     }
 
-  uniqInstr.remove_if([](Instr& i){
+  uniqInstr.erase(std::remove_if(uniqInstr.begin(),uniqInstr.end(),[](const Instr& i){
     return i.counter==0 && !i.ptr->font.hasNotes();
-    });
+    }),uniqInstr.end());
   }
 
 void Mixer::setVolume(float v) {
@@ -324,30 +447,16 @@ void Mixer::implMix(PatternInternal &pptn, float volume, int16_t *out, size_t cn
     std::memset(pcm.data(),0,cnt2*sizeof(pcm[0]));
     ins.font.mix(pcm.data(),cnt);
 
-    float insVolume = std::pow(ins.volume,2.f);
-    if(ins.key==5 || ins.key==6) {
-      // HACK
-      // insVolume*=0.10f;
-      }
     const bool hasVol = hasVolumeCurves(pptn,i);
     if(hasVol) {
       volFromCurve(pptn,i,vol);
-      for(size_t r=0;r<cnt2;++r) {
-        float v = vol[r/2];
-        pcmMix[r] += pcm[r]*insVolume*(v*v);
-        }
+      mixCurve(pcmMix.data(),pcm.data(),vol.data(),i.gain,cnt);
       } else {
-      for(size_t r=0;r<cnt2;++r) {
-        float v = i.volLast;
-        pcmMix[r] += pcm[r]*insVolume*(v*v);
-        }
+      mixConst(pcmMix.data(),pcm.data(),i.gain*i.volLast*i.volLast,cnt2);
       }
     }
 
-  for(size_t i=0;i<cnt2;++i) {
-    float v = pcmMix[i]*volume;
-    out[i] = (v < -1.00004566f ? int16_t(-32768) : (v > 1.00001514f ? int16_t(32767) : int16_t(v * 32767.5f)));
-    }
+  toPcm16(out,pcmMix.data(),volume,cnt2);
   }
 
 void Mixer::volFromCurve(PatternInternal &part,Instr& inst,std::vector<float> &v) {
@@ -372,47 +481,8 @@ void Mixer::volFromCurve(PatternInternal &part,Instr& inst,std::vector<float> &v
     const size_t begin = size_t(std::max<int64_t>(s,0));
     const size_t size  = std::min(size_t(e),v.size());
     const float  range = float(e-s);
-    const float  diffV = i.endV-i.startV;
-    const float  shift = i.startV;
-    const float  endV  = i.endV;
-
-    switch(i.shape) {
-      case DMUS_CURVES_LINEAR: {
-        for(size_t i=begin;i<size;++i) {
-          float val = (float(i)-float(s))/range;
-          v[i] = val*diffV+shift;
-          }
-        break;
-        }
-      case DMUS_CURVES_INSTANT: {
-        for(size_t i=begin;i<size;++i) {
-          v[i] = endV;
-          }
-        break;
-        }
-      case DMUS_CURVES_EXP: {
-        for(size_t i=begin;i<size;++i) {
-          float val = (float(i)-float(s))/range;
-          v[i] = std::pow(val,2.f)*diffV+shift;
-          }
-        break;
-        }
-      case DMUS_CURVES_LOG: {
-        for(size_t i=begin;i<size;++i) {
-          float val = (float(i)-float(s))/range;
-          v[i] = std::sqrt(val)*diffV+shift;
-          }
-        break;
-        }
-      case DMUS_CURVES_SINE: {
-        for(size_t i=begin;i<size;++i) {
-          float linear = (float(i)-float(s))/range;
-          float val    = std::sin(float(M_PI)*linear*0.5f);
-          v[i] = val*diffV+shift;
-          }
-        break;
-        }
-      }
+
+    fillCurve(v.data(),begin,size,float(s),range,i.startV,i.endV,i.shape);
     if(size>begin)
       base = v[size-1];
     }
@@ -7,7 +7,6 @@
 #include <cstdint>
 #include <thread>
 #include <atomic>
-#include <list>
 
 #include "patternlist.h"
 #include "music.h"
@@ -30,9 +29,9 @@ class Mixer final {
     struct Instr;
 
     struct Active {
-      int64_t           at=0;
-      SoundFont::Ticket ticket;
-      Instr*            parent=nullptr;
+      int64_t                   at=0;
+      SoundFont::Ticket         ticket;
+      PatternList::InsInternal* inst=nullptr;
       };
 
     struct Step final {
@@ -44,6 +43,7 @@ class Mixer final {
 
     struct Instr {
       PatternList::InsInternal* ptr=nullptr;
+      float                     gain=1.f;
       float                     volLast=1.f;
       size_t                    counter=0;
       std::shared_ptr<PatternList::PatternInternal> pattern; //prevent pattern from deleting
@@ -61,6 +61,7 @@ class Mixer final {
     void     noteOn (std::shared_ptr<PatternInternal> &pattern, PatternList::Note *r);
     void     noteOn (std::shared_ptr<PatternInternal> &pattern, int64_t time);
     void     noteOff(int64_t time);
+    Instr*   findInstr(const PatternList::InsInternal* ins);
     std::shared_ptr<PatternInternal> checkPattern(std::shared_ptr<PatternInternal> p);
 
     void     nextPattern();
@@ -85,7 +86,7 @@ class Mixer final {
 
     std::atomic<float>                 volume={1.f};
     std::vector<Active>                active;
-    std::list<Instr>                   uniqInstr;
+    std::vector<Instr>                 uniqInstr;
     std::vector<float>                 pcm, vol, pcmMix;
   };
 
@@ -210,6 +210,9 @@ void PatternList::index(const Style& stl,PatternInternal &inst, const Dx8::Patte
     });
 
   inst.timeTotal = inst.waves.size()>0 ? pattern.timeLength(stl.styh.dblTempo) : 0;
+
+  for(auto& i:instument)
+    i.font.setPolyphony(polyphony(inst,i));
   }
 
 void PatternList::index(PatternInternal &idx, InsInternal* inst,
@@ -253,6 +256,24 @@ void PatternList::index(PatternInternal &idx, InsInternal* inst,
     }
   }
 
+size_t PatternList::polyphony(const PatternInternal& ptn, const InsInternal& ins) {
+  // only one variation is played at time: max of notes, that overlap within a variation
+  std::vector<uint64_t> ends;
+  size_t                ret = 0;
+  for(uint32_t bit=0; bit<32; ++bit) {
+    ends.clear();
+    for(auto& i:ptn.waves) {
+      if(i.inst!=&ins || (i.dwVariation & (1u<<bit))==0)
+        continue;
+      // waves are sorted by time
+      ends.erase(std::remove_if(ends.begin(),ends.end(),[&i](uint64_t e){ return e<=i.at; }),ends.end());
+      ends.push_back(i.at+i.duration);
+      ret = std::max(ret,ends.size());
+      }
+    }
+  return ret;
+  }
+
 size_t PatternList::size() const {
   return intern->pptn.size();
   }
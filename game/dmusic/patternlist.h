@@ -98,6 +98,8 @@ class PatternList final {
     void index(const Style &stl, PatternInternal& inst, const Dx8::Pattern &pattern);
     void index(PatternInternal &idx, InsInternal *inst, const Style &stl, const Style::Part &part);
 
+    static size_t polyphony(const PatternInternal& ptn, const InsInternal& ins);
+
     void dbgDump(const Style &stl, const Dx8::Pattern::PartRef &pref, const Style::Part &part) const;
 
     DirectMusic*                  owner=nullptr;
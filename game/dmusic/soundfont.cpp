@@ -1,6 +1,7 @@
 #include "soundfont.h"
 
 #include <Tempest/Log>
+#include <algorithm>
 #include <bitset>
 
 #include "dlscollection.h"
@@ -9,6 +10,9 @@
 using namespace Dx8;
 using namespace Tempest;
 
+// note may trigger few regions, and voices in release keep sounding after note-off
+static constexpr size_t VoicesPerNote = 2;
+
 #ifdef TSF_IMPLEMENTATION
 // For testing
 TSFDEF void __note_on(tsf* f, int preset_index, int key, float vel) {
@@ -203,11 +207,25 @@ struct SoundFont::Impl {
       }
     auto fnt = std::make_shared<Instance>(shData,dwPatch);
     fnt->setPan(pan);
+    Hydra::reserveVoices(fnt->fnt,voices);
     fnt->noteOn(note,velosity);
     inst.emplace_back(fnt);
     return inst.back();
     }
 
+  void setPolyphony(size_t notes) {
+    // instrument may be shared by many patterns: keep the largest reservation
+    voices = std::max(voices,int((notes*VoicesPerNote+3)/4)*4);
+    if(inst.empty() && voices>0) {
+      // create upfront, instead of allocating in audio thread on first note
+      auto fnt = std::make_shared<Instance>(shData,dwPatch);
+      fnt->setPan(pan);
+      inst.emplace_back(fnt);
+      }
+    for(auto& i:inst)
+      Hydra::reserveVoices(i->fnt,voices);
+    }
+
   /*
   void noteOff(uint8_t note){
     for(auto& i:inst){
@@ -231,6 +249,7 @@ struct SoundFont::Impl {
   std::shared_ptr<Data>                  shData;
   uint32_t                               dwPatch=0;
   float                                  pan=0.5f;
+  int                                    voices=0;
   std::vector<std::shared_ptr<Instance>> inst;
   };
 
@@ -264,6 +283,12 @@ void SoundFont::setPan(float p) {
   impl->setPan(p);
   }
 
+void SoundFont::setPolyphony(size_t notes) {
+  if(impl==nullptr)
+    return;
+  impl->setPolyphony(notes);
+  }
+
 void SoundFont::mix(float *samples, size_t count) {
   if(impl==nullptr)
     return;
@@ -42,6 +42,8 @@ class SoundFont final {
     bool hasNotes() const;
     void setVolume(float v);
     void setPan(float p);
+    // preallocates voices for 'notes' notes, playing at once; never shrinks
+    void setPolyphony(size_t notes);
     void mix(float* samples,size_t count);
 
     Ticket      noteOn(uint8_t note, uint8_t velosity);
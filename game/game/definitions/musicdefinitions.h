@@ -12,6 +12,12 @@ class MusicDefinitions final {
 
     const zenkit::IMusicTheme* operator[](std::string_view name) const;
 
+    template<class F>
+    void forEach(const F& f) const {
+      for(auto& i:themes)
+        f(*i);
+      }
+
   private:
     std::unique_ptr<zenkit::DaedalusVm>  vm;
     std::vector<std::shared_ptr<zenkit::IMusicTheme>> themes;
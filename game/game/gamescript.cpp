@@ -1407,6 +1407,10 @@ uint32_t GameScript::rand(uint32_t max) {
   return uint32_t(randGen())%max;
   }
 
+void GameScript::setSeed(uint32_t seed) {
+  randGen.seed(seed);
+  }
+
 Npc* GameScript::findNpc(zenkit::DaedalusSymbol* s) {
   if(s->is_instance_of<zenkit::INpc>()) {
     auto cNpc = reinterpret_cast<zenkit::INpc*>(s->get_instance().get());
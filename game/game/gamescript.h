@@ -84,6 +84,7 @@ class GameScript final {
     void         tick(uint64_t dt);
 
     uint32_t     rand(uint32_t max);
+    void         setSeed(uint32_t seed);
     void         removeItem(Item& it);
 
     void         setInstanceNPC (std::string_view name, Npc& npc);
@@ -6,6 +6,7 @@
 #include <Tempest/MemWriter>
 #include <cctype>
 
+#include "utils/profiler.h"
 #include "utils/string_frm.h"
 #include "worldstatestorage.h"
 #include "world/objects/npc.h"
@@ -301,6 +302,7 @@ void GameSession::setTime(gtime t) {
   }
 
 void GameSession::tick(uint64_t dt) {
+  PROFILE_ZONE("GameSession::tick");
   wrld->scaleTime(dt);
 
   // apply ztime multiplyer
@@ -5,6 +5,8 @@
 #include "world/world.h"
 #include "serialize.h"
 
+#include <utility>
+
 const float   MoveAlgo::closeToPointThreshold = 40;
 const float   MoveAlgo::climbMove             = 55;
 const float   MoveAlgo::gravity               = DynamicWorld::gravity;
@@ -439,6 +441,50 @@ void MoveAlgo::tick(uint64_t dt, MvFlags moveFlg) {
     }
   }
 
+size_t MoveAlgo::prefetch(uint64_t dt) {
+  // NOTE: must not modify shared state - executed in parallel for npc's, ahead of serial tick
+  pfLand.z  = std::numeric_limits<float>::infinity();
+  pfWater.z = std::numeric_limits<float>::infinity();
+  if(npc.interactive()!=nullptr || isClimb() || isJumpup() || isInAir() || isSlide() || npc.isDead())
+    return 0;
+
+  // same queries, as first rays of tickRun/tickSwim
+  const float fallThreshold = stepHeight();
+  const auto  pos           = npc.position();
+  const auto  dp            = npcMoveSpeed(dt,MvFlags::NoFlag);
+  if(dp==Tempest::Vec3() && !isSwim())
+    return 0; // standing: tick hits own cache
+  const auto  ground        = pos+dp+Tempest::Vec3(0,fallThreshold,0);
+  const auto  water         = (isSwim() ? ground : pos+dp) - Tempest::Vec3(0,waterPadd,0);
+
+  size_t ret    = 0;
+  auto&  physic = *npc.world().physic();
+  if(std::fabs(cache.x-ground.x)>eps || std::fabs(cache.y-ground.y)>eps || std::fabs(cache.z-ground.z)>eps) {
+    const float dy = (fallSpeed.y<0) ? 0 : waterDepthChest()+100;
+    static_cast<DynamicWorld::RayLandResult&>(pfLand) = physic.landRay(ground,dy);
+    pfLand.x = ground.x;
+    pfLand.y = ground.y;
+    pfLand.z = ground.z;
+    pfLandDy = dy;
+    ++ret;
+    }
+  if(std::fabs(cacheW.x-water.x)>eps || std::fabs(cacheW.y-water.y)>eps || std::fabs(cacheW.z-water.z)>eps) {
+    static_cast<DynamicWorld::RayWaterResult&>(pfWater) = physic.waterRay(water);
+    pfWater.x = water.x;
+    pfWater.y = water.y;
+    pfWater.z = water.z;
+    ++ret;
+    }
+  return ret;
+  }
+
+size_t MoveAlgo::takePrefetchHits() {
+  // unused results are dropped: collision world may change until next tick
+  pfLand.z  = std::numeric_limits<float>::infinity();
+  pfWater.z = std::numeric_limits<float>::infinity();
+  return std::exchange(pfHits,uint8_t(0));
+  }
+
 void MoveAlgo::implTick(uint64_t dt, MvFlags moveFlg) {
   if(npc.interactive()!=nullptr)
     return tickMobsi(dt);
@@ -1006,7 +1052,13 @@ void MoveAlgo::onGravityFailed(const DynamicWorld::CollisionTest& info, uint64_t
 float MoveAlgo::waterRay(const Tempest::Vec3& p, bool* hasCol) const {
   auto pos = p - Tempest::Vec3(0,waterPadd,0);
   if(std::fabs(cacheW.x-pos.x)>eps || std::fabs(cacheW.y-pos.y)>eps || std::fabs(cacheW.z-pos.z)>eps) {
-    static_cast<DynamicWorld::RayWaterResult&>(cacheW) = npc.world().physic()->waterRay(pos);
+    if(pfWater.x==pos.x && pfWater.y==pos.y && pfWater.z==pos.z) {
+      static_cast<DynamicWorld::RayWaterResult&>(cacheW) = pfWater;
+      ++pfHits;
+      } else {
+      static_cast<DynamicWorld::RayWaterResult&>(cacheW) = npc.world().physic()->waterRay(pos);
+      }
+    pfWater.z = std::numeric_limits<float>::infinity();
     cacheW.x = pos.x;
     cacheW.y = pos.y;
     cacheW.z = pos.z;
@@ -1021,7 +1073,13 @@ void MoveAlgo::rayMain(const Tempest::Vec3& pos) const {
     float dy = waterDepthChest()+100;  // 1 meter extra offset
     if(fallSpeed.y<0)
       dy = 0; // whole world
-    static_cast<DynamicWorld::RayLandResult&>(cache) = npc.world().physic()->landRay(pos,dy);
+    if(pfLand.x==pos.x && pfLand.y==pos.y && pfLand.z==pos.z && pfLandDy==dy) {
+      static_cast<DynamicWorld::RayLandResult&>(cache) = pfLand;
+      ++pfHits;
+      } else {
+      static_cast<DynamicWorld::RayLandResult&>(cache) = npc.world().physic()->landRay(pos,dy);
+      }
+    pfLand.z = std::numeric_limits<float>::infinity();
     cache.x = pos.x;
     cache.y = pos.y;
     cache.z = pos.z;
@@ -42,6 +42,10 @@ class MoveAlgo final {
     void    save(Serialize& fout) const;
 
     void    tick(uint64_t dt, MvFlags fai=NoFlag);
+    // read-only: ground and water rays of upcoming tick, at predicted position; returns number of rays cast
+    size_t  prefetch(uint64_t dt);
+    // number of prefetched rays, consumed by tick since last call; drops unused ones
+    size_t  takePrefetchHits();
 
     void    multSpeed(float s){ mulSpeed=s; }
     void    clearSpeed();
@@ -144,6 +148,11 @@ class MoveAlgo final {
     Npc&                npc;
     mutable CacheLand   cache;
     mutable CacheWater  cacheW;
+    // results of prefetch(), consumed only on exact match of the query
+    mutable CacheLand   pfLand;
+    mutable CacheWater  pfWater;
+    mutable float       pfLandDy = 0;
+    mutable uint8_t     pfHits   = 0;
 
     std::string_view    portal;
     std::string_view    formerPortal;
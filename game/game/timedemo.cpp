@@ -0,0 +1,239 @@
+#include "timedemo.h"
+
+#include <Tempest/File>
+#include <Tempest/Log>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <type_traits>
+
+#include "game/gamesession.h"
+#include "game/gamescript.h"
+#include "world/objects/npc.h"
+#include "utils/string_frm.h"
+#include "camera.h"
+#include "gothic.h"
+
+using namespace Tempest;
+
+// bump, if layout of demo file has changed
+static constexpr uint32_t DemoVersion = 1;
+static const char         Magic[8]    = {'O','G','D','E','M','O','\0','\0'};
+// player is out of sync with recording, if deviates further than this
+static constexpr float    DesyncDist  = 10.f;
+
+struct TimeDemo::Header final {
+  char     magic[8]  = {};
+  uint32_t version   = 0;
+  uint32_t seed      = 0;
+  uint32_t frames    = 0;
+  uint32_t inputs    = 0;
+  uint32_t startLen  = 0;
+  uint8_t  startSave = 0;
+  uint8_t  padd[3]   = {};
+  };
+
+static_assert(std::is_trivially_copyable_v<TimeDemo::Input>);
+
+TimeDemo::~TimeDemo() {
+  finish();
+  }
+
+bool TimeDemo::record(std::string_view file) {
+  if(md!=M_None)
+    return false;
+  md      = M_Record;
+  path    = std::string(file);
+  rndSeed = std::random_device()();
+  return true;
+  }
+
+bool TimeDemo::replay(std::string_view file) {
+  if(md!=M_None)
+    return false;
+  try {
+    RFile  fin{std::string(file)};
+    Header hdr;
+    if(fin.read(&hdr,sizeof(hdr))!=sizeof(hdr) || std::memcmp(hdr.magic,Magic,sizeof(Magic))!=0 || hdr.version!=DemoVersion) {
+      Log::e("timedemo: \"",file,"\" is not a demo file, or it was recorded by another version");
+      return false;
+      }
+    start.resize(hdr.startLen);
+    frames.resize(hdr.frames);
+    inputs.resize(hdr.inputs);
+    const size_t szFrames = frames.size()*sizeof(Frame);
+    const size_t szInputs = inputs.size()*sizeof(Input);
+    if(fin.read(start.data(),start.size())!=start.size() ||
+       fin.read(frames.data(),szFrames)!=szFrames ||
+       fin.read(inputs.data(),szInputs)!=szInputs) {
+      Log::e("timedemo: \"",file,"\" is truncated");
+      return false;
+      }
+    startSave = hdr.startSave!=0;
+    rndSeed   = hdr.seed;
+    }
+  catch(...) {
+    Log::e("timedemo: unable to open \"",file,"\"");
+    return false;
+    }
+
+  if(frames.empty() || start.empty())
+    return false;
+  md   = M_Replay;
+  path = std::string(file);
+  frameTime.reserve(frames.size());
+  return true;
+  }
+
+void TimeDemo::finish() {
+  if(md==M_Record && !frames.empty())
+    write();
+  md = M_None;
+  }
+
+void TimeDemo::onSessionStart(std::string_view slot, bool isSave) {
+  if(md!=M_Record)
+    return;
+  if(!frames.empty()) {
+    // another game is loaded: recorded session is over
+    finish();
+    return;
+    }
+  start     = std::string(slot);
+  startSave = isSave;
+  inputs.clear();
+  }
+
+void TimeDemo::pushInput(const Input& in) {
+  if(md!=M_Record || start.empty())
+    return;
+  inputs.push_back(in);
+  inputs.back().frame = uint32_t(frames.size());
+  }
+
+bool TimeDemo::beginFrame(uint64_t& dt) {
+  if(md==M_Record && !start.empty()) {
+    if(frames.empty())
+      seed();
+    Frame f;
+    f.dt = uint16_t(std::min<uint64_t>(dt,0xFFFF));
+    frames.push_back(f);
+    inFrame = true;
+    }
+  else if(md==M_Replay) {
+    if(frameId>=frames.size())
+      return false;
+    if(frameId==0)
+      seed();
+    dt      = frames[frameId].dt;
+    inFrame = true;
+    frameId++;
+    }
+  return true;
+  }
+
+void TimeDemo::endFrame(Camera* camera, const Npc* player) {
+  if(!inFrame)
+    return;
+  inFrame = false;
+
+  if(md==M_Record) {
+    auto& f = frames.back();
+    if(camera!=nullptr)
+      f.spin = camera->spin();
+    if(player!=nullptr) {
+      auto p = player->position();
+      f.pos[0] = p.x;
+      f.pos[1] = p.y;
+      f.pos[2] = p.z;
+      }
+    return;
+    }
+
+  if(md!=M_Replay)
+    return;
+  auto& f = frames[frameId-1];
+  // camera is driven by recorded input as well; spin is forced only to keep view identical, in spite of float drift
+  if(camera!=nullptr)
+    camera->setSpin(f.spin);
+  if(player!=nullptr) {
+    const float drift = (player->position()-Tempest::Vec3(f.pos[0],f.pos[1],f.pos[2])).length();
+    maxDrift = std::max(maxDrift,drift);
+    if(drift>DesyncDist && firstDesync==size_t(-1))
+      firstDesync = frameId-1;
+    }
+
+  const auto now = std::chrono::steady_clock::now();
+  if(frameId>1)
+    frameTime.push_back(uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(now-lastFrame).count()));
+  lastFrame = now;
+
+  if(frameId==frames.size()) {
+    report();
+    md = M_None;
+    }
+  }
+
+void TimeDemo::seed() {
+  if(auto game = Gothic::inst().gameSession())
+    game->script()->setSeed(rndSeed);
+  std::srand(rndSeed);
+  }
+
+void TimeDemo::write() {
+  Header hdr;
+  std::memcpy(hdr.magic,Magic,sizeof(Magic));
+  hdr.version   = DemoVersion;
+  hdr.seed      = rndSeed;
+  hdr.frames    = uint32_t(frames.size());
+  hdr.inputs    = uint32_t(inputs.size());
+  hdr.startLen  = uint32_t(start.size());
+  hdr.startSave = startSave ? 1 : 0;
+  try {
+    WFile fout{path};
+    fout.write(&hdr,sizeof(hdr));
+    fout.write(start.data(),start.size());
+    fout.write(frames.data(),frames.size()*sizeof(Frame));
+    fout.write(inputs.data(),inputs.size()*sizeof(Input));
+    Log::i("timedemo: \"",path,"\" recorded, ",frames.size()," frames");
+    }
+  catch(...) {
+    Log::e("timedemo: unable to write \"",path,"\"");
+    }
+  }
+
+void TimeDemo::report() {
+  if(frameTime.empty())
+    return;
+  std::vector<uint32_t> v = frameTime;
+  std::sort(v.begin(),v.end());
+
+  uint64_t sum = 0;
+  for(auto i:v)
+    sum += i;
+  auto pct = [&v](size_t p) {
+    return float(v[std::min(v.size()-1,(v.size()*p)/100)])/1000.f;
+    };
+  const float avg = float(sum)/float(v.size())/1000.f;
+
+  string_frm<256> line0("timedemo: ",path,", ",frames.size()," frames, ",float(sum)/1000000.f," s, avg ",avg," ms (",1000.f/avg," fps)");
+  string_frm<256> line1("  p50 ",pct(50)," ms, p95 ",pct(95)," ms, p99 ",pct(99)," ms, max ",float(v.back())/1000.f," ms");
+  string_frm<256> line2 = firstDesync==size_t(-1) ? string_frm<256>("  player in sync, max drift ",maxDrift)
+                                                   : string_frm<256>("  player desync at frame ",firstDesync,", max drift ",maxDrift);
+  Log::i(std::string_view(line0));
+  Log::i(std::string_view(line1));
+  Log::i(std::string_view(line2));
+
+  try {
+    WFile fout{path+".txt"};
+    for(auto l:{std::string_view(line0),std::string_view(line1),std::string_view(line2)}) {
+      fout.write(l.data(),l.size());
+      fout.write("\n",1);
+      }
+    }
+  catch(...) {
+    Log::e("timedemo: unable to write report \"",path,".txt\"");
+    }
+  }
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <Tempest/Point>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/keycodec.h"
+
+class Camera;
+class Npc;
+
+// Recording of player input and frame timing, for deterministic replay of a play session.
+// Session starts from a save-game or a fresh world, random of scripts is seeded from the file;
+// replay feeds recorded dt and input back into main loop and reports frame-time percentiles.
+class TimeDemo final {
+  public:
+    enum Mode : uint8_t {
+      M_None,
+      M_Record,
+      M_Replay,
+      };
+
+    enum InputType : uint8_t {
+      I_KeyDown,
+      I_KeyUp,
+      I_Rotate,       // player rotation by mouse: x, y
+      I_CameraRotate, // camera rotation by mouse: x, y
+      I_CameraZoom,   // x - wheel delta
+      };
+
+    struct Input final {
+      uint32_t         frame   = 0; // number of frames, simulated before this input
+      uint16_t         key     = 0; // Tempest::KeyEvent::KeyType
+      InputType        type    = I_KeyDown;
+      KeyCodec::Action action  = KeyCodec::Idle;
+      uint8_t          mapping = 0;
+      uint8_t          padd[3] = {};
+      float            x       = 0;
+      float            y       = 0;
+      };
+
+    ~TimeDemo();
+
+    bool             record(std::string_view file);
+    bool             replay(std::string_view file);
+    // stops recording and writes demo file
+    void             finish();
+
+    Mode             mode()        const { return md; }
+    bool             isReplay()    const { return md==M_Replay; }
+    // startup of demo: save-game, if startIsSave, world name otherwise
+    std::string_view startSlot()   const { return start; }
+    bool             startIsSave() const { return startSave; }
+
+    // recording covers a single session: first one, that is started
+    void             onSessionStart(std::string_view slot, bool isSave);
+    void             pushInput(const Input& in);
+
+    // beginFrame is called right before game tick, dt is overridden in replay; endFrame - once camera is updated
+    // returns false, if replay is over
+    bool             beginFrame(uint64_t& dt);
+    void             endFrame(Camera* camera, const Npc* player);
+
+    // replay: inputs, due up to current frame; mouse input is applied in the middle of frame, as it was recorded
+    template<class F>
+    void             replayInput(bool mouse, const F& f);
+
+  private:
+    struct Header;
+
+    struct Frame final {
+      uint16_t        dt     = 0;
+      uint16_t        padd   = 0;
+      Tempest::PointF spin;
+      float           pos[3] = {};
+      };
+
+    static bool      isMouse(InputType t) { return t==I_Rotate || t==I_CameraRotate; }
+
+    void             write();
+    void             report();
+    void             seed();
+
+    Mode                     md          = M_None;
+    std::string              path;
+    std::string              start;
+    bool                     startSave   = false;
+    bool                     inFrame     = false;
+    uint32_t                 rndSeed     = 0;
+
+    std::vector<Frame>       frames;
+    std::vector<Input>       inputs;
+
+    // replay
+    size_t                   frameId     = 0;
+    size_t                   cursor[2]   = {};
+    std::vector<uint32_t>    frameTime; // us
+    std::chrono::steady_clock::time_point lastFrame;
+    float                    maxDrift    = 0;
+    size_t                   firstDesync = size_t(-1);
+  };
+
+template<class F>
+void TimeDemo::replayInput(bool mouse, const F& f) {
+  if(md!=M_Replay)
+    return;
+  auto& at = cursor[mouse ? 1 : 0];
+  for(; at<inputs.size(); ++at) {
+    auto& in = inputs[at];
+    if(isMouse(in.type)!=mouse)
+      continue;
+    if(in.frame>frameId)
+      break;
+    f(in);
+    }
+  }
@@ -4,6 +4,9 @@
 #include <Tempest/Sound>
 #include <Tempest/Log>
 
+#include <algorithm>
+#include <chrono>
+
 #include "game/definitions/musicdefinitions.h"
 #include "dmusic/mixer.h"
 #include "resources.h"
@@ -294,6 +297,51 @@ GameMusic::Tags GameMusic::mkTags(GameMusic::Tags daytime, GameMusic::Tags mode)
   return Tags(daytime | mode);
   }
 
+void GameMusic::benchmark(uint32_t seconds, BenchStats& st) {
+  using clock = std::chrono::steady_clock;
+  auto us = [](clock::time_point a, clock::time_point b) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(b-a).count());
+    };
+
+  std::vector<std::string> files;
+  Gothic::musicDef().forEach([&files](const zenkit::IMusicTheme& theme) {
+    if(!theme.file.empty())
+      files.push_back(theme.file);
+    });
+  std::sort(files.begin(),files.end());
+  files.erase(std::unique(files.begin(),files.end()),files.end());
+
+  // same size, as a typical buffer of sound device
+  const size_t         chunk = 1024;
+  const size_t         total = size_t(seconds)*SAMPLE_RATE;
+  st.rate = SAMPLE_RATE;
+  std::vector<int16_t> pcm(chunk*2);
+  for(auto& f:files) {
+    const auto t0 = clock::now();
+    Dx8::Music m;
+    try {
+      Dx8::PatternList p = Resources::loadDxMusic(f);
+      m.addPattern(p);
+      }
+    catch(...) {
+      st.errors++;
+      continue;
+      }
+    const auto t1 = clock::now();
+
+    Dx8::Mixer mix;
+    mix.setMusic(m);
+    for(size_t i=0; i<total; i+=chunk)
+      mix.mix(pcm.data(),std::min(chunk,total-i));
+    const auto t2 = clock::now();
+
+    st.themes++;
+    st.samples += total;
+    st.load    += us(t0,t1);
+    st.render  += us(t1,t2);
+    }
+  }
+
 void GameMusic::setEnabled(bool e) {
   impl->setEnabled(e);
   }
@@ -13,6 +13,8 @@ class GameMusic final {
     ~GameMusic();
 
     static GameMusic& inst();
+    // false in headless mode: no music device
+    static bool       isAvailable() { return instance!=nullptr; }
 
     enum Music : uint8_t {
       SysLoading
@@ -29,6 +31,17 @@ class GameMusic final {
 
     static Tags mkTags(Tags daytime,Tags mode);
 
+    struct BenchStats {
+      size_t   themes  = 0;
+      size_t   errors  = 0;
+      uint32_t rate    = 0; // samples per second
+      uint64_t samples = 0; // stereo frames
+      uint64_t load    = 0; // us
+      uint64_t render  = 0; // us
+      };
+    // renders every theme of Music.dat to memory, without sound device
+    static void benchmark(uint32_t seconds, BenchStats& st);
+
     void      setEnabled(bool e);
     bool      isEnabled() const;
     void      setMusic(Music m);
@@ -17,9 +17,11 @@
 
 #include "world/objects/npc.h"
 #include "graphics/shaders.h"
+#include "graphics/texturestreaming.h"
 
 #include "utils/fileutil.h"
 #include "utils/inifile.h"
+#include "utils/workers.h"
 
 #include "commandline.h"
 
@@ -129,6 +131,13 @@ Gothic::Gothic() {
   defaults->set("ENGINE",       "zEnvMappingEnabled", 1); // reflections
   defaults->set("ENGINE",       "zCloudShadowScale", gpu.type==Tempest::DeviceType::Discrete); // ssao
   defaults->set("INTERNAL",     "vidResIndex", 0); // full-res
+  defaults->set("INTERNAL",     "workerThreads", 0); // 0 - hardware concurrency
+  defaults->set("INTERNAL",     "animLodNear",   2500); // full-rate animation, in centimeters
+  defaults->set("INTERNAL",     "animLodFar",    6000); // reduced-rate animation, in centimeters; 4x slower rate beyond
+  defaults->set("INTERNAL",     "animLodRate",   100);  // reduced-rate animation update period, in milliseconds
+  defaults->set("INTERNAL",     "pathLandmarks", 8);    // ALT landmarks for waynet path search, 0 - euclidean heuristic only
+  defaults->set("INTERNAL",     "textureStreaming", 1);  // stream full mip-chain of world textures on demand
+  defaults->set("INTERNAL",     "textureBudget", 1024);  // full-resolution streamed textures, in megabytes; 0 - unlimited
 
   defaults->set("VIDEO", "zVidBrightness", 0.5f);
   defaults->set("VIDEO", "zVidContrast",   0.5f);
@@ -170,6 +179,10 @@ Gothic::Gothic() {
   defaults->set("KEYS", "keyShowMap",     "3200");
   }
 
+  Workers::setThreadCount(uint32_t(std::max(0, settingsGetI("INTERNAL","workerThreads"))));
+  Resources::textureStreaming().setup(settingsGetI("INTERNAL","textureStreaming")!=0,
+                                      uint64_t(std::max(0, settingsGetI("INTERNAL","textureBudget")))*1024u*1024u);
+
   detectGothicVersion();
 
   std::u16string_view mod = CommandLine::inst().modPath();
@@ -128,6 +128,9 @@ class Gothic final {
     bool         doClock() const { return showTime; }
     void         setClock(bool t) { showTime = t; }
 
+    bool         doProfiler() const { return showProfiler; }
+    void         setProfiler(bool p) { showProfiler = p; }
+
     Tempest::Signal<void()> toggleGi, toggleVsm;
 
     LoadState    checkLoading() const;
@@ -201,6 +204,7 @@ class Gothic final {
     bool                                    desktop        = false;
     bool                                    showFpsCounter = false;
     bool                                    showTime       = false;
+    bool                                    showProfiler   = false;
 
     std::string                             wrldDef, plDef, gameDatDef, ouDef;
 
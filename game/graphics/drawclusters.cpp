@@ -23,6 +23,8 @@ uint32_t DrawClusters::alloc(const PackedMesh::Cluster* cx, size_t firstMeshlet,
     Cluster c;
     c.pos          = cx[i].pos;
     c.r            = cx[i].r;
+    c.coneAxis     = cx[i].coneAxis;
+    c.coneCutoff   = cx[i].coneCutoff;
     c.bucketId     = bucketId;
     c.commandId    = commandId;
     c.firstMeshlet = uint32_t(firstMeshlet + i);
@@ -22,6 +22,8 @@ class DrawClusters {
       uint32_t      firstMeshlet = 0;
       uint32_t      meshletCount = 0;
       uint32_t      instanceId   = 0;
+      Tempest::Vec3 coneAxis;
+      float         coneCutoff   = 1;
       };
 
     Cluster& operator[](size_t i) { return clusters[i]; }
@@ -1,6 +1,7 @@
 #include "instancestorage.h"
 #include "shaders.h"
 #include "utils/workers.h"
+#include "utils/profiler.h"
 
 #include <Tempest/Log>
 #include <cstdint>
@@ -122,6 +123,7 @@ InstanceStorage::~InstanceStorage() {
   }
 
 bool InstanceStorage::commit(Encoder<CommandBuffer>& cmd, uint8_t fId) {
+  PROFILE_ZONE("InstanceStorage::commit");
   auto& device = Resources::device();
 
   std::atomic_thread_fence(std::memory_order_acquire);
@@ -27,6 +27,7 @@ void InventoryRenderer::draw(Tempest::Encoder<CommandBuffer>& cmd, uint8_t fId)
   mv.scale(0.8f,1.f,1.f);
 
   size_t descI = 0;
+  texUsage.clear();
   for(auto& i:items) {
     cmd.setViewport(i.x,i.y,i.w,i.h);
     for(size_t r=0;r<i.mesh.nodesCount();++r) {
@@ -36,6 +37,7 @@ void InventoryRenderer::draw(Tempest::Encoder<CommandBuffer>& cmd, uint8_t fId)
       if(descI>=ctx.decs.size())
         ctx.decs.emplace_back(device.descriptors(*pInventory));
       ctx.decs[descI].set(0, *m.tex);
+      texUsage.push_back({m.tex, 0.f});
 
       if(auto s = n.mesh()) {
         auto sl = n.meshSlice();
@@ -50,6 +52,7 @@ void InventoryRenderer::draw(Tempest::Encoder<CommandBuffer>& cmd, uint8_t fId)
       }
     }
   ctx.decs.resize(descI);
+  Resources::textureStreaming().touch(texUsage);
   }
 
 void InventoryRenderer::reset(bool full) {
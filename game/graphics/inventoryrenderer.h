@@ -5,6 +5,7 @@
 
 #include "meshobjects.h"
 #include "sceneglobals.h"
+#include "texturestreaming.h"
 #include "visualobjects.h"
 
 class Item;
@@ -33,6 +34,7 @@ class InventoryRenderer {
     MeshObjects            itmGroup;
     std::vector<Itm>       items;
     std::vector<Itm>       prevItems; // reseve previous to avoid bucket reallocation
+    std::vector<TextureStreaming::Usage> texUsage;
 
     const Tempest::RenderPipeline* pInventory = nullptr;
 
@@ -140,21 +140,14 @@ LightGroup::LightGroup(const SceneGlobals& scene)
   }
 
 LightGroup::Light LightGroup::add(const zenkit::LightPreset& vob) {
-  LightSource l;
-  l.setPosition(Vec3(0, 0, 0));
-
-  if(!vob.range_animation_scale.empty()) {
-    l.setRange(vob.range_animation_scale,vob.range,vob.range_animation_fps,vob.range_animation_smooth);
-    } else {
-    l.setRange(vob.range);
-    }
+  return add(mkSource(vob));
+  }
 
-  if(!vob.color_animation_list.empty()) {
-    l.setColor(vob.color_animation_list,vob.color_animation_fps,vob.color_animation_smooth);
-    } else {
-    l.setColor(Vec3(vob.color.r / 255.f, vob.color.g / 255.f, vob.color.b / 255.f));
-    }
+LightGroup::Light LightGroup::add(const zenkit::VLight& vob) {
+  return add(mkSource(vob));
+  }
 
+LightGroup::Light LightGroup::add(LightSource&& l) {
   std::lock_guard<std::mutex> guard(sync);
   size_t id = alloc(l.isDynamic());
   auto   lx = Light(*this, id);
@@ -171,8 +164,26 @@ LightGroup::Light LightGroup::add(const zenkit::LightPreset& vob) {
   return lx;
   }
 
-LightGroup::Light LightGroup::add(const zenkit::VLight& vob) {
-  auto l = add(static_cast<const zenkit::LightPreset&>(vob));
+LightSource LightGroup::mkSource(const zenkit::LightPreset& vob) {
+  LightSource l;
+  l.setPosition(Vec3(0, 0, 0));
+
+  if(!vob.range_animation_scale.empty()) {
+    l.setRange(vob.range_animation_scale,vob.range,vob.range_animation_fps,vob.range_animation_smooth);
+    } else {
+    l.setRange(vob.range);
+    }
+
+  if(!vob.color_animation_list.empty()) {
+    l.setColor(vob.color_animation_list,vob.color_animation_fps,vob.color_animation_smooth);
+    } else {
+    l.setColor(Vec3(vob.color.r / 255.f, vob.color.g / 255.f, vob.color.b / 255.f));
+    }
+  return l;
+  }
+
+LightSource LightGroup::mkSource(const zenkit::VLight& vob) {
+  auto l = mkSource(static_cast<const zenkit::LightPreset&>(vob));
   l.setPosition(Vec3(vob.position.x,vob.position.y,vob.position.z));
   return l;
   }
@@ -45,6 +45,10 @@ class LightGroup final {
     Light  add(const zenkit::LightPreset& vob);
     Light  add(const zenkit::VLight& vob);
     Light  add(std::string_view preset);
+    Light  add(LightSource&& l);
+    // description of light, without registration in group; safe to call from worker threads
+    static LightSource mkSource(const zenkit::LightPreset& vob);
+    static LightSource mkSource(const zenkit::VLight& vob);
     size_t size() const { return lightSourceData.size(); }
 
     void   tick(uint64_t time);
@@ -10,8 +10,8 @@ static Tempest::Color toColor(glm::u8vec4 v) {
   return c;
   }
 
-Material::Material(const zenkit::Material& m, bool enableAlphaTest) {
-  tex = Resources::loadTexture(m.texture);
+Material::Material(const zenkit::Material& m, bool enableAlphaTest, bool streamed) {
+  tex = streamed ? Resources::loadTextureStreamed(m.texture) : Resources::loadTexture(m.texture);
   if(tex==nullptr) {
     if(!m.texture.empty()) {
       tex = Resources::loadTexture("DEFAULT.TGA");
@@ -10,7 +10,8 @@
 class Material final {
   public:
     Material()=default;
-    Material(const zenkit::Material& m, bool enableAlphaTest);
+    // streamed - texture mips are streamed in on demand (world and static meshes)
+    Material(const zenkit::Material& m, bool enableAlphaTest, bool streamed = false);
     Material(const zenkit::VisualDecal& decal);
     Material(const zenkit::IParticleEffect &src);
 
@@ -3,6 +3,7 @@
 #include <Tempest/Matrix4x4>
 
 #include "graphics/mesh/animationsolver.h"
+#include "graphics/mesh/pose.h"
 #include "graphics/pfx/pfxobjects.h"
 #include "game/constants.h"
 #include "meshobjects.h"
@@ -74,7 +75,7 @@ class MdlVisual final {
     bool                           isUsingTorch() const;
 
     const Pose&                    pose() const { return *skInst; }
-    bool                           updateAnimation(Npc* npc, World& world, uint64_t dt);
+    bool                           updateAnimation(Npc* npc, World& world, uint64_t dt, Pose::LodTier lod = Pose::LodFull);
     void                           processLayers  (World& world);
     bool                           processEvents(World& world, uint64_t &barrier, Animation::EvCount &ev);
     auto                           mapBone(const size_t boneId) const -> Tempest::Vec3;
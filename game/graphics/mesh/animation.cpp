@@ -1,6 +1,7 @@
 #include "animation.h"
 
 #include <Tempest/Log>
+#include <atomic>
 #include <cctype>
 
 #include "utils/string_frm.h"
@@ -10,6 +11,8 @@
 
 using namespace Tempest;
 
+static std::atomic<size_t> totalRawSize{0}, totalPackedSize{0};
+
 static void setupTime(std::vector<uint64_t>& t0,const std::vector<int32_t>& inp,float fps){
   t0.resize(inp.size());
   for(size_t i=0;i<inp.size();++i){
@@ -73,6 +76,26 @@ Animation::Animation(zenkit::ModelScript& p, std::string_view name, const bool i
   meshDef = std::move(p.skeleton);
 
   setupIndex();
+
+  // aliases and combinations share data with original sequence
+  std::vector<const AnimData*> data;
+  for(auto& i:sequences)
+    data.push_back(i.data.get());
+  std::sort(data.begin(),data.end());
+  data.erase(std::unique(data.begin(),data.end()),data.end());
+
+  size_t rawSize = 0, packedSize = 0;
+  for(auto i:data) {
+    rawSize    += i->samples.rawSize();
+    packedSize += i->samples.memoryUsage();
+    }
+  totalRawSize   .fetch_add(rawSize,   std::memory_order_relaxed);
+  totalPackedSize.fetch_add(packedSize,std::memory_order_relaxed);
+  }
+
+void Animation::memoryStatistic(size_t& raw, size_t& packed) {
+  raw    = totalRawSize   .load(std::memory_order_relaxed);
+  packed = totalPackedSize.load(std::memory_order_relaxed);
   }
 
 const Animation::Sequence* Animation::sequence(std::string_view name) const {
@@ -97,8 +120,10 @@ const Animation::Sequence *Animation::sequenceAsc(std::string_view name) const {
   }
 
 void Animation::debug() const {
-  for(auto& i:sequences)
-    Log::d(i.name);
+  for(auto& i:sequences) {
+    auto& smp = i.data->samples;
+    Log::d(i.name," (",smp.rawSize()," -> ",smp.memoryUsage()," bytes)");
+    }
   }
 
 std::string_view Animation::defaultMesh() const {
@@ -215,9 +240,8 @@ Animation::Sequence::Sequence(const zenkit::MdsAnimation& hdr, std::string_view
   data->fpsRate = p.fps;
   data->numFrames = p.frame_count;
   data->nodeIndex = p.node_indices;
-  data->samples = p.samples;
-
-  setupMoveTr();
+  data->setupMoveTr(p.samples);
+  data->samples = PackedAnimation(p.samples,p.node_indices.size());
   }
 
 bool Animation::Sequence::isFinished(uint64_t now, uint64_t sTime, uint16_t comboLen) const {
@@ -537,11 +561,7 @@ void Animation::Sequence::schemeName(char scheme[64]) const {
     }
   }
 
-void Animation::Sequence::setupMoveTr() {
-  data->setupMoveTr();
-  }
-
-void Animation::AnimData::setupMoveTr() {
+void Animation::AnimData::setupMoveTr(const std::vector<zenkit::AnimationSample>& samples) {
   size_t sz = nodeIndex.size();
   if(sz==0)
     return;
@@ -6,6 +6,8 @@
 #include <Tempest/Vec>
 #include <memory>
 
+#include "packedanimation.h"
+
 class Npc;
 class MdlVisual;
 class World;
@@ -42,7 +44,7 @@ class Animation final {
       Tempest::Vec3                               translate={};
       Tempest::Vec3                               moveTr={};
 
-      std::vector<zenkit::AnimationSample>        samples;
+      PackedAnimation                             samples;
       std::vector<uint32_t>                       nodeIndex;
       std::vector<Tempest::Vec3>                  tr;
       bool                                        hasMoveTr=false;
@@ -65,7 +67,7 @@ class Animation final {
       std::vector<uint64_t>                       defParFrame;
       std::vector<uint64_t>                       defWindow;
 
-      void                                        setupMoveTr();
+      void                                        setupMoveTr(const std::vector<zenkit::AnimationSample>& samples);
       void                                        setupEvents(float fpsRate);
       };
 
@@ -112,7 +114,6 @@ class Animation final {
       std::shared_ptr<AnimData>              data;
 
       private:
-        void                                 setupMoveTr();
         static void                          processEvent(const zenkit::MdsEventTag& e, EvCount& ev, uint64_t time);
         bool                                 extractFrames(uint64_t &frameA, uint64_t &frameB, bool &invert, uint64_t barrier, uint64_t sTime, uint64_t now) const;
       };
@@ -123,7 +124,10 @@ class Animation final {
     const Sequence*    sequence(std::string_view name) const;
     const Sequence*    sequenceAsc(std::string_view name) const;
     void               debug() const;
+    auto               sequenceList() const -> const std::vector<Sequence>& { return sequences; }
     std::string_view   defaultMesh() const;
+    // total of all loaded animations, in bytes
+    static void        memoryStatistic(size_t& raw, size_t& packed);
 
   private:
     Sequence&          loadMAN(const zenkit::MdsAnimation& hdr, std::string_view name);
@@ -1,7 +1,72 @@
 #include "animmath.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define ANIM_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// avx2 kernels are compiled for x86-64 regardless of compiler flags, and selected at runtime
+#if defined(ANIM_SSE2) && (defined(__x86_64__) || defined(_M_X64))
+#define ANIM_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define ANIM_TARGET_AVX2
+#else
+#define ANIM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static AnimSimd detectSimd() {
+#if defined(ANIM_AVX2) && defined(_MSC_VER) && !defined(__clang__)
+  int info[4] = {};
+  __cpuid(info,0);
+  if(info[0]>=7) {
+    __cpuid(info,1);
+    const bool avx = (info[2] & (1<<27))!=0 && (info[2] & (1<<28))!=0; // osxsave + avx
+    __cpuidex(info,7,0);
+    if(avx && (info[1] & (1<<5))!=0 && (_xgetbv(0) & 0x6)==0x6)
+      return AnimSimd::AVX2;
+    }
+#elif defined(ANIM_AVX2)
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))
+    return AnimSimd::AVX2;
+#endif
+#if defined(ANIM_SSE2)
+  return AnimSimd::SSE2;
+#else
+  return AnimSimd::Scalar;
+#endif
+  }
+
+static const AnimSimd simdSupported = detectSimd();
+static AnimSimd       simdLevel     = simdSupported;
+
+AnimSimd animSimdSupported() {
+  return simdSupported;
+  }
+
+AnimSimd animSimd() {
+  return simdLevel;
+  }
+
+void setAnimSimd(AnimSimd s) {
+  simdLevel = std::min(s,simdSupported);
+  }
+
+const char* animSimdName(AnimSimd s) {
+  switch(s) {
+    case AnimSimd::Scalar: return "scalar";
+    case AnimSimd::SSE2:   return "sse2";
+    case AnimSimd::AVX2:   return "avx2";
+    }
+  return "?";
+  }
+
 static float mix(float x,float y,float a){
   return x+(y-x)*a;
   }
@@ -43,3 +108,338 @@ Tempest::Matrix4x4 mkMatrix(const zenkit::AnimationSample& s) {
   return mkMatrix(s.rotation.x,s.rotation.y,s.rotation.z,s.rotation.w,
                   s.position.x,s.position.y,s.position.z);
   }
+
+void AnimSampleBatch::set(size_t i, const zenkit::AnimationSample& s) {
+  qx[i] = s.rotation.x;
+  qy[i] = s.rotation.y;
+  qz[i] = s.rotation.z;
+  qw[i] = s.rotation.w;
+  px[i] = s.position.x;
+  py[i] = s.position.y;
+  pz[i] = s.position.z;
+  }
+
+zenkit::AnimationSample AnimSampleBatch::get(size_t i) const {
+  zenkit::AnimationSample r {};
+  r.rotation.x = qx[i];
+  r.rotation.y = qy[i];
+  r.rotation.z = qz[i];
+  r.rotation.w = qw[i];
+  r.position.x = px[i];
+  r.position.y = py[i];
+  r.position.z = pz[i];
+  return r;
+  }
+
+// nlerp deviates from slerp noticeably only for wide arcs: below this cosine slerp is used
+static constexpr float NlerpMinDot = 0.95f;
+
+static void slerpBatch(AnimSampleBatch& dst, const AnimSampleBatch& x, const AnimSampleBatch& y, float a, size_t i) {
+  const glm::quat q = glm::slerp(x.get(i).rotation,y.get(i).rotation,a);
+  dst.qx[i] = q.x;
+  dst.qy[i] = q.y;
+  dst.qz[i] = q.z;
+  dst.qw[i] = q.w;
+  }
+
+static void mixBatch(AnimSampleBatch& dst, const AnimSampleBatch& x, const AnimSampleBatch& y, float a, size_t begin, size_t end) {
+  // nlerp for close keyframes, slerp for wide arcs
+  for(size_t i=begin; i<end; ++i) {
+    const float d  = x.qx[i]*y.qx[i] + x.qy[i]*y.qy[i] + x.qz[i]*y.qz[i] + x.qw[i]*y.qw[i];
+    if(std::fabs(d)<NlerpMinDot) {
+      slerpBatch(dst,x,y,a,i);
+      dst.px[i] = mix(x.px[i],y.px[i],a);
+      dst.py[i] = mix(x.py[i],y.py[i],a);
+      dst.pz[i] = mix(x.pz[i],y.pz[i],a);
+      continue;
+      }
+    const float b  = d<0 ? -a : a;
+    const float ia = 1.f-a;
+    float qx = x.qx[i]*ia + y.qx[i]*b;
+    float qy = x.qy[i]*ia + y.qy[i]*b;
+    float qz = x.qz[i]*ia + y.qz[i]*b;
+    float qw = x.qw[i]*ia + y.qw[i]*b;
+    const float l = qx*qx + qy*qy + qz*qz + qw*qw;
+    const float k = l>0 ? 1.f/std::sqrt(l) : 0.f;
+    dst.qx[i] = qx*k;
+    dst.qy[i] = qy*k;
+    dst.qz[i] = qz*k;
+    dst.qw[i] = qw*k;
+    dst.px[i] = mix(x.px[i],y.px[i],a);
+    dst.py[i] = mix(x.py[i],y.py[i],a);
+    dst.pz[i] = mix(x.pz[i],y.pz[i],a);
+    }
+  }
+
+#if defined(ANIM_SSE2)
+static size_t mixBatchSse2(AnimSampleBatch& dst, const AnimSampleBatch& x, const AnimSampleBatch& y, float a, size_t i, size_t count) {
+  const __m128 va   = _mm_set1_ps(a);
+  const __m128 via  = _mm_set1_ps(1.f-a);
+  const __m128 sign = _mm_set1_ps(-0.f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 wide = _mm_set1_ps(NlerpMinDot);
+  for(; i+4<=count; i+=4) {
+    const __m128 x0 = _mm_load_ps(x.qx+i), x1 = _mm_load_ps(x.qy+i), x2 = _mm_load_ps(x.qz+i), x3 = _mm_load_ps(x.qw+i);
+    const __m128 y0 = _mm_load_ps(y.qx+i), y1 = _mm_load_ps(y.qy+i), y2 = _mm_load_ps(y.qz+i), y3 = _mm_load_ps(y.qw+i);
+
+    __m128 d = _mm_mul_ps(x0,y0);
+    d = _mm_add_ps(d,_mm_mul_ps(x1,y1));
+    d = _mm_add_ps(d,_mm_mul_ps(x2,y2));
+    d = _mm_add_ps(d,_mm_mul_ps(x3,y3));
+
+    // rare: wide arc in some of lanes; scalar path reads each lane before writing it, so dst may alias x or y
+    if(_mm_movemask_ps(_mm_cmplt_ps(_mm_andnot_ps(sign,d),wide))!=0) {
+      mixBatch(dst,x,y,a,i,i+4);
+      continue;
+      }
+
+    // shortest path: flip sign of weight, if quaternions are in different hemispheres
+    const __m128 b = _mm_xor_ps(va,_mm_and_ps(_mm_cmplt_ps(d,zero),sign));
+
+    __m128 q0 = _mm_add_ps(_mm_mul_ps(x0,via),_mm_mul_ps(y0,b));
+    __m128 q1 = _mm_add_ps(_mm_mul_ps(x1,via),_mm_mul_ps(y1,b));
+    __m128 q2 = _mm_add_ps(_mm_mul_ps(x2,via),_mm_mul_ps(y2,b));
+    __m128 q3 = _mm_add_ps(_mm_mul_ps(x3,via),_mm_mul_ps(y3,b));
+
+    __m128 l = _mm_mul_ps(q0,q0);
+    l = _mm_add_ps(l,_mm_mul_ps(q1,q1));
+    l = _mm_add_ps(l,_mm_mul_ps(q2,q2));
+    l = _mm_add_ps(l,_mm_mul_ps(q3,q3));
+    const __m128 k = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.f),_mm_sqrt_ps(l)),_mm_cmpgt_ps(l,zero));
+
+    _mm_store_ps(dst.qx+i,_mm_mul_ps(q0,k));
+    _mm_store_ps(dst.qy+i,_mm_mul_ps(q1,k));
+    _mm_store_ps(dst.qz+i,_mm_mul_ps(q2,k));
+    _mm_store_ps(dst.qw+i,_mm_mul_ps(q3,k));
+
+    _mm_store_ps(dst.px+i,_mm_add_ps(_mm_mul_ps(_mm_load_ps(x.px+i),via),_mm_mul_ps(_mm_load_ps(y.px+i),va)));
+    _mm_store_ps(dst.py+i,_mm_add_ps(_mm_mul_ps(_mm_load_ps(x.py+i),via),_mm_mul_ps(_mm_load_ps(y.py+i),va)));
+    _mm_store_ps(dst.pz+i,_mm_add_ps(_mm_mul_ps(_mm_load_ps(x.pz+i),via),_mm_mul_ps(_mm_load_ps(y.pz+i),va)));
+    }
+  return i;
+  }
+#endif
+
+#if defined(ANIM_AVX2)
+ANIM_TARGET_AVX2
+static size_t mixBatchAvx2(AnimSampleBatch& dst, const AnimSampleBatch& x, const AnimSampleBatch& y, float a, size_t i, size_t count) {
+  // same as sse2 version, eight bones at once
+  const __m256 va   = _mm256_set1_ps(a);
+  const __m256 via  = _mm256_set1_ps(1.f-a);
+  const __m256 sign = _mm256_set1_ps(-0.f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 wide = _mm256_set1_ps(NlerpMinDot);
+  for(; i+8<=count; i+=8) {
+    const __m256 x0 = _mm256_loadu_ps(x.qx+i), x1 = _mm256_loadu_ps(x.qy+i), x2 = _mm256_loadu_ps(x.qz+i), x3 = _mm256_loadu_ps(x.qw+i);
+    const __m256 y0 = _mm256_loadu_ps(y.qx+i), y1 = _mm256_loadu_ps(y.qy+i), y2 = _mm256_loadu_ps(y.qz+i), y3 = _mm256_loadu_ps(y.qw+i);
+
+    __m256 d = _mm256_mul_ps(x0,y0);
+    d = _mm256_add_ps(d,_mm256_mul_ps(x1,y1));
+    d = _mm256_add_ps(d,_mm256_mul_ps(x2,y2));
+    d = _mm256_add_ps(d,_mm256_mul_ps(x3,y3));
+
+    if(_mm256_movemask_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign,d),wide,_CMP_LT_OQ))!=0) {
+      mixBatch(dst,x,y,a,i,i+8);
+      continue;
+      }
+
+    const __m256 b = _mm256_xor_ps(va,_mm256_and_ps(_mm256_cmp_ps(d,zero,_CMP_LT_OQ),sign));
+
+    __m256 q0 = _mm256_add_ps(_mm256_mul_ps(x0,via),_mm256_mul_ps(y0,b));
+    __m256 q1 = _mm256_add_ps(_mm256_mul_ps(x1,via),_mm256_mul_ps(y1,b));
+    __m256 q2 = _mm256_add_ps(_mm256_mul_ps(x2,via),_mm256_mul_ps(y2,b));
+    __m256 q3 = _mm256_add_ps(_mm256_mul_ps(x3,via),_mm256_mul_ps(y3,b));
+
+    __m256 l = _mm256_mul_ps(q0,q0);
+    l = _mm256_add_ps(l,_mm256_mul_ps(q1,q1));
+    l = _mm256_add_ps(l,_mm256_mul_ps(q2,q2));
+    l = _mm256_add_ps(l,_mm256_mul_ps(q3,q3));
+    const __m256 k = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.f),_mm256_sqrt_ps(l)),_mm256_cmp_ps(l,zero,_CMP_GT_OQ));
+
+    _mm256_storeu_ps(dst.qx+i,_mm256_mul_ps(q0,k));
+    _mm256_storeu_ps(dst.qy+i,_mm256_mul_ps(q1,k));
+    _mm256_storeu_ps(dst.qz+i,_mm256_mul_ps(q2,k));
+    _mm256_storeu_ps(dst.qw+i,_mm256_mul_ps(q3,k));
+
+    _mm256_storeu_ps(dst.px+i,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x.px+i),via),_mm256_mul_ps(_mm256_loadu_ps(y.px+i),va)));
+    _mm256_storeu_ps(dst.py+i,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x.py+i),via),_mm256_mul_ps(_mm256_loadu_ps(y.py+i),va)));
+    _mm256_storeu_ps(dst.pz+i,_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x.pz+i),via),_mm256_mul_ps(_mm256_loadu_ps(y.pz+i),va)));
+    }
+  return i;
+  }
+#endif
+
+void mixBatch(AnimSampleBatch& dst, const AnimSampleBatch& x, const AnimSampleBatch& y, float a, size_t count) {
+  size_t i = 0;
+#if defined(ANIM_AVX2)
+  if(simdLevel>=AnimSimd::AVX2)
+    i = mixBatchAvx2(dst,x,y,a,i,count);
+#endif
+#if defined(ANIM_SSE2)
+  if(simdLevel>=AnimSimd::SSE2)
+    i = mixBatchSse2(dst,x,y,a,i,count);
+#endif
+  mixBatch(dst,x,y,a,i,count);
+  }
+
+static void mkMatrixBatch(float (*dst)[16], const AnimSampleBatch& s, size_t begin, size_t end) {
+  for(size_t i=begin; i<end; ++i) {
+    auto m = mkMatrix(s.qx[i],s.qy[i],s.qz[i],s.qw[i], s.px[i],s.py[i],s.pz[i]);
+    std::copy(m.data(),m.data()+16,dst[i]);
+    }
+  }
+
+#if defined(ANIM_SSE2)
+static size_t mkMatrixBatchSse2(float (*dst)[16], const AnimSampleBatch& s, size_t i, size_t count) {
+  const __m128 two  = _mm_set1_ps(2.f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one  = _mm_set1_ps(1.f);
+  for(; i+4<=count; i+=4) {
+    const __m128 x = _mm_load_ps(s.qx+i), y = _mm_load_ps(s.qy+i), z = _mm_load_ps(s.qz+i), w = _mm_load_ps(s.qw+i);
+    const __m128 xx = _mm_mul_ps(x,x), yy = _mm_mul_ps(y,y), zz = _mm_mul_ps(z,z), ww = _mm_mul_ps(w,w);
+    const __m128 xy = _mm_mul_ps(x,y), xz = _mm_mul_ps(x,z), yz = _mm_mul_ps(y,z);
+    const __m128 wx = _mm_mul_ps(w,x), wy = _mm_mul_ps(w,y), wz = _mm_mul_ps(w,z);
+
+    // same as scalar mkMatrix, four bones at once; one register per matrix element
+    __m128 c0 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(ww,xx),yy),zz);
+    __m128 c1 = _mm_mul_ps(two,_mm_sub_ps(xy,wz));
+    __m128 c2 = _mm_mul_ps(two,_mm_add_ps(xz,wy));
+    __m128 c3 = zero;
+    _MM_TRANSPOSE4_PS(c0,c1,c2,c3);
+    _mm_storeu_ps(dst[i+0]+0,c0);
+    _mm_storeu_ps(dst[i+1]+0,c1);
+    _mm_storeu_ps(dst[i+2]+0,c2);
+    _mm_storeu_ps(dst[i+3]+0,c3);
+
+    c0 = _mm_mul_ps(two,_mm_add_ps(xy,wz));
+    c1 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(ww,yy),xx),zz);
+    c2 = _mm_mul_ps(two,_mm_sub_ps(yz,wx));
+    c3 = zero;
+    _MM_TRANSPOSE4_PS(c0,c1,c2,c3);
+    _mm_storeu_ps(dst[i+0]+4,c0);
+    _mm_storeu_ps(dst[i+1]+4,c1);
+    _mm_storeu_ps(dst[i+2]+4,c2);
+    _mm_storeu_ps(dst[i+3]+4,c3);
+
+    c0 = _mm_mul_ps(two,_mm_sub_ps(xz,wy));
+    c1 = _mm_mul_ps(two,_mm_add_ps(yz,wx));
+    c2 = _mm_sub_ps(_mm_sub_ps(_mm_add_ps(ww,zz),xx),yy);
+    c3 = zero;
+    _MM_TRANSPOSE4_PS(c0,c1,c2,c3);
+    _mm_storeu_ps(dst[i+0]+8,c0);
+    _mm_storeu_ps(dst[i+1]+8,c1);
+    _mm_storeu_ps(dst[i+2]+8,c2);
+    _mm_storeu_ps(dst[i+3]+8,c3);
+
+    c0 = _mm_load_ps(s.px+i);
+    c1 = _mm_load_ps(s.py+i);
+    c2 = _mm_load_ps(s.pz+i);
+    c3 = one;
+    _MM_TRANSPOSE4_PS(c0,c1,c2,c3);
+    _mm_storeu_ps(dst[i+0]+12,c0);
+    _mm_storeu_ps(dst[i+1]+12,c1);
+    _mm_storeu_ps(dst[i+2]+12,c2);
+    _mm_storeu_ps(dst[i+3]+12,c3);
+    }
+  return i;
+  }
+#endif
+
+#if defined(ANIM_AVX2)
+ANIM_TARGET_AVX2
+static inline void storeColumns(float (*dst)[16], size_t at, __m256 c0, __m256 c1, __m256 c2, __m256 c3) {
+  // low and high halves are two groups of four bones
+  __m128 l0 = _mm256_castps256_ps128(c0), l1 = _mm256_castps256_ps128(c1), l2 = _mm256_castps256_ps128(c2), l3 = _mm256_castps256_ps128(c3);
+  __m128 h0 = _mm256_extractf128_ps(c0,1), h1 = _mm256_extractf128_ps(c1,1), h2 = _mm256_extractf128_ps(c2,1), h3 = _mm256_extractf128_ps(c3,1);
+  _MM_TRANSPOSE4_PS(l0,l1,l2,l3);
+  _MM_TRANSPOSE4_PS(h0,h1,h2,h3);
+  _mm_storeu_ps(dst[0]+at,l0);
+  _mm_storeu_ps(dst[1]+at,l1);
+  _mm_storeu_ps(dst[2]+at,l2);
+  _mm_storeu_ps(dst[3]+at,l3);
+  _mm_storeu_ps(dst[4]+at,h0);
+  _mm_storeu_ps(dst[5]+at,h1);
+  _mm_storeu_ps(dst[6]+at,h2);
+  _mm_storeu_ps(dst[7]+at,h3);
+  }
+
+ANIM_TARGET_AVX2
+static size_t mkMatrixBatchAvx2(float (*dst)[16], const AnimSampleBatch& s, size_t i, size_t count) {
+  const __m256 two  = _mm256_set1_ps(2.f);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one  = _mm256_set1_ps(1.f);
+  for(; i+8<=count; i+=8) {
+    const __m256 x = _mm256_loadu_ps(s.qx+i), y = _mm256_loadu_ps(s.qy+i), z = _mm256_loadu_ps(s.qz+i), w = _mm256_loadu_ps(s.qw+i);
+    const __m256 xx = _mm256_mul_ps(x,x), yy = _mm256_mul_ps(y,y), zz = _mm256_mul_ps(z,z), ww = _mm256_mul_ps(w,w);
+    const __m256 xy = _mm256_mul_ps(x,y), xz = _mm256_mul_ps(x,z), yz = _mm256_mul_ps(y,z);
+    const __m256 wx = _mm256_mul_ps(w,x), wy = _mm256_mul_ps(w,y), wz = _mm256_mul_ps(w,z);
+
+    storeColumns(dst+i,0,
+                 _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(ww,xx),yy),zz),
+                 _mm256_mul_ps(two,_mm256_sub_ps(xy,wz)),
+                 _mm256_mul_ps(two,_mm256_add_ps(xz,wy)),
+                 zero);
+    storeColumns(dst+i,4,
+                 _mm256_mul_ps(two,_mm256_add_ps(xy,wz)),
+                 _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(ww,yy),xx),zz),
+                 _mm256_mul_ps(two,_mm256_sub_ps(yz,wx)),
+                 zero);
+    storeColumns(dst+i,8,
+                 _mm256_mul_ps(two,_mm256_sub_ps(xz,wy)),
+                 _mm256_mul_ps(two,_mm256_add_ps(yz,wx)),
+                 _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(ww,zz),xx),yy),
+                 zero);
+    storeColumns(dst+i,12,_mm256_loadu_ps(s.px+i),_mm256_loadu_ps(s.py+i),_mm256_loadu_ps(s.pz+i),one);
+    }
+  return i;
+  }
+#endif
+
+void mkMatrixBatch(float (*dst)[16], const AnimSampleBatch& s, size_t count) {
+  size_t i = 0;
+#if defined(ANIM_AVX2)
+  if(simdLevel>=AnimSimd::AVX2)
+    i = mkMatrixBatchAvx2(dst,s,i,count);
+#endif
+#if defined(ANIM_SSE2)
+  if(simdLevel>=AnimSimd::SSE2)
+    i = mkMatrixBatchSse2(dst,s,i,count);
+#endif
+  mkMatrixBatch(dst,s,i,count);
+  }
+
+#if defined(ANIM_SSE2)
+static void mulMatrixSse2(float* r, const float* a, const float* b) {
+  const __m128 a0 = _mm_loadu_ps(a+0);
+  const __m128 a1 = _mm_loadu_ps(a+4);
+  const __m128 a2 = _mm_loadu_ps(a+8);
+  const __m128 a3 = _mm_loadu_ps(a+12);
+  for(int i=0; i<4; ++i) {
+    const float* bi = b+i*4;
+    __m128 v = _mm_mul_ps(a0,_mm_set1_ps(bi[0]));
+    v = _mm_add_ps(v,_mm_mul_ps(a1,_mm_set1_ps(bi[1])));
+    v = _mm_add_ps(v,_mm_mul_ps(a2,_mm_set1_ps(bi[2])));
+    v = _mm_add_ps(v,_mm_mul_ps(a3,_mm_set1_ps(bi[3])));
+    _mm_storeu_ps(r+i*4,v);
+    }
+  }
+#endif
+
+void mulMatrix(Tempest::Matrix4x4& dst, const float* a, const float* b) {
+  float r[16];
+#if defined(ANIM_SSE2)
+  if(simdLevel>=AnimSimd::SSE2) {
+    mulMatrixSse2(r,a,b);
+    dst = Tempest::Matrix4x4(r);
+    return;
+    }
+#endif
+  for(int i=0; i<4; ++i)
+    for(int j=0; j<4; ++j) {
+      float v = 0;
+      for(int q=0; q<4; ++q)
+        v += a[q*4+j]*b[i*4+q];
+      r[i*4+j] = v;
+      }
+  dst = Tempest::Matrix4x4(r);
+  }
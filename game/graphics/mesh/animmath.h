@@ -5,5 +5,42 @@
 
 #include <zenkit/ModelAnimation.hh>
 
+#include <cstdint>
+
+#include "resources.h"
+
+// SoA storage of animation samples, for batched kernels
+struct AnimSampleBatch final {
+  static constexpr size_t MaxSize = (Resources::MAX_NUM_SKELETAL_NODES+3)/4*4;
+
+  alignas(16) float qx[MaxSize];
+  alignas(16) float qy[MaxSize];
+  alignas(16) float qz[MaxSize];
+  alignas(16) float qw[MaxSize];
+  alignas(16) float px[MaxSize];
+  alignas(16) float py[MaxSize];
+  alignas(16) float pz[MaxSize];
+
+  void                    set(size_t i, const zenkit::AnimationSample& s);
+  zenkit::AnimationSample get(size_t i) const;
+  };
+
 zenkit::AnimationSample mix(const zenkit::AnimationSample& x, const zenkit::AnimationSample& y, float a);
 Tempest::Matrix4x4      mkMatrix(const zenkit::AnimationSample& s);
+
+// instruction set of batched kernels: best supported one is detected at startup
+enum class AnimSimd : uint8_t {
+  Scalar = 0,
+  SSE2   = 1,
+  AVX2   = 2,
+  };
+AnimSimd                animSimdSupported();
+AnimSimd                animSimd();
+// for benchmarks and tests: clamped to supported level
+void                    setAnimSimd(AnimSimd s);
+const char*             animSimdName(AnimSimd s);
+
+// batched versions: AVX2 or SSE2, when available, scalar otherwise
+void                    mixBatch(AnimSampleBatch& dst, const AnimSampleBatch& x, const AnimSampleBatch& y, float a, size_t count);
+void                    mkMatrixBatch(float (*dst)[16], const AnimSampleBatch& s, size_t count);
+void                    mulMatrix(Tempest::Matrix4x4& dst, const float* a, const float* b);
@@ -19,7 +19,7 @@ Landscape::Landscape(VisualObjects& visual, const PackedMesh &packed)
   for(size_t i=0; i<packed.subMeshes.size(); ++i) {
     auto& sub      = packed.subMeshes[i];
     auto  id       = uint32_t(sub.iboOffset/PackedMesh::MaxInd);
-    auto  material = Resources::loadMaterial(sub.material,true);
+    auto  material = Resources::loadMaterial(sub.material,true,true);
 
     if(material.alpha==Material::AdditiveLight || sub.iboLength==0) {
       continue;
@@ -0,0 +1,264 @@
+#include "packedanimation.h"
+
+#include "animmath.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+static const float  rotEpsilon = 0.002f; // max rotation error, in radians
+static const float  posEpsilon = 0.1f;   // max position error, in centimeters
+static const size_t maxKeyGap  = 16;     // bounds cost of key reduction at load time
+static const float  sqrt2      = 1.41421356f;
+
+template<class F>
+static void selectKeys(size_t numFrames, std::vector<uint16_t>& keys, const F& fits) {
+  keys.clear();
+  keys.push_back(0);
+
+  size_t b = 0;
+  while(b+1<numFrames) {
+    // greedy: extend segment, while all in-between frames can be interpolated from the segment ends
+    size_t e = b+1;
+    while(e+1<numFrames && e+1-b<=maxKeyGap) {
+      bool ok = true;
+      for(size_t f=b+1; f<=e && ok; ++f)
+        ok = fits(b,e+1,f);
+      if(!ok)
+        break;
+      ++e;
+      }
+    keys.push_back(uint16_t(e));
+    b = e;
+    }
+  }
+
+static void denseKeys(size_t numFrames, std::vector<uint16_t>& keys) {
+  keys.resize(numFrames);
+  for(size_t i=0; i<numFrames; ++i)
+    keys[i] = uint16_t(i);
+  }
+
+PackedAnimation::PackedAnimation(const std::vector<zenkit::AnimationSample>& samples, size_t numTracks) {
+  rawBytes = samples.size()*sizeof(zenkit::AnimationSample);
+  if(numTracks==0 || samples.size()<numTracks || samples.size()%numTracks!=0)
+    return;
+
+  numFrames = samples.size()/numTracks;
+  tracks.resize(numTracks);
+  for(size_t i=0; i<numTracks; ++i) {
+    packRotation(tracks[i], samples.data()+i, numTracks);
+    packPosition(tracks[i], samples.data()+i, numTracks);
+    }
+
+  keyFrames.shrink_to_fit();
+  rot.shrink_to_fit();
+  pos.shrink_to_fit();
+  }
+
+size_t PackedAnimation::memoryUsage() const {
+  return sizeof(*this) +
+         tracks.size()*sizeof(Track) + keyFrames.size()*sizeof(uint16_t) +
+         rot.size()*sizeof(PackedQuat) + pos.size()*sizeof(PackedPos);
+  }
+
+zenkit::AnimationSample PackedAnimation::sample(size_t track, size_t frame) const {
+  auto& t = tracks[track];
+  frame = std::min(frame, numFrames-1);
+
+  zenkit::AnimationSample r {};
+  r.rotation = rotation(t,frame);
+  r.position = position(t,frame);
+  return r;
+  }
+
+void PackedAnimation::sample(size_t frame, AnimSampleBatch& dst, size_t count) const {
+  frame = std::min(frame, numFrames-1);
+  count = std::min(count, tracks.size());
+  for(size_t i=0; i<count; ++i) {
+    auto& t = tracks[i];
+    auto  q = rotation(t,frame);
+    auto  p = position(t,frame);
+    dst.qx[i] = q.x;
+    dst.qy[i] = q.y;
+    dst.qz[i] = q.z;
+    dst.qw[i] = q.w;
+    dst.px[i] = p.x;
+    dst.py[i] = p.y;
+    dst.pz[i] = p.z;
+    }
+  }
+
+void PackedAnimation::packRotation(Track& t, const zenkit::AnimationSample* smp, size_t stride) {
+  const float rotCos = std::cos(rotEpsilon*0.5f);
+
+  std::vector<glm::quat> q(numFrames);
+  for(size_t i=0; i<numFrames; ++i) {
+    q[i] = glm::normalize(smp[i*stride].rotation);
+    if(i>0 && glm::dot(q[i],q[i-1])<0)
+      q[i] = -q[i];
+    }
+
+  bool constant = true;
+  for(size_t i=1; i<numFrames && constant; ++i)
+    constant = std::abs(glm::dot(q[0],q[i]))>=rotCos;
+
+  std::vector<uint16_t> keys;
+  if(constant) {
+    keys.push_back(0);
+    }
+  else if(numFrames<=0xFFFF) {
+    selectKeys(numFrames, keys, [&](size_t b, size_t e, size_t f) {
+      const float a = float(f-b)/float(e-b);
+      return std::abs(glm::dot(glm::slerp(q[b],q[e],a),q[f]))>=rotCos;
+      });
+    }
+
+  // sparse key costs key-frame index on top of sample itself
+  if(!constant && (keys.empty() || keys.size()*(sizeof(PackedQuat)+sizeof(uint16_t))>=numFrames*sizeof(PackedQuat)))
+    denseKeys(numFrames,keys);
+
+  t.rot.data = uint32_t(rot.size());
+  storeKeys(t.rot,keys);
+  for(auto k:keys)
+    rot.push_back(pack(q[k]));
+  }
+
+void PackedAnimation::packPosition(Track& t, const zenkit::AnimationSample* smp, size_t stride) {
+  std::vector<glm::vec3> p(numFrames);
+  glm::vec3 bbox[2] = {smp[0].position, smp[0].position};
+  for(size_t i=0; i<numFrames; ++i) {
+    p[i]    = smp[i*stride].position;
+    bbox[0] = glm::min(bbox[0],p[i]);
+    bbox[1] = glm::max(bbox[1],p[i]);
+    }
+
+  const glm::vec3 ext      = bbox[1]-bbox[0];
+  const bool      constant = std::max({ext.x,ext.y,ext.z})<=posEpsilon;
+
+  std::vector<uint16_t> keys;
+  if(constant) {
+    keys.push_back(0);
+    t.posMin   = (bbox[0]+bbox[1])*0.5f;
+    t.posScale = glm::vec3(0);
+    }
+  else {
+    if(numFrames<=0xFFFF) {
+      selectKeys(numFrames, keys, [&](size_t b, size_t e, size_t f) {
+        const float     a = float(f-b)/float(e-b);
+        const glm::vec3 d = glm::abs(p[b]+(p[e]-p[b])*a - p[f]);
+        return std::max({d.x,d.y,d.z})<=posEpsilon;
+        });
+      }
+    if(keys.empty() || keys.size()*(sizeof(PackedPos)+sizeof(uint16_t))>=numFrames*sizeof(PackedPos))
+      denseKeys(numFrames,keys);
+    t.posMin   = bbox[0];
+    t.posScale = ext/float(0xFFFF);
+    }
+
+  t.pos.data = uint32_t(pos.size());
+  storeKeys(t.pos,keys);
+  for(auto k:keys) {
+    PackedPos v;
+    for(int i=0; i<3; ++i) {
+      const float d = t.posScale[i]>0 ? (p[k][i]-t.posMin[i])/t.posScale[i] : 0.f;
+      v.v[i] = uint16_t(std::lround(std::clamp(d,0.f,float(0xFFFF))));
+      }
+    pos.push_back(v);
+    }
+  }
+
+void PackedAnimation::storeKeys(Channel& ch, const std::vector<uint16_t>& keys) {
+  ch.count = uint32_t(keys.size());
+  if(1<keys.size() && keys.size()<numFrames) {
+    ch.keys = uint32_t(keyFrames.size());
+    keyFrames.insert(keyFrames.end(), keys.begin(), keys.end());
+    }
+  }
+
+size_t PackedAnimation::findKey(const Channel& ch, size_t frame, float& a) const {
+  a = 0;
+  if(ch.count==1)
+    return 0;
+  if(ch.count==numFrames)
+    return frame;
+
+  const uint16_t* k  = &keyFrames[ch.keys];
+  const size_t    id = size_t(std::upper_bound(k, k+ch.count, frame) - k) - 1;
+  if(id+1>=ch.count)
+    return ch.count-1;
+  a = float(frame-k[id])/float(k[id+1]-k[id]);
+  return id;
+  }
+
+glm::quat PackedAnimation::rotation(const Track& t, size_t frame) const {
+  float      a  = 0;
+  const auto id = findKey(t.rot,frame,a);
+  const auto q0 = unpack(rot[t.rot.data+id]);
+  if(a<=0)
+    return q0;
+  return glm::slerp(q0,unpack(rot[t.rot.data+id+1]),a);
+  }
+
+glm::vec3 PackedAnimation::position(const Track& t, size_t frame) const {
+  float      a  = 0;
+  const auto id = findKey(t.pos,frame,a);
+  const auto p0 = unpack(t,pos[t.pos.data+id]);
+  if(a<=0)
+    return p0;
+  const auto p1 = unpack(t,pos[t.pos.data+id+1]);
+  return p0+(p1-p0)*a;
+  }
+
+glm::vec3 PackedAnimation::unpack(const Track& t, const PackedPos& p) const {
+  return t.posMin + glm::vec3(p.v[0],p.v[1],p.v[2])*t.posScale;
+  }
+
+PackedAnimation::PackedQuat PackedAnimation::pack(glm::quat q) {
+  const float c[4] = {q.x,q.y,q.z,q.w};
+
+  size_t id = 0;
+  for(size_t i=1; i<4; ++i)
+    if(std::abs(c[i])>std::abs(c[id]))
+      id = i;
+
+  // q and -q are same rotation: make largest component positive, so it can be restored from other three
+  const float sign = c[id]<0 ? -1.f : 1.f;
+
+  PackedQuat ret;
+  for(size_t i=0, r=0; i<4; ++i) {
+    if(i==id)
+      continue;
+    const float v = std::clamp(c[i]*sign*sqrt2*0.5f+0.5f, 0.f, 1.f);
+    ret.v[r] = uint16_t(std::lround(v*float(0x7FFF)));
+    ++r;
+    }
+  ret.v[0] = uint16_t(ret.v[0] | ((id&0x1)<<15));
+  ret.v[1] = uint16_t(ret.v[1] | ((id&0x2)<<14));
+  return ret;
+  }
+
+glm::quat PackedAnimation::unpack(const PackedQuat& q) {
+  const size_t id = size_t(q.v[0]>>15) | size_t((q.v[1]>>15)<<1);
+
+  float c[4] = {};
+  float sum  = 0;
+  for(size_t i=0, r=0; i<4; ++i) {
+    if(i==id)
+      continue;
+    const float v = float(q.v[r] & 0x7FFF)/float(0x7FFF);
+    c[i] = (v*2.f-1.f)/sqrt2;
+    sum += c[i]*c[i];
+    ++r;
+    }
+  c[id] = std::sqrt(std::max(0.f, 1.f-sum));
+
+  glm::quat ret;
+  ret.x = c[0];
+  ret.y = c[1];
+  ret.z = c[2];
+  ret.w = c[3];
+  return ret;
+  }
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <zenkit/ModelAnimation.hh>
+
+#include <cstdint>
+#include <vector>
+
+struct AnimSampleBatch;
+
+class PackedAnimation final {
+  public:
+    PackedAnimation() = default;
+    PackedAnimation(const std::vector<zenkit::AnimationSample>& samples, size_t numTracks);
+
+    bool                    isEmpty()    const { return tracks.empty(); }
+    size_t                  trackCount() const { return tracks.size();  }
+    size_t                  frameCount() const { return numFrames;      }
+
+    zenkit::AnimationSample sample(size_t track, size_t frame) const;
+    void                    sample(size_t frame, AnimSampleBatch& dst, size_t count) const;
+
+    size_t                  rawSize()    const { return rawBytes; }
+    size_t                  memoryUsage() const;
+
+  private:
+    // smallest-three quaternion: 2 bits of index + 3x15 bits of components
+    struct PackedQuat final {
+      uint16_t v[3] = {};
+      };
+
+    // per-track quantized position
+    struct PackedPos final {
+      uint16_t v[3] = {};
+      };
+
+    struct Channel final {
+      uint32_t keys  = 0; // offset in keyFrames, used only if 1<count<numFrames
+      uint32_t data  = 0; // offset in rot or pos
+      uint32_t count = 0; // 1 - constant channel
+      };
+
+    struct Track final {
+      Channel   rot, pos;
+      glm::vec3 posMin   = {};
+      glm::vec3 posScale = {};
+      };
+
+    void                    packRotation(Track& t, const zenkit::AnimationSample* smp, size_t stride);
+    void                    packPosition(Track& t, const zenkit::AnimationSample* smp, size_t stride);
+
+    void                    storeKeys(Channel& ch, const std::vector<uint16_t>& keys);
+    size_t                  findKey(const Channel& ch, size_t frame, float& a) const;
+
+    glm::quat               rotation(const Track& t, size_t frame) const;
+    glm::vec3               position(const Track& t, size_t frame) const;
+    glm::vec3               unpack(const Track& t, const PackedPos& p) const;
+
+    static PackedQuat       pack(glm::quat q);
+    static glm::quat        unpack(const PackedQuat& q);
+
+    std::vector<Track>      tracks;
+    std::vector<uint16_t>   keyFrames;
+    std::vector<PackedQuat> rot;
+    std::vector<PackedPos>  pos;
+    size_t                  numFrames = 0;
+    size_t                  rawBytes  = 0;
+  };
@@ -10,6 +10,7 @@
 #include "animmath.h"
 
 #include <cmath>
+#include <atomic>
 
 using namespace Tempest;
 
@@ -148,6 +149,8 @@ void Pose::setSkeleton(const Skeleton* sk) {
     }
   for(auto& i:hasSamples)
     i = S_None;
+  lodTime      = 0;
+  lodAlpha     = 1;
   trY          = skeleton->rootTr.y;
   needToUpdate = true;
   if(lay.size()>0) //TODO
@@ -312,7 +315,53 @@ void Pose::processLayers(AnimationSolver& solver, uint64_t tickCount) {
     }
   }
 
-bool Pose::update(uint64_t tickCount) {
+static uint64_t              lodInterval = 100;
+static std::atomic<uint32_t> lodStat[Pose::LodCount] = {};
+
+void Pose::setLodInterval(uint64_t ms) {
+  lodInterval = std::max<uint64_t>(ms,1);
+  }
+
+uint32_t Pose::lodStatistic(LodTier lod) {
+  return lodStat[lod].load(std::memory_order_relaxed);
+  }
+
+void Pose::resetLodStatistic() {
+  for(auto& i:lodStat)
+    i.store(0,std::memory_order_relaxed);
+  }
+
+bool Pose::update(uint64_t tickCount, LodTier lod) {
+  lodStat[lod].fetch_add(1,std::memory_order_relaxed);
+
+  if(lay.size()==0 || lastUpdate==0)
+    lod = LodFull;
+
+  switch(lod) {
+    case LodFull:
+    case LodCount:
+      lodTime  = 0;
+      lodAlpha = 1;
+      return implUpdate(tickCount);
+    case LodReduced:
+      return updateReduced(tickCount,lodInterval);
+    case LodDistant:
+      return updateReduced(tickCount,lodInterval*4);
+    case LodRootOnly:
+      // animation is on hold; skeleton still follows object matrix
+      lodTime  = 0;
+      lodAlpha = 1;
+      if(needToUpdate) {
+        mkSkeleton(pos);
+        needToUpdate = false;
+        return true;
+        }
+      return false;
+    }
+  return false;
+  }
+
+bool Pose::implUpdate(uint64_t tickCount) {
   if(lay.size()==0) {
     const bool ret = needToUpdate;
     if(needToUpdate || lastUpdate==0)
@@ -323,14 +372,7 @@ bool Pose::update(uint64_t tickCount) {
     }
 
   if(lastUpdate!=tickCount) {
-    for(auto& i:lay) {
-      const Animation::Sequence* seq = i.seq;
-      if(0<i.comb && i.comb<=i.seq->comb.size()) {
-        if(auto sx = i.seq->comb[size_t(i.comb-1)])
-          seq = sx;
-        }
-      needToUpdate |= updateFrame(*seq,i.bs,i.sBlend,lastUpdate,i.sAnim,tickCount);
-      }
+    sampleLayers(tickCount);
     lastUpdate = tickCount;
     }
 
@@ -342,12 +384,57 @@ bool Pose::update(uint64_t tickCount) {
   return false;
   }
 
+bool Pose::updateReduced(uint64_t tickCount, uint64_t interval) {
+  if(lodTime==0 || lodResample || tickCount<lodTime || tickCount>=lodTime+interval) {
+    const bool   restart = (lodTime==0 || tickCount<lodTime || lodPrev==nullptr);
+    const size_t count   = std::min(numBones,AnimSampleBatch::MaxSize);
+    if(lodPrev==nullptr)
+      lodPrev.reset(new AnimSampleBatch());
+
+    // previous key is the start of blend; bones without samples start from fresh key
+    SampleStatus had[AnimSampleBatch::MaxSize] = {};
+    for(size_t i=0; i<count; ++i) {
+      had[i] = hasSamples[i];
+      lodPrev->set(i,base[i]);
+      }
+    sampleLayers(tickCount);
+    for(size_t i=0; i<count; ++i) {
+      if(restart || had[i]==S_None)
+        lodPrev->set(i,base[i]);
+      }
+    lastUpdate  = tickCount;
+    lodTime     = tickCount;
+    lodResample = false;
+    }
+
+  // in between samples skeleton is blended from previous key towards last one, lagging by one interval
+  const float a = interval>0 ? std::min(1.f, float(tickCount-lodTime)/float(interval)) : 1.f;
+  if(a!=lodAlpha || needToUpdate) {
+    lodAlpha = a;
+    mkSkeleton(pos);
+    needToUpdate = false;
+    return true;
+    }
+  return false;
+  }
+
+void Pose::sampleLayers(uint64_t tickCount) {
+  for(auto& i:lay) {
+    const Animation::Sequence* seq = i.seq;
+    if(0<i.comb && i.comb<=i.seq->comb.size()) {
+      if(auto sx = i.seq->comb[size_t(i.comb-1)])
+        seq = sx;
+      }
+    needToUpdate |= updateFrame(*seq,i.bs,i.sBlend,lastUpdate,i.sAnim,tickCount);
+    }
+  }
+
 bool Pose::updateFrame(const Animation::Sequence &s, BodyState bs, uint64_t sBlend,
                        uint64_t barrier, uint64_t sTime, uint64_t now) {
   auto&        d         = *s.data;
   const size_t numFrames = d.numFrames;
-  const size_t idSize    = d.nodeIndex.size();
-  if(numFrames==0 || idSize==0 || d.samples.size()%idSize!=0)
+  const size_t idSize    = std::min(d.nodeIndex.size(),AnimSampleBatch::MaxSize);
+  if(numFrames==0 || idSize==0 || d.samples.trackCount()!=d.nodeIndex.size())
     return false;
   if(numFrames==1 && !needToUpdate)
     return false;
@@ -375,8 +462,11 @@ bool Pose::updateFrame(const Animation::Sequence &s, BodyState bs, uint64_t sBle
     frameB = d.numFrames-1-frameB;
     }
 
-  auto* sampleA = &d.samples[size_t(frameA*idSize)];
-  auto* sampleB = &d.samples[size_t(frameB*idSize)];
+  // decode and blend all tracks at once
+  AnimSampleBatch smpA, smpB;
+  d.samples.sample(size_t(frameA),smpA,idSize);
+  d.samples.sample(size_t(frameB),smpB,idSize);
+  mixBatch(smpA,smpA,smpB,a,idSize);
 
   const uint64_t blendMax = std::max(s.blendOut,s.blendIn);
   const uint64_t blend    = std::max<uint64_t>(0, now-sBlend);
@@ -385,7 +475,7 @@ bool Pose::updateFrame(const Animation::Sequence &s, BodyState bs, uint64_t sBle
     size_t idx = d.nodeIndex[i];
     if(idx>=numBones)
       continue;
-    auto smp = mix(sampleA[i],sampleB[i],a);
+    auto smp = smpA.get(i);
     if(i==0) {
       if(bs==BS_CLIMB)
         smp.position.y = trY;
@@ -430,15 +520,28 @@ void Pose::mkSkeleton(const Tempest::Matrix4x4& mt) {
 void Pose::implMkSkeleton(const Matrix4x4 &mt) {
   if(skeleton==nullptr)
     return;
-  auto& nodes      = skeleton->nodes;
-  auto  BIP01_HEAD = skeleton->BIP01_HEAD;
+  auto&        nodes      = skeleton->nodes;
+  auto         BIP01_HEAD = skeleton->BIP01_HEAD;
+  const size_t count      = std::min({nodes.size(),numBones,AnimSampleBatch::MaxSize});
+
+  AnimSampleBatch smp;
+  alignas(16) float local[AnimSampleBatch::MaxSize][16];
+  for(size_t i=0; i<count; ++i)
+    smp.set(i,base[i]);
+  if(lodPrev!=nullptr && lodAlpha<1.f) {
+    const AnimSampleBatch key = smp;
+    mixBatch(smp,*lodPrev,key,lodAlpha,count);
+    }
+  mkMatrixBatch(local,smp,count);
+
+  // nodes are ordered: parent always comes before child
   for(size_t i=0; i<nodes.size(); ++i) {
-    size_t parent = nodes[i].parent;
-    auto   mat    = hasSamples[i] ? mkMatrix(base[i]) : nodes[i].tr;
+    size_t       parent = nodes[i].parent;
+    const float* mat    = (i<count && hasSamples[i]) ? local[i] : nodes[i].tr.data();
 
     if(parent<Resources::MAX_NUM_SKELETAL_NODES)
-      tr[i] = tr[parent]*mat; else
-      tr[i] = mt*mat;
+      mulMatrix(tr[i],tr[parent].data(),mat); else
+      mulMatrix(tr[i],mt.data(),mat);
 
     if(i==BIP01_HEAD && (headRotX!=0 || headRotY!=0)) {
       Matrix4x4& m = tr[i];
@@ -455,7 +558,11 @@ void Pose::implMkSkeleton(const Tempest::Matrix4x4 &mt, size_t parent) {
   for(size_t i=0;i<nodes.size();++i){
     if(nodes[i].parent!=parent)
       continue;
-    auto mat = hasSamples[i] ? mkMatrix(base[i]) : nodes[i].tr;
+    auto mat = nodes[i].tr;
+    if(hasSamples[i] && lodPrev!=nullptr && lodAlpha<1.f && i<AnimSampleBatch::MaxSize)
+      mat = mkMatrix(mix(lodPrev->get(i),base[i],lodAlpha)); else
+    if(hasSamples[i])
+      mat = mkMatrix(base[i]);
     tr[i] = mt*mat;
     implMkSkeleton(tr[i],i);
     }
@@ -515,6 +622,7 @@ void Pose::addLayer(const Animation::Sequence *seq, BodyState bs, uint8_t comb,
   }
 
 void Pose::onAddLayer(const Pose::Layer& l) {
+  lodResample = true;
   if(hasLayerEvents(l))
     hasEvents++;
   if(l.seq->isFly())
@@ -525,6 +633,7 @@ void Pose::onAddLayer(const Pose::Layer& l) {
   }
 
 void Pose::onRemoveLayer(const Pose::Layer &l) {
+  lodResample = true;
   if(l.seq==rotation)
     rotation=nullptr;
   if(hasLayerEvents(l))
@@ -7,6 +7,7 @@
 
 #include "game/constants.h"
 #include "animation.h"
+#include "animmath.h"
 #include "resources.h"
 
 class Skeleton;
@@ -28,6 +29,14 @@ class Pose final {
       Force      = 0x1,
       };
 
+    enum LodTier : uint8_t {
+      LodFull     = 0, // evaluate every frame
+      LodReduced  = 1, // evaluate at lodInterval rate, blend last two samples in between
+      LodDistant  = 2, // evaluate at 4*lodInterval rate, blend last two samples in between
+      LodRootOnly = 3, // keep pose, follow object matrix only
+      LodCount    = 4,
+      };
+
     static uint8_t     calcAniComb(const Tempest::Vec3& dpos, float rotation);
     static uint8_t     calcAniCombVert(const Tempest::Vec3& dpos);
 
@@ -48,7 +57,11 @@ class Pose final {
     void               stopAllAnim();
 
     void               setObjectMatrix(const Tempest::Matrix4x4& obj, bool sync);
-    bool               update(uint64_t tickCount);
+    bool               update(uint64_t tickCount, LodTier lod = LodFull);
+
+    static void        setLodInterval(uint64_t ms);
+    static uint32_t    lodStatistic(LodTier lod);
+    static void        resetLodStatistic();
 
     void               processLayers(AnimationSolver &solver, uint64_t tickCount);
     bool               processEvents(uint64_t& barrier, uint64_t now, Animation::EvCount &ev) const;
@@ -113,6 +126,10 @@ class Pose final {
       void     setBreak()      { bits |=0x8000; }
       };
 
+    bool implUpdate(uint64_t tickCount);
+    bool updateReduced(uint64_t tickCount, uint64_t interval);
+    void sampleLayers(uint64_t tickCount);
+
     auto mkBaseTranslation() -> Tempest::Vec3;
     void mkSkeleton(const Tempest::Matrix4x4 &mt);
     void implMkSkeleton(const Tempest::Matrix4x4 &mt);
@@ -153,4 +170,8 @@ class Pose final {
     zenkit::AnimationSample         prev      [Resources::MAX_NUM_SKELETAL_NODES] = {};
     Tempest::Matrix4x4              tr        [Resources::MAX_NUM_SKELETAL_NODES] = {};
     Tempest::Matrix4x4              pos;
+    uint64_t                        lodTime     = 0; // last sample of reduced-rate animation
+    bool                            lodResample = false;
+    float                           lodAlpha    = 1; // blend factor from lodPrev to base
+    std::unique_ptr<AnimSampleBatch> lodPrev;         // previous sample of reduced-rate animation
   };
@@ -4,16 +4,16 @@
 #include <Tempest/Log>
 #include <fstream>
 #include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 
 #include "game/compatibility/phoenix.h"
-#include "gothic.h"
+#include "utils/workers.h"
 
 using namespace Tempest;
 
-static uint64_t mkUInt64(uint32_t a, uint32_t b) {
-  return (uint64_t(a)<<32) | uint64_t(b);
-  };
-
 static bool isVisuallySame(const zenkit::Material& a, const zenkit::Material& b) {
   return
           // a.name                         == b.name && // mat name
@@ -42,46 +42,382 @@ static bool isVisuallySame(const zenkit::Material& a, const zenkit::Material& b)
     a.default_mapping              == b.default_mapping;
   }
 
-struct PackedMesh::PrimitiveHeap {
-  using value_type = std::pair<uint64_t,uint32_t>;
-  using iterator   = std::vector<value_type>::iterator;
+static uint32_t mortonSpread(uint32_t x) {
+  x &= 0x3FF;
+  x = (x | (x<<16)) & 0x030000FF;
+  x = (x | (x<< 8)) & 0x0300F00F;
+  x = (x | (x<< 4)) & 0x030C30C3;
+  x = (x | (x<< 2)) & 0x09249249;
+  return x;
+  }
 
-  std::vector<std::pair<uint64_t,uint32_t>>  data;
+// Pipelines cull by winding: which side is front is voted by vertex normals over the whole mesh
+static float frontFace(const zenkit::Mesh& mesh) {
+  auto& vbo  = mesh.vertices;
+  auto& ibo  = mesh.polygons.vertex_indices;
+  auto& feat = mesh.polygons.feature_indices;
 
-  void   reserve(size_t n) { data.reserve(n*3); }
+  int64_t vote = 0;
+  for(size_t i=0; i+2<ibo.size(); i+=3) {
+    auto& a = vbo[ibo[i+0]];
+    auto& b = vbo[ibo[i+1]];
+    auto& c = vbo[ibo[i+2]];
+    Vec3  n = Vec3::crossProduct(Vec3(b.x-a.x,b.y-a.y,b.z-a.z),Vec3(c.x-a.x,c.y-a.y,c.z-a.z));
+    Vec3  v;
+    for(size_t r=0; r<3; ++r) {
+      auto& nr = mesh.features[feat[i+r]].normal;
+      v = v + Vec3(nr.x,nr.y,nr.z);
+      }
+    const float d = Vec3::dotProduct(n,v);
+    vote += d>0 ? 1 : (d<0 ? -1 : 0);
+    }
+  return vote<0 ? -1.f : 1.f;
+  }
 
-  void   clear() { data.clear();        }
-  size_t size()  { return data.size();  }
-  bool   empty() { return data.empty(); }
+// Meshlets of a single sub-mesh. Meshlet grows over shared vertices: candidate triangles are scored by
+// number of new vertices, distance to meshlet center and deviation from average normal.
+// Once nothing connected fits, next meshlet is seeded from unused triangles in morton order.
+struct PackedMesh::MeshletBuilder {
+  static constexpr float    ConeWeight = 0.5f;
+  static constexpr uint8_t  NoSlot     = 0xFF;
+  static constexpr uint32_t NoTri      = uint32_t(-1);
+
+  std::vector<Vert>                         corners;   // 3 per triangle
+  std::vector<uint32_t>                     cornerId;  // dense vertex id of each corner
+  std::vector<uint32_t>                     cornerPos; // dense position id of each corner
+  std::vector<Vert>                         verts;
+  std::vector<uint32_t>                     posMap;    // vbo index -> dense position id
+  std::vector<uint32_t>                     positions;
+  std::vector<uint32_t>                     adjOffset; // triangles at position p: adjTri[adjOffset[p]..adjOffset[p+1]]
+  std::vector<uint32_t>                     adjFill;
+  std::vector<uint32_t>                     adjTri;
+  std::vector<Vec3>                         triCenter;
+  std::vector<Vec3>                         triNormal; // of front face
+  std::vector<std::pair<uint32_t,uint32_t>> seeds;
+  std::vector<uint8_t>                      used;
+  std::vector<uint8_t>                      slot;      // vertex -> index in active meshlet
+  std::vector<uint32_t>                     live;      // position -> number of unused triangles
+  std::vector<uint32_t>                     mark;      // triangle -> last meshlet, it was a candidate of
+  std::vector<uint32_t>                     candidates;
+  std::vector<uint8_t>                      extraOf;   // triangle -> number of new vertices, valid for candidates
+  float                                     radius = 1; // expected radius of a full meshlet
+
+  uint32_t                                  activeVert[MaxVert] = {};
+  uint32_t                                  activeTri [MaxPrim] = {};
+  uint32_t                                  meshletId = 0;
+  Vec3                                      centerSum, axisSum;
+
+  void     clear() { corners.clear(); }
+  bool     empty() const { return corners.empty(); }
+  void     push(const Vert& v) { corners.push_back(v); }
+
+  // front: sign of cross-product of front faces; 0 - no normal cones
+  std::vector<Meshlet> build(const std::vector<glm::vec3>& vbo, float front, MeshletStats& stats);
+
+  void     prepare(const std::vector<glm::vec3>& vbo, float front);
+  uint8_t  newVertices(uint32_t tri) const;
+  uint8_t  priority(uint32_t tri, uint8_t extra) const;
+  uint32_t bestCandidate(const Meshlet& m, bool& fits);
+  void     append(Meshlet& m, uint32_t tri);
+  void     emit(Meshlet& m, const std::vector<glm::vec3>& vbo, bool cone, std::vector<Meshlet>& out, MeshletStats& stats);
+  void     computeCone(Cluster& c, size_t numTri) const;
+  };
 
-  void   push_back(const value_type& v) { data.push_back(v); }
+PackedMesh::MeshletStats& PackedMesh::MeshletStats::operator += (const MeshletStats& other) {
+  meshlets     += other.meshlets;
+  vertices     += other.vertices;
+  primitives   += other.primitives;
+  cones        += other.cones;
+  radius       += other.radius;
+  halfDiagonal += other.halfDiagonal;
+  return *this;
+  }
 
-  void   sort() {
-    std::sort(data.begin(), data.end(), [](const value_type& l, const value_type& r){
-      return l.first<r.first;
-      });
+void PackedMesh::MeshletBuilder::prepare(const std::vector<glm::vec3>& vbo, float front) {
+  const size_t numTri = corners.size()/3;
+
+  // adjacency is over positions, so meshlet can grow across uv-seams
+  posMap.resize(vbo.size(),NoTri);
+  positions.clear();
+  cornerPos.resize(corners.size());
+  for(size_t i=0; i<corners.size(); ++i) {
+    auto& p = posMap[corners[i].first];
+    if(p==NoTri) {
+      p = uint32_t(positions.size());
+      positions.push_back(corners[i].first);
+      }
+    cornerPos[i] = p;
+    }
+  for(auto i:positions)
+    posMap[i] = NoTri;
+
+  // counting sort of corners by position
+  adjOffset.assign(positions.size()+1,0);
+  for(auto p:cornerPos)
+    adjOffset[p+1]++;
+  for(size_t i=1; i<adjOffset.size(); ++i)
+    adjOffset[i] += adjOffset[i-1];
+  adjFill.assign(adjOffset.begin(),adjOffset.end()-1);
+  adjTri .resize(corners.size());
+  for(size_t i=0; i<corners.size(); ++i)
+    adjTri[adjFill[cornerPos[i]]++] = uint32_t(i);
+
+  // dense vertex ids: distinct features at the same position; usually just a few
+  verts.clear();
+  cornerId.resize(corners.size());
+  for(size_t p=0; p+1<adjOffset.size(); ++p) {
+    const size_t first = verts.size();
+    for(uint32_t i=adjOffset[p]; i<adjOffset[p+1]; ++i) {
+      const uint32_t c  = adjTri[i];
+      size_t         id = first;
+      while(id<verts.size() && verts[id]!=corners[c])
+        ++id;
+      if(id==verts.size())
+        verts.push_back(corners[c]);
+      cornerId[c] = uint32_t(id);
+      adjTri  [i] = c/3;
+      }
     }
 
-  iterator begin() { return data.begin(); }
-  iterator end()   { return data.end();   }
+  triCenter.resize(numTri);
+  triNormal.resize(numTri);
+  float area = 0;
+  for(size_t i=0; i<numTri; ++i) {
+    auto& a  = vbo[corners[i*3+0].first];
+    auto& b  = vbo[corners[i*3+1].first];
+    auto& c  = vbo[corners[i*3+2].first];
+    Vec3  pa = Vec3(a.x,a.y,a.z);
+    Vec3  pb = Vec3(b.x,b.y,b.z);
+    Vec3  pc = Vec3(c.x,c.y,c.z);
+    Vec3  n  = Vec3::crossProduct(pb-pa,pc-pa);
+    float l  = n.length();
+    triCenter[i] = (pa+pb+pc)*(1.f/3.f);
+    // degenerated triangle is invisible: no normal, doesn't affect normal cone
+    triNormal[i] = l>0 ? n*((front<0 ? -1.f : 1.f)/l) : Vec3();
+    area        += l*0.5f;
+    }
+  radius = std::sqrt(std::max(area/float(numTri),1e-6f)*float(MaxPrim)/3.1415926f);
 
-  iterator erase(iterator& i) {
-    return data.erase(i);
+  Vec3 lo = triCenter[0], hi = triCenter[0];
+  for(auto& c:triCenter) {
+    lo.x = std::min(lo.x,c.x); lo.y = std::min(lo.y,c.y); lo.z = std::min(lo.z,c.z);
+    hi.x = std::max(hi.x,c.x); hi.y = std::max(hi.y,c.y); hi.z = std::max(hi.z,c.z);
+    }
+  const float scale = 1023.f/std::max({hi.x-lo.x, hi.y-lo.y, hi.z-lo.z, 1e-6f});
+  seeds.resize(numTri);
+  for(size_t i=0; i<numTri; ++i) {
+    const Vec3     p = (triCenter[i]-lo)*scale;
+    const uint32_t x = std::min(uint32_t(p.x),1023u);
+    const uint32_t y = std::min(uint32_t(p.y),1023u);
+    const uint32_t z = std::min(uint32_t(p.z),1023u);
+    seeds[i] = std::make_pair(mortonSpread(x) | mortonSpread(y)<<1 | mortonSpread(z)<<2, uint32_t(i));
     }
+  std::sort(seeds.begin(), seeds.end());
+  }
+
+std::vector<PackedMesh::Meshlet> PackedMesh::MeshletBuilder::build(const std::vector<glm::vec3>& vbo, float front, MeshletStats& stats) {
+  std::vector<Meshlet> ret;
+  const size_t numTri = corners.size()/3;
+  if(numTri==0)
+    return ret;
+  prepare(vbo,front);
+
+  const bool cone = (front!=0);
+
+  used.assign(numTri,0);
+  mark.assign(numTri,uint32_t(-1));
+  extraOf.resize(numTri);
+  slot.assign(verts.size(),NoSlot);
+  live.resize(positions.size());
+  for(size_t i=0; i<positions.size(); ++i)
+    live[i] = adjOffset[i+1]-adjOffset[i];
+  candidates.clear();
+  meshletId = 0;
+  centerSum = Vec3();
+  axisSum   = Vec3();
 
-  std::pair<iterator,iterator> equal_range(uint64_t v) {
-    auto l = std::lower_bound(data.begin(), data.end(), v, [](const value_type& x, uint64_t v){
-      return x.first<v;
-      });
-    auto r = l; ++r;
-    while(r!=data.end()) {
-      if(r->first>v)
+  Meshlet active;
+  size_t  nextSeed = 0;
+  while(true) {
+    bool     fits = false;
+    uint32_t tri  = bestCandidate(active,fits);
+    if(tri!=NoTri && !fits) {
+      // full: next meshlet starts right next to this one
+      emit(active,vbo,cone,ret,stats);
+      }
+
+    if(tri==NoTri) {
+      while(nextSeed<seeds.size() && used[seeds[nextSeed].second])
+        ++nextSeed;
+      if(nextSeed==seeds.size())
         break;
-      ++r;
+      tri = seeds[nextSeed].second;
+
+      // disconnected piece goes to the active meshlet, only if there is room and it's nearby
+      const Vec3 center = centerSum*(3.f/float(std::max<uint8_t>(active.indSz,1)));
+      if(active.indSz>0 && (active.vertSz+newVertices(tri)>MaxVert || active.indSz+3>MaxInd ||
+                            (triCenter[tri]-center).length()>2.f*radius))
+        emit(active,vbo,cone,ret,stats);
       }
-    return std::make_pair(l,r);
+    append(active,tri);
     }
-  };
+
+  if(active.indSz>0)
+    emit(active,vbo,cone,ret,stats);
+  return ret;
+  }
+
+uint8_t PackedMesh::MeshletBuilder::newVertices(uint32_t tri) const {
+  const uint32_t* v   = &cornerId[tri*3];
+  uint8_t         ret = 0;
+  if(slot[v[0]]==NoSlot)
+    ++ret;
+  if(slot[v[1]]==NoSlot && v[1]!=v[0])
+    ++ret;
+  if(slot[v[2]]==NoSlot && v[2]!=v[0] && v[2]!=v[1])
+    ++ret;
+  return ret;
+  }
+
+uint8_t PackedMesh::MeshletBuilder::priority(uint32_t tri, uint8_t extra) const {
+  if(extra==0)
+    return 0;
+  // last unused triangle at a position: would end up stranded, if not taken now
+  const uint32_t* v = &cornerPos[tri*3];
+  if(live[v[0]]==1 || live[v[1]]==1 || live[v[2]]==1)
+    return 1;
+  return uint8_t(extra+1);
+  }
+
+uint32_t PackedMesh::MeshletBuilder::bestCandidate(const Meshlet& m, bool& fits) {
+  fits = false;
+  if(m.indSz==0)
+    return NoTri;
+
+  const Vec3  center = centerSum*(3.f/float(m.indSz));
+  const float len    = axisSum.length();
+  const Vec3  axis   = len>0 ? axisSum*(1.f/len) : Vec3();
+  const float invR2  = 1.f/(radius*radius);
+
+  // fewer new vertices always wins, score breaks the ties
+  uint32_t best      = NoTri;
+  uint8_t  bestPrio  = 0;
+  float    bestScore = 0;
+  for(size_t i=0; i<candidates.size();) {
+    const uint32_t t = candidates[i];
+    if(used[t]) {
+      candidates[i] = candidates.back();
+      candidates.pop_back();
+      continue;
+      }
+    ++i;
+
+    const uint8_t extra = extraOf[t];
+    const uint8_t prio  = priority(t,extra);
+    const bool    f     = (m.vertSz+extra<=MaxVert && m.indSz+3<=MaxInd);
+    if(best!=NoTri && (fits && !f))
+      continue;
+    if(best!=NoTri && fits==f && prio>bestPrio)
+      continue;
+
+    const float score = (triCenter[t]-center).quadLength()*invR2 + ConeWeight*(1.f - Vec3::dotProduct(triNormal[t],axis));
+    if(best==NoTri || f!=fits || prio<bestPrio || score<bestScore) {
+      best      = t;
+      bestPrio  = prio;
+      bestScore = score;
+      fits      = f;
+      }
+    }
+  return best;
+  }
+
+void PackedMesh::MeshletBuilder::append(Meshlet& m, uint32_t tri) {
+  used[tri]            = 1;
+  activeTri[m.indSz/3] = tri;
+  for(uint32_t k=0; k<3; ++k) {
+    const uint32_t v = cornerId[tri*3+k];
+    const uint32_t p = cornerPos[tri*3+k];
+    --live[p];
+    if(slot[v]==NoSlot) {
+      slot[v]              = m.vertSz;
+      activeVert[m.vertSz] = v;
+      m.vert[m.vertSz]     = verts[v];
+      ++m.vertSz;
+      for(uint32_t i=adjOffset[p]; i<adjOffset[p+1]; ++i) {
+        const uint32_t t = adjTri[i];
+        if(used[t])
+          continue;
+        extraOf[t] = newVertices(t);
+        if(mark[t]==meshletId)
+          continue;
+        mark[t] = meshletId;
+        candidates.push_back(t);
+        }
+      }
+    m.indexes[m.indSz+k] = slot[v];
+    }
+  m.indSz   = uint8_t(m.indSz+3u);
+  centerSum = centerSum + triCenter[tri];
+  axisSum   = axisSum   + triNormal[tri];
+  }
+
+void PackedMesh::MeshletBuilder::emit(Meshlet& m, const std::vector<glm::vec3>& vbo, bool cone,
+                                      std::vector<Meshlet>& out, MeshletStats& stats) {
+  const size_t numTri = m.indSz/3;
+  m.bounds = Cluster();
+  if(cone)
+    computeCone(m.bounds,numTri);
+  m.optimizeVertexCache();
+  m.updateBounds(vbo);
+
+  Vec3 lo = Vec3(vbo[m.vert[0].first].x,vbo[m.vert[0].first].y,vbo[m.vert[0].first].z), hi = lo;
+  for(size_t i=1; i<m.vertSz; ++i) {
+    auto& v = vbo[m.vert[i].first];
+    lo.x = std::min(lo.x,v.x); lo.y = std::min(lo.y,v.y); lo.z = std::min(lo.z,v.z);
+    hi.x = std::max(hi.x,v.x); hi.y = std::max(hi.y,v.y); hi.z = std::max(hi.z,v.z);
+    }
+  stats.meshlets     += 1;
+  stats.vertices     += m.vertSz;
+  stats.primitives   += numTri;
+  stats.radius       += m.bounds.r;
+  stats.halfDiagonal += (hi-lo).length()*0.5f;
+  if(m.bounds.coneCutoff<1.f)
+    stats.cones++;
+
+  for(size_t i=0; i<m.vertSz; ++i)
+    slot[activeVert[i]] = NoSlot;
+  candidates.clear();
+  centerSum = Vec3();
+  axisSum   = Vec3();
+  ++meshletId;
+
+  out.push_back(m);
+  m.clear();
+  }
+
+void PackedMesh::MeshletBuilder::computeCone(Cluster& c, size_t numTri) const {
+  Vec3 axis;
+  for(size_t i=0; i<numTri; ++i)
+    axis = axis + triNormal[activeTri[i]];
+  const float len = axis.length();
+  if(len<=0)
+    return;
+  axis = axis*(1.f/len);
+
+  float minDp = 1;
+  for(size_t i=0; i<numTri; ++i) {
+    const uint32_t t = activeTri[i];
+    if(triNormal[t].quadLength()>0)
+      minDp = std::min(minDp, Vec3::dotProduct(triNormal[t],axis));
+    }
+  if(minDp<=0.1f)
+    return; // too wide to ever cull anything
+
+  // normals are within acos(minDp) of axis: whole meshlet is back-facing, if view direction
+  // is within 90-acos(minDp) degrees of axis
+  c.coneAxis   = axis;
+  c.coneCutoff = std::sqrt(1.f - minDp*minDp);
+  }
 
 void PackedMesh::Meshlet::flush(std::vector<Vertex>& vertices,
                                 std::vector<uint32_t>& indices,
@@ -131,24 +467,7 @@ void PackedMesh::Meshlet::flush(std::vector<Vertex>& vertices,
     indices[iboSz+i] = uint32_t(vboSz+indSz/3);
     }
 
-  if(Gothic::options().doMeshShading || true) {
-    size_t iboSz8 = indices8.size();
-    indices8.resize(iboSz8 + MaxPrim*4);
-    for(size_t i=0; i<indSz; i+=3) {
-      size_t at = iboSz8 + (i/3)*4;
-      indices8[at+0] = indexes[i+0];
-      indices8[at+1] = indexes[i+1];
-      indices8[at+2] = indexes[i+2];
-      indices8[at+3] = 0;
-      }
-    if(indSz+1<MaxInd) {
-      size_t at = iboSz8 + MaxPrim*4 - 4;
-      indices8[at+0] = indexes[0];
-      indices8[at+1] = indexes[0];
-      indices8[at+2] = indSz/3;
-      indices8[at+3] = vertSz;
-      }
-    }
+  flushIndices8(indices8);
   }
 
 void PackedMesh::Meshlet::flush(std::vector<Vertex>& vertices, std::vector<VertexA>& verticesA,
@@ -236,23 +555,26 @@ void PackedMesh::Meshlet::flush(std::vector<Vertex>& vertices, std::vector<Verte
     indices[iboSz+i] = uint32_t(vboSz+indSz/3);
     }
 
-  if(Gothic::options().doMeshShading || true) {
-    size_t iboSz8 = indices8.size();
-    indices8.resize(iboSz8 + MaxPrim*4);
-    for(size_t i=0; i<indSz; i+=3) {
-      size_t at = iboSz8 + (i/3)*4;
-      indices8[at+0] = indexes[i+0];
-      indices8[at+1] = indexes[i+1];
-      indices8[at+2] = indexes[i+2];
-      indices8[at+3] = 0;
-      }
-    if(indSz+1<MaxInd) {
-      size_t at = iboSz8 + MaxPrim*4 - 4;
-      indices8[at+0] = indexes[0];
-      indices8[at+1] = indexes[0];
-      indices8[at+2] = indSz/3;
-      indices8[at+3] = vertSz;
-      }
+  flushIndices8(indices8);
+  }
+
+void PackedMesh::Meshlet::flushIndices8(std::vector<uint8_t>& indices8) const {
+  // 8-bit indices of mesh-shader path; built unconditionally, so packing doesn't depend on game options
+  size_t iboSz8 = indices8.size();
+  indices8.resize(iboSz8 + MaxPrim*4);
+  for(size_t i=0; i<indSz; i+=3) {
+    size_t at = iboSz8 + (i/3)*4;
+    indices8[at+0] = indexes[i+0];
+    indices8[at+1] = indexes[i+1];
+    indices8[at+2] = indexes[i+2];
+    indices8[at+3] = 0;
+    }
+  if(indSz+1<MaxInd) {
+    size_t at = iboSz8 + MaxPrim*4 - 4;
+    indices8[at+0] = indexes[0];
+    indices8[at+1] = indexes[0];
+    indices8[at+2] = indSz/3;
+    indices8[at+3] = vertSz;
     }
   }
 
@@ -270,124 +592,110 @@ bool PackedMesh::Meshlet::validate() const {
   */
   }
 
-bool PackedMesh::Meshlet::insert(const Vert& a, const Vert& b, const Vert& c) {
-  if(indSz+3>MaxInd)
-    return false;
-
-  uint8_t ea = MaxVert, eb = MaxVert, ec = MaxVert;
-  for(uint8_t i=0; i<vertSz; ++i) {
-    if(vert[i]==a)
-      ea = i;
-    if(vert[i]==b)
-      eb = i;
-    if(vert[i]==c)
-      ec = i;
-    }
-
-  uint8_t vSz = vertSz;
-  if(ea==MaxVert) {
-    ea = vSz;
-    ++vSz;
-    }
-  if(eb==MaxVert) {
-    eb = vSz;
-    ++vSz;
-    }
-  if(ec==MaxVert) {
-    ec = vSz;
-    ++vSz;
-    }
-
-  if(vSz>MaxVert)
-    return false;
-
-  if(vSz==vertSz) {
-    for(size_t i=0; i<indSz; i+=3) {
-      if(indexes[i+0]==ea && indexes[i+1]==eb && indexes[i+2]==ec) {
-        // duplicant?
-        return true;
-        }
-      }
-    }
-
-  indexes[indSz+0] = ea;
-  indexes[indSz+1] = eb;
-  indexes[indSz+2] = ec;
-  indSz            = uint8_t(indSz+3u);
-
-  vert[ea] = a;
-  vert[eb] = b;
-  vert[ec] = c;
-  vertSz   = vSz;
-
-  return true;
-  }
-
 void PackedMesh::Meshlet::clear() {
   vertSz = 0;
   indSz  = 0;
   }
 
-void PackedMesh::Meshlet::updateBounds(const zenkit::Mesh& mesh) {
-  updateBounds(mesh.vertices);
-  }
+void PackedMesh::Meshlet::optimizeVertexCache() {
+  // greedy: next triangle is the one, that reuses most of recently referenced vertices;
+  // vertices are renumbered in order of first use afterwards
+  static constexpr size_t CacheSize = 16;
+  static_assert(MaxVert<=64, "vertex set must fit into 64-bit mask");
+
+  const size_t numTri = indSz/3;
+  uint8_t      src [MaxInd ] = {};
+  uint64_t     mask[MaxPrim] = {};
+  uint8_t      fifo[CacheSize] = {};
+  size_t       fifoSz = 0;
+  uint64_t     cache  = 0;
+  std::memcpy(src,indexes,indSz);
+  for(size_t i=0; i<numTri; ++i)
+    mask[i] = (1ull<<src[i*3+0]) | (1ull<<src[i*3+1]) | (1ull<<src[i*3+2]);
+
+  for(size_t i=0; i<numTri; ++i) {
+    // triangles [i..numTri) are not emitted yet
+    size_t best      = i;
+    int    bestScore = -1;
+    for(size_t r=i; r<numTri; ++r) {
+      const int score = std::popcount(mask[r] & cache);
+      if(score>bestScore) {
+        best      = r;
+        bestScore = score;
+        if(score==3)
+          break;
+        }
+      }
+    std::swap(mask[i],mask[best]);
+    for(size_t k=0; k<3; ++k) {
+      std::swap(src[i*3+k],src[best*3+k]);
+      indexes[i*3+k]         = src[i*3+k];
+      fifo[fifoSz%CacheSize] = src[i*3+k];
+      ++fifoSz;
+      }
+    cache = 0;
+    for(size_t k=0; k<std::min(fifoSz,CacheSize); ++k)
+      cache |= (1ull<<fifo[k]);
+    }
 
-void PackedMesh::Meshlet::updateBounds(const zenkit::MultiResolutionMesh& mesh) {
-  updateBounds(mesh.positions);
+  Vert    vsrc [MaxVert];
+  uint8_t remap[MaxVert];
+  std::copy(vert, vert+vertSz, vsrc);
+  std::fill(remap, remap+MaxVert, uint8_t(MaxVert));
+  uint8_t next = 0;
+  for(size_t i=0; i<indSz; ++i) {
+    const uint8_t v = indexes[i];
+    if(remap[v]==MaxVert) {
+      remap[v]   = next;
+      vert[next] = vsrc[v];
+      ++next;
+      }
+    indexes[i] = remap[v];
+    }
   }
 
 void PackedMesh::Meshlet::updateBounds(const std::vector<glm::vec3>& vbo) {
-  float dim = 0;
+  // two candidates: center of the most distant vertex pair and center of aabb; smaller sphere wins
+  auto at = [&](size_t i) {
+    auto& v = vbo[vert[i].first];
+    return Vec3(v.x,v.y,v.z);
+    };
+  auto radius = [&](const Vec3& c) {
+    float r = 0;
+    for(size_t i=0; i<vertSz; ++i)
+      r = std::max(r,(at(i)-c).quadLength());
+    return std::sqrt(r);
+    };
+
+  if(vertSz==0) {
+    bounds.pos = Vec3();
+    bounds.r   = 0;
+    return;
+    }
+
+  Vec3  pair = at(0);
+  float dim  = 0;
   for(size_t i=0; i<vertSz; ++i)
     for(size_t r=i+1; r<vertSz; ++r) {
-      auto a = vbo[vert[i].first];
-      auto b = vbo[vert[r].first];
-      a.x -= b.x;
-      a.y -= b.y;
-      a.z -= b.z;
-      float d = a.x*a.x + a.y*a.y + a.z*a.z;
+      const Vec3  a = at(i), b = at(r);
+      const float d = (a-b).quadLength();
       if(dim<d) {
-        bounds.pos = Vec3(b.x,b.y,b.z)+Vec3(a.x,a.y,a.z)*0.5f;
-        dim = d;
+        pair = (a+b)*0.5f;
+        dim  = d;
         }
       }
-  bounds.r = 0;
-  for(size_t i=0; i<vertSz; ++i) {
-    auto a = vbo[vert[i].first];
-    a.x -= bounds.pos.x;
-    a.y -= bounds.pos.y;
-    a.z -= bounds.pos.z;
-    float d = (a.x*a.x + a.y*a.y + a.z*a.z);
-    if(bounds.r<d)
-      bounds.r = d;
-    }
-  bounds.r = std::sqrt(bounds.r);
-  }
-
-bool PackedMesh::Meshlet::canMerge(const Meshlet& other) const {
-  if(vertSz+other.vertSz>MaxVert)
-    return false;
-  if(indSz+other.indSz>MaxInd)
-    return false;
-  return true;
-  }
 
-bool PackedMesh::Meshlet::hasIntersection(const Meshlet& other) const {
-  return (bounds.pos-other.bounds.pos).quadLength() < std::pow(bounds.r+other.bounds.r,2.f);
-  }
-
-float PackedMesh::Meshlet::qDistance(const Meshlet& other) const {
-  return (bounds.pos-other.bounds.pos).quadLength();
-  }
-
-void PackedMesh::Meshlet::merge(const Meshlet& other) {
-  for(uint8_t i=0; i<other.indSz; ++i) {
-    uint8_t index  = uint8_t(vertSz+other.indexes[i]);
-    indexes[indSz] = index;
-    vert[index]    = other.vert[other.indexes[i]];
-    ++indSz;
+  Vec3 lo = at(0), hi = at(0);
+  for(size_t i=1; i<vertSz; ++i) {
+    const Vec3 v = at(i);
+    lo.x = std::min(lo.x,v.x); lo.y = std::min(lo.y,v.y); lo.z = std::min(lo.z,v.z);
+    hi.x = std::max(hi.x,v.x); hi.y = std::max(hi.y,v.y); hi.z = std::max(hi.z,v.z);
     }
-  vertSz = uint8_t(vertSz+other.vertSz);
+  const Vec3  box = (lo+hi)*0.5f;
+  const float rp  = radius(pair);
+  const float rb  = radius(box);
+  bounds.pos = rp<=rb ? pair : box;
+  bounds.r   = std::min(rp,rb);
   }
 
 PackedMesh::PackedMesh(const zenkit::Mesh& mesh, PkgType type) {
@@ -548,47 +856,57 @@ void PackedMesh::packMeshletsLnd(const zenkit::Mesh& mesh) {
     return std::tie(a.mat) < std::tie(b.mat);
     });
 
-  PrimitiveHeap heap;
-  heap.reserve(mid.size());
-  std::vector<bool> used(mid.size(),false);
-
-  vertices.reserve(mesh.vertices.size());
-  indices .reserve(ibo.size());
-  indices8.reserve(ibo.size());
-  meshletBounds.reserve(prim.size()/MaxPrim);
+  struct Group final {
+    uint32_t             mat   = 0;
+    size_t               begin = 0;
+    size_t               end   = 0;
+    std::vector<Meshlet> meshlets;
+    MeshletStats         stats;
+    };
+  std::vector<Group> groups;
   for(size_t i=0; i<prim.size();) {
-    const auto mId = prim[i].mat;
+    Group g;
+    g.mat   = prim[i].mat;
+    g.begin = i;
+    while(i<prim.size() && prim[i].mat==g.mat)
+      ++i;
+    g.end   = i;
+    groups.emplace_back(std::move(g));
+    }
 
-    heap.clear();
-    for(; i<prim.size() && prim[i].mat==mId; ++i) {
+  // material groups are independent: build in parallel, flush in order, so result is deterministic
+  const float front = frontFace(mesh);
+  Workers::parallelTasks(groups,[&](Group& g){
+    MeshletBuilder builder;
+    for(size_t i=g.begin; i<g.end; ++i) {
       const uint32_t id = prim[i].primId;
-
-      auto a = mkUInt64(ibo[id+0],feat[id+0]);
-      auto b = mkUInt64(ibo[id+1],feat[id+1]);
-      auto c = mkUInt64(ibo[id+2],feat[id+2]);
-
-      heap.push_back(std::make_pair(a, id));
-      heap.push_back(std::make_pair(b, id));
-      heap.push_back(std::make_pair(c, id));
+      for(uint32_t r=0; r<3; ++r)
+        builder.push(std::make_pair(ibo[id+r],feat[id+r]));
       }
+    // waves displace vertices, normal cone of source geometry is not valid for them
+    const bool waves = (mesh.materials[g.mat].wave_mode!=zenkit::WaveMode::NONE);
+    g.meshlets = builder.build(mesh.vertices,waves ? 0.f : front,g.stats);
+    });
 
-    if(heap.size()==0)
-      continue;
-
-    std::vector<Meshlet> meshlets = buildMeshlets(&mesh,nullptr,heap,used);
-    for(size_t i=0; i<meshlets.size(); ++i)
-      meshlets[i].updateBounds(mesh);
+  vertices.reserve(mesh.vertices.size());
+  indices .reserve(ibo.size());
+  indices8.reserve(ibo.size());
+  meshletBounds.reserve(prim.size()/MaxPrim);
+  for(auto& g:groups) {
+    meshletStats += g.stats;
 
     SubMesh pack;
-    pack.material  = mesh.materials[mId];
+    pack.material  = mesh.materials[g.mat];
     pack.iboOffset = indices.size();
-    for(auto& i:meshlets)
+    for(auto& i:g.meshlets)
       i.flush(vertices,indices,indices8,meshletBounds,mesh);
     pack.iboLength = indices.size() - pack.iboOffset;
-    if(pack.iboLength>0)
+    if(pack.iboLength>0) {
       subMeshes.push_back(std::move(pack));
-
-    //dbgUtilization(meshlets);
+      materialId.push_back(g.mat);
+      }
+    //dbgUtilization(g.meshlets);
+    g.meshlets = std::vector<Meshlet>();
     }
   }
 
@@ -596,31 +914,23 @@ void PackedMesh::packMeshletsObj(const zenkit::MultiResolutionMesh& mesh, PkgTyp
                                  const std::vector<SkeletalData>* skeletal) {
   auto* vId = (type==PK_VisualMorph) ? &verticesId : nullptr;
 
-  size_t maxTri = 0;
-  for(auto& sm:mesh.sub_meshes)
-    maxTri = std::max(maxTri, sm.triangles.size());
-  PrimitiveHeap heap;
-  heap.reserve(maxTri);
-  std::vector<bool> used(maxTri);
-
+  MeshletBuilder builder;
   for(size_t mId=0; mId<mesh.sub_meshes.size(); ++mId) {
     auto& sm      = mesh.sub_meshes[mId];
     auto& pack    = subMeshes[mId];
     pack.material = sm.mat;
 
-    heap.clear();
+    builder.clear();
     for(size_t i=0; i<sm.triangles.size(); ++i) {
       const uint16_t* ibo = sm.triangles[i].wedges;
       for(int x=0; x<3; ++x) {
         auto& wedge = sm.wedges[ibo[x]];
-        auto vert = mkUInt64(wedge.index,ibo[x]);
-        heap.push_back(std::make_pair(vert,uint32_t(i*3)));
+        builder.push(std::make_pair(wedge.index,uint32_t(ibo[x])));
         }
       }
 
-    std::vector<Meshlet> meshlets = buildMeshlets(nullptr,&sm,heap,used);
-    for(size_t i=0; i<meshlets.size(); ++i)
-      meshlets[i].updateBounds(mesh);
+    // objects are culled as a whole: no use for normal cone of a meshlet
+    std::vector<Meshlet> meshlets = builder.build(mesh.positions,0,meshletStats);
 
     pack.iboOffset = indices.size();
     for(auto& i:meshlets)
@@ -631,97 +941,6 @@ void PackedMesh::packMeshletsObj(const zenkit::MultiResolutionMesh& mesh, PkgTyp
     }
   }
 
-std::vector<PackedMesh::Meshlet> PackedMesh::buildMeshlets(const zenkit::Mesh* mesh,
-                                                           const zenkit::SubMesh* proto_mesh,
-                                                           PrimitiveHeap& heap, std::vector<bool>& used) {
-  heap.sort();
-  std::fill(used.begin(), used.end(), false);
-
-  const bool tightPacking = true;
-
-  size_t  firstUnused = 0;
-  size_t  firstVert   = 0;
-  Meshlet active;
-
-  std::vector<Meshlet> meshlets;
-  while(true) {
-    size_t triId = size_t(-1);
-
-    for(size_t r=firstVert; r<active.vertSz; ++r) {
-      auto i = active.vert[r];
-      auto e = heap.equal_range(mkUInt64(i.first,i.second));
-      for(auto it = e.first; it!=e.second; ++it) {
-        auto id = it->second/3;
-        if(used[id])
-          continue;
-        if(addTriangle(active,mesh,proto_mesh,id)) {
-          used[id] = true;
-          continue;
-          }
-        triId = id;
-        break;
-        }
-      firstVert = r+1;
-      }
-
-    if(triId==size_t(-1) && active.indSz!=0 && !tightPacking) {
-      // active.validate();
-      meshlets.push_back(std::move(active));
-      active.clear();
-      firstVert = 0;
-      continue;
-      }
-
-    if(triId==size_t(-1)) {
-      for(auto i=heap.begin()+ptrdiff_t(firstUnused); i!=heap.end();) {
-        if(used[i->second/3]) {
-          ++i;
-          continue;
-          }
-        firstUnused = size_t(std::distance(heap.begin(),i+1));
-        triId       = i->second/3;
-        break;
-        }
-      }
-
-    if(triId!=size_t(-1) && addTriangle(active,mesh,proto_mesh,triId)) {
-      used[triId] = true;
-      continue;
-      }
-
-    if(active.indSz!=0) {
-      // active.validate();
-      meshlets.push_back(std::move(active));
-      active.clear();
-      firstVert = 0;
-      }
-
-    if(triId==size_t(-1))
-      break;
-    }
-
-  return meshlets;
-  }
-
-bool PackedMesh::addTriangle(Meshlet& dest, const zenkit::Mesh* mesh, const zenkit::SubMesh* sm, size_t id) {
-  if(mesh!=nullptr) {
-    size_t id3  = id*3;
-    auto&  ibo  = mesh->polygons.vertex_indices;
-    auto&  feat = mesh->polygons.feature_indices;
-
-    auto a = std::make_pair(ibo[id3+0],feat[id3+0]);
-    auto b = std::make_pair(ibo[id3+1],feat[id3+1]);
-    auto c = std::make_pair(ibo[id3+2],feat[id3+2]);
-    return dest.insert(a,b,c);
-    }
-
-  const uint16_t* feat = sm->triangles[id].wedges;
-  auto a = std::make_pair(sm->wedges[feat[0]].index, feat[0]);
-  auto b = std::make_pair(sm->wedges[feat[1]].index, feat[1]);
-  auto c = std::make_pair(sm->wedges[feat[2]].index, feat[2]);
-  return dest.insert(a,b,c);
-  }
-
 void PackedMesh::debug(std::ostream &out) const {
   for(auto& i:vertices) {
     out << "v  " << i.pos[0]  << " " << i.pos[1]  << " " << i.pos[2]  << std::endl;
@@ -39,7 +39,20 @@ class PackedMesh {
 
     struct Cluster final {
       Tempest::Vec3 pos;
-      float         r = 0;
+      float         r          = 0;
+      Tempest::Vec3 coneAxis;
+      float         coneCutoff = 1; // normal cone for backface culling; 1 - disabled
+      };
+
+    // accumulated over all meshlets of this mesh
+    struct MeshletStats final {
+      size_t meshlets     = 0;
+      size_t vertices     = 0;
+      size_t primitives   = 0;
+      size_t cones        = 0; // meshlets with usable normal cone
+      double radius       = 0; // sum of bounding sphere radii
+      double halfDiagonal = 0; // sum of half-diagonals of meshlet aabb
+      MeshletStats& operator += (const MeshletStats& other);
       };
 
     std::vector<Vertex>   vertices;
@@ -52,7 +65,9 @@ class PackedMesh {
 
     std::vector<uint32_t> verticesId; // only for morph meshes
     bool                  isUsingAlphaTest = true;
+    MeshletStats          meshletStats;
 
+    PackedMesh() = default;
     PackedMesh(const zenkit::MultiResolutionMesh& mesh, PkgType type);
     PackedMesh(const zenkit::Mesh& mesh, PkgType type);
     PackedMesh(const zenkit::SoftSkinMesh& mesh);
@@ -62,7 +77,8 @@ class PackedMesh {
     std::pair<Tempest::Vec3,Tempest::Vec3> bbox() const;
 
   private:
-    Tempest::Vec3 mBbox[2];
+    Tempest::Vec3         mBbox[2];
+    std::vector<uint32_t> materialId; // source material of sub-mesh; only for landscape
 
     struct Prim {
       uint32_t primId = 0;
@@ -76,7 +92,7 @@ class PackedMesh {
       };
 
     using  Vert = std::pair<uint32_t,uint32_t>;
-    struct PrimitiveHeap;
+    struct MeshletBuilder;
     struct Meshlet {
       Vert          vert   [MaxVert] = {};
       uint8_t       indexes[MaxInd ] = {};
@@ -93,32 +109,24 @@ class PackedMesh {
                     std::vector<uint32_t>* verticesId, const std::vector<glm::vec3>& vbo,
                     const std::vector<zenkit::MeshWedge>& wedgeList,
                     const std::vector<SkeletalData>* skeletal);
+      void    flushIndices8(std::vector<uint8_t>& indices8) const;
       bool    validate() const;
 
-      bool    insert(const Vert& a, const Vert& b, const Vert& c);
       void    clear();
-      void    updateBounds(const zenkit::Mesh& mesh);
-      void    updateBounds(const zenkit::MultiResolutionMesh& mesh);
+      void    optimizeVertexCache();
       void    updateBounds(const std::vector<glm::vec3>& vbo);
-      bool    canMerge(const Meshlet& other) const;
-      bool    hasIntersection(const Meshlet& other) const;
-      float   qDistance(const Meshlet& other) const;
-      void    merge(const Meshlet& other);
       };
 
-    bool   addTriangle(Meshlet& dest, const zenkit::Mesh* mesh, const zenkit::SubMesh* proto_mesh, size_t id);
-
     void   packPhysics(const zenkit::Mesh& mesh, PkgType type);
     void   packMeshletsLnd(const zenkit::Mesh& mesh);
     void   packMeshletsObj(const zenkit::MultiResolutionMesh& mesh, PkgType type,
                            const std::vector<SkeletalData>* skeletal);
 
-    std::vector<Meshlet> buildMeshlets(const zenkit::Mesh* mesh, const zenkit::SubMesh* proto_mesh,
-                                       PrimitiveHeap& heap, std::vector<bool>& used);
-
     void   computeBbox();
 
     void   dbgUtilization(const std::vector<Meshlet>& meshlets);
     void   dbgMeshlets(const zenkit::Mesh& mesh, const std::vector<Meshlet*>& meshlets);
+
+  friend class WorldCache;
   };
 
@@ -2,6 +2,8 @@
 
 #include <Tempest/Log>
 
+#include <glm/gtc/type_ptr.hpp>
+
 #include "world/world.h"
 #include "game/serialize.h"
 #include "graphics/mesh/pose.h"
@@ -153,7 +155,10 @@ void ObjVisual::setVisual(const zenkit::VirtualObject& vob, World& world, bool s
 
       const bool windy = (vob.anim_mode!=zenkit::AnimationType::NONE && vob.anim_strength>0);
       if(vob.show_visual && enableCollision && !windy) {
-        mesh.physic = PhysicMesh(*view,*world.physic(),false);
+        // static vobs of world come with prebuilt collision
+        mesh.physic = world.takeVobPhysic(vob);
+        if(mesh.physic.isEmpty())
+          mesh.physic = PhysicMesh(*view,*world.physic(),false);
         }
       break;
       }
@@ -211,6 +216,26 @@ void ObjVisual::setVisual(const zenkit::VirtualObject& vob, World& world, bool s
     }
   }
 
+PhysicMesh ObjVisual::mkStaticPhysic(const zenkit::VirtualObject& vob, World& world) {
+  // must mirror M_Mesh branch of setVisual
+  if(vob.visual==nullptr || vob.visual->name.empty() || !vob.show_visual || !vob.cd_dynamic)
+    return PhysicMesh();
+  if(vob.visual->type!=zenkit::VisualType::MESH && vob.visual->type!=zenkit::VisualType::MULTI_RESOLUTION_MESH)
+    return PhysicMesh();
+  const bool windy = (vob.anim_mode!=zenkit::AnimationType::NONE && vob.anim_strength>0);
+  if(windy)
+    return PhysicMesh();
+
+  auto view = Resources::loadMesh(vob.visual->name);
+  if(view==nullptr)
+    return PhysicMesh();
+
+  // same as Vob::transform of static vob
+  glm::mat4x4 worldMatrix = vob.rotation;
+  worldMatrix[3] = glm::vec4(vob.position, 1);
+  return PhysicMesh::detached(*view,*world.physic(),Tempest::Matrix4x4(glm::value_ptr(worldMatrix)));
+  }
+
 void ObjVisual::setObjMatrix(const Tempest::Matrix4x4& obj) {
   switch(type) {
     case M_None:
@@ -262,9 +287,9 @@ bool ObjVisual::isAnimExist(std::string_view name) const {
   return false;
   }
 
-bool ObjVisual::updateAnimation(Npc* npc, World& world, uint64_t dt) {
+bool ObjVisual::updateAnimation(Npc* npc, World& world, uint64_t dt, Pose::LodTier lod) {
   if(type==M_Mdl) {
-    bool ret = mdl.view.updateAnimation(npc,world,dt);
+    bool ret = mdl.view.updateAnimation(npc,world,dt,lod);
     if(ret)
       mdl.view.syncAttaches();
     return ret;
@@ -22,12 +22,15 @@ class ObjVisual {
     void setVisual(const zenkit::VirtualObject& visual, World& world, bool staticDraw);
     void setObjMatrix(const Tempest::Matrix4x4& obj);
 
+    // collision of static mesh-visual, at vob transform and not linked into world; safe to call from worker threads
+    static PhysicMesh mkStaticPhysic(const zenkit::VirtualObject& vob, World& world);
+
     void setInteractive(Interactive* it);
 
     const Animation::Sequence* startAnimAndGet(std::string_view name, uint64_t tickCount, bool force = false);
     bool isAnimExist(std::string_view name) const;
 
-    bool updateAnimation(Npc* npc, World& world, uint64_t dt);
+    bool updateAnimation(Npc* npc, World& world, uint64_t dt, Pose::LodTier lod = Pose::LodFull);
     void processLayers(World& world);
     void syncPhysics();
 
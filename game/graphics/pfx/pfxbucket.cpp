@@ -1,5 +1,14 @@
 #include "pfxbucket.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define PFX_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #include "graphics/mesh/submesh/pfxemittermesh.h"
 #include "graphics/shaders.h"
 #include "pfxobjects.h"
@@ -24,11 +33,111 @@ static uint64_t ppsDiff(const ParticleFx& decl, bool loop, uint64_t time0, uint6
   return emitted1-emitted0;
   }
 
-float PfxBucket::ParState::lifeTime() const {
-  return 1.f-life/float(maxLife);
+// trail points are placed once per tick: ring is sized for ~120 fps, faster ticks reuse newest point
+static constexpr uint64_t TrailStep = 8;
+static constexpr size_t   MaxTrail  = 64;
+
+// emitter lod: distance bands (fraction of view range), minimal simulation step and spawn rate divider
+static constexpr float    LodDistance[] = {0.5f, 0.75f};
+static constexpr uint64_t LodStep    [] = {0, 33, 66};
+static constexpr uint32_t LodSpawn   [] = {1, 2, 4};
+// longer step is a catch-up after culling: particles of last lifetime are spawned with random age
+static constexpr uint64_t CatchUpTime   = 100;
+
+// Integrates particles [begin,end) under constant gravity: pos += dir*dt + gravity*dt^2/2, dir += gravity*dt, life -= dt.
+// Integration is exact, so simulation step (lod, catch-up) doesn't change trajectories.
+// Indices of particles, that run out of life, are appended to 'dead'; their state is left as is.
+static void integrate(uint16_t* life, float* px, float* py, float* pz, float* dx, float* dy, float* dz,
+                      size_t begin, size_t end, uint64_t dt, const Vec3& gravity, std::vector<size_t>& dead) {
+  const uint16_t dt16 = uint16_t(std::min<uint64_t>(dt,0xFFFF));
+  const float    dtF  = float(dt);
+  const float    half = 0.5f*dtF*dtF;
+  size_t         i    = begin;
+#if defined(PFX_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i dtI  = _mm_set1_epi16(int16_t(dt16));
+  const __m128  dtV  = _mm_set1_ps(dtF);
+  const __m128  gx   = _mm_set1_ps(gravity.x);
+  const __m128  gy   = _mm_set1_ps(gravity.y);
+  const __m128  gz   = _mm_set1_ps(gravity.z);
+  for(; i+4<=end; i+=4) {
+    const __m128i l0   = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(life+i));
+    const __m128i l1   = _mm_subs_epu16(l0,dtI);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(life+i),l1);
+
+    const __m128i gone = _mm_cmpeq_epi16(l1,zero);
+    const __m128i died = _mm_andnot_si128(_mm_cmpeq_epi16(l0,zero),gone);
+    if(const int mask = _mm_movemask_epi8(_mm_unpacklo_epi16(died,died))) {
+      for(size_t r=0; r<4; ++r)
+        if(mask & (1<<(r*4)))
+          dead.push_back(i+r);
+      }
+
+    // dead and dying particles don't move
+    const __m128  step = _mm_andnot_ps(_mm_castsi128_ps(_mm_unpacklo_epi16(gone,gone)),dtV);
+    const __m128  hsq  = _mm_mul_ps(_mm_mul_ps(step,step),_mm_set1_ps(0.5f));
+    const __m128  vx   = _mm_loadu_ps(dx+i);
+    const __m128  vy   = _mm_loadu_ps(dy+i);
+    const __m128  vz   = _mm_loadu_ps(dz+i);
+    _mm_storeu_ps(px+i,_mm_add_ps(_mm_loadu_ps(px+i),_mm_add_ps(_mm_mul_ps(vx,step),_mm_mul_ps(gx,hsq))));
+    _mm_storeu_ps(py+i,_mm_add_ps(_mm_loadu_ps(py+i),_mm_add_ps(_mm_mul_ps(vy,step),_mm_mul_ps(gy,hsq))));
+    _mm_storeu_ps(pz+i,_mm_add_ps(_mm_loadu_ps(pz+i),_mm_add_ps(_mm_mul_ps(vz,step),_mm_mul_ps(gz,hsq))));
+    _mm_storeu_ps(dx+i,_mm_add_ps(vx,_mm_mul_ps(gx,step)));
+    _mm_storeu_ps(dy+i,_mm_add_ps(vy,_mm_mul_ps(gy,step)));
+    _mm_storeu_ps(dz+i,_mm_add_ps(vz,_mm_mul_ps(gz,step)));
+    }
+#endif
+  for(; i<end; ++i) {
+    if(life[i]==0)
+      continue;
+    if(life[i]<=dt) {
+      life[i] = 0;
+      dead.push_back(i);
+      continue;
+      }
+    life[i] = uint16_t(life[i]-dt16);
+    px[i]  += dx[i]*dtF + gravity.x*half;
+    py[i]  += dy[i]*dtF + gravity.y*half;
+    pz[i]  += dz[i]*dtF + gravity.z*half;
+    dx[i]  += gravity.x*dtF;
+    dy[i]  += gravity.y*dtF;
+    dz[i]  += gravity.z*dtF;
+    }
   }
 
-std::mt19937 PfxBucket::rndEngine;
+void PfxBucket::ParState::resize(size_t sz) {
+  life   .resize(sz);
+  maxLife.resize(sz,1);
+  posX   .resize(sz);
+  posY   .resize(sz);
+  posZ   .resize(sz);
+  dirX   .resize(sz);
+  dirY   .resize(sz);
+  dirZ   .resize(sz);
+  }
+
+void PfxBucket::ParState::clear(size_t i) {
+  life   [i] = 0;
+  maxLife[i] = 1;
+  setPos(i,Vec3());
+  setDir(i,Vec3());
+  }
+
+void PfxBucket::ParState::setPos(size_t i, const Vec3& v) {
+  posX[i] = v.x;
+  posY[i] = v.y;
+  posZ[i] = v.z;
+  }
+
+void PfxBucket::ParState::setDir(size_t i, const Vec3& v) {
+  dirX[i] = v.x;
+  dirY[i] = v.y;
+  dirZ[i] = v.z;
+  }
+
+float PfxBucket::ParState::lifeTime(size_t i) const {
+  return 1.f-life[i]/float(maxLife[i]);
+  }
 
 void PfxBucket::Draw::setPfxData(const Tempest::StorageBuffer& ssbo) {
   if(ssbo.isEmpty())
@@ -89,8 +198,8 @@ void PfxBucket::Draw::preFrameUpdate(const SceneGlobals& scene, const Material&
     }
   }
 
-PfxBucket::PfxBucket(const ParticleFx &decl, PfxObjects& parent, const SceneGlobals& scene, VisualObjects& visual)
-  :decl(decl), parent(parent), visual(visual)  {
+PfxBucket::PfxBucket(const ParticleFx &decl, PfxObjects& parent, const SceneGlobals& scene, VisualObjects& visual, uint32_t seed)
+  :decl(decl), parent(parent), visual(visual), rndEngine(seed)  {
   uint64_t lt      = decl.maxLifetime();
   uint64_t pps     = uint64_t(std::ceil(decl.maxPps()));
   uint64_t reserve = (lt*pps+1000-1)/1000;
@@ -117,8 +226,20 @@ PfxBucket::PfxBucket(const ParticleFx &decl, PfxObjects& parent, const SceneGlob
     item.prepareUniforms(scene, decl.visMaterial);
     }
 
+  sizeRadius = std::max(decl.visSizeStart.x,decl.visSizeStart.y)*std::max(1.f,decl.visSizeEndScale)*0.5f;
+  if(decl.hasTrails())
+    sizeRadius = std::max(sizeRadius,decl.trlWidth);
+  if(decl.shpType!=ParticleFx::EmitterType::Mesh) {
+    float scale = 1;
+    for(auto k:decl.shpScaleKeys)
+      scale = std::max(scale,k);
+    spawnRadius = (decl.shpDim*scale).length() + decl.shpOffsetVec.length() + sizeRadius;
+    }
+
   if(decl.hasTrails()) {
     maxTrlTime = uint64_t(decl.trlFadeSpeed*1000.f);
+    if(maxTrlTime>0)
+      trlCap = size_t(std::min<uint64_t>(maxTrlTime/TrailStep+2,MaxTrail));
 
     Material mat = decl.visMaterial;
     mat.tex = decl.trlTexture;
@@ -156,14 +277,23 @@ bool PfxBucket::isEmpty() const {
   return impl.size()==0;
   }
 
+size_t PfxBucket::numParticles() const {
+  size_t ret = 0;
+  for(auto& b:block)
+    if(b.allocated)
+      ret += b.count;
+  return ret;
+  }
+
 size_t PfxBucket::allocBlock() {
   for(size_t i=0; i<Resources::MaxFramesInFlight; ++i)
     forceUpdate[i] = true;
 
   for(size_t i=0;i<block.size();++i) {
     if(!block[i].allocated) {
+      block[i]           = Block{};
       block[i].allocated = true;
-      block[i].timeTotal = 0;
+      block[i].offset    = i*blockSize;
       return i;
       }
     }
@@ -177,9 +307,13 @@ size_t PfxBucket::allocBlock() {
 
   particles.resize(particles.size()+blockSize);
   pfxCpu   .resize(particles.size());
+  if(trlCap>0) {
+    trailRing.resize(particles.size());
+    trailPool.resize(particles.size()*trlCap);
+    }
 
   for(size_t i=0; i<blockSize; ++i)
-    particles[b.offset+i].life = 0;
+    finalize(b.offset+i);
   return block.size()-1;
   }
 
@@ -259,6 +393,10 @@ bool PfxBucket::shrink() {
   if(particles.size()!=block.size()*blockSize) {
     particles.resize(block.size()*blockSize);
     pfxCpu   .resize(particles.size());
+    if(trlCap>0) {
+      trailRing.resize(particles.size());
+      trailPool.resize(particles.size()*trlCap);
+      }
     return true;
     }
   return false;
@@ -273,68 +411,68 @@ float PfxBucket::randf(float base, float var) {
   }
 
 void PfxBucket::init(PfxBucket::Block& block, ImplEmitter& emitter, size_t particle) {
-  auto& p   = particles[particle];
+  Vec3 pos = {}, dir = {};
 
-  p.life    = uint16_t(randf(decl.lspPartAvg,decl.lspPartVar));
-  p.maxLife = p.life;
+  particles.life   [particle] = uint16_t(randf(decl.lspPartAvg,decl.lspPartVar));
+  particles.maxLife[particle] = particles.life[particle];
 
   // TODO: pfx.shpDistribType, pfx.shpDistribWalkSpeed;
   switch(decl.shpType) {
     case ParticleFx::EmitterType::Point:{
-      p.pos = Vec3();
+      pos = Vec3();
       break;
       }
     case ParticleFx::EmitterType::Line:{
       float at = randf();
-      p.pos = Vec3(at,at,at);
+      pos = Vec3(at,at,at);
       break;
       }
     case ParticleFx::EmitterType::Box:{
       if(decl.shpIsVolume) {
-        p.pos = Vec3(randf()*2.f-1.f,
-                     randf()*2.f-1.f,
-                     randf()*2.f-1.f);
-        p.pos*=0.5;
+        pos = Vec3(randf()*2.f-1.f,
+                   randf()*2.f-1.f,
+                   randf()*2.f-1.f);
+        pos*=0.5;
         } else {
         // TODO
-        p.pos = Vec3(randf()*2.f-1.f,
-                     randf()*2.f-1.f,
-                     randf()*2.f-1.f);
-        p.pos*=0.5;
+        pos = Vec3(randf()*2.f-1.f,
+                   randf()*2.f-1.f,
+                   randf()*2.f-1.f);
+        pos*=0.5;
         }
       break;
       }
     case ParticleFx::EmitterType::Sphere:{
       float theta = float(2.0*M_PI)*randf();
       float phi   = std::acos(1.f - 2.f * randf());
-      p.pos = Vec3(std::sin(phi) * std::cos(theta),
-                   std::sin(phi) * std::sin(theta),
-                   std::cos(phi));
-      //p.pos*=0.5;
+      pos = Vec3(std::sin(phi) * std::cos(theta),
+                 std::sin(phi) * std::sin(theta),
+                 std::cos(phi));
+      //pos*=0.5;
       if(decl.shpIsVolume)
-        p.pos*=randf();
+        pos*=randf();
       break;
       }
     case ParticleFx::EmitterType::Circle:{
       float a = float(2.0*M_PI)*randf();
-      p.pos = Vec3(std::sin(a),
-                   0,
-                   std::cos(a));
-      //p.pos*=0.5;
+      pos = Vec3(std::sin(a),
+                 0,
+                 std::cos(a));
+      //pos*=0.5;
       if(decl.shpIsVolume)
-        p.pos = p.pos*std::sqrt(randf());
+        pos = pos*std::sqrt(randf());
       break;
       }
     case ParticleFx::EmitterType::Mesh:{
-      p.pos = Vec3();
+      pos = Vec3();
       auto mesh = (emitter.mesh!=nullptr) ? emitter.mesh : decl.shpMesh;
       auto pose = (emitter.mesh!=nullptr) ? emitter.pose : nullptr;
       if(mesh!=nullptr) {
-        auto pos = mesh->randCoord(randf(),pose);
-        pos -= emitter.pos;
-        p.pos = emitter.direction[0]*pos.x +
-                emitter.direction[1]*pos.y +
-                emitter.direction[2]*pos.z;
+        auto at = mesh->randCoord(randf(),pose);
+        at -= emitter.pos;
+        pos = emitter.direction[0]*at.x +
+              emitter.direction[1]*at.y +
+              emitter.direction[2]*at.z;
         }
       break;
       }
@@ -343,21 +481,21 @@ void PfxBucket::init(PfxBucket::Block& block, ImplEmitter& emitter, size_t parti
   if(decl.shpType!=ParticleFx::EmitterType::Point &&
      decl.shpType!=ParticleFx::EmitterType::Mesh) {
     Vec3 dim = decl.shpDim*decl.shpScale(block.timeTotal);
-    p.pos.x*=dim.x;
-    p.pos.y*=dim.y;
-    p.pos.z*=dim.z;
+    pos.x*=dim.x;
+    pos.y*=dim.y;
+    pos.z*=dim.z;
     }
 
   switch(decl.shpFOR) {
     case ParticleFx::Frame::Object:
     case ParticleFx::Frame::Node: {
-      p.pos += emitter.direction[0]*decl.shpOffsetVec.x +
-               emitter.direction[1]*decl.shpOffsetVec.y +
-               emitter.direction[2]*decl.shpOffsetVec.z;
+      pos += emitter.direction[0]*decl.shpOffsetVec.x +
+             emitter.direction[1]*decl.shpOffsetVec.y +
+             emitter.direction[2]*decl.shpOffsetVec.z;
       break;
       }
     case ParticleFx::Frame::World: {
-      p.pos += decl.shpOffsetVec;
+      pos += decl.shpOffsetVec;
       break;
       }
     }
@@ -370,7 +508,7 @@ void PfxBucket::init(PfxBucket::Block& block, ImplEmitter& emitter, size_t parti
       float dx    = sn * std::cos(theta);
       float dz    = sn * std::sin(theta);
 
-      p.dir       = Vec3(dx,dy,dz);
+      dir         = Vec3(dx,dy,dz);
       break;
       }
     case ParticleFx::Dir::Dir: {
@@ -393,13 +531,13 @@ void PfxBucket::init(PfxBucket::Block& block, ImplEmitter& emitter, size_t parti
       switch(decl.dirFOR) {
         case ParticleFx::Frame::Object:
         case ParticleFx::Frame::Node: {
-          p.dir = emitter.direction[0]*dx +
-                  emitter.direction[1]*dy +
-                  emitter.direction[2]*dz;
+          dir = emitter.direction[0]*dx +
+                emitter.direction[1]*dy +
+                emitter.direction[2]*dz;
           break;
           }
         case ParticleFx::Frame::World: {
-          p.dir = Vec3(dx,dy,dz);
+          dir = Vec3(dx,dy,dz);
           break;
           }
         }
@@ -424,137 +562,163 @@ void PfxBucket::init(PfxBucket::Block& block, ImplEmitter& emitter, size_t parti
           break;
           }
         }
-      p.dir += targetPos - (emitter.pos+p.pos);
+      dir += targetPos - (emitter.pos+pos);
       break;
     }
 
   if(!decl.useEmittersFOR)
-    p.pos += emitter.pos;
+    pos += emitter.pos;
 
-  auto l = p.dir.length();
+  auto l = dir.length();
   if(l!=0.f) {
     float velocity = randf(decl.velAvg,decl.velVar);
-    p.dir = p.dir*velocity/l;
+    dir = dir*velocity/l;
     }
+
+  particles.setPos(particle,pos);
+  particles.setDir(particle,dir);
   }
 
 void PfxBucket::finalize(size_t particle) {
-  particles[particle] = {};
-  pfxCpu   [particle] = {};
+  particles.clear(particle);
+  pfxCpu[particle] = {};
+  if(trlCap>0)
+    trailRing[particle] = {};
   }
 
-void PfxBucket::tick(Block& sys, ImplEmitter& emitter, size_t particle, uint64_t dt) {
-  ParState& ps = particles[particle+sys.offset];
-  if(ps.life==0)
-    return;
-
-  if(ps.life<=dt){
-    ps.life = 0;
+void PfxBucket::advance(Block& sys, size_t particle, uint64_t dt) {
+  auto& life = particles.life[particle];
+  if(life<=dt) {
     sys.count--;
-    finalize(particle+sys.offset);
+    finalize(particle);
     return;
     }
 
-  const float dtF = float(dt);
+  const float t   = float(dt);
+  const Vec3  dir = particles.dir(particle);
+  life = uint16_t(life-dt);
+  particles.setPos(particle,particles.pos(particle) + dir*t + decl.flyGravity*(0.5f*t*t));
+  particles.setDir(particle,dir + decl.flyGravity*t);
+  }
 
-  // eval particle
-  ps.life  = uint16_t(ps.life-dt);
-  ps.pos  += ps.dir*dtF;
-  ps.dir  += decl.flyGravity*dtF;
+void PfxBucket::tick(Block& sys, ImplEmitter& emitter, uint64_t dt) {
+  const size_t begin = sys.offset;
+  const size_t end   = sys.offset+blockSize;
 
-  if(maxTrlTime!=0)
-    tickTrail(ps,emitter,dt);
+  dead.clear();
+  integrate(particles.life.data(),
+            particles.posX.data(), particles.posY.data(), particles.posZ.data(),
+            particles.dirX.data(), particles.dirY.data(), particles.dirZ.data(),
+            begin, end, dt, decl.flyGravity, dead);
+  for(auto i:dead) {
+    sys.count--;
+    finalize(i);
+    }
+
+  if(maxTrlTime==0)
+    return;
+  for(size_t i=begin; i<end; ++i)
+    if(particles.life[i]!=0)
+      tickTrail(i,emitter);
   }
 
-void PfxBucket::tickTrail(ParState& ps, ImplEmitter& emitter, uint64_t dt) {
-  for(auto& i:ps.trail)
-    i.time+=dt;
+void PfxBucket::tickTrail(size_t particle, const ImplEmitter& emitter) {
+  auto&  r    = trailRing[particle];
+  Trail* ring = &trailPool[particle*trlCap];
 
   Trail tx;
+  tx.pos  = particles.pos(particle);
+  tx.time = trlClock;
   if(decl.useEmittersFOR)
-    tx.pos = ps.pos + emitter.pos; else
-    tx.pos = ps.pos;
+    tx.pos += emitter.pos;
 
-  if(ps.trail.size()==0) {
-    ps.trail.push_back(tx);
-    }
-  else if(ps.trail.back().pos!=tx.pos) {
-    bool extrude = false;
-    if(false && ps.trail.size()>1) {
-      auto u = tx.pos              - ps.trail[ps.trail.size()-2].pos;
-      auto v = ps.trail.back().pos - ps.trail[ps.trail.size()-2].pos;
-      if(std::abs(Vec3::dotProduct(u,v)-u.length()*v.length()) < 0.001f)
-        extrude = true;
+  if(r.size==0) {
+    ring[r.head] = tx;
+    r.size       = 1;
+    } else {
+    auto& back = ring[(r.head+r.size-1)%trlCap];
+    if(back.pos==tx.pos) {
+      back.time = trlClock;
+      }
+    else if(r.size<trlCap) {
+      ring[(r.head+r.size)%trlCap] = tx;
+      r.size++;
+      }
+    else {
+      back = tx;
       }
-    if(extrude)
-      ps.trail.back() = tx; else
-      ps.trail.push_back(tx);
-    }
-  else {
-    ps.trail.back().time = 0;
     }
 
-  for(size_t rm=0; rm<=ps.trail.size(); ++rm) {
-    if(rm==ps.trail.size() || ps.trail[rm].time<maxTrlTime) {
-      ps.trail.erase(ps.trail.begin(),ps.trail.begin()+int(rm));
-      break;
-      }
+  while(r.size>0 && trlClock-ring[r.head].time>=maxTrlTime) {
+    r.head = uint8_t((r.head+1)%trlCap);
+    r.size--;
     }
   }
 
-void PfxBucket::tick(uint64_t dt, const Vec3& viewPos) {
+void PfxBucket::tick(uint64_t dt, const Vec3& viewPos, const SceneGlobals& scene) {
+  std::fill(std::begin(lodCount),std::end(lodCount),0);
   if(decl.isDecal()) {
     implTickDecals(dt,viewPos);
     return;
     }
-  implTickCommon(dt,viewPos);
+  implTickCommon(dt,viewPos,scene);
+  }
+
+void PfxBucket::tickNext(uint64_t dt) {
+  if(decl.isDecal())
+    return;
+  for(size_t i=0; i<impl.size(); ++i) {
+    if(impl[i].st==S_Free)
+      continue;
+
+    if(impl[i].next==nullptr && decl.ppsCreateEm!=nullptr && impl[i].waitforNext<dt && impl[i].st==S_Active) {
+      // may allocate emitter in this bucket: impl[i] is not stable across this call
+      std::unique_ptr<PfxEmitter> next(new PfxEmitter(parent,decl.ppsCreateEm));
+      auto& emitter = impl[i];
+      next->setPosition(emitter.pos.x,emitter.pos.y,emitter.pos.z);
+      next->setActive(true);
+      next->setLooped(emitter.isLoop);
+      emitter.next = std::move(next);
+      }
+
+    if(impl[i].waitforNext>=dt)
+      impl[i].waitforNext-=dt;
+    }
   }
 
-void PfxBucket::implTickCommon(uint64_t dt, const Vec3& viewPos) {
+void PfxBucket::implTickCommon(uint64_t dt, const Vec3& viewPos, const SceneGlobals& scene) {
   bool doShrink = false;
+  trlClock += dt;
   for(auto& emitter:impl) {
     if(emitter.st==S_Free)
       continue;
 
     const auto dp     = emitter.pos-viewPos;
     const bool nearby = (dp.quadLength()<PfxObjects::viewRage*PfxObjects::viewRage);
-
-    if(emitter.next==nullptr && decl.ppsCreateEm!=nullptr && emitter.waitforNext<dt && emitter.st==S_Active) {
-      emitter.next.reset(new PfxEmitter(parent,decl.ppsCreateEm));
-      auto& e = *emitter.next;
-      e.setPosition(emitter.pos.x,emitter.pos.y,emitter.pos.z);
-      e.setActive(true);
-      e.setLooped(emitter.isLoop);
-      }
-
-    if(emitter.waitforNext>=dt)
-      emitter.waitforNext-=dt;
+    const auto lod    = lodOf(emitter.block!=size_t(-1) ? &block[emitter.block] : nullptr,emitter,viewPos,scene);
+    lodCount[lod]++;
 
     if(emitter.block!=size_t(-1)) {
       auto& p = getBlock(emitter);
-      if(p.count>0) {
-        for(size_t i=0;i<blockSize;++i)
-          tick(p,emitter,i,dt);
-        if(p.count==0 && (emitter.st==S_Fade || !nearby)) {
-          // free mem
-          freeBlock(emitter.block);
-          if(emitter.st==S_Fade)
-            emitter.st = S_Free;
-          doShrink = true;
-          continue;
-          }
+      p.lag += dt;
+      if(lod!=PfxObjects::L_Culled && p.lag>=LodStep[lod])
+        simulate(p,emitter,lod,nearby);
+      else if(lod==PfxObjects::L_Culled && !nearby && p.lag>=LodStep[PfxObjects::L_Far])
+        simulate(p,emitter,PfxObjects::L_Far,nearby); // let particles die out, to release the block
+      if(p.count==0 && (emitter.st==S_Fade || !nearby)) {
+        // free mem
+        freeBlock(emitter.block);
+        if(emitter.st==S_Fade)
+          emitter.st = S_Free;
+        doShrink = true;
         }
+      continue;
       }
 
-    if(emitter.st==S_Active && nearby) {
-      auto& p = getBlock(emitter);
-      auto dE = ppsDiff(decl,emitter.isLoop,p.timeTotal,p.timeTotal+dt);
-      tickEmit(p,emitter,dE);
-      }
-
-    if(emitter.block!=size_t(-1)) {
+    if(emitter.st==S_Active && nearby && lod!=PfxObjects::L_Culled) {
       auto& p = getBlock(emitter);
-      p.timeTotal+=dt;
+      p.lag = dt;
+      simulate(p,emitter,lod,nearby);
       }
     }
 
@@ -562,6 +726,64 @@ void PfxBucket::implTickCommon(uint64_t dt, const Vec3& viewPos) {
     shrink();
   }
 
+void PfxBucket::simulate(Block& p, ImplEmitter& emitter, PfxObjects::Lod lod, bool nearby) {
+  const uint64_t dt = p.lag;
+  p.lag   = 0;
+  p.dirty = true;
+  if(p.count>0)
+    tick(p,emitter,dt);
+
+  if(emitter.st==S_Active && nearby) {
+    const bool     catchUp = (dt>CatchUpTime);
+    const uint64_t window  = catchUp ? std::min(dt,decl.maxLifetime()) : dt;
+    uint64_t       dE      = ppsDiff(decl,emitter.isLoop,p.timeTotal+dt-window,p.timeTotal+dt);
+    if(LodSpawn[lod]>1) {
+      const uint64_t all = dE+p.spawnCarry;
+      dE           = all/LodSpawn[lod];
+      p.spawnCarry = uint32_t(all%LodSpawn[lod]);
+      }
+    tickEmit(p,emitter,dE,catchUp ? window : 0);
+    }
+
+  p.timeTotal += dt;
+  }
+
+PfxObjects::Lod PfxBucket::lodOf(const Block* p, const ImplEmitter& emitter, const Vec3& viewPos,
+                                 const SceneGlobals& scene) const {
+  // particles to be spawned
+  bool visible = isVisible(emitter.pos,spawnRadius,scene);
+  if(!visible && p!=nullptr && p->count>0) {
+    // particles alive: bounds of last simulation, grown by flight since then
+    const float t      = float(p->lag);
+    const float grow   = p->maxSpeed*t + 0.5f*decl.flyGravity.length()*t*t;
+    Vec3        center = (p->bbox[0]+p->bbox[1])*0.5f;
+    if(decl.useEmittersFOR)
+      center += p->pos;
+    visible = isVisible(center,(p->bbox[1]-p->bbox[0]).length()*0.5f + grow + sizeRadius,scene);
+    }
+  if(!visible)
+    return PfxObjects::L_Culled;
+
+  const float dist = (emitter.pos-viewPos).length();
+  if(dist<PfxObjects::viewRage*LodDistance[0])
+    return PfxObjects::L_Full;
+  if(dist<PfxObjects::viewRage*LodDistance[1])
+    return PfxObjects::L_Reduced;
+  return PfxObjects::L_Far;
+  }
+
+bool PfxBucket::isVisible(const Vec3& pos, float r, const SceneGlobals& scene) const {
+  if(r<=0)
+    return true;
+  if(scene.frustrum[SceneGlobals::V_Main].testPoint(pos,r))
+    return true;
+  // off-screen particles may still cast visible shadows
+  if(item[0].pShadow==nullptr && itemTrl[0].pShadow==nullptr)
+    return false;
+  return scene.frustrum[SceneGlobals::V_Shadow0].testPoint(pos,r) ||
+         scene.frustrum[SceneGlobals::V_Shadow1].testPoint(pos,r);
+  }
+
 void PfxBucket::implTickDecals(uint64_t, const Vec3&) {
   for(auto& emitter:impl) {
     if(emitter.st==S_Free)
@@ -570,11 +792,11 @@ void PfxBucket::implTickDecals(uint64_t, const Vec3&) {
     auto& p = getBlock(emitter);
     if(emitter.st==S_Active || emitter.st==S_Inactive) {
       if(p.count==0)
-        tickEmit(p,emitter,1);
+        tickEmit(p,emitter,1,0);
       } else
     if(emitter.st==S_Fade) {
       for(size_t i=0; i<blockSize; ++i)
-        particles[p.offset+i].life = 0;
+        particles.life[p.offset+i] = 0;
       p.count = 0;
       freeBlock(emitter.block);
       emitter.st = S_Free;
@@ -582,18 +804,21 @@ void PfxBucket::implTickDecals(uint64_t, const Vec3&) {
     }
   }
 
-void PfxBucket::tickEmit(Block& p, ImplEmitter& emitter, uint64_t emited) {
+void PfxBucket::tickEmit(Block& p, ImplEmitter& emitter, uint64_t emited, uint64_t spread) {
   size_t lastI = 0;
   for(size_t id=1; emited>0; ++id) {
-    const size_t i  = id%blockSize;
-    ParState&    ps = particles[i+p.offset];
-    if(ps.life==0) { // free slot
+    const size_t i    = id%blockSize;
+    uint16_t&    life = particles.life[i+p.offset];
+    if(life==0) { // free slot
       --emited;
       lastI = i;
       init(p,emitter,i+p.offset);
-      if(ps.life==0)
+      if(life==0)
         continue;
       p.count++;
+      p.dirty = true;
+      if(spread>0)
+        advance(p,i+p.offset,uint64_t(randf()*float(spread)));
       } else {
       // out of slots
       if(lastI==i)
@@ -614,19 +839,33 @@ void PfxBucket::buildSsbo() {
   auto  visAlphaFunc    = decl.visMaterial.alpha;
 
   for(auto& p:block) {
-    if(p.count==0)
+    // blocks, skipped by lod, keep billboards of previous step
+    if(p.count==0 || !p.dirty)
       continue;
+    p.dirty = false;
 
+    const float inf     = std::numeric_limits<float>::max();
+    Vec3        bbox[2] = {Vec3(inf,inf,inf), Vec3(-inf,-inf,-inf)};
+    float       speed   = 0;
     for(size_t pId=0; pId<blockSize; ++pId) {
-      ParState& ps = particles[pId+p.offset];
-      auto&     px = pfxCpu   [pId+p.offset];
+      const size_t i  = pId+p.offset;
+      auto&        px = pfxCpu[i];
 
-      if(ps.life==0) {
+      if(particles.life[i]==0) {
         px.size = Vec3();
         continue;
         }
 
-      const float a     = ps.lifeTime();
+      const Vec3 pos = particles.pos(i);
+      bbox[0].x = std::min(bbox[0].x,pos.x);
+      bbox[0].y = std::min(bbox[0].y,pos.y);
+      bbox[0].z = std::min(bbox[0].z,pos.z);
+      bbox[1].x = std::max(bbox[1].x,pos.x);
+      bbox[1].y = std::max(bbox[1].y,pos.y);
+      bbox[1].z = std::max(bbox[1].z,pos.z);
+      speed     = std::max(speed,particles.dir(i).quadLength());
+
+      const float a     = particles.lifeTime(i);
       const Vec3  cl    = colorS*(1.f-a)        + colorE*a;
       const float clA   = visAlphaStart*(1.f-a) + visAlphaEnd*a;
 
@@ -655,8 +894,11 @@ void PfxBucket::buildSsbo() {
         }
       uint32_t colorU32;
       std::memcpy(&colorU32,&color,4);
-      buildBilboard(px,p,ps, colorU32, szX,szY,szZ);
+      buildBilboard(px,p,i, colorU32, szX,szY,szZ);
       }
+    p.bbox[0]  = bbox[0];
+    p.bbox[1]  = bbox[1];
+    p.maxSpeed = std::sqrt(speed);
     }
   }
 
@@ -667,26 +909,31 @@ void PfxBucket::buildSsboTrails() {
   trlCpu.reserve(trlCpu.size());
   trlCpu.clear();
 
-  for(auto& p:particles) {
-    if(p.life==0)
+  if(trlCap==0)
+    return;
+
+  for(size_t i=0; i<particles.size(); ++i) {
+    if(particles.life[i]==0)
       continue;
-    if(p.trail.size()<2)
+    auto& r = trailRing[i];
+    if(r.size<2)
       continue;
 
-    float maxT = float(std::min(maxTrlTime,p.trail[0].time));
-    for(size_t r=1; r<p.trail.size(); ++r) {
+    const Trail* ring = &trailPool[i*trlCap];
+    float        maxT = float(std::min(maxTrlTime,trlClock-ring[r.head].time));
+    for(size_t k=1; k<r.size; ++k) {
       PfxState st;
-      buildTrailSegment(st,p.trail[r-1],p.trail[r],maxT);
+      buildTrailSegment(st,ring[(r.head+k-1)%trlCap],ring[(r.head+k)%trlCap],maxT);
       trlCpu.push_back(st);
       }
     }
   }
 
-void PfxBucket::buildBilboard(PfxState& v, const Block& p, const ParState& ps, const uint32_t color,
+void PfxBucket::buildBilboard(PfxState& v, const Block& p, size_t particle, const uint32_t color,
                               float szX, float szY, float szZ) {
   if(decl.useEmittersFOR)
-    v.pos = ps.pos + p.pos; else
-    v.pos = ps.pos;
+    v.pos = particles.pos(particle) + p.pos; else
+    v.pos = particles.pos(particle);
 
   v.size  = Vec3(szX,szY,szZ);
   v.color = color;
@@ -696,12 +943,12 @@ void PfxBucket::buildBilboard(PfxState& v, const Block& p, const ParState& ps, c
   v.bits0 |= uint32_t(decl.visYawAlign ? 1 : 0) << 2;
   v.bits0 |= uint32_t(0) << 3; // TODO: trails
   v.bits0 |= uint32_t(decl.visOrientation) << 4;
-  v.dir   = ps.dir;
+  v.dir   = particles.dir(particle);
   }
 
 void PfxBucket::buildTrailSegment(PfxState& v, const Trail& a, const Trail& b, float maxT) {
-  float    tA  = 1.f - float(a.time)/maxT;
-  float    tB  = 1.f - float(b.time)/maxT;
+  float    tA  = 1.f - float(trlClock-a.time)/maxT;
+  float    tB  = 1.f - float(trlClock-b.time)/maxT;
 
   uint32_t clA = mkTrailColor(tA);
   uint32_t clB = mkTrailColor(tB);
@@ -14,7 +14,7 @@ class PfxBucket {
   public:
     using Vertex = Resources::Vertex;
 
-    PfxBucket(const ParticleFx &decl, PfxObjects& parent, const SceneGlobals& scene, VisualObjects& visual);
+    PfxBucket(const ParticleFx &decl, PfxObjects& parent, const SceneGlobals& scene, VisualObjects& visual, uint32_t seed);
     ~PfxBucket();
 
     enum AllocState: uint8_t {
@@ -53,6 +53,10 @@ class PfxBucket {
     const ParticleFx&           decl;
     PfxObjects&                 parent;
 
+    // statistics of last tick
+    uint64_t                    cpuTime = 0; // us
+    uint32_t                    lodCount[PfxObjects::L_Count] = {};
+
     bool                        isEmpty() const;
 
     void                        prepareUniforms(const SceneGlobals& scene);
@@ -66,8 +70,12 @@ class PfxBucket {
     void                        freeEmitter(size_t& id);
 
     ImplEmitter&                get(size_t id) { return impl[id]; }
-    void                        tick(uint64_t dt, const Tempest::Vec3& viewPos);
+    // spawns child emitters: touches other buckets, so must not run concurrently with tick
+    void                        tickNext(uint64_t dt);
+    // touches only this bucket: safe to run in parallel with other buckets
+    void                        tick(uint64_t dt, const Tempest::Vec3& viewPos, const SceneGlobals& scene);
     void                        buildSsbo();
+    size_t                      numParticles() const;
 
   private:
     enum UboLinkpackage : uint8_t {
@@ -89,27 +97,48 @@ class PfxBucket {
       };
 
     struct Block final {
-      bool          allocated = false;
-      uint64_t      timeTotal = 0;
+      bool          allocated  = false;
+      uint64_t      timeTotal  = 0;
+      uint64_t      lag        = 0; // time, not yet simulated: lod step or culled
+      uint32_t      spawnCarry = 0; // spawns, skipped by lod
+
+      size_t        offset     = 0;
+      size_t        count      = 0;
 
-      size_t        offset    = 0;
-      size_t        count     = 0;
+      Tempest::Vec3 pos        = {};
 
-      Tempest::Vec3 pos       = {};
+      // bounds of particles as of last simulation, in particle space
+      Tempest::Vec3 bbox[2]    = {};
+      float         maxSpeed   = 0;
+      bool          dirty      = false;
       };
 
     struct Trail final {
       Tempest::Vec3 pos;
-      uint64_t      time = 0;
+      uint64_t      time = 0; // trlClock, at which point was placed
       };
 
-    struct ParState final {
-      uint16_t      life=0, maxLife=1;
-      Tempest::Vec3 pos, dir;
-
-      std::vector<Trail> trail;
+    // ring of trail points, over fixed-size slice of trail pool
+    struct TrailRing final {
+      uint8_t       head = 0;
+      uint8_t       size = 0;
+      };
 
-      float         lifeTime() const;
+    // particle storage, SoA: one entry per particle slot
+    struct ParState final {
+      std::vector<uint16_t> life, maxLife;
+      std::vector<float>    posX, posY, posZ;
+      std::vector<float>    dirX, dirY, dirZ;
+
+      size_t        size() const { return life.size(); }
+      void          resize(size_t sz);
+      void          clear(size_t i);
+
+      Tempest::Vec3 pos(size_t i) const { return Tempest::Vec3(posX[i],posY[i],posZ[i]); }
+      Tempest::Vec3 dir(size_t i) const { return Tempest::Vec3(dirX[i],dirY[i],dirZ[i]); }
+      void          setPos(size_t i, const Tempest::Vec3& v);
+      void          setDir(size_t i, const Tempest::Vec3& v);
+      float         lifeTime(size_t i) const;
       };
 
     struct Draw {
@@ -128,28 +157,33 @@ class PfxBucket {
 
     void                        drawCommon(Tempest::Encoder<Tempest::CommandBuffer>& cmd, const Draw& itm, SceneGlobals::VisCamera view, Material::AlphaFunc func);
 
-    void                        tickEmit(Block& p, ImplEmitter& emitter, uint64_t emited);
+    void                        tickEmit(Block& p, ImplEmitter& emitter, uint64_t emited, uint64_t spread);
+    void                        simulate(Block& p, ImplEmitter& emitter, PfxObjects::Lod lod, bool nearby);
+    auto                        lodOf(const Block* p, const ImplEmitter& emitter, const Tempest::Vec3& viewPos,
+                                      const SceneGlobals& scene) const -> PfxObjects::Lod;
+    bool                        isVisible(const Tempest::Vec3& pos, float r, const SceneGlobals& scene) const;
     bool                        shrink();
 
     size_t                      allocBlock();
     void                        freeBlock(size_t& s);
 
-    static float                randf();
-    static float                randf(float base, float var);
+    float                       randf();
+    float                       randf(float base, float var);
 
     Block&                      getBlock(ImplEmitter& emitter);
     Block&                      getBlock(PfxEmitter&  emitter);
 
     void                        init     (Block& block, ImplEmitter& emitter, size_t particle);
     void                        finalize (size_t particle);
-    void                        tick     (Block& sys, ImplEmitter& emitter, size_t particle, uint64_t dt);
-    void                        tickTrail(ParState& ps, ImplEmitter& emitter, uint64_t dt);
+    void                        advance  (Block& sys, size_t particle, uint64_t dt);
+    void                        tick     (Block& sys, ImplEmitter& emitter, uint64_t dt);
+    void                        tickTrail(size_t particle, const ImplEmitter& emitter);
 
-    void                        implTickCommon(uint64_t dt, const Tempest::Vec3& viewPos);
+    void                        implTickCommon(uint64_t dt, const Tempest::Vec3& viewPos, const SceneGlobals& scene);
     void                        implTickDecals(uint64_t dt, const Tempest::Vec3& viewPos);
 
     void                        buildSsboTrails();
-    void                        buildBilboard(PfxState& v, const Block& p, const ParState& ps, const uint32_t color,
+    void                        buildBilboard(PfxState& v, const Block& p, size_t particle, const uint32_t color,
                                               float szX, float szY, float szZ);
     void                        buildTrailSegment(PfxState& v, const Trail& a, const Trail& b, float maxT);
     uint32_t                    mkTrailColor(float clA) const;
@@ -162,15 +196,23 @@ class PfxBucket {
     Draw                        itemTrl[Resources::MaxFramesInFlight];
     std::vector<PfxState>       trlCpu;
 
-    uint64_t                    maxTrlTime = 0;
-    size_t                      blockSize = 0;
-
-    std::vector<ParState>       particles;
+    float                       spawnRadius = 0; // extent of emitter shape and particle size; 0 - unbounded
+    float                       sizeRadius  = 0; // half-size of largest particle
+    uint64_t                    maxTrlTime  = 0;
+    uint64_t                    trlClock    = 0;
+    size_t                      trlCap      = 0; // points per particle
+    size_t                      blockSize   = 0;
+
+    ParState                    particles;
+    std::vector<Trail>          trailPool;
+    std::vector<TrailRing>      trailRing;
+    std::vector<size_t>         dead;
     std::vector<ImplEmitter>    impl;
     std::vector<Block>          block;
     bool                        forceUpdate[Resources::MaxFramesInFlight] = {};
 
-    static std::mt19937         rndEngine;
+    // own sequence per bucket: buckets are ticked in parallel, and must not repeat each other
+    std::mt19937                rndEngine;
 
     friend class PfxEmitter;
   };
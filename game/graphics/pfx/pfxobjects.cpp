@@ -1,9 +1,13 @@
 #include "pfxobjects.h"
 
 #include <Tempest/Log>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 #include "graphics/sceneglobals.h"
+#include "utils/workers.h"
+#include "utils/profiler.h"
 
 #include "pfxbucket.h"
 #include "particlefx.h"
@@ -26,6 +30,7 @@ void PfxObjects::resetTicks() {
   }
 
 void PfxObjects::tick(uint64_t ticks) {
+  PROFILE_ZONE("PfxObjects::tick");
   static bool disabled = false;
   if(disabled)
     return;
@@ -39,15 +44,48 @@ void PfxObjects::tick(uint64_t ticks) {
   if(dt==0)
     return;
 
+  // child emitters may land in any bucket, so spawn them up front; the rest is bucket-local
   for(auto& i:bucket)
-    i.tick(dt,viewerPos);
+    i.tickNext(dt);
 
+  active.clear();
   for(auto& i:bucket)
-    i.buildSsbo();
+    active.push_back(&i);
+  Workers::parallelTasks(active,[dt,this](PfxBucket* b){
+    auto t0 = std::chrono::steady_clock::now();
+    b->tick(dt,viewerPos,scene);
+    b->buildSsbo();
+    b->cpuTime = uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-t0).count());
+    });
 
   lastUpdate = ticks;
   }
 
+PfxObjects::Stats PfxObjects::stats(size_t heaviest) const {
+  Stats ret;
+  for(auto& i:bucket) {
+    BucketStats b;
+    b.name      = i.decl.dbgName;
+    b.particles = i.numParticles();
+    b.time      = i.cpuTime;
+
+    ret.buckets++;
+    ret.particles += b.particles;
+    ret.time      += b.time;
+    for(size_t r=0; r<L_Count; ++r)
+      ret.emitters[r] += i.lodCount[r];
+    if(heaviest>0)
+      ret.heaviest.push_back(b);
+    }
+
+  auto mid = ret.heaviest.begin() + int(std::min(heaviest,ret.heaviest.size()));
+  std::partial_sort(ret.heaviest.begin(),mid,ret.heaviest.end(),[](const BucketStats& a, const BucketStats& b){
+    return a.time>b.time;
+    });
+  ret.heaviest.erase(mid,ret.heaviest.end());
+  return ret;
+  }
+
 bool PfxObjects::isInPfxRange(const Vec3& pos) const {
   auto dp = viewerPos-pos;
   return dp.quadLength()<viewRage*viewRage;
@@ -90,7 +128,7 @@ PfxBucket& PfxObjects::getBucket(const ParticleFx &decl) {
   for(auto& i:bucket)
     if(&i.decl==&decl)
       return i;
-  bucket.emplace_back(decl,*this,scene,visual);
+  bucket.emplace_back(decl,*this,scene,visual,bucketSeed++);
   return bucket.back();
   }
 
@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <list>
+#include <string_view>
 
 #include "world/objects/pfxemitter.h"
 #include "graphics/visualobjects.h"
@@ -21,11 +22,35 @@ class PfxObjects final {
 
     static constexpr const float viewRage = 4000.f;
 
+    // simulation level of emitter: distance band, or culled - simulation is deferred until visible
+    enum Lod : uint8_t {
+      L_Full,
+      L_Reduced,
+      L_Far,
+      L_Culled,
+      L_Count,
+      };
+
+    struct BucketStats final {
+      std::string_view name;
+      size_t           particles = 0;
+      uint64_t         time      = 0; // us, last tick
+      };
+
+    struct Stats final {
+      size_t                   buckets   = 0;
+      size_t                   particles = 0;
+      size_t                   emitters[L_Count] = {};
+      uint64_t                 time      = 0; // us, last tick, sum over buckets
+      std::vector<BucketStats> heaviest;      // by cpu time of last tick
+      };
+
     void       setViewerPos(const Tempest::Vec3& pos);
 
     void       resetTicks();
     void       tick(uint64_t ticks);
     bool       isInPfxRange(const Tempest::Vec3& pos) const;
+    Stats      stats(size_t heaviest = 0) const;
 
     void       prepareUniforms();
     void       preFrameUpdate(uint8_t fId);
@@ -51,6 +76,8 @@ class PfxObjects final {
     std::recursive_mutex          sync;
 
     std::list<PfxBucket>          bucket;
+    std::vector<PfxBucket*>       active;
+    uint32_t                      bucketSeed = 0;
     std::vector<SpriteEmitter>    spriteEmit;
 
     Tempest::Vec3                 viewerPos={};
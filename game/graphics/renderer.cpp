@@ -9,6 +9,7 @@
 #include "camera.h"
 #include "gothic.h"
 #include "ui/videowidget.h"
+#include "utils/profiler.h"
 #include "utils/string_frm.h"
 
 #include <ui/videowidget.h>
@@ -765,6 +766,7 @@ void Renderer::prepareSky(Tempest::Encoder<Tempest::CommandBuffer>& cmd, uint8_t
 void Renderer::draw(Encoder<CommandBuffer>& cmd, uint8_t cmdId, size_t imgId,
                     VectorImage::Mesh& uiLayer, VectorImage::Mesh& numOverlay,
                     InventoryMenu& inventory, VideoWidget& video) {
+  PROFILE_ZONE("Renderer::draw");
   auto& result = swapchain[imgId];
 
   if(!video.isActive()) {
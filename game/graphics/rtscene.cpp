@@ -17,6 +17,11 @@ void RtScene::notifyTlas(const Material& mat, Category cat) const {
   needToUpdate = true;
   }
 
+void RtScene::notifyTextures() const {
+  if(!tex.empty())
+    needToUpdate = true;
+  }
+
 bool RtScene::isUpdateRequired() const {
   return needToUpdate;
   }
@@ -27,6 +27,8 @@ class RtScene {
       };
 
     void notifyTlas(const Material& m, RtScene::Category cat) const;
+    // content of streamed textures has changed: bindings must be rebuilt
+    void notifyTextures() const;
     bool isUpdateRequired() const;
 
     void addInstance(const Tempest::Matrix4x4& pos, const Tempest::AccelerationStructure& blas,
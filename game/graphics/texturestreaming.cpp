@@ -0,0 +1,433 @@
+#include "texturestreaming.h"
+
+#include <Tempest/Device>
+#include <Tempest/MemReader>
+
+#include <zenkit/Texture.hh>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "utils/fileext.h"
+#include "resources.h"
+
+using namespace Tempest;
+
+namespace {
+struct DdsHeader final {
+  uint32_t magic       = 0x20534444; // "DDS "
+  uint32_t size        = 124;
+  uint32_t flags       = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000; // caps, height, width, pixelformat, mipcount, linearsize
+  uint32_t height      = 0;
+  uint32_t width       = 0;
+  uint32_t linearSize  = 0;
+  uint32_t depth       = 0;
+  uint32_t mipCount    = 0;
+  uint32_t reserved1[11] = {};
+  uint32_t pfSize      = 32;
+  uint32_t pfFlags     = 0x4; // fourcc
+  uint32_t fourCC      = 0;
+  uint32_t rgbBitCount = 0;
+  uint32_t masks[4]    = {};
+  uint32_t caps        = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+  uint32_t caps2       = 0;
+  uint32_t caps3       = 0;
+  uint32_t caps4       = 0;
+  uint32_t reserved2   = 0;
+  };
+static_assert(sizeof(DdsHeader)==128);
+}
+
+static uint32_t fourCC(zenkit::TextureFormat frm) {
+  auto cc = [](char n) { return uint32_t('D') | uint32_t('X')<<8 | uint32_t('T')<<16 | uint32_t(n)<<24; };
+  switch(frm) {
+    case zenkit::TextureFormat::DXT1: return cc('1');
+    case zenkit::TextureFormat::DXT3: return cc('3');
+    case zenkit::TextureFormat::DXT5: return cc('5');
+    default:
+      // DXT2/DXT4 and uncompressed textures are loaded by Resources, as a whole
+      return 0;
+    }
+  }
+
+namespace {
+// header of compiled -C.TEX texture; mip levels follow it, smallest first
+struct CompiledTex final {
+  char     magic[4]  = {};
+  uint32_t version   = 0;
+  uint32_t format    = 0;
+  uint32_t width     = 0;
+  uint32_t height    = 0;
+  uint32_t mipCount  = 0;
+  uint32_t refWidth  = 0;
+  uint32_t refHeight = 0;
+  uint32_t avgColor  = 0;
+
+  uint32_t mipWidth (uint32_t level) const { return std::max(1u,width >>level); }
+  uint32_t mipHeight(uint32_t level) const { return std::max(1u,height>>level); }
+  uint64_t mipSize  (uint32_t level) const {
+    const uint64_t blocks = uint64_t(std::max(1u,mipWidth(level)/4))*uint64_t(std::max(1u,mipHeight(level)/4));
+    return blocks*(zenkit::TextureFormat(format)==zenkit::TextureFormat::DXT1 ? 8 : 16);
+    }
+  // size of levels [first..mipCount)
+  uint64_t tailSize (uint32_t first) const {
+    uint64_t ret = 0;
+    for(uint32_t i=first; i<mipCount; ++i)
+      ret += mipSize(i);
+    return ret;
+    }
+  };
+static_assert(sizeof(CompiledTex)==36);
+}
+
+static std::unique_ptr<zenkit::Read> openCompiled(std::string_view name, CompiledTex& hdr) {
+  // only header is read here: small or unsupported textures are left to Resources
+  if(!FileExt::hasExt(name,"TGA"))
+    return nullptr;
+  std::string cname = std::string(name);
+  cname.resize(cname.size() + 2);
+  std::memcpy(&cname[0]+cname.size()-6,"-C.TEX",6);
+
+  const auto* entry = Resources::vdfsIndex().find(cname);
+  if(entry==nullptr)
+    return nullptr;
+  try {
+    auto reader = entry->open_read();
+    if(reader->read(&hdr,sizeof(hdr))!=sizeof(hdr))
+      return nullptr;
+    if(std::memcmp(hdr.magic,"ZTEX",4)!=0 || hdr.version!=0)
+      return nullptr;
+    if(fourCC(zenkit::TextureFormat(hdr.format))==0 || hdr.mipCount<=1 || hdr.mipCount>16)
+      return nullptr;
+    return reader;
+    }
+  catch(...) {
+    return nullptr;
+    }
+  }
+
+static uint32_t lowMip(const CompiledTex& tex, uint32_t lowSize) {
+  for(uint32_t i=0; i<tex.mipCount; ++i)
+    if(std::max(tex.mipWidth(i),tex.mipHeight(i))<=lowSize)
+      return i;
+  return tex.mipCount-1;
+  }
+
+static Pixmap readPixmap(zenkit::Read& rd, const CompiledTex& tex, uint32_t first) {
+  // mip-tail as dds, starting from 'first' level; block-compressed data is copied as is.
+  // File stores levels smallest first, so tail is a prefix of data, that follows the header
+  DdsHeader hdr;
+  hdr.width      = tex.mipWidth(first);
+  hdr.height     = tex.mipHeight(first);
+  hdr.linearSize = uint32_t(tex.mipSize(first));
+  hdr.mipCount   = tex.mipCount-first;
+  hdr.fourCC     = fourCC(zenkit::TextureFormat(tex.format));
+
+  const size_t         tail = size_t(tex.tailSize(first));
+  std::vector<uint8_t> dds(sizeof(hdr) + tail);
+  std::memcpy(dds.data(),&hdr,sizeof(hdr));
+
+  rd.seek(sizeof(CompiledTex), zenkit::Whence::BEG);
+  size_t at = dds.size();
+  for(uint32_t i=tex.mipCount; i>first; ) {
+    --i;
+    const size_t sz = size_t(tex.mipSize(i));
+    at -= sz;
+    if(rd.read(dds.data()+at,sz)!=sz)
+      throw std::runtime_error("truncated texture");
+    }
+
+  MemReader mem(dds.data(),dds.size());
+  return Pixmap(mem);
+  }
+
+uint32_t TextureResidency::add(uint64_t low, uint64_t full) {
+  Entry e;
+  e.lowBytes  = low;
+  e.fullBytes = std::max(full,low);
+  entries.push_back(e);
+  resident += low;
+  lowTotal += low;
+  return uint32_t(entries.size()-1);
+  }
+
+void TextureResidency::touch(uint32_t id, float distance, uint64_t time) {
+  auto& e = entries[id];
+  if(!e.used || e.sweep!=sweep)
+    e.distance = distance; else
+    e.distance = std::min(e.distance,distance);
+  e.sweep    = sweep;
+  e.used     = true;
+  e.lastUsed = std::max(e.lastUsed,time);
+  }
+
+void TextureResidency::update(uint64_t time, Decision& out) {
+  out.load.clear();
+  out.evict.clear();
+
+  auto recent = [time](const Entry& e) {
+    return e.used && time<=e.lastUsed+IdleTime;
+    };
+  auto key = [](const Entry& e) {
+    return e.state==S_Low ? e.distance : e.distance*KeepBias;
+    };
+
+  order.clear();
+  for(uint32_t i=0; i<entries.size(); ++i) {
+    auto& e = entries[i];
+    if(e.state==S_Low && (e.broken || !recent(e)))
+      continue;
+    order.push_back(i);
+    }
+
+  // textures in use go first, nearest first; idle ones keep full mips only while there is room
+  std::sort(order.begin(),order.end(),[&](uint32_t a, uint32_t b){
+    auto&      ea = entries[a];
+    auto&      eb = entries[b];
+    const bool ra = recent(ea);
+    const bool rb = recent(eb);
+    if(ra!=rb)
+      return ra;
+    const float ka = key(ea);
+    const float kb = key(eb);
+    if(ka!=kb)
+      return ka<kb;
+    return a<b;
+    });
+
+  uint64_t total = lowTotal;
+  uint32_t slots = MaxLoadsInFlight - std::min(inFlight,MaxLoadsInFlight);
+  for(auto id:order) {
+    auto&          e     = entries[id];
+    const uint64_t extra = e.fullBytes-e.lowBytes;
+    const bool     want  = (budgetBytes==0 || total+extra<=budgetBytes);
+    if(want)
+      total += extra;
+
+    if(want && e.state==S_Low && slots>0) {
+      e.state   = S_Loading;
+      resident += extra;
+      inFlight++;
+      slots--;
+      out.load.push_back(id);
+      }
+    else if(!want && e.state==S_Full) {
+      out.evict.push_back(id);
+      }
+    }
+  }
+
+void TextureResidency::complete(uint32_t id, bool full) {
+  auto& e = entries[id];
+  if(e.state==S_Loading)
+    inFlight--;
+  if(full) {
+    e.state = S_Full;
+    return;
+    }
+  if(e.state==S_Loading)
+    e.broken = true;
+  if(e.state!=S_Low)
+    resident -= (e.fullBytes-e.lowBytes);
+  e.state = S_Low;
+  }
+
+TextureStreaming::TextureStreaming() {
+  }
+
+TextureStreaming::~TextureStreaming() {
+  for(auto& i:jobs)
+    i.wait();
+  }
+
+void TextureStreaming::setup(bool enable, uint64_t budget) {
+  std::lock_guard<std::mutex> guard(sync);
+  enabled = enable;
+  residency.setBudget(budget);
+  }
+
+const Texture2d* TextureStreaming::load(std::string_view name) {
+  if(!enabled || name.empty())
+    return nullptr;
+  auto s = cache.get(std::string(name),[this,name](){
+    return implLoad(name);
+    });
+  return s!=nullptr ? &s->tex : nullptr;
+  }
+
+std::unique_ptr<TextureStreaming::Slot> TextureStreaming::implLoad(std::string_view name) {
+  CompiledTex hdr;
+  auto        rd = openCompiled(name,hdr);
+  if(rd==nullptr)
+    return nullptr;
+
+  const uint32_t first = lowMip(hdr,LowMipSize);
+  if(first==0)
+    return nullptr; // small enough as is
+
+  auto ret = std::make_unique<Slot>();
+  try {
+    ret->low = readPixmap(*rd,hdr,first);
+    ret->tex = Resources::loadTexturePm(ret->low,ret->low.mipCount()>1);
+    }
+  catch(...) {
+    return nullptr;
+    }
+  ret->name   = std::string(name);
+  ret->width  = hdr.width;
+  ret->height = hdr.height;
+  ret->mips   = hdr.mipCount;
+
+  std::lock_guard<std::mutex> guard(sync);
+  ret->id = residency.add(hdr.tailSize(first),hdr.tailSize(0));
+  slots.push_back(ret.get());
+  index[&ret->tex] = ret->id;
+  return ret;
+  }
+
+void TextureStreaming::implLoadFull(uint32_t id) {
+  std::string name;
+  {
+  std::lock_guard<std::mutex> guard(sync);
+  name = slots[id]->name;
+  }
+
+  Ready r;
+  r.id = id;
+  CompiledTex hdr;
+  if(auto rd = openCompiled(name,hdr)) {
+    try {
+      auto pm = readPixmap(*rd,hdr,0);
+      r.tex = Resources::loadTexturePm(pm,pm.mipCount()>1);
+      r.ok  = true;
+      }
+    catch(...) {
+      }
+    }
+
+  std::lock_guard<std::mutex> guard(sync);
+  ready.emplace_back(std::move(r));
+  }
+
+void TextureStreaming::touch(const std::vector<Usage>& usage) {
+  std::lock_guard<std::mutex> guard(sync);
+  for(auto& u:usage) {
+    auto it = index.find(u.tex);
+    if(it==index.end())
+      continue;
+    residency.touch(it->second,u.distance,now);
+    if(recording)
+      current.usage.emplace_back(it->second,u.distance);
+    }
+  }
+
+void TextureStreaming::beginSweep() {
+  std::lock_guard<std::mutex> guard(sync);
+  residency.beginSweep();
+  }
+
+bool TextureStreaming::tick(uint64_t time) {
+  now = time;
+  if(time<lastUpdate+UpdateInterval)
+    return false;
+  lastUpdate = time;
+
+  // swaps are batched: each batch costs a rebind of scene descriptors
+  bool changed = false;
+  {
+  std::lock_guard<std::mutex> guard(sync);
+  for(auto& r:ready) {
+    if(r.ok) {
+      auto& s = *slots[r.id];
+      Resources::recycle(std::move(s.tex));
+      s.tex   = std::move(r.tex);
+      changed = true;
+      }
+    residency.complete(r.id,r.ok);
+    }
+  ready.clear();
+
+  residency.update(time,decision);
+  if(recording) {
+    current.time = time;
+    record.emplace_back(std::move(current));
+    current = Sample();
+    }
+
+  for(auto id:decision.evict) {
+    auto& s = *slots[id];
+    Resources::recycle(std::move(s.tex));
+    s.tex   = Resources::loadTexturePm(s.low,s.low.mipCount()>1);
+    changed = true;
+    residency.complete(id,false);
+    }
+  numLoads  += decision.load.size();
+  numEvicts += decision.evict.size();
+  }
+
+  jobs.erase(std::remove_if(jobs.begin(),jobs.end(),[](const Workers::Task& t){ return t.isDone(); }),jobs.end());
+  for(auto id:decision.load) {
+    jobs.push_back(Workers::async([this,id](){
+      implLoadFull(id);
+      }));
+    }
+
+  if(changed)
+    ++gen;
+  return changed;
+  }
+
+void TextureStreaming::setRecording(bool r) {
+  std::lock_guard<std::mutex> guard(sync);
+  if(r && !recording) {
+    record.clear();
+    current = Sample();
+    }
+  recording = r;
+  }
+
+TextureResidency TextureStreaming::residencyProto() const {
+  std::lock_guard<std::mutex> guard(sync);
+  TextureResidency ret;
+  ret.setBudget(residency.budget());
+  for(uint32_t i=0; i<residency.size(); ++i)
+    ret.add(residency.lowBytes(i),residency.fullBytes(i));
+  return ret;
+  }
+
+TextureStreaming::Stats TextureStreaming::stats() const {
+  std::lock_guard<std::mutex> guard(sync);
+  Stats ret;
+  ret.textures  = residency.size();
+  ret.resident  = residency.residentBytes();
+  ret.low       = residency.lowBytes();
+  ret.budget    = residency.budget();
+  ret.loads     = numLoads;
+  ret.evictions = numEvicts;
+  for(uint32_t i=0; i<residency.size(); ++i)
+    if(residency.isFull(i))
+      ret.full++;
+  return ret;
+  }
+
+void TextureStreaming::wait() {
+  for(auto& i:jobs)
+    i.wait();
+  jobs.clear();
+  }
+
+size_t TextureStreaming::validate() const {
+  std::lock_guard<std::mutex> guard(sync);
+  size_t ret = 0;
+  for(auto s:slots) {
+    auto&      t    = s->tex;
+    const bool full = residency.isFull(s->id);
+    const auto w    = full ? s->width  : uint32_t(s->low.w());
+    const auto h    = full ? s->height : uint32_t(s->low.h());
+    const auto mips = full ? s->mips   : s->low.mipCount();
+    if(uint32_t(t.w())!=w || uint32_t(t.h())!=h || t.mipCount()!=mips)
+      ++ret;
+    }
+  return ret;
+  }
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Tempest/Pixmap>
+#include <Tempest/Texture2d>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/resourcecache.h"
+#include "utils/workers.h"
+
+// Residency policy of streamed textures: pure bookkeeping, no gpu objects.
+// Recently used textures get full mip-chain, nearest first, as long as memory budget allows;
+// everything else falls back to low mips.
+class TextureResidency final {
+  public:
+    struct Decision final {
+      std::vector<uint32_t> load;
+      std::vector<uint32_t> evict;
+      };
+
+    static constexpr uint64_t IdleTime         = 5000; // ms, after which texture is no longer 'in use'
+    static constexpr uint32_t MaxLoadsInFlight = 16;
+    static constexpr float    KeepBias         = 0.75f; // resident textures look closer, to avoid thrashing at budget edge
+
+    // 0 - unlimited
+    void     setBudget(uint64_t bytes) { budgetBytes = bytes; }
+    uint64_t budget() const { return budgetBytes; }
+
+    uint32_t add(uint64_t lowBytes, uint64_t fullBytes);
+    size_t   size() const { return entries.size(); }
+
+    // begin new pass over scene: distance is minimum over a single pass
+    void     beginSweep() { ++sweep; }
+    void     touch(uint32_t id, float distance, uint64_t time);
+    // loads are in flight, until complete; evictions are expected to be complete right away
+    void     update(uint64_t time, Decision& out);
+    // full==false for a pending load: load has failed, texture stays at low mips
+    void     complete(uint32_t id, bool full);
+
+    bool     isFull       (uint32_t id) const { return entries[id].state==S_Full; }
+    uint64_t fullBytes    (uint32_t id) const { return entries[id].fullBytes; }
+    uint64_t lowBytes     (uint32_t id) const { return entries[id].lowBytes;  }
+    uint64_t lowBytes     ()            const { return lowTotal; }
+    uint64_t residentBytes()            const { return resident; }
+
+  private:
+    enum State : uint8_t {
+      S_Low,
+      S_Loading,
+      S_Full,
+      };
+
+    struct Entry final {
+      uint64_t lowBytes  = 0;
+      uint64_t fullBytes = 0;
+      uint64_t lastUsed  = 0;
+      uint32_t sweep     = 0;
+      float    distance  = 0;
+      bool     used      = false;
+      bool     broken    = false;
+      State    state     = S_Low;
+      };
+
+    std::vector<Entry>    entries;
+    std::vector<uint32_t> order;
+    uint64_t              budgetBytes = 0;
+    uint64_t              resident    = 0;
+    uint64_t              lowTotal    = 0;
+    uint32_t              sweep       = 0;
+    uint32_t              inFlight    = 0;
+  };
+
+// Streaming of world textures: texture is created from low mips right away, full mip-chain
+// is decoded on worker threads. Texture2d objects have stable address, content is swapped in between frames.
+class TextureStreaming final {
+  public:
+    TextureStreaming();
+    ~TextureStreaming();
+
+    struct Usage final {
+      const Tempest::Texture2d* tex      = nullptr;
+      float                     distance = 0;
+      };
+
+    // usage of textures, in between of two residency updates
+    struct Sample final {
+      uint64_t                               time = 0;
+      std::vector<std::pair<uint32_t,float>> usage;
+      };
+
+    struct Stats final {
+      size_t   textures  = 0;
+      size_t   full      = 0;
+      uint64_t resident  = 0;
+      uint64_t low       = 0;
+      uint64_t budget    = 0;
+      uint64_t loads     = 0;
+      uint64_t evictions = 0;
+      };
+
+    void        setup(bool enable, uint64_t budget);
+
+    // thread-safe; nullptr, if texture is not streamable
+    const Tempest::Texture2d* load(std::string_view name);
+
+    // main thread only
+    void        touch(const std::vector<Usage>& usage);
+    void        beginSweep();
+    // apply finished loads and issue new ones; returns true, if content of any texture has changed
+    bool        tick(uint64_t time);
+    uint64_t    generation() const { return gen; }
+
+    void        setRecording(bool r);
+    auto        recorded() const -> const std::vector<Sample>& { return record; }
+    // copy of residency bookkeeping, without state: sizes of all known textures
+    auto        residencyProto() const -> TextureResidency;
+    Stats       stats() const;
+    // main thread only: blocks, until loads in flight are done; they are applied by next tick
+    void        wait();
+    // number of textures, which size or mip count doesn't match their residency state
+    size_t      validate() const;
+
+  private:
+    struct Slot final {
+      Tempest::Texture2d tex;
+      Tempest::Pixmap    low;
+      std::string        name;
+      uint32_t           id     = 0;
+      // full mip-chain
+      uint32_t           width  = 0;
+      uint32_t           height = 0;
+      uint32_t           mips   = 0;
+      };
+
+    struct Ready final {
+      uint32_t           id = 0;
+      Tempest::Texture2d tex;
+      bool               ok = false;
+      };
+
+    static constexpr uint32_t LowMipSize     = 64;
+    static constexpr uint64_t UpdateInterval = 250;
+
+    std::unique_ptr<Slot> implLoad(std::string_view name);
+    void                  implLoadFull(uint32_t id);
+
+    bool                                   enabled = true;
+
+    ResourceCache<std::string,Slot>        cache;
+
+    mutable std::mutex                     sync; // slots, index, residency and ready queue
+    std::vector<Slot*>                     slots;
+    std::unordered_map<const Tempest::Texture2d*,uint32_t> index;
+    TextureResidency                       residency;
+    std::vector<Ready>                     ready;
+
+    std::vector<Workers::Task>             jobs;
+    TextureResidency::Decision             decision;
+    uint64_t                               now        = 0;
+    uint64_t                               lastUpdate = 0;
+    uint64_t                               gen        = 0;
+    uint64_t                               numLoads   = 0;
+    uint64_t                               numEvicts  = 0;
+
+    bool                                   recording = false;
+    std::vector<Sample>                    record;
+    Sample                                 current;
+  };
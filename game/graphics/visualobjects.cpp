@@ -2,7 +2,10 @@
 
 #include <Tempest/Log>
 
+#include <limits>
+
 #include "graphics/mesh/submesh/animmesh.h"
+#include "graphics/texturestreaming.h"
 #include "gothic.h"
 
 using namespace Tempest;
@@ -478,7 +481,14 @@ void VisualObjects::prepareGlobals(Encoder<CommandBuffer>& enc, uint8_t fId) {
   if(cs)
     drawCmd.updateTasksUniforms();
 
-  if(mem || buk|| cmd)
+  const uint64_t texGen = Resources::textureStreaming().generation();
+  const bool     tex    = (texGen!=texGeneration);
+  if(tex) {
+    texGeneration = texGen;
+    scene.rtScene.notifyTextures();
+    }
+
+  if(mem || buk || cmd || tex)
     drawCmd.updateCommandUniforms();
 
   drawCmd.updateUniforms(fId);
@@ -489,6 +499,41 @@ void VisualObjects::preFrameUpdate(uint8_t fId) {
   preFrameUpdateMorph(fId);
   }
 
+void VisualObjects::touchTextures(const Vec3& viewer) {
+  // usage of streamed textures: clusters are visited in slices, full sweep over scene takes few frames
+  static constexpr size_t SliceSize = 8192;
+  static constexpr float  NoUse     = std::numeric_limits<float>::max();
+
+  auto& bk = bucketsMem.buckets();
+  if(texUsage.size()<bk.size())
+    texUsage.resize(bk.size(),NoUse);
+
+  const size_t end = std::min(clusters.size(), texSweep+SliceSize);
+  for(size_t i=texSweep; i<end; ++i) {
+    auto& c = clusters[i];
+    if(c.meshletCount==0 || c.r<0 || c.bucketId>=texUsage.size())
+      continue;
+    const float dist = std::max(0.f, (c.pos-viewer).length()-c.r);
+    texUsage[c.bucketId] = std::min(texUsage[c.bucketId], dist);
+    }
+  texSweep = end;
+  if(texSweep<clusters.size())
+    return;
+
+  std::vector<TextureStreaming::Usage> usage;
+  for(size_t i=0; i<texUsage.size() && i<bk.size(); ++i) {
+    if(texUsage[i]==NoUse || bk[i].mat.tex==nullptr)
+      continue;
+    usage.push_back({bk[i].mat.tex, texUsage[i]});
+    }
+  auto& st = Resources::textureStreaming();
+  st.beginSweep();
+  st.touch(usage);
+
+  texSweep = 0;
+  std::fill(texUsage.begin(),texUsage.end(),NoUse);
+  }
+
 void VisualObjects::preFrameUpdateWind(uint8_t fId) {
   if(!scene.zWindEnabled)
     return;
@@ -70,6 +70,7 @@ class VisualObjects final {
     void prepareUniforms();
     void prepareLigtsUniforms();
     void preFrameUpdate (uint8_t fId);
+    void touchTextures  (const Tempest::Vec3& viewer);
     void prepareGlobals (Tempest::Encoder<Tempest::CommandBuffer>& cmd, uint8_t fId);
     void postFrameupdate();
 
@@ -155,6 +156,10 @@ class VisualObjects final {
     std::unordered_set<size_t> objectsMorph;
     std::unordered_set<size_t> objectsFree;
 
+    std::vector<float>         texUsage;      // min distance to viewer per bucket, in current sweep
+    size_t                     texSweep      = 0;
+    uint64_t                   texGeneration = 0;
+
     friend class Item;
   };
 
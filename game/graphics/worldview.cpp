@@ -70,6 +70,7 @@ void WorldView::preFrameUpdate(const Camera& camera, uint64_t tickCount, uint8_t
 
   pfxGroup.preFrameUpdate(fId);
   visuals .preFrameUpdate(fId);
+  visuals .touchTextures(camera.originLwc());
   }
 
 void WorldView::prepareGlobals(Tempest::Encoder<Tempest::CommandBuffer>& cmd, uint8_t fId) {
@@ -217,6 +218,12 @@ LightGroup::Light WorldView::addLight(std::string_view preset) {
   return l;
   }
 
+LightGroup::Light WorldView::addLight(LightSource&& src) {
+  auto l = gLights.add(std::move(src));
+  l.setTimeOffset(owner.tickCount());
+  return l;
+  }
+
 void WorldView::dbgClusters(Tempest::Painter& p, Vec2 wsz) {
   visuals.dbgClusters(p, wsz);
   }
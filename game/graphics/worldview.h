@@ -77,6 +77,7 @@ class WorldView {
     MeshObjects::Mesh   addDecalView (const zenkit::VisualDecal& vob);
     LightGroup::Light   addLight     (const zenkit::VLight& vob);
     LightGroup::Light   addLight     (std::string_view preset);
+    LightGroup::Light   addLight     (LightSource&& l);
 
     void                dbgClusters(Tempest::Painter& p, Tempest::Vec2 wsz);
 
@@ -84,6 +85,7 @@ class WorldView {
     const Sky&          sky() const { return gSky; }
     const Landscape&    landscape() const { return land; }
     const LightGroup&   lights() const { return gLights; }
+    PfxObjects&         particles() { return pfxGroup; }
 
   private:
     const World&  owner;
@@ -0,0 +1,168 @@
+#include "headless.h"
+
+#include <Tempest/File>
+#include <Tempest/Log>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "game/gamesession.h"
+#include "game/serialize.h"
+#include "world/world.h"
+#include "utils/profiler.h"
+#include "gothic.h"
+#include "marvin.h"
+
+using namespace Tempest;
+
+namespace {
+struct Series final {
+  const char*           name = "";
+  std::vector<uint64_t> us;
+  };
+
+struct Output final {
+  void print(std::string_view s) {
+    std::printf("  %.*s\n", int(s.size()), s.data());
+    }
+  };
+}
+
+static void report(const Series& s) {
+  if(s.us.empty())
+    return;
+  std::vector<uint64_t> v = s.us;
+  std::sort(v.begin(),v.end());
+
+  uint64_t sum = 0;
+  for(auto i:v)
+    sum += i;
+  auto pct = [&v](size_t p) {
+    return double(v[std::min(v.size()-1,(v.size()*p)/100)])/1000.0;
+    };
+  std::printf("  %-10s avg %8.3f ms, p50 %8.3f, p95 %8.3f, p99 %8.3f, max %8.3f\n",
+              s.name, double(sum)/double(v.size())/1000.0, pct(50), pct(95), pct(99), double(v.back())/1000.0);
+  }
+
+int Headless::run(uint32_t frames, const std::vector<std::string>& bench) {
+  if(frames==0 && !bench.empty())
+    return exec(bench);
+  int ret = simulate(frames);
+  if(ret==0)
+    ret = exec(bench);
+  return ret;
+  }
+
+int Headless::simulate(uint32_t frames) {
+  using clock = std::chrono::steady_clock;
+  auto us = [](clock::time_point a, clock::time_point b) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(b-a).count());
+    };
+
+  auto& gothic = Gothic::inst();
+  if(!startGame()) {
+    Log::e("headless: unable to load game");
+    return 1;
+    }
+
+  enum : uint8_t { F_Frame, F_Script, F_Objects, F_Physics, F_Sound, F_Effects, F_Anim, F_Count };
+  Series st[F_Count] = {{"frame"},{"script"},{"objects"},{"physics"},{"sound"},{"effects"},{"animation"}};
+  for(auto& i:st)
+    i.us.reserve(frames);
+
+  const auto time0 = clock::now();
+  uint32_t   done  = 0;
+  for(; done<frames; ++done) {
+    PROFILE_FRAME();
+    const auto t0 = clock::now();
+    gothic.tick(FrameTime);
+    const auto t1 = clock::now();
+    gothic.updateAnimation(FrameTime);
+    const auto t2 = clock::now();
+
+    auto world = gothic.world();
+    if(world==nullptr)
+      break; // session is over
+    // world tick is nested into session tick: remainder is script vm
+    auto&          ws    = world->tickStats();
+    const uint64_t tick  = us(t0,t1);
+    const uint64_t wrld  = ws.objects + ws.physics + ws.view + ws.sound + ws.effects;
+    st[F_Frame  ].us.push_back(us(t0,t2));
+    st[F_Script ].us.push_back(tick>wrld ? tick-wrld : 0);
+    st[F_Objects].us.push_back(ws.objects);
+    st[F_Physics].us.push_back(ws.physics);
+    st[F_Sound  ].us.push_back(ws.sound);
+    st[F_Effects].us.push_back(ws.effects);
+    st[F_Anim   ].us.push_back(us(t1,t2));
+
+    // change of world: loading time is not a part of statistics
+    if(gothic.checkLoading()!=Gothic::LoadState::Idle && !waitLoading())
+      break;
+    }
+  const auto total = us(time0,clock::now());
+
+  std::printf("headless: %u frames of %u ms, %.3f s total\n", unsigned(done), unsigned(FrameTime), double(total)/1000000.0);
+  for(auto& i:st)
+    report(i);
+  if(auto world = gothic.world()) {
+    auto& pf = world->npcPrefetch();
+    std::printf("  npc prefetch: %zu rays cast in parallel, %zu used by serial tick\n",
+                size_t(pf.cast), size_t(pf.used));
+    }
+  std::fflush(stdout);
+  return done==frames ? 0 : 1;
+  }
+
+int Headless::exec(const std::vector<std::string>& bench) {
+  Marvin marvin;
+  Output out;
+  marvin.print.bind(&out,&Output::print);
+
+  int ret = 0;
+  for(auto& i:bench) {
+    std::printf("headless: %s\n", i.c_str());
+    std::fflush(stdout);
+    if(!marvin.exec(i)) {
+      std::printf("headless: '%s' has failed\n", i.c_str());
+      ret = 1;
+      }
+    }
+  std::fflush(stdout);
+  return ret;
+  }
+
+bool Headless::startGame() {
+  auto& gothic = Gothic::inst();
+  if(!gothic.defaultSave().empty()) {
+    gothic.startLoad("",[slot=std::string(gothic.defaultSave())](std::unique_ptr<GameSession>&& game){
+      game = nullptr;
+      Tempest::RFile file(slot);
+      Serialize      s(file);
+      return std::unique_ptr<GameSession>(new GameSession(s));
+      });
+    } else {
+    gothic.startLoad("",[world=std::string(gothic.defaultWorld())](std::unique_ptr<GameSession>&& game){
+      game = nullptr;
+      return std::unique_ptr<GameSession>(new GameSession(world));
+      });
+    }
+  return waitLoading() && gothic.world()!=nullptr;
+  }
+
+bool Headless::waitLoading() {
+  auto& gothic = Gothic::inst();
+  while(true) {
+    auto st = gothic.checkLoading();
+    if(st==Gothic::LoadState::Finalize || st==Gothic::LoadState::FailedLoad || st==Gothic::LoadState::FailedSave) {
+      gothic.finishLoading();
+      return st==Gothic::LoadState::Finalize;
+      }
+    if(st==Gothic::LoadState::Idle)
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Simulation of game logic without window, swapchain, world rendering and music:
+// loads startup world or save-game, runs fixed-dt frames and prints per-subsystem timings.
+// Console commands from '-bench' run afterwards; with '-frames 0' no world is loaded at all.
+class Headless final {
+  public:
+    static constexpr uint64_t FrameTime = 1000/60; // ms
+
+    // returns process exit code: non-zero, if game failed to load or any of commands has failed
+    static int run(uint32_t frames, const std::vector<std::string>& bench);
+
+  private:
+    static int  simulate(uint32_t frames);
+    static int  exec(const std::vector<std::string>& bench);
+    static bool startGame();
+    static bool waitLoading();
+  };
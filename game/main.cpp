@@ -19,7 +19,9 @@
 #endif
 
 #include "utils/crashlog.h"
+#include "world/worldcache.h"
 #include "mainwindow.h"
+#include "headless.h"
 #include "gothic.h"
 #include "build.h"
 #include "commandline.h"
@@ -137,6 +139,15 @@ int main(int argc,const char** argv) {
 
   Resources            resources{device};
   Gothic               gothic;
+  if(cmd.doPrebuildCache()) {
+    // no window and no game scripts: only derived landscape data is computed
+    return WorldCache::prebuildAll()==0 ? 0 : 1;
+    }
+  if(cmd.isHeadless()) {
+    // no window, no world rendering and no music: game logic only
+    gothic.setupGlobalScripts();
+    return Headless::run(cmd.headlessFrames(),cmd.headlessBench());
+    }
   GameMusic            music;
   gothic.setupGlobalScripts();
 
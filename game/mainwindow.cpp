@@ -15,12 +15,15 @@
 #include "ui/videowidget.h"
 
 #include "utils/mouseutil.h"
+#include "utils/profiler.h"
 #include "utils/string_frm.h"
 #include "world/objects/npc.h"
 #include "game/serialize.h"
 #include "game/globaleffects.h"
 #include "utils/gthfont.h"
 #include "utils/dbgpainter.h"
+#include "graphics/texturestreaming.h"
+#include "graphics/worldview.h"
 
 #include "commandline.h"
 #include "gothic.h"
@@ -73,7 +76,18 @@ MainWindow::MainWindow(Device& device)
 
   Gothic::inst().onVideo       .bind(this,&MainWindow::onVideo);
 
-  if(!Gothic::inst().defaultSave().empty()){
+  if(!CommandLine::inst().recordDemo().empty())
+    demo.record(CommandLine::inst().recordDemo());
+  else if(!CommandLine::inst().replayDemo().empty())
+    demo.replay(CommandLine::inst().replayDemo());
+
+  if(demo.isReplay()) {
+    if(demo.startIsSave())
+      Gothic::inst().load(demo.startSlot()); else
+      startGame(demo.startSlot());
+    rootMenu.popMenu();
+    }
+  else if(!Gothic::inst().defaultSave().empty()){
     Gothic::inst().load(Gothic::inst().defaultSave());
     rootMenu.popMenu();
     }
@@ -114,6 +128,7 @@ MainWindow::MainWindow(Device& device)
   }
 
 MainWindow::~MainWindow() {
+  demo.finish();
   GameMusic::inst().stopMusic();
   Gothic::inst().cancelLoading();
   device.waitIdle();
@@ -262,8 +277,35 @@ void MainWindow::paintEvent(PaintEvent& event) {
 
     auto& fnt = Resources::font();
     fnt.drawText(p,5,fnt.pixelSize()+5,fpsT);
+
+    if(world!=nullptr) {
+      char lodT[64]={};
+      std::snprintf(lodT,sizeof(lodT),"anim lod = %u/%u/%u/%u",
+                    Pose::lodStatistic(Pose::LodFull),Pose::lodStatistic(Pose::LodReduced),
+                    Pose::lodStatistic(Pose::LodDistant),Pose::lodStatistic(Pose::LodRootOnly));
+      fnt.drawText(p,5,2*fnt.pixelSize()+5,lodT);
+
+      if(auto wview = world->view()) {
+        auto st = wview->particles().stats(3);
+        char pfxT[128]={};
+        std::snprintf(pfxT,sizeof(pfxT),"pfx = %u particles, %u us, lod = %u/%u/%u/%u",
+                      unsigned(st.particles),unsigned(st.time),
+                      unsigned(st.emitters[PfxObjects::L_Full]),unsigned(st.emitters[PfxObjects::L_Reduced]),
+                      unsigned(st.emitters[PfxObjects::L_Far]), unsigned(st.emitters[PfxObjects::L_Culled]));
+        fnt.drawText(p,5,3*fnt.pixelSize()+5,pfxT);
+        for(size_t i=0; i<st.heaviest.size(); ++i) {
+          auto& b = st.heaviest[i];
+          std::snprintf(pfxT,sizeof(pfxT),"  %.*s: %u, %u us",
+                        int(b.name.size()),b.name.data(),unsigned(b.particles),unsigned(b.time));
+          fnt.drawText(p,5,int(4+i)*fnt.pixelSize()+5,pfxT);
+          }
+        }
+      }
     }
 
+  if(Gothic::inst().doProfiler() && !Gothic::inst().isDesktop())
+    drawProfiler(p);
+
   if(Gothic::inst().doClock() && world!=nullptr) {
     if (!Gothic::inst().isDesktop()) {
       auto hour = world->time().hour();
@@ -297,11 +339,18 @@ void MainWindow::resizeEvent(SizeEvent&) {
 void MainWindow::mouseDownEvent(MouseEvent &event) {
   if(event.button<sizeof(mouseP))
     mouseP[event.button]=true;
-  player.onKeyPressed(keycodec.tr(event),KeyEvent::K_NoKey);
+  TimeDemo::Input in;
+  in.type   = TimeDemo::I_KeyDown;
+  in.action = keycodec.tr(event);
+  in.key    = uint16_t(KeyEvent::K_NoKey);
+  input(in);
   }
 
 void MainWindow::mouseUpEvent(MouseEvent &event) {
-  player.onKeyReleased(keycodec.tr(event));
+  TimeDemo::Input in;
+  in.type   = TimeDemo::I_KeyUp;
+  in.action = keycodec.tr(event);
+  input(in);
   if(event.button<sizeof(mouseP))
     mouseP[event.button]=false;
   }
@@ -328,6 +377,12 @@ void MainWindow::processMouse(MouseEvent& event, bool enable) {
   }
 
 void MainWindow::tickMouse() {
+  if(demo.isReplay()) {
+    dMouse = Point();
+    demo.replayInput(true,[this](const TimeDemo::Input& in){ applyInput(in); });
+    return;
+    }
+
   auto camera = Gothic::inst().camera();
   if(dialogs.hasContent() || Gothic::inst().isPause() || camera==nullptr || camera->isCutscene()) {
     dMouse = Point();
@@ -351,15 +406,52 @@ void MainWindow::tickMouse() {
   if(camLookaroundInverse)
     dpScaled.y *= -1.f;
 
-  camera->onRotateMouse(PointF(dpScaled.y,-dpScaled.x));
+  TimeDemo::Input in;
+  in.type = TimeDemo::I_CameraRotate;
+  in.x    = dpScaled.y;
+  in.y    = -dpScaled.x;
+  input(in);
   if(!inventory.isActive()) {
-    player.onRotateMouse  (-dpScaled.x);
-    player.onRotateMouseDy(-dpScaled.y);
+    in.type = TimeDemo::I_Rotate;
+    in.x    = -dpScaled.x;
+    in.y    = -dpScaled.y;
+    input(in);
     }
 
   dMouse = Point();
   }
 
+void MainWindow::input(const TimeDemo::Input& in) {
+  if(demo.isReplay())
+    return; // live input is ignored, while demo is playing
+  demo.pushInput(in);
+  applyInput(in);
+  }
+
+void MainWindow::applyInput(const TimeDemo::Input& in) {
+  const auto mapping = KeyCodec::Mapping(in.mapping);
+  switch(in.type) {
+    case TimeDemo::I_KeyDown:
+      player.onKeyPressed(in.action,KeyEvent::KeyType(in.key),mapping);
+      break;
+    case TimeDemo::I_KeyUp:
+      player.onKeyReleased(in.action,mapping);
+      break;
+    case TimeDemo::I_Rotate:
+      player.onRotateMouse  (in.x);
+      player.onRotateMouseDy(in.y);
+      break;
+    case TimeDemo::I_CameraRotate:
+      if(auto camera = Gothic::inst().camera())
+        camera->onRotateMouse(PointF(in.x,in.y));
+      break;
+    case TimeDemo::I_CameraZoom:
+      if(auto camera = Gothic::inst().camera())
+        camera->changeZoom(int(in.x));
+      break;
+    }
+  }
+
 void MainWindow::onSettings() {
   auto zMaxFps = Gothic::inst().settingsGetI("ENGINE","zMaxFps");
   if(zMaxFps>0)
@@ -368,8 +460,10 @@ void MainWindow::onSettings() {
   }
 
 void MainWindow::mouseWheelEvent(MouseEvent &event) {
-  if(auto camera = Gothic::inst().camera())
-    camera->changeZoom(event.delta);
+  TimeDemo::Input in;
+  in.type = TimeDemo::I_CameraZoom;
+  in.x    = float(event.delta);
+  input(in);
   }
 
 void MainWindow::keyDownEvent(KeyEvent &event) {
@@ -430,7 +524,12 @@ void MainWindow::keyDownEvent(KeyEvent &event) {
 
   auto act = keycodec.tr(event);
   auto mapping = keycodec.mapping(event);
-  player.onKeyPressed(act,event.key,mapping);
+  TimeDemo::Input in;
+  in.type    = TimeDemo::I_KeyDown;
+  in.action  = act;
+  in.key     = uint16_t(event.key);
+  in.mapping = uint8_t(mapping);
+  input(in);
 
   if(event.key==Event::K_F11) {
     auto tex = renderer.screenshoot(cmdId);
@@ -528,7 +627,11 @@ void MainWindow::keyUpEvent(KeyEvent &event) {
       }
     clearInput();
     }
-  player.onKeyReleased(act, mapping);
+  TimeDemo::Input in;
+  in.type    = TimeDemo::I_KeyUp;
+  in.action  = act;
+  in.mapping = uint8_t(mapping);
+  input(in);
   }
 
 void MainWindow::focusEvent(FocusEvent &event) {
@@ -664,6 +767,71 @@ void MainWindow::drawBar(Painter &p, const Tempest::Texture2d* bar, int x, int y
              0,0,bar->w(),bar->h());
   }
 
+void MainWindow::drawProfiler(Tempest::Painter& p) {
+  // flame graph of last frames: band per thread, row per nesting level
+  static constexpr int      RowH     = 14;
+  static constexpr uint32_t MaxDepth = 6;
+
+  auto cap = Profiler::capture(3);
+  if(cap.frames.size()<2)
+    return;
+
+  auto&          fnt = Resources::font();
+  const uint64_t t0  = cap.frames.front();
+  const uint64_t t1  = cap.frames.back();
+  const int      x0  = 5;
+  const int      pw  = w()-10;
+  auto toX = [&](uint64_t t) {
+    t = std::clamp(t,t0,t1);
+    return x0 + int(double(t-t0)*double(pw)/double(t1-t0));
+    };
+
+  int ph = RowH;
+  for(auto& th:cap.threads) {
+    uint32_t depth = 0;
+    for(auto& e:th.events)
+      depth = std::max(depth,e.depth);
+    ph += int(std::min(depth+1,MaxDepth)+1)*RowH;
+    }
+  int y = h()-ph-5;
+
+  p.setBrush(Color(0,0,0,0.6f));
+  p.drawRect(x0,y,pw,ph);
+
+  char txt[64]={};
+  std::snprintf(txt,sizeof(txt),"cpu: %u frames, %.2f ms",unsigned(cap.frames.size()-1),double(t1-t0)/1000000.0);
+  fnt.drawText(p,x0,y+RowH,txt);
+  y += RowH;
+
+  for(auto& th:cap.threads) {
+    fnt.drawText(p,x0,y+RowH,th.name);
+    y += RowH;
+
+    uint32_t depth = 0;
+    for(auto& e:th.events) {
+      depth = std::max(depth,e.depth);
+      if(e.depth>=MaxDepth || e.end<t0 || e.begin>t1)
+        continue;
+      const int x  = toX(e.begin);
+      const int zw = std::max(toX(e.end)-x,1);
+      // color is stable per zone name
+      const uint32_t hash = uint32_t(reinterpret_cast<uintptr_t>(e.name)>>3)*2654435761u;
+      p.setBrush(Color(0.3f+0.6f*float((hash>>8 )&0xFF)/255.f,
+                       0.3f+0.6f*float((hash>>16)&0xFF)/255.f,
+                       0.3f+0.6f*float((hash>>24)&0xFF)/255.f, 0.85f));
+      const int zy = y+int(e.depth)*RowH;
+      p.drawRect(x,zy,zw,RowH-1);
+      if(zw>fnt.textSize(e.name).w+4)
+        fnt.drawText(p,x+2,zy+RowH-2,e.name);
+      }
+    y += int(std::min(depth+1,MaxDepth))*RowH;
+    }
+
+  p.setBrush(Color(1,1,1,0.8f));
+  for(auto f:cap.frames)
+    p.drawRect(toX(f),h()-ph-5,1,ph);
+  }
+
 void MainWindow::drawMsg(Tempest::Painter& p) {
   const float scale   = Gothic::options().interfaceScale;
   const float destW   = 200.f*scale*float(std::min(w(),800))/800.f;
@@ -877,6 +1045,10 @@ uint64_t MainWindow::tick() {
     return dt;
     }
 
+  demo.replayInput(false,[this](const TimeDemo::Input& in){ applyInput(in); });
+  if(!demo.beginFrame(dt))
+    return 0;
+
   dialogs.tick(dt);
   inventory.tick(dt);
   Gothic::inst().tick(dt);
@@ -993,6 +1165,7 @@ Camera::Mode MainWindow::solveCameraMode() const {
 
 void MainWindow::startGame(std::string_view slot) {
   // gothic.emitGlobalSound(gothic.loadSoundFx("NEWGAME"));
+  demo.onSessionStart(slot,false);
 
   if(Gothic::inst().checkLoading()==Gothic::LoadState::Idle){
     setGameImpl(nullptr);
@@ -1008,6 +1181,7 @@ void MainWindow::startGame(std::string_view slot) {
   }
 
 void MainWindow::loadGame(std::string_view slot) {
+  demo.onSessionStart(slot,true);
   if(Gothic::inst().checkLoading()==Gothic::LoadState::Idle){
     setGameImpl(nullptr);
     onWorldLoaded();
@@ -1099,6 +1273,7 @@ void MainWindow::setFullscreen(bool fs) {
   }
 
 void MainWindow::render(){
+  PROFILE_FRAME();
   try {
     static uint64_t time=Application::tickCount();
 
@@ -1117,6 +1292,14 @@ void MainWindow::render(){
     updateAnimation(dt);
     tickCamera(dt);
 
+    const bool replay = demo.isReplay();
+    demo.endFrame(Gothic::inst().camera(),Gothic::inst().player());
+    if(replay && !demo.isReplay()) {
+      // timedemo is over: report is written
+      SystemApi::exit();
+      return;
+      }
+
     auto& sync = fence[cmdId];
     if(!sync.wait(0)) {
       // GPU rendering is not done, pass to next frame
@@ -1124,6 +1307,10 @@ void MainWindow::render(){
       return;
       }
     Resources::resetRecycled(cmdId);
+    if(Gothic::inst().checkLoading()==Gothic::LoadState::Idle) {
+      // loader threads may create materials: no texture swaps while loading
+      Resources::textureStreaming().tick(Application::tickCount());
+      }
 
     if(video.isActive()) {
       video.paint(device,cmdId);
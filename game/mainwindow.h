@@ -25,6 +25,7 @@
 #include "world/world.h"
 #include "world/focus.h"
 #include "game/playercontrol.h"
+#include "game/timedemo.h"
 #include "graphics/renderer.h"
 #include "ui/dialogmenu.h"
 #include "ui/inventorymenu.h"
@@ -68,6 +69,7 @@ class MainWindow : public Tempest::Window {
 
     void drawBar(Tempest::Painter& p, const Tempest::Texture2d *bar, int x, int y, float v, Tempest::AlignFlag flg);
     void drawMsg(Tempest::Painter& p);
+    void drawProfiler(Tempest::Painter& p);
     void drawProgress(Tempest::Painter& p, int x, int y, int w, int h, float v);
     void drawLoading (Tempest::Painter& p,int x,int y,int w,int h);
     void drawSaving  (Tempest::Painter& p);
@@ -87,6 +89,8 @@ class MainWindow : public Tempest::Window {
 
     void processMouse(Tempest::MouseEvent& event, bool enable);
     void tickMouse();
+    void input(const TimeDemo::Input& in);
+    void applyInput(const TimeDemo::Input& in);
     void onSettings();
 
     void setupUi();
@@ -156,6 +160,7 @@ class MainWindow : public Tempest::Window {
     Tempest::Widget*          uiKeyUp=nullptr;
     Tempest::Point            dMouse;
     PlayerControl             player;
+    TimeDemo                  demo;
     uint64_t                  lastTick=0;
 
     Tempest::Shortcut         funcKey[11];
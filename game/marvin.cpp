@@ -1,15 +1,31 @@
 #include "marvin.h"
 
+#include <atomic>
 #include <charconv>
+#include <cmath>
 #include <cstdint>
 #include <cctype>
+#include <chrono>
+#include <random>
+#include <thread>
 
+#include <zenkit/World.hh>
+
+#include "graphics/mesh/animation.h"
+#include "graphics/texturestreaming.h"
+#include "graphics/worldview.h"
+#include "ui/videowidget.h"
+#include "utils/fileext.h"
+#include "utils/profiler.h"
 #include "utils/string_frm.h"
 #include "world/objects/npc.h"
 #include "world/objects/item.h"
 #include "world/triggers/abstracttrigger.h"
+#include "world/spaceindex.h"
 #include "camera.h"
+#include "gamemusic.h"
 #include "gothic.h"
+#include "resources.h"
 
 static bool startsWith(std::string_view str, std::string_view needle) {
   if(needle.size()>str.size())
@@ -146,6 +162,21 @@ Marvin::Marvin() {
 
     {"toggle gi",                  C_ToggleGI},
     {"toggle vsm",                 C_ToggleVsm},
+    {"bench npcindex",             C_BenchNpcIndex},
+    {"bench resources",            C_BenchResources},
+    {"anim stats %s",              C_AnimStats},
+    {"los stats",                  C_LosStats},
+    {"ray record",                 C_RayRecord},
+    {"bench rays",                 C_BenchRays},
+    {"texture stats",              C_TextureStats},
+    {"texture record",             C_TextureRecord},
+    {"texture replay %d",          C_TextureReplay},
+    {"texture check %d",           C_TextureCheck},
+    {"bench pfx %s %d",            C_BenchPfx},
+    {"toggle profiler",            C_ToggleProfiler},
+    {"profiler export %s",         C_ProfilerExport},
+    {"bench bink %s",              C_BenchBink},
+    {"bench music",                C_BenchMusic},
     };
   }
 
@@ -428,6 +459,36 @@ bool Marvin::exec(std::string_view v) {
     case C_ToggleVsm:
       Gothic::inst().toggleVsm();
       return true;
+    case C_BenchNpcIndex:
+      return benchNpcIndex();
+    case C_BenchResources:
+      return benchResources();
+    case C_AnimStats:
+      return animStats(ret.argv[0]);
+    case C_LosStats:
+      return losStats();
+    case C_RayRecord:
+      return rayRecord();
+    case C_BenchRays:
+      return benchRays();
+    case C_TextureStats:
+      return textureStats();
+    case C_TextureRecord:
+      return textureRecord();
+    case C_TextureReplay:
+      return textureReplay(ret.argv[0]);
+    case C_TextureCheck:
+      return textureCheck(ret.argv[0]);
+    case C_BenchPfx:
+      return benchPfx(ret.argv[0],ret.argv[1]);
+    case C_ToggleProfiler:
+      return toggleProfiler();
+    case C_ProfilerExport:
+      return profilerExport(ret.argv[0]);
+    case C_BenchBink:
+      return benchBink(ret.argv[0]);
+    case C_BenchMusic:
+      return benchMusic();
     }
 
   return true;
@@ -487,6 +548,434 @@ bool Marvin::printVariable(World* world, std::string_view name) {
   return true;
   }
 
+bool Marvin::benchNpcIndex() {
+  using namespace Tempest;
+  using clock = std::chrono::steady_clock;
+
+  // synthetic crowd: 2k npc's spread over world-sized area, each one runs a senses-range query
+  const size_t numNpc     = 2000;
+  const float  worldSize  = 60000;
+  const float  senseRange = 2000;
+  const size_t iterations = 10;
+
+  std::mt19937                          rng(42);
+  std::uniform_real_distribution<float> pos(-worldSize*0.5f, worldSize*0.5f);
+  std::uniform_real_distribution<float> step(-50.f, 50.f);
+
+  std::vector<Vec3> npc(numNpc);
+  for(auto& i:npc)
+    i = Vec3(pos(rng), pos(rng)*0.02f, pos(rng));
+
+  PointIndex<Vec3> index;
+  for(auto& i:npc)
+    index.add(&i,i);
+
+  size_t hitScan = 0, hitHash = 0;
+  double tScan = 0, tHash = 0, tUpdate = 0;
+  for(size_t it=0; it<iterations; ++it) {
+    auto t0 = clock::now();
+    for(auto& q:npc) {
+      for(auto& i:npc)
+        if((i-q).quadLength()<senseRange*senseRange)
+          ++hitScan;
+      }
+
+    auto t1 = clock::now();
+    for(auto& q:npc)
+      index.find(q,senseRange,[&hitHash](Vec3&){ ++hitHash; });
+
+    auto t2 = clock::now();
+    for(auto& i:npc) {
+      i = i + Vec3(step(rng),0,step(rng));
+      index.update(&i,i);
+      }
+    auto t3 = clock::now();
+
+    tScan   += std::chrono::duration<double,std::micro>(t1-t0).count();
+    tHash   += std::chrono::duration<double,std::micro>(t2-t1).count();
+    tUpdate += std::chrono::duration<double,std::micro>(t3-t2).count();
+    }
+
+  const double n = double(iterations);
+  print(string_frm("npc index (",numNpc," npc, R=",int(senseRange),"): scan ",size_t(tScan/n),"us, hash ",size_t(tHash/n),
+                   "us, update ",size_t(tUpdate/n),"us per frame", hitScan==hitHash ? "" : " - MISMATCH"));
+  return hitScan==hitHash;
+  }
+
+bool Marvin::benchResources() {
+  World* world = Gothic::inst().world();
+  if(world==nullptr)
+    return false;
+  const auto* entry = Resources::vdfsIndex().find(world->name());
+  if(entry==nullptr)
+    return false;
+
+  // every mesh of the current world, requested from many threads at once
+  zenkit::World zen;
+  try {
+    auto reader = entry->open_read();
+    zen.load(reader.get(), Gothic::inst().version().game==1 ? zenkit::GameVersion::GOTHIC_1
+                                                            : zenkit::GameVersion::GOTHIC_2);
+    }
+  catch(...) {
+    return false;
+    }
+
+  std::vector<std::string>                  names;
+  std::vector<const zenkit::VirtualObject*> stk;
+  for(auto& i:zen.world_vobs)
+    stk.push_back(i.get());
+  while(!stk.empty()) {
+    auto vob = stk.back();
+    stk.pop_back();
+    for(auto& i:vob->children)
+      stk.push_back(i.get());
+    if(vob->visual==nullptr)
+      continue;
+    auto& name = vob->visual->name;
+    if(FileExt::hasExt(name,"3DS") || FileExt::hasExt(name,"MDS") || FileExt::hasExt(name,"MMS") ||
+       FileExt::hasExt(name,"MDL") || FileExt::hasExt(name,"MDM") || FileExt::hasExt(name,"ASC"))
+      names.push_back(name);
+    }
+  std::sort(names.begin(),names.end());
+  names.erase(std::unique(names.begin(),names.end()),names.end());
+  if(names.empty())
+    return false;
+
+  // each thread starts at own offset, so same keys are requested concurrently as well
+  const size_t numThreads = std::max<size_t>(4,std::thread::hardware_concurrency());
+  const auto   cold       = Resources::stressLoadMeshes(names,numThreads,true);
+  const auto   warm       = Resources::stressLoadMeshes(names,numThreads,false);
+  print(string_frm("resources: ",names.size()," meshes x ",numThreads," threads: cold ",cold.timeMs,"ms, warm ",warm.timeMs,"ms, ",
+                   cold.loaded," loaded", (cold.mismatch==0 && warm.mismatch==0) ? "" : " - MISMATCH"));
+  return cold.mismatch==0 && warm.mismatch==0 && cold.loaded>0;
+  }
+
+bool Marvin::losStats() {
+  World* world = Gothic::inst().world();
+  if(world==nullptr)
+    return false;
+  auto& los  = world->lineOfSight();
+  auto& last = los.lastTick();
+  auto& all  = los.total();
+  print(string_frm("los last tick: requested ",last.requested,", deduplicated ",last.deduplicated,", cast ",last.cast));
+  print(string_frm("los total: requested ",all.requested,", deduplicated ",all.deduplicated,", cast ",all.cast));
+  return true;
+  }
+
+bool Marvin::rayRecord() {
+  World* world = Gothic::inst().world();
+  if(world==nullptr)
+    return false;
+  world->physic()->setRayRecording(true);
+  print("recording rays: play for a while, then run 'bench rays'");
+  return true;
+  }
+
+bool Marvin::animStats(std::string_view name) {
+  auto anim = Resources::loadAnimation(name);
+  if(anim==nullptr)
+    return false;
+
+  size_t raw = 0, packed = 0;
+  for(auto& i:anim->sequenceList()) {
+    auto& smp = i.data->samples;
+    print(string_frm(i.name,": ",smp.rawSize()," -> ",smp.memoryUsage()," bytes"));
+    raw    += smp.rawSize();
+    packed += smp.memoryUsage();
+    }
+  print(string_frm(name,": ",anim->sequenceList().size()," sequences, ",raw/1024,"Kb -> ",packed/1024,"Kb"));
+  return true;
+  }
+
+bool Marvin::benchRays() {
+  using clock = std::chrono::steady_clock;
+
+  World* world = Gothic::inst().world();
+  if(world==nullptr)
+    return false;
+  auto& physic = *world->physic();
+  physic.setRayRecording(false);
+
+  auto rays = physic.recordedRays();
+  if(rays.empty()) {
+    // nothing recorded (i.e. headless run): synthetic mix of ground and sight rays around the player
+    Npc* player = Gothic::inst().player();
+    if(player==nullptr)
+      return false;
+    std::mt19937                          rng(42);
+    std::uniform_real_distribution<float> off(-3000.f, 3000.f);
+    const Tempest::Vec3                   at = player->position();
+    for(size_t i=0; i<4096; ++i) {
+      const Tempest::Vec3 a = at + Tempest::Vec3(off(rng),200.f,off(rng));
+      if(i%2==0)
+        rays.push_back({a, a - Tempest::Vec3(0,2000.f,0)}); else
+        rays.push_back({a, at + Tempest::Vec3(off(rng),200.f,off(rng))});
+      }
+    print(string_frm("no rays recorded, using ",rays.size()," synthetic rays"));
+    }
+
+  std::vector<DynamicWorld::RayLandResult> serial(rays.size()), batch(rays.size());
+  physic.updateAabbs();
+
+  auto t0 = clock::now();
+  for(size_t i=0; i<rays.size(); ++i)
+    serial[i] = physic.ray(rays[i].from,rays[i].to);
+  auto t1 = clock::now();
+  physic.rayBatch(rays,batch);
+  auto t2 = clock::now();
+
+  size_t mismatch = 0;
+  for(size_t i=0; i<rays.size(); ++i)
+    if(serial[i].hasCol!=batch[i].hasCol || serial[i].hitFraction!=batch[i].hitFraction)
+      ++mismatch;
+
+  const auto us0 = std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count();
+  const auto us1 = std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
+  print(string_frm("rays: ",rays.size()," recorded, serial ",size_t(us0),"us, batch ",size_t(us1),"us",
+                   mismatch==0 ? "" : " - MISMATCH"));
+  return mismatch==0;
+  }
+
+bool Marvin::textureStats() {
+  const auto st = Resources::textureStreaming().stats();
+  print(string_frm("textures: ",st.textures," streamed, ",st.full," full, resident ",st.resident/(1024*1024),"mb of ",
+                   st.budget/(1024*1024),"mb, loads ",st.loads,", evictions ",st.evictions));
+  return true;
+  }
+
+bool Marvin::textureRecord() {
+  Resources::textureStreaming().setRecording(true);
+  print("recording texture usage: move camera around for a while, then run 'texture replay <budget mb>'");
+  return true;
+  }
+
+bool Marvin::textureReplay(std::string_view budgetMb) {
+  auto& st = Resources::textureStreaming();
+  st.setRecording(false);
+
+  int mb = 0;
+  auto err = std::from_chars(budgetMb.data(), budgetMb.data()+budgetMb.size(), mb, 10).ec;
+  if(err!=std::errc() || mb<0)
+    return false;
+
+  auto& samples = st.recorded();
+  if(samples.empty()) {
+    print("no texture usage recorded, run 'texture record' first");
+    return true;
+    }
+
+  // residency policy alone, without gpu: loads and evictions complete right away
+  TextureResidency res = st.residencyProto();
+  if(mb>0)
+    res.setBudget(uint64_t(mb)*1024*1024);
+  const uint64_t limit = std::max(res.budget(),res.lowBytes());
+
+  TextureResidency::Decision d;
+  std::vector<uint64_t>      evictedAt(res.size(),0);
+  uint64_t loads = 0, evictions = 0, thrash = 0, exceeded = 0, peak = 0;
+  for(auto& s:samples) {
+    res.beginSweep();
+    for(auto& u:s.usage)
+      if(u.first<res.size())
+        res.touch(u.first,u.second,s.time);
+    res.update(s.time,d);
+
+    for(auto id:d.evict) {
+      res.complete(id,false);
+      evictedAt[id] = s.time+1;
+      }
+    for(auto id:d.load) {
+      res.complete(id,true);
+      // reloaded, while texture is still in use
+      if(evictedAt[id]!=0 && s.time<evictedAt[id]+TextureResidency::IdleTime)
+        ++thrash;
+      }
+    loads     += d.load.size();
+    evictions += d.evict.size();
+    peak       = std::max(peak,res.residentBytes());
+    if(res.budget()!=0 && res.residentBytes()>limit)
+      ++exceeded;
+    }
+
+  print(string_frm("texture replay: ",samples.size()," samples, budget ",res.budget()/(1024*1024),"mb, loads ",loads,
+                   ", evictions ",evictions,", reloads ",thrash,", peak ",peak/(1024*1024),"mb",
+                   exceeded==0 ? "" : " - BUDGET EXCEEDED"));
+  return true;
+  }
+
+bool Marvin::textureCheck(std::string_view budgetMb) {
+  int mb = 0;
+  auto err = std::from_chars(budgetMb.data(), budgetMb.data()+budgetMb.size(), mb, 10).ec;
+  if(err!=std::errc() || mb<=0)
+    return false;
+
+  // compiled textures from vdfs, streamed by a private instance: no world is required
+  std::vector<std::string> names;
+  auto collect = [&names](const zenkit::VfsNode& node, auto& self) -> void {
+    for(auto& i:node.children()) {
+      if(i.type()==zenkit::VfsNodeType::DIRECTORY) {
+        self(i,self);
+        continue;
+        }
+      std::string name = std::string(i.name());
+      if(name.size()>6 && FileExt::hasExt(name,"TEX") && name[name.size()-6]=='-') {
+        name.resize(name.size()-6);
+        names.push_back(name+".TGA");
+        }
+      }
+    };
+  collect(Resources::vdfsIndex().root(),collect);
+  std::sort(names.begin(),names.end());
+
+  const size_t                          maxTextures = 512;
+  TextureStreaming                      st;
+  std::vector<TextureStreaming::Usage>  usage;
+  st.setup(true,uint64_t(mb)*1024*1024);
+  for(auto& i:names) {
+    if(usage.size()>=maxTextures)
+      break;
+    if(auto t = st.load(i))
+      usage.push_back({t,float(usage.size())});
+    }
+  if(usage.empty()) {
+    print("texture check: no streamable textures");
+    return false;
+    }
+
+  // everything is in use: nearest ones must become full, as long as budget allows
+  uint64_t time = 0, peak = 0, exceeded = 0;
+  for(size_t i=0; i<64; ++i) {
+    time += 1000;
+    st.beginSweep();
+    st.touch(usage);
+    st.tick(time);
+    st.wait();
+
+    const auto s = st.stats();
+    peak = std::max(peak,s.resident);
+    if(s.resident>std::max(s.budget,s.low))
+      ++exceeded;
+    }
+
+  const auto   s   = st.stats();
+  const size_t bad = st.validate();
+  print(string_frm("texture check: ",s.textures," textures, ",s.full," full, peak ",peak/1024,"kb of ",s.budget/1024,
+                   "kb, ",bad," mismatched", exceeded==0 ? "" : " - BUDGET EXCEEDED"));
+  return exceeded==0 && bad==0 && s.full>0;
+  }
+
+bool Marvin::benchPfx(std::string_view name, std::string_view count) {
+  using namespace Tempest;
+  using clock = std::chrono::steady_clock;
+
+  World* world  = Gothic::inst().world();
+  Npc*   player = Gothic::inst().player();
+  size_t num    = 0;
+  if(world==nullptr || player==nullptr || !fromString(count,num) || num==0)
+    return false;
+  auto decl = Gothic::inst().loadParticleFx(name);
+  if(decl==nullptr)
+    return false;
+
+  // simulation only: emitters are ticked in a tight loop, no frames are rendered in between
+  const uint64_t dt     = 16;
+  const size_t   warmup = 120;
+  const size_t   frames = 240;
+
+  std::mt19937                          rng(42);
+  std::uniform_real_distribution<float> off(-PfxObjects::viewRage*0.5f, PfxObjects::viewRage*0.5f);
+
+  std::vector<PfxEmitter> emitters;
+  emitters.reserve(num);
+  const Vec3 at = player->position();
+  for(size_t i=0; i<num; ++i) {
+    PfxEmitter e(*world,decl);
+    if(e.isEmpty())
+      return false;
+    e.setPosition(at + Vec3(off(rng),off(rng)*0.1f,off(rng)));
+    e.setLooped(true);
+    e.setActive(true);
+    emitters.emplace_back(std::move(e));
+    }
+
+  auto&    pfx  = world->view()->particles();
+  uint64_t time = 0;
+  pfx.resetTicks();
+  pfx.tick(time);
+  for(size_t i=0; i<warmup; ++i)
+    pfx.tick(time+=dt);
+
+  auto t0 = clock::now();
+  for(size_t i=0; i<frames; ++i)
+    pfx.tick(time+=dt);
+  auto t1 = clock::now();
+
+  const auto   st = pfx.stats();
+  const double us = std::chrono::duration<double,std::micro>(t1-t0).count()/double(frames);
+  emitters.clear();
+  pfx.resetTicks();
+
+  print(string_frm("pfx ",name,": ",num," emitters, ",st.particles," particles in ",st.buckets," buckets, ",
+                   size_t(us),"us per tick", st.particles>0 ? "" : " - NO PARTICLES"));
+  return st.particles>0;
+  }
+
+bool Marvin::toggleProfiler() {
+  if(!Profiler::enabled) {
+    print("profiler is not built in: configure with -DOPENGOTHIC_PROFILER=ON");
+    return true;
+    }
+  Gothic::inst().setProfiler(!Gothic::inst().doProfiler());
+  return true;
+  }
+
+bool Marvin::profilerExport(std::string_view file) {
+  if(!Profiler::enabled) {
+    print("profiler is not built in: configure with -DOPENGOTHIC_PROFILER=ON");
+    return true;
+    }
+  if(!Profiler::exportTrace(file)) {
+    print(string_frm<256>("unable to export trace to \"",file,"\""));
+    return true;
+    }
+  print(string_frm<256>("trace is written to \"",file,"\", open it in chrome://tracing or ui.perfetto.dev"));
+  return true;
+  }
+
+bool Marvin::benchBink(std::string_view name) {
+  VideoWidget::BenchStats st;
+  if(!VideoWidget::benchmark(name,st)) {
+    print(string_frm<256>("unable to open video \"",name,"\""));
+    return false;
+    }
+  if(st.frames==0) {
+    print(string_frm<256>("bink ",name,": no frames decoded"));
+    return false;
+    }
+  const float decode = float(st.decode)/1000000.f;
+  const float total  = float(st.decode+st.convert)/1000000.f;
+  print(string_frm<256>("bink ",name,": ",st.frames," frames ",st.width,"x",st.height,", ",st.errors," errors"));
+  print(string_frm<256>("  decode ",float(st.frames)/std::max(decode,1e-6f)," fps, decode+yuv ",
+                        float(st.frames)/std::max(total,1e-6f)," fps"));
+  return st.errors==0;
+  }
+
+bool Marvin::benchMusic() {
+  // rendering is timed only: loading of segments and dls is reported separately
+  GameMusic::BenchStats st;
+  GameMusic::benchmark(10,st);
+  if(st.themes==0) {
+    print(string_frm<256>("music: no themes rendered, ",st.errors," errors"));
+    return false;
+    }
+  const float audio  = float(st.samples)/float(st.rate);
+  const float render = float(st.render)/1000000.f;
+  print(string_frm<256>("music: ",st.themes," themes, ",st.errors," errors, load ",float(st.load)/1000.f," ms"));
+  print(string_frm<256>("  ",audio," s of audio in ",render," s, ",audio/std::max(render,1e-6f),"x realtime"));
+  return st.errors==0;
+  }
+
 bool Marvin::setTime(World& world, std::string_view hh, std::string_view mm) {
   int hv = 0, mv = 0;
 
@@ -57,6 +57,21 @@ class Marvin {
       // opengothic specific
       C_ToggleGI,
       C_ToggleVsm,
+      C_BenchNpcIndex,
+      C_BenchResources,
+      C_AnimStats,
+      C_LosStats,
+      C_RayRecord,
+      C_BenchRays,
+      C_TextureStats,
+      C_TextureRecord,
+      C_TextureReplay,
+      C_TextureCheck,
+      C_BenchPfx,
+      C_ToggleProfiler,
+      C_ProfilerExport,
+      C_BenchBink,
+      C_BenchMusic,
       };
 
     struct Cmd {
@@ -84,6 +99,21 @@ class Marvin {
     bool   printVariable           (World* world, std::string_view name);
     bool   setTime                 (World& world, std::string_view hh, std::string_view mm);
     bool   goToVob                 (World& world, Npc& player, Camera& c, std::string_view name, size_t n);
+    bool   benchNpcIndex           ();
+    bool   benchResources          ();
+    bool   animStats               (std::string_view name);
+    bool   losStats                ();
+    bool   rayRecord               ();
+    bool   benchRays               ();
+    bool   textureStats            ();
+    bool   textureRecord           ();
+    bool   textureReplay           (std::string_view budgetMb);
+    bool   textureCheck            (std::string_view budgetMb);
+    bool   benchPfx                (std::string_view name, std::string_view count);
+    bool   toggleProfiler          ();
+    bool   profilerExport          (std::string_view file);
+    bool   benchBink               (std::string_view name);
+    bool   benchMusic              ();
 
     std::vector<Cmd> cmd;
   };
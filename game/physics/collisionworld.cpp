@@ -5,11 +5,34 @@
 #include "dynamicworld.h"
 #include "world/objects/item.h"
 
+class CollisionWorld::WriteLock final {
+  public:
+    explicit WriteLock(CollisionWorld& w):w(w) {
+      if(w.writer.load()!=std::this_thread::get_id()) {
+        w.sync.lock();
+        w.writer.store(std::this_thread::get_id());
+        }
+      w.writeDepth++;
+      }
+
+    ~WriteLock() {
+      w.writeDepth--;
+      if(w.writeDepth==0) {
+        w.writer.store(std::thread::id());
+        w.sync.unlock();
+        }
+      }
+
+  private:
+    CollisionWorld& w;
+  };
+
 CollisionWorld::CollisionBody::CollisionBody(btRigidBody::btRigidBodyConstructionInfo& inf, CollisionWorld* owner)
   :btRigidBody(inf), owner(owner) {
   }
 
 CollisionWorld::CollisionBody::~CollisionBody() {
+  WriteLock guard(*owner);
   auto flags = this->getCollisionFlags();
 
   if((flags & btCollisionObject::CF_STATIC_OBJECT)==0) {
@@ -39,13 +62,38 @@ struct CollisionWorld::Broadphase : btDbvtBroadphase {
       }
     };
 
+  struct BroadphaseAabbTester : btDbvt::ICollide {
+    btBroadphaseAabbCallback& m_aabbCallback;
+    BroadphaseAabbTester(btBroadphaseAabbCallback& orgCallback) : m_aabbCallback(orgCallback) {}
+    void Process(const btDbvtNode* leaf) {
+      btDbvtProxy* proxy = reinterpret_cast<btDbvtProxy*>(leaf->data);
+      m_aabbCallback.process(proxy);
+      }
+    };
+
   Broadphase() {
     m_deferedcollide = true;
-    rayTestStk.reserve(btDbvt::DOUBLE_STACKSIZE);
+    }
+
+  void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& aabbCallback) override {
+    // same as btDbvtBroadphase::aabbTest, but without heap allocation and with per-thread stack
+    static thread_local btAlignedObjectArray<const btDbvtNode*> aabbTestStk;
+    if(aabbTestStk.capacity()==0)
+      aabbTestStk.reserve(btDbvt::SIMPLE_STACKSIZE);
+
+    BroadphaseAabbTester callback(aabbCallback);
+    const ATTRIBUTE_ALIGNED16(btDbvtVolume) bounds = btDbvtVolume::FromMM(aabbMin,aabbMax);
+    m_sets[0].collideTVNoStackAlloc(m_sets[0].m_root, bounds, aabbTestStk, callback);
+    m_sets[1].collideTVNoStackAlloc(m_sets[1].m_root, bounds, aabbTestStk, callback);
     }
 
   void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback,
                const btVector3& aabbMin, const btVector3& aabbMax) {
+    // ray-queries are allowed from multiple threads - traversal stack is per-thread
+    static thread_local btAlignedObjectArray<const btDbvtNode*> rayTestStk;
+    if(rayTestStk.capacity()==0)
+      rayTestStk.reserve(btDbvt::DOUBLE_STACKSIZE);
+
     BroadphaseRayTester callback(rayCallback);
     btAlignedObjectArray<const btDbvtNode*>* stack = &rayTestStk;
 
@@ -71,8 +119,6 @@ struct CollisionWorld::Broadphase : btDbvtBroadphase {
         *stack,
         callback);
     }
-
-  btAlignedObjectArray<const btDbvtNode*> rayTestStk;
   };
 
 struct CollisionWorld::ContructInfo {
@@ -121,10 +167,12 @@ CollisionWorld::CollisionWorld(ContructInfo ci)
   }
 
 void CollisionWorld::updateAabbs() {
-  if(aabbChanged>0) {
-    btDiscreteDynamicsWorld::updateAabbs();
-    aabbChanged = 0;
+  if(aabbChanged.load()==0)
     return;
+  WriteLock guard(*this);
+  if(aabbChanged.load()>0) {
+    btDiscreteDynamicsWorld::updateAabbs();
+    aabbChanged.store(0);
     }
   }
 
@@ -132,6 +180,16 @@ void CollisionWorld::touchAabbs() {
   aabbChanged++;
   }
 
+void CollisionWorld::addCollisionObject(btCollisionObject* obj, int group, int mask) {
+  WriteLock guard(*this);
+  btDiscreteDynamicsWorld::addCollisionObject(obj,group,mask);
+  }
+
+void CollisionWorld::removeCollisionObject(btCollisionObject* obj) {
+  WriteLock guard(*this);
+  btDiscreteDynamicsWorld::removeCollisionObject(obj);
+  }
+
 bool CollisionWorld::hasCollision(btRigidBody& it, Tempest::Vec3& normal, Interactive*& vob) {
   struct rCallBack : public btCollisionWorld::ContactResultCallback {
     int                 count = 0;
@@ -185,6 +243,12 @@ bool CollisionWorld::hasCollision(btRigidBody& it, Tempest::Vec3& normal, Intera
   }
 
 std::unique_ptr<CollisionWorld::CollisionBody> CollisionWorld::addCollisionBody(btCollisionShape& shape, const Tempest::Matrix4x4& tr, float friction) {
+  auto obj = mkCollisionBody(shape,tr,friction);
+  addCollisionBody(*obj);
+  return obj;
+  }
+
+std::unique_ptr<CollisionWorld::CollisionBody> CollisionWorld::mkCollisionBody(btCollisionShape& shape, const Tempest::Matrix4x4& tr, float friction) {
   btRigidBody::btRigidBodyConstructionInfo rigidBodyCI(
         0,                  // mass, in kg. 0 -> Static object, will never move.
         nullptr,
@@ -201,12 +265,15 @@ std::unique_ptr<CollisionWorld::CollisionBody> CollisionWorld::addCollisionBody(
 
   obj->setWorldTransform(trans);
   obj->setFriction(friction);
-
-  this->addCollisionObject(obj.get());
-  this->updateSingleAabb(obj.get());
   return obj;
   }
 
+void CollisionWorld::addCollisionBody(CollisionBody& obj) {
+  WriteLock guard(*this);
+  this->addCollisionObject(&obj);
+  this->updateSingleAabb(&obj);
+  }
+
 std::unique_ptr<CollisionWorld::DynamicBody> CollisionWorld::addDynamicBody(btCollisionShape& shape, const Tempest::Matrix4x4& tr,
                                                                             float friction, float mass) {
   if(mass<=0)
@@ -221,6 +288,7 @@ std::unique_ptr<CollisionWorld::DynamicBody> CollisionWorld::addDynamicBody(btCo
         localInertia
         );
 
+  WriteLock guard(*this);
   std::unique_ptr<DynamicBody> obj(new DynamicBody(rigidBodyCI,this));
   // obj->setFlags(btCollisionObject::CF_NO_CONTACT_RESPONSE);
   // obj->setCollisionFlags(btCollisionObject::CO_RIGID_BODY);
@@ -246,13 +314,31 @@ void CollisionWorld::rayCast(const Tempest::Vec3& b, const Tempest::Vec3& e, btC
   btVector3 s = toMeters(b), f = toMeters(e);
   if(s==f)
     return;
+  if(writer.load()==std::this_thread::get_id()) {
+    // nested query from within modification
+    this->rayTest(s,f,cb);
+    return;
+    }
+  std::shared_lock<std::shared_mutex> guard(sync);
   this->rayTest(s,f,cb);
   }
 
+void CollisionWorld::aabbTest(const Tempest::Vec3& min, const Tempest::Vec3& max, btBroadphaseAabbCallback& cb) {
+  const btVector3 bmin = toMeters(min), bmax = toMeters(max);
+  if(writer.load()==std::this_thread::get_id()) {
+    broad->aabbTest(bmin,bmax,cb);
+    return;
+    }
+  std::shared_lock<std::shared_mutex> guard(sync);
+  broad->aabbTest(bmin,bmax,cb);
+  }
+
 void CollisionWorld::tick(uint64_t dt) {
   static bool  dynamic = true;
   const  float dtF     = float(dt);
 
+  WriteLock guard(*this);
+
   if(dynamic) {
     if(rigid.size()>0)
       this->stepSimulation(dtF/1000.f, 2);
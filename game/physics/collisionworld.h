@@ -5,9 +5,12 @@
 
 #include <zenkit/Material.hh>
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <functional>
+#include <shared_mutex>
+#include <thread>
 
 #include "physics/physics.h"
 
@@ -39,13 +42,22 @@ class CollisionWorld : public btDiscreteDynamicsWorld {
     void updateAabbs() override;
     void touchAabbs();
 
+    void addCollisionObject   (btCollisionObject* obj, int group = btBroadphaseProxy::DefaultFilter, int mask = btBroadphaseProxy::AllFilter) override;
+    void removeCollisionObject(btCollisionObject* obj) override;
+
     bool hasCollision(const btCollisionObject &it, Tempest::Vec3& normal);
     bool hasCollision(btRigidBody& it, Tempest::Vec3& normal, Interactive*& vob);
 
     std::unique_ptr<CollisionBody> addCollisionBody(btCollisionShape& shape, const Tempest::Matrix4x4& tr, float friction);
+    // static body, that is not linked into world yet: safe to create from worker threads
+    std::unique_ptr<CollisionBody> mkCollisionBody (btCollisionShape& shape, const Tempest::Matrix4x4& tr, float friction);
+    void                           addCollisionBody(CollisionBody& obj);
     std::unique_ptr<DynamicBody>   addDynamicBody  (btCollisionShape& shape, const Tempest::Matrix4x4& tr, float friction, float mass);
 
+    // thread-safe: concurrent ray-queries are allowed, modifications of world wait for them to complete
     void rayCast(const Tempest::Vec3& b, const Tempest::Vec3& e, RayResultCallback& cb);
+    // broadphase-only query: reports every object, which aabb overlaps [min,max]
+    void aabbTest(const Tempest::Vec3& min, const Tempest::Vec3& max, btBroadphaseAabbCallback& cb);
 
     class CollisionBody : public btRigidBody {
       public:
@@ -67,6 +79,7 @@ class CollisionWorld : public btDiscreteDynamicsWorld {
   private:
     struct Broadphase;
     struct ContructInfo;
+    class  WriteLock;
 
     CollisionWorld(std::unique_ptr<btCollisionConfiguration>&& conf);
     CollisionWorld(ContructInfo ci);
@@ -86,6 +99,11 @@ class CollisionWorld : public btDiscreteDynamicsWorld {
     btVector3                                   gravity = btVector3(0,0,0);
     btVector3                                   bbox[2] = {btVector3(0,0,0), btVector3(0,0,0)};
 
-    mutable uint32_t aabbChanged = 0;
+    std::atomic<uint32_t>                       aabbChanged{0};
+
+    // readers are ray-queries; writer is re-entrant on it's own thread
+    std::shared_mutex                           sync;
+    std::atomic<std::thread::id>                writer;
+    uint32_t                                    writeDepth = 0;
   };
 
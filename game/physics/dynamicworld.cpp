@@ -7,16 +7,21 @@
 
 #include <algorithm>
 #include <cmath>
+#include <shared_mutex>
+#include <unordered_map>
 
 #include "graphics/mesh/submesh/packedmesh.h"
 #include "world/objects/item.h"
 #include "world/bullet.h"
 #include "world/world.h"
+#include "utils/workers.h"
 
 const float DynamicWorld::ghostPadding=50-22.5f;
 const float DynamicWorld::ghostHeight =140;
 const float DynamicWorld::worldHeight =20000;
 
+static const size_t rayRecordLimit = 1u<<20;
+
 struct DynamicWorld::HumShape:btCapsuleShape {
   HumShape(btScalar radius, btScalar height):btCapsuleShape(
       CollisionWorld::toMeters(height<=0.f ? 0.f : radius),
@@ -145,7 +150,8 @@ struct DynamicWorld::NpcBodyList final {
     n.r = std::max((dx+dz)*0.5f, dz)*0.5f;
     n.h = h;
 
-    maxR = std::max(maxR,n.r);
+    maxR    = std::max(maxR,n.r);
+    maxRayR = std::max(maxRayR,rayRadius(n));
     }
 
   void onMove(NpcBody& n){
@@ -163,56 +169,130 @@ struct DynamicWorld::NpcBodyList final {
       }
     }
 
-  bool rayTest(NpcBody& npc, const Tempest::Vec3& s, const Tempest::Vec3& e, float extR, float& proj) {
+  struct RayQuery final {
+    Tempest::Vec3 s, e;
+    float         extR = 0;
+    };
+
+  // exact segment-vs-capsule test: vertical capsule from feet to top of npc body
+  bool rayTest(const NpcBody& npc, const Tempest::Vec3& s, const Tempest::Vec3& e, float extR, float& frac) const {
     if(!npc.enable)
       return false;
-    auto  ln   = e       - s;
-    auto  at   = npc.pos - s;
-
-    float lenL = ln.length();
-
-    float dot  = Tempest::Vec3::dotProduct(ln,at);
-
-    proj = dot/(lenL<=0 ? 1.f : (lenL*lenL));
-    proj = std::max(0.f,std::min(proj,1.f));
-
-    // TODO: ray-box intersection
-    auto& tr   = npc.getWorldTransform();
-    auto  pos  = CollisionWorld::toCentimeters(tr.getOrigin());
+    const float R  = rayRadius(npc) + extR;
+    const float y0 = npc.pos.y;
+    const float y1 = npc.pos.y + npc.h;
+    const auto  d  = e - s;
+
+    // side of the cylinder; it also bounds caps horizontally
+    const float ox = s.x - npc.pos.x, oz = s.z - npc.pos.z;
+    const float a  = d.x*d.x + d.z*d.z;
+    const float b  = ox*d.x + oz*d.z;
+    const float c  = ox*ox + oz*oz - R*R;
+    if(c<=0 && y0<=s.y && s.y<=y1) {
+      frac = 0;
+      return true;
+      }
 
-    auto  nr   = ln*proj + s;
-    auto  dp   = nr      - pos;
-    float R    = 0.5f*(npc.rX + npc.rZ) + extR;
-    if(dp.x*dp.x+dp.z*dp.z > R*R)
+    float tMin = 2;
+    if(a>0) {
+      const float disc = b*b - a*c;
+      if(disc<0)
+        return false;
+      const float t = (-b - std::sqrt(disc))/a;
+      const float y = s.y + d.y*t;
+      if(0<=t && t<=1 && y0<=y && y<=y1)
+        tMin = t;
+      }
+    else if(c>0) {
+      // vertical ray outside of cylinder
       return false;
-    if(npc.h<abs(dp.y))
+      }
+
+    tMin = std::min(tMin, raySphere(s,d,Tempest::Vec3(npc.pos.x,y0,npc.pos.z),R));
+    tMin = std::min(tMin, raySphere(s,d,Tempest::Vec3(npc.pos.x,y1,npc.pos.z),R));
+    if(tMin>1)
       return false;
+    frac = tMin;
     return true;
     }
 
+  static float raySphere(const Tempest::Vec3& s, const Tempest::Vec3& d, const Tempest::Vec3& at, float R) {
+    const auto  o = s - at;
+    const float a = Tempest::Vec3::dotProduct(d,d);
+    const float b = Tempest::Vec3::dotProduct(o,d);
+    const float c = Tempest::Vec3::dotProduct(o,o) - R*R;
+    if(c<=0)
+      return 0;
+    if(a<=0 || b>0)
+      return 2;
+    const float disc = b*b - a*c;
+    if(disc<0)
+      return 2;
+    return (-b - std::sqrt(disc))/a;
+    }
+
+  static float rayRadius(const NpcBody& npc) {
+    return 0.5f*(npc.rX + npc.rZ);
+    }
+
   NpcBody* rayTest(const Tempest::Vec3& s, const Tempest::Vec3& e, float extR) {
-    NpcBody* ret     = nullptr;
-    float    minProj = 2;
+    RayQuery q;
+    q.s    = s;
+    q.e    = e;
+    q.extR = extR;
+    NpcBody* ret = nullptr;
+    rayTest(&q,1,&ret);
+    return ret;
+    }
 
-    for(auto i:body) {
-      float proj = 0;
-      if(rayTest(*i.body, s, e, extR, proj)) {
-        if(proj<minProj) {
-          ret     = i.body;
-          minProj = proj;
-          }
-        }
+  // closest npc hit for every query, in one pass over npc list
+  void rayTest(const RayQuery* q, size_t count, NpcBody** out) {
+    // moving bodies are not sorted: for a batch sort them once, single query just scans them
+    const bool sortBody = (count>1 && body.size()>1);
+    if(sortBody) {
+      bodySorted.assign(body.begin(),body.end());
+      for(auto& i:bodySorted)
+        i.x = i.body->pos.x;
+      std::sort(bodySorted.begin(),bodySorted.end(),[](const Record& a, const Record& b){
+        return a.x < b.x;
+        });
       }
-    for(auto i:frozen) {
-      float proj = 0;
-      if(i.body!=nullptr && rayTest(*i.body, s, e, extR, proj)) {
-        if(proj<minProj) {
-          ret     = i.body;
-          minProj = proj;
-          }
+
+    for(size_t i=0; i<count; ++i) {
+      NpcBody* ret  = nullptr;
+      float    frac = 2;
+      rayTest(sortBody ? bodySorted : body, sortBody, q[i], ret, frac);
+      rayTest(frozen, srt, q[i], ret, frac);
+      out[i] = ret;
+      }
+    }
+
+  void rayTest(const std::vector<Record>& arr, bool sorted, const RayQuery& q, NpcBody*& ret, float& frac) const {
+    auto        l = arr.begin();
+    auto        r = arr.end();
+    const float R = maxRayR + q.extR;
+    if(sorted) {
+      // broadphase: only bodies within x-extent of the segment
+      const float x0 = std::min(q.s.x,q.e.x) - R;
+      const float x1 = std::max(q.s.x,q.e.x) + R;
+      l = std::lower_bound(l,r,x0,[](const Record& b,float x){ return b.x<x; });
+      r = std::upper_bound(l,r,x1,[](float x,const Record& b){ return x<b.x; });
+      }
+
+    const float z0 = std::min(q.s.z,q.e.z) - R, z1 = std::max(q.s.z,q.e.z) + R;
+    const float y0 = std::min(q.s.y,q.e.y) - R, y1 = std::max(q.s.y,q.e.y) + R;
+    for(; l!=r; ++l) {
+      const NpcBody* b = l->body;
+      if(b==nullptr)
+        continue;
+      if(b->pos.z<z0 || z1<b->pos.z || b->pos.y+b->h<y0 || y1<b->pos.y)
+        continue;
+      float t = 0;
+      if(rayTest(*b,q.s,q.e,q.extR,t) && t<frac) {
+        ret  = l->body;
+        frac = t;
         }
       }
-    return ret;
     }
 
   bool hasCollision(const DynamicWorld::NpcItem& obj,Tempest::Vec3& normal) {
@@ -322,9 +402,11 @@ struct DynamicWorld::NpcBodyList final {
 
   DynamicWorld&         wrld;
   std::vector<Record>   body, frozen;
+  std::vector<Record>   bodySorted;
   bool                  srt=false;
   uint64_t              tick=0;
   float                 maxR=0;
+  float                 maxRayR=0;
   };
 
 struct DynamicWorld::BulletsList final {
@@ -347,8 +429,23 @@ struct DynamicWorld::BulletsList final {
     }
 
   void tick(uint64_t dt) {
+    // npc hits of all bullets are found in one pass, before callbacks can alter the world
+    query.clear();
+    for(auto& i:body) {
+      NpcBodyList::RayQuery q;
+      q.s    = i.pos;
+      q.e    = wrld.bulletStep(i,i.dir,dt);
+      q.extR = i.targetRange();
+      query.push_back(q);
+      }
+    npcHit.resize(query.size());
+    wrld.npcList->rayTest(query.data(),query.size(),npcHit.data());
+
+    size_t id = 0;
     for(auto& i:body) {
-      wrld.moveBullet(i,i.dir,dt);
+      // list may grow from within callbacks: new bullets are added to front and not visited
+      wrld.moveBullet(i,i.dir,dt,id<npcHit.size() ? npcHit[id] : nullptr);
+      ++id;
       if(i.cb!=nullptr)
         i.cb->onMove();
       }
@@ -363,8 +460,10 @@ struct DynamicWorld::BulletsList final {
       }
     }
 
-  std::list<BulletBody> body;
-  DynamicWorld&         wrld;
+  std::list<BulletBody>              body;
+  DynamicWorld&                      wrld;
+  std::vector<NpcBodyList::RayQuery> query;
+  std::vector<NpcBody*>              npcHit;
   };
 
 struct DynamicWorld::BBoxList final {
@@ -415,10 +514,194 @@ struct DynamicWorld::BBoxList final {
   DynamicWorld&          wrld;
   };
 
-DynamicWorld::DynamicWorld(World& owner,const zenkit::Mesh& worldMesh) {
-  world.reset(new CollisionWorld());
+struct DynamicWorld::HeightField final {
+  // 2.5D grid over landscape: each cell keeps triangles of land and water meshes, that overlap cell column.
+  // Vertical rays are resolved against those triangles directly; collision-world is only queried for objects in the way
+  static constexpr float CellSize = 400.f; // centimeters
+
+  struct Tri final {
+    uint32_t part = 0;
+    uint32_t id   = 0;
+    };
+
+  struct Cell final {
+    std::vector<Tri> land, water;
+    };
+
+  struct Hit final {
+    btScalar  frac = 1;
+    btVector3 norm = {0,0,0};
+    uint32_t  part = uint32_t(-1);
+    };
+
+  HeightField(DynamicWorld& wrld):wrld(wrld){
+    }
+
+  // returns false, if ray must be resolved by collision-world
+  bool landRay(const Tempest::Vec3& from, const Tempest::Vec3& to, RayLandResult& out) {
+    const btVector3 s = CollisionWorld::toMeters(from), e = CollisionWorld::toMeters(to);
+    const Cell*     c = cell(from);
+    if(c==nullptr)
+      return false;
+
+    Hit hit;
+    if(s!=e) {
+      for(auto& t:c->land) {
+        btVector3 v[3];
+        wrld.landMesh->triangle(t.part,t.id,v);
+        rayTriangle(v,s,e,t.part,hit);
+        }
+      }
+
+    btVector3 hitPos = e;
+    if(hit.part!=uint32_t(-1))
+      hitPos.setInterpolate3(s,e,hit.frac);
+    if(s!=e && hasObject(from,CollisionWorld::toCentimeters(hitPos)))
+      return false;
+
+    out = RayLandResult();
+    out.v           = to;
+    out.hitFraction = 1;
+    if(hit.part!=uint32_t(-1)) {
+      out.v           = CollisionWorld::toCentimeters(hitPos);
+      out.n           = Tempest::Vec3(hit.norm.x(),hit.norm.y(),hit.norm.z());
+      out.mat         = wrld.landMesh->materialId(hit.part);
+      out.sector      = wrld.landMesh->sectorName(hit.part);
+      out.hasCol      = true;
+      out.hitFraction = hit.frac;
+      }
+    return true;
+    }
+
+  // returns false, if ray must be resolved by collision-world
+  bool waterRay(const Tempest::Vec3& from, const Tempest::Vec3& to, bool& hasCol, float& waterY) {
+    const btVector3 s = CollisionWorld::toMeters(from), e = CollisionWorld::toMeters(to);
+    const Cell*     c = cell(from);
+    if(c==nullptr)
+      return false;
+
+    Hit hit;
+    for(auto& t:c->water) {
+      btVector3 v[3];
+      wrld.waterMesh->triangle(t.part,t.id,v);
+      rayTriangle(v,s,e,t.part,hit);
+      }
+    hasCol = (hit.part!=uint32_t(-1));
+    if(hasCol) {
+      btVector3 p;
+      p.setInterpolate3(s,e,hit.frac);
+      waterY = p.y()*100.f;
+      }
+    return true;
+    }
+
+  private:
+    // same test as btTriangleRaycastCallback with kF_FilterBackfaces | kF_KeepUnflippedNormal
+    static void rayTriangle(const btVector3 (&v)[3], const btVector3& from, const btVector3& to, uint32_t part, Hit& hit) {
+      const btVector3 v10 = v[1] - v[0];
+      const btVector3 v20 = v[2] - v[0];
+      btVector3       n   = v10.cross(v20);
+
+      const btScalar dist   = v[0].dot(n);
+      const btScalar distA  = n.dot(from) - dist;
+      const btScalar distB  = n.dot(to)   - dist;
+      if(distA*distB>=btScalar(0) || distA<=btScalar(0))
+        return;
+
+      const btScalar distance = distA/(distA-distB);
+      if(distance>=hit.frac)
+        return;
+
+      const btScalar edgeTolerance = n.length2()*btScalar(-0.0001);
+      btVector3 point;
+      point.setInterpolate3(from,to,distance);
+      const btVector3 v0p = v[0]-point;
+      const btVector3 v1p = v[1]-point;
+      const btVector3 v2p = v[2]-point;
+      if(v0p.cross(v1p).dot(n)<edgeTolerance ||
+         v1p.cross(v2p).dot(n)<edgeTolerance ||
+         v2p.cross(v0p).dot(n)<edgeTolerance)
+        return;
+
+      n.normalize();
+      hit.frac = distance;
+      hit.norm = n;
+      hit.part = part;
+      }
 
-  {
+    struct Collector : btTriangleCallback {
+      std::vector<Tri>& dst;
+      explicit Collector(std::vector<Tri>& dst):dst(dst){}
+      void processTriangle(btVector3*, int partId, int triangleIndex) override {
+        Tri t;
+        t.part = uint32_t(partId);
+        t.id   = uint32_t(triangleIndex);
+        dst.push_back(t);
+        }
+      };
+
+    struct ObjectTest : btBroadphaseAabbCallback {
+      bool found = false;
+      bool process(const btBroadphaseProxy* proxy) override {
+        auto obj = reinterpret_cast<const btCollisionObject*>(proxy->m_clientObject);
+        if(obj->getUserIndex()==C_Object)
+          found = true;
+        return !found;
+        }
+      };
+
+    static int32_t cellCoord(float v) {
+      return int32_t(std::clamp(std::floor(v/CellSize), -1e6f, 1e6f));
+      }
+
+    bool hasObject(const Tempest::Vec3& from, const Tempest::Vec3& to) const {
+      // static and movable objects are checked live, so movers never leave stale data in cache
+      const float pad = 1.f;
+      Tempest::Vec3 min = {from.x-pad, std::min(from.y,to.y)-pad, from.z-pad};
+      Tempest::Vec3 max = {from.x+pad, std::max(from.y,to.y)+pad, from.z+pad};
+      ObjectTest test;
+      wrld.world->aabbTest(min,max,test);
+      return test.found;
+      }
+
+    const Cell* cell(const Tempest::Vec3& p) {
+      const int32_t  x   = cellCoord(p.x);
+      const int32_t  z   = cellCoord(p.z);
+      const uint64_t key = (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(z));
+      {
+      std::shared_lock<std::shared_mutex> guard(sync);
+      auto it = cells.find(key);
+      if(it!=cells.end())
+        return it->second.get();
+      }
+
+      // lazy build, outside of lock: landscape never changes, so racing builds produce same data
+      auto c = std::make_unique<Cell>();
+      const btVector3 min = CollisionWorld::toMeters(Tempest::Vec3(float(x)*CellSize, -1e7f, float(z)*CellSize));
+      const btVector3 max = CollisionWorld::toMeters(Tempest::Vec3(float(x+1)*CellSize, 1e7f, float(z+1)*CellSize));
+      if(wrld.landShape!=nullptr) {
+        Collector cb(c->land);
+        static_cast<btConcaveShape*>(wrld.landShape.get())->processAllTriangles(&cb,min,max);
+        }
+      if(wrld.waterShape!=nullptr) {
+        Collector cb(c->water);
+        static_cast<btConcaveShape*>(wrld.waterShape.get())->processAllTriangles(&cb,min,max);
+        }
+
+      std::unique_lock<std::shared_mutex> guard(sync);
+      auto& ret = cells[key];
+      if(ret==nullptr)
+        ret = std::move(c);
+      return ret.get();
+      }
+
+    DynamicWorld&                                  wrld;
+    std::shared_mutex                              sync;
+    std::unordered_map<uint64_t,std::unique_ptr<Cell>> cells;
+  };
+
+static void packLandscape(const zenkit::Mesh& worldMesh, std::vector<std::string>& sectors, std::vector<btVector3>& landVbo,
+                          std::unique_ptr<PhysicVbo>& landMesh, std::unique_ptr<PhysicVbo>& waterMesh) {
   PackedMesh pkg(worldMesh,PackedMesh::PK_Physic);
   sectors.resize(pkg.subMeshes.size());
   for(size_t i=0;i<sectors.size();++i)
@@ -445,11 +728,41 @@ DynamicWorld::DynamicWorld(World& owner,const zenkit::Mesh& worldMesh) {
     }
   }
 
+static btMultimaterialTriangleMeshShape* mkLandShape(PhysicVbo& mesh, btOptimizedBvh* bvh) {
+  if(bvh!=nullptr && bvh->isQuantized()==mesh.useQuantization()) {
+    auto ret = new btMultimaterialTriangleMeshShape(&mesh,mesh.useQuantization(),false);
+    ret->setOptimizedBvh(bvh);
+    return ret;
+    }
+  return new btMultimaterialTriangleMeshShape(&mesh,mesh.useQuantization(),true);
+  }
+
+void DynamicWorld::buildCache(const zenkit::Mesh& worldMesh, WorldCache::Writer& out) {
+  std::vector<std::string>   sectors;
+  std::vector<btVector3>     landVbo;
+  std::unique_ptr<PhysicVbo> landMesh, waterMesh;
+  packLandscape(worldMesh,sectors,landVbo,landMesh,waterMesh);
+
+  if(!landMesh->isEmpty()) {
+    std::unique_ptr<btMultimaterialTriangleMeshShape> shape(mkLandShape(*landMesh,nullptr));
+    out.addBvh(WorldCache::S_LandBvh,*shape->getOptimizedBvh());
+    }
+  if(!waterMesh->isEmpty()) {
+    std::unique_ptr<btMultimaterialTriangleMeshShape> shape(mkLandShape(*waterMesh,nullptr));
+    out.addBvh(WorldCache::S_WaterBvh,*shape->getOptimizedBvh());
+    }
+  }
+
+DynamicWorld::DynamicWorld(World& owner,const zenkit::Mesh& worldMesh, std::shared_ptr<WorldCache> c)
+  :cache(std::move(c)) {
+  world.reset(new CollisionWorld());
+  packLandscape(worldMesh,sectors,landVbo,landMesh,waterMesh);
+
   btVector3 bbox[2] = {btVector3(0,0,0), btVector3(0,0,0)};
   if(!landMesh->isEmpty()) {
     Tempest::Matrix4x4 mt;
     mt.identity();
-    landShape.reset(new btMultimaterialTriangleMeshShape(landMesh.get(),landMesh->useQuantization(),true));
+    landShape.reset(mkLandShape(*landMesh,cache!=nullptr ? cache->takeBvh(WorldCache::S_LandBvh) : nullptr));
     landBody = world->addCollisionBody(*landShape,mt,DynamicWorld::materialFriction(zenkit::MaterialGroup::NONE));
     landBody->setUserIndex(C_Landscape);
 
@@ -462,7 +775,7 @@ DynamicWorld::DynamicWorld(World& owner,const zenkit::Mesh& worldMesh) {
   if(!waterMesh->isEmpty()) {
     Tempest::Matrix4x4 mt;
     mt.identity();
-    waterShape.reset(new btMultimaterialTriangleMeshShape(waterMesh.get(),waterMesh->useQuantization(),true));
+    waterShape.reset(mkLandShape(*waterMesh,cache!=nullptr ? cache->takeBvh(WorldCache::S_WaterBvh) : nullptr));
     waterBody = world->addCollisionBody(*waterShape,mt,0);
     waterBody->setUserIndex(C_Water);
     waterBody->setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT | btCollisionObject::CF_NO_CONTACT_RESPONSE);
@@ -478,6 +791,7 @@ DynamicWorld::DynamicWorld(World& owner,const zenkit::Mesh& worldMesh) {
   npcList   .reset(new NpcBodyList(*this));
   bulletList.reset(new BulletsList(*this));
   bboxList  .reset(new BBoxList   (*this));
+  heightField.reset(new HeightField(*this));
 
   world->setItemHitCallback([&](::Item& itm, zenkit::MaterialGroup mat, float impulse, float mass) {
     auto  snd = owner.addLandHitEffect(ItemMaterial(itm.handle().material),mat,itm.transform());
@@ -491,11 +805,34 @@ DynamicWorld::DynamicWorld(World& owner,const zenkit::Mesh& worldMesh) {
 DynamicWorld::~DynamicWorld(){
   }
 
+void DynamicWorld::storeCache(WorldCache::Writer& out) const {
+  if(landShape!=nullptr)
+    out.addBvh(WorldCache::S_LandBvh, *static_cast<btBvhTriangleMeshShape&>(*landShape).getOptimizedBvh());
+  if(waterShape!=nullptr)
+    out.addBvh(WorldCache::S_WaterBvh,*static_cast<btBvhTriangleMeshShape&>(*waterShape).getOptimizedBvh());
+  }
+
+void DynamicWorld::updateAabbs() const {
+  world->updateAabbs();
+  }
+
 DynamicWorld::RayLandResult DynamicWorld::landRay(const Tempest::Vec3& from, float maxDy) const {
   world->updateAabbs();
   if(maxDy==0)
     maxDy = worldHeight;
-  return ray(Tempest::Vec3(from.x,from.y+ghostPadding,from.z), Tempest::Vec3(from.x,from.y-maxDy,from.z));
+  return vertRay(Tempest::Vec3(from.x,from.y+ghostPadding,from.z), Tempest::Vec3(from.x,from.y-maxDy,from.z));
+  }
+
+DynamicWorld::RayLandResult DynamicWorld::vertRay(const Tempest::Vec3& from, const Tempest::Vec3& to) const {
+  if(rayRecording.load()) {
+    std::lock_guard<std::mutex> guard(rayRecSync);
+    if(rayRec.size()<rayRecordLimit)
+      rayRec.push_back({from,to});
+    }
+  RayLandResult ret;
+  if(heightField->landRay(from,to,ret))
+    return ret;
+  return implRay(from,to);
   }
 
 DynamicWorld::RayWaterResult DynamicWorld::waterRay(const Tempest::Vec3& from) const {
@@ -517,6 +854,28 @@ DynamicWorld::RayWaterResult DynamicWorld::implWaterRay(const Tempest::Vec3& fro
       }
     };
 
+  RayWaterResult ret;
+  if(from.x==to.x && from.z==to.z) {
+    bool  hasCol = false;
+    float waterY = 0;
+    if(heightField->waterRay(from,to,hasCol,waterY)) {
+      if(hasCol) {
+        auto cave = vertRay(from,Tempest::Vec3(to.x,waterY,to.z));
+        if(cave.hasCol && cave.v.y<waterY) {
+          ret.wdepth = from.y-worldHeight;
+          ret.hasCol = false;
+          } else {
+          ret.wdepth = waterY;
+          ret.hasCol = true;
+          }
+        return ret;
+        }
+      ret.wdepth = from.y-worldHeight;
+      ret.hasCol = false;
+      return ret;
+      }
+    }
+
   CallBack callback{CollisionWorld::toMeters(from), CollisionWorld::toMeters(to)};
   callback.m_flags = btTriangleRaycastCallback::kF_KeepUnflippedNormal | btTriangleRaycastCallback::kF_FilterBackfaces;
 
@@ -533,7 +892,6 @@ DynamicWorld::RayWaterResult DynamicWorld::implWaterRay(const Tempest::Vec3& fro
                          callback);
     }
 
-  RayWaterResult ret;
   if(callback.hasHit()) {
     float waterY = callback.m_hitPointWorld.y()*100.f;
     auto  cave   = ray(from,Tempest::Vec3(to.x,waterY,to.z));
@@ -553,6 +911,46 @@ DynamicWorld::RayWaterResult DynamicWorld::implWaterRay(const Tempest::Vec3& fro
   }
 
 DynamicWorld::RayLandResult DynamicWorld::ray(const Tempest::Vec3& from, const Tempest::Vec3& to) const {
+  if(rayRecording.load()) {
+    std::lock_guard<std::mutex> guard(rayRecSync);
+    if(rayRec.size()<rayRecordLimit)
+      rayRec.push_back({from,to});
+    }
+  return implRay(from,to);
+  }
+
+void DynamicWorld::rayBatch(std::span<const RaySegment> rays, std::span<RayLandResult> out) const {
+  const size_t count = std::min(rays.size(),out.size());
+  if(count==0)
+    return;
+  if(rayRecording.load()) {
+    std::lock_guard<std::mutex> guard(rayRecSync);
+    for(size_t i=0; i<count && rayRec.size()<rayRecordLimit; ++i)
+      rayRec.push_back(rays[i]);
+    }
+  // shared state of bullet is updated once; each ray uses callback on the stack of it's worker
+  // small batches (camera probes) are below parallelFor step and run inline
+  world->updateAabbs();
+  auto* begin = rays.data();
+  Workers::parallelFor(begin, begin+count, [this,begin,out](const RaySegment& r) {
+    const size_t id = size_t(&r-begin);
+    out[id] = implRay(r.from,r.to);
+    });
+  }
+
+void DynamicWorld::setRayRecording(bool rec) {
+  std::lock_guard<std::mutex> guard(rayRecSync);
+  if(rec)
+    rayRec.clear();
+  rayRecording.store(rec);
+  }
+
+std::vector<DynamicWorld::RaySegment> DynamicWorld::recordedRays() const {
+  std::lock_guard<std::mutex> guard(rayRecSync);
+  return rayRec;
+  }
+
+DynamicWorld::RayLandResult DynamicWorld::implRay(const Tempest::Vec3& from, const Tempest::Vec3& to) const {
   struct CallBack:btCollisionWorld::ClosestRayResultCallback {
     using ClosestRayResultCallback::ClosestRayResultCallback;
     zenkit::MaterialGroup matId  = zenkit::MaterialGroup::UNDEFINED;
@@ -683,6 +1081,14 @@ DynamicWorld::Item DynamicWorld::movableObj(const PhysicMeshShape* shape, const
   return createObj(&shape->shape,false,m,0,shape->friction(),IT_Movable);
   }
 
+DynamicWorld::Item DynamicWorld::detachedObj(const PhysicMeshShape* shape, const Tempest::Matrix4x4& m) {
+  if(shape==nullptr)
+    return Item();
+  auto obj = world->mkCollisionBody(shape->shape,m,shape->friction());
+  obj->setUserIndex(C_Object);
+  return Item(this,obj.release(),nullptr);
+  }
+
 DynamicWorld::Item DynamicWorld::createObj(btCollisionShape* shape, bool ownShape, const Tempest::Matrix4x4& m, float mass, float friction, ItemType type) {
   std::unique_ptr<CollisionWorld::CollisionBody> obj;
   switch(type) {
@@ -725,12 +1131,17 @@ DynamicWorld::BBoxBody DynamicWorld::bboxObj(BBoxCallback* cb, const Tempest::Ve
   return BBoxBody(this,cb,pos,R);
   }
 
-void DynamicWorld::moveBullet(BulletBody &b, const Tempest::Vec3& dir, uint64_t dt) {
+Tempest::Vec3 DynamicWorld::bulletStep(const BulletBody& b, const Tempest::Vec3& dir, uint64_t dt) const {
+  const float dtF = float(dt);
+  return b.pos + dir*dtF - Tempest::Vec3(0,(b.isSpell() ? 0 : gravity*dtF*dtF),0);
+  }
+
+void DynamicWorld::moveBullet(BulletBody &b, const Tempest::Vec3& dir, uint64_t dt, NpcBody* npcHit) {
   const float dtF     = float(dt);
   const bool  isSpell = b.isSpell();
 
   auto  pos = b.pos;
-  auto  to  = pos + dir*dtF - Tempest::Vec3(0,(isSpell ? 0 : gravity*dtF*dtF),0);
+  auto  to  = bulletStep(b,dir,dt);
 
   struct CallBack:btCollisionWorld::ClosestRayResultCallback {
     using ClosestRayResultCallback::ClosestRayResultCallback;
@@ -805,9 +1216,9 @@ void DynamicWorld::moveBullet(BulletBody &b, const Tempest::Vec3& dir, uint64_t
       }
     b.addHit();
     } else {
-    if(auto ptr = npcList->rayTest(pos,to,b.targetRange())) {
+    if(npcHit!=nullptr && npcHit->enable) {
       if(b.cb!=nullptr)
-        b.cb->onCollide(*ptr->toNpc());
+        b.cb->onCollide(*npcHit->toNpc());
       }
     const float l = b.speed();
     auto        d = b.direction();
@@ -1037,6 +1448,11 @@ void DynamicWorld::Item::setObjMatrix(const Tempest::Matrix4x4 &m) {
     }
   }
 
+void DynamicWorld::Item::attach() {
+  if(obj!=nullptr)
+    owner->world->addCollisionBody(*static_cast<CollisionWorld::CollisionBody*>(obj));
+  }
+
 void DynamicWorld::Item::setItem(::Item* it) {
   assert(obj->getUserIndex()==DynamicWorld::C_Item);
   obj->setUserPointer(it);
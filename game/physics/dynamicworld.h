@@ -5,6 +5,11 @@
 #include <Tempest/Matrix4x4>
 #include <memory>
 #include <limits>
+#include <mutex>
+#include <span>
+#include <atomic>
+
+#include "world/worldcache.h"
 
 class btTriangleIndexVertexArray;
 class btCollisionShape;
@@ -32,6 +37,7 @@ class DynamicWorld final {
     struct NpcBodyList;
     struct BulletsList;
     struct BBoxList;
+    struct HeightField;
 
   public:
     static constexpr float gravityMS   = 9.8f; // meters per second^2
@@ -40,10 +46,14 @@ class DynamicWorld final {
     static constexpr float spellSpeed  = 1; // centimeters per milliseconds
     static const     float ghostPadding;
 
-    DynamicWorld(World &world, const zenkit::Mesh& mesh);
+    DynamicWorld(World &world, const zenkit::Mesh& mesh, std::shared_ptr<WorldCache> cache = nullptr);
     DynamicWorld(const DynamicWorld&)=delete;
     ~DynamicWorld();
 
+    // builds landscape collision without world; used to prebuild world-cache
+    static void buildCache(const zenkit::Mesh& mesh, WorldCache::Writer& out);
+    void        storeCache(WorldCache::Writer& out) const;
+
     enum Category {
       C_Null      = 1,
       C_Landscape = 2,
@@ -120,6 +130,7 @@ class DynamicWorld final {
           }
 
         void setObjMatrix(const Tempest::Matrix4x4& m);
+        void attach();
         void setItem(::Item* it);
         void setInteractive(Interactive* it);
         bool isEmpty() const { return obj==nullptr; }
@@ -149,6 +160,11 @@ class DynamicWorld final {
       Npc* npcHit = nullptr;
       };
 
+    struct RaySegment {
+      Tempest::Vec3 from = {};
+      Tempest::Vec3 to   = {};
+      };
+
     struct BulletCallback {
       virtual ~BulletCallback()=default;
       virtual void onStop(){}
@@ -231,11 +247,15 @@ class DynamicWorld final {
 
     RayLandResult  ray          (const Tempest::Vec3& from, const Tempest::Vec3& to) const;
     RayQueryResult rayNpc       (const Tempest::Vec3& from, const Tempest::Vec3& to) const;
+    // same as ray, for many segments at once; spread across worker pool
+    void           rayBatch     (std::span<const RaySegment> rays, std::span<RayLandResult> out) const;
     float          soundOclusion(const Tempest::Vec3& from, const Tempest::Vec3& to) const;
 
     NpcItem        ghostObj  (std::string_view visual);
     Item           staticObj (const PhysicMeshShape *src, const Tempest::Matrix4x4& m);
     Item           movableObj(const PhysicMeshShape *src, const Tempest::Matrix4x4& m);
+    // static object, not linked into world until Item::attach; can be created from worker threads
+    Item           detachedObj(const PhysicMeshShape *src, const Tempest::Matrix4x4& m);
     Item           dynamicObj(const Tempest::Matrix4x4& pos, const Bounds& bbox, zenkit::MaterialGroup mat);
 
     BulletBody*    bulletObj(BulletCallback* cb);
@@ -243,9 +263,15 @@ class DynamicWorld final {
     BBoxBody       bboxObj(BBoxCallback* cb, const Tempest::Vec3& pos, float R);
 
     void           tick(uint64_t dt);
+    // makes ray-queries read-only, until next modification of collision world
+    void           updateAabbs() const;
 
     void           deleteObj(BulletBody* obj);
 
+    // debug: keep segments of ray() queries, to replay them in benchmark
+    void           setRayRecording(bool rec);
+    auto           recordedRays() const -> std::vector<RaySegment>;
+
     static float   materialFriction(zenkit::MaterialGroup mat);
     static float   materialDensity (zenkit::MaterialGroup mat);
 
@@ -261,10 +287,14 @@ class DynamicWorld final {
                              float mass, float friction, ItemType type);
 
 
-    void           moveBullet(BulletBody& b, const Tempest::Vec3& dir, uint64_t dt);
+    Tempest::Vec3  bulletStep(const BulletBody& b, const Tempest::Vec3& dir, uint64_t dt) const;
+    void           moveBullet(BulletBody& b, const Tempest::Vec3& dir, uint64_t dt, NpcBody* npcHit);
     RayWaterResult implWaterRay(const Tempest::Vec3& from, const Tempest::Vec3& to) const;
+    RayLandResult  implRay     (const Tempest::Vec3& from, const Tempest::Vec3& to) const;
+    RayLandResult  vertRay     (const Tempest::Vec3& from, const Tempest::Vec3& to) const;
     bool           hasCollision(const NpcItem &it, CollisionTest& out);
 
+    std::shared_ptr<WorldCache>        cache; // owns in-place bvh of landscape: must outlive shapes
     std::unique_ptr<CollisionWorld>    world;
 
     std::vector<std::string>           sectors;
@@ -281,6 +311,11 @@ class DynamicWorld final {
     std::unique_ptr<NpcBodyList>       npcList;
     std::unique_ptr<BulletsList>       bulletList;
     std::unique_ptr<BBoxList>          bboxList;
+    std::unique_ptr<HeightField>       heightField;
+
+    std::atomic_bool                   rayRecording{false};
+    mutable std::mutex                 rayRecSync;
+    mutable std::vector<RaySegment>    rayRec;
 
     static const float                 ghostHeight;
     static const float                 worldHeight;
@@ -19,6 +19,19 @@ PhysicMesh::PhysicMesh(const ProtoMesh& proto, DynamicWorld& owner, bool movable
     }
   }
 
+PhysicMesh PhysicMesh::detached(const ProtoMesh& proto, DynamicWorld& owner, const Tempest::Matrix4x4& obj) {
+  PhysicMesh ret;
+  ret.ani = &proto;
+  for(auto& i:proto.attach)
+    ret.sub.emplace_back(owner.detachedObj(i.shape.get(),obj));
+  return ret;
+  }
+
+void PhysicMesh::attach() {
+  for(auto& i:sub)
+    i.attach();
+  }
+
 bool PhysicMesh::isEmpty() const {
   return sub.empty();
   }
@@ -12,6 +12,10 @@ class PhysicMesh final {
     PhysicMesh()=default;
     PhysicMesh(const ProtoMesh& proto, DynamicWorld& owner, bool movable);
 
+    // static mesh, placed at obj, but not linked into world until attach; can be built from worker threads
+    static PhysicMesh detached(const ProtoMesh& proto, DynamicWorld& owner, const Tempest::Matrix4x4& obj);
+    void   attach();
+
     bool   isEmpty() const;
 
     void   setObjMatrix  (const Tempest::Matrix4x4& m);
@@ -83,6 +83,13 @@ const char* PhysicVbo::sectorName(size_t segment) const {
   return nullptr;
   }
 
+void PhysicVbo::triangle(size_t segment, size_t tri, btVector3 (&v)[3]) const {
+  const uint32_t* ibo = &id[segments[segment].off + tri*3];
+  v[0] = vert[ibo[0]];
+  v[1] = vert[ibo[1]];
+  v[2] = vert[ibo[2]];
+  }
+
 bool PhysicVbo::useQuantization() const {
   constexpr int maxParts = (1<<MAX_NUM_PARTS_IN_BITS);
   constexpr int maxTri   = (1 << (31 - MAX_NUM_PARTS_IN_BITS));
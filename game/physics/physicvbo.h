@@ -24,6 +24,7 @@ class PhysicVbo : public btTriangleIndexVertexArray {
     void                    addIndex(const std::vector<uint32_t>& index, size_t iboOff, size_t iboLen, zenkit::MaterialGroup material, const char* sector);
     zenkit::MaterialGroup   materialId(size_t segment) const;
     auto                    sectorName(size_t segment) const -> const char*;
+    void                    triangle(size_t segment, size_t tri, btVector3 (&v)[3]) const;
     bool                    useQuantization() const;
     bool                    isEmpty() const;
 
@@ -27,6 +27,7 @@
 #include "graphics/mesh/animation.h"
 #include "graphics/mesh/attachbinder.h"
 #include "graphics/material.h"
+#include "graphics/texturestreaming.h"
 #include "dmusic/directmusic.h"
 #include "utils/fileext.h"
 #include "utils/gthfont.h"
@@ -36,6 +37,10 @@
 
 #include <dmusic.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 using namespace Tempest;
 
 Resources* Resources::inst=nullptr;
@@ -54,6 +59,7 @@ static void emplaceTag(char* buf, char tag){
 Resources::Resources(Tempest::Device &device)
   : dev(device) {
   inst=this;
+  texStream.reset(new TextureStreaming());
 
   static std::array<VertexFsq,6> fsqBuf =
    {{
@@ -85,9 +91,6 @@ Resources::Resources(Tempest::Device &device)
   // switch-build
   dxMusic->addPath(Gothic::nestedPath({u"_work",u"Data",u"Music"},Dir::FT_Dir));
 
-  fBuff .reserve(8*1024*1024);
-  ddsBuf.reserve(8*1024*1024);
-
   {
   Pixmap pm(1,1,TextureFormat::RGBA8);
   uint8_t* pix = reinterpret_cast<uint8_t*>(pm.data());
@@ -192,7 +195,6 @@ Resources::~Resources() {
   }
 
 bool Resources::hasFile(std::string_view name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
   return inst->gothicAssets.find(name) != nullptr;
   }
 
@@ -353,23 +355,12 @@ int64_t Resources::vdfTimestamp(const std::u16string& name) {
     }
   }
 
-Tempest::Texture2d* Resources::implLoadTexture(std::string_view cname, bool forceMips) {
-  if(cname.empty())
-    return nullptr;
-
+std::unique_ptr<Texture2d> Resources::implLoadTexture(std::string_view cname, bool forceMips) {
   std::string name = std::string(cname);
-  auto it=texCache.find(name);
-  if(it!=texCache.end())
-    return it->second.get();
-
   if(FileExt::hasExt(name,"TGA")) {
     name.resize(name.size() + 2);
     std::memcpy(&name[0]+name.size()-6,"-C.TEX",6);
 
-    it=texCache.find(name);
-    if(it!=texCache.end())
-      return it->second.get();
-
     if(const auto* entry = Resources::vdfsIndex().find(name)) {
       zenkit::Texture tex;
 
@@ -384,7 +375,7 @@ Tempest::Texture2d* Resources::implLoadTexture(std::string_view cname, bool forc
         auto dds = zenkit::to_dds(tex);
         auto ddsRead = zenkit::Read::from(dds);
 
-        auto t = implLoadTexture(std::string(cname), *ddsRead, forceMips);
+        auto t = implLoadTexture(*ddsRead, forceMips);
         if(t!=nullptr)
           return t;
         } else {
@@ -393,11 +384,7 @@ Tempest::Texture2d* Resources::implLoadTexture(std::string_view cname, bool forc
         try {
           Tempest::Pixmap    pm(tex.width(), tex.height(), TextureFormat::RGBA8);
           std::memcpy(pm.data(), rgba.data(), rgba.size());
-
-          std::unique_ptr<Texture2d> t{new Texture2d(dev.texture(pm))};
-          Texture2d* ret=t.get();
-          texCache[std::move(name)] = std::move(t);
-          return ret;
+          return std::unique_ptr<Texture2d>{new Texture2d(loadTexturePm(pm))};
           }
         catch (...) {
           }
@@ -407,16 +394,15 @@ Tempest::Texture2d* Resources::implLoadTexture(std::string_view cname, bool forc
 
   if(auto* entry = Resources::vdfsIndex().find(cname)) {
     auto reader = entry->open_read();
-    return implLoadTexture(std::string(cname), *reader, forceMips);
+    return implLoadTexture(*reader, forceMips);
     }
-
-  texCache[name]=nullptr;
   return nullptr;
   }
 
-Texture2d *Resources::implLoadTexture(std::string&& name, zenkit::Read& data, bool forceMips) {
+std::unique_ptr<Texture2d> Resources::implLoadTexture(zenkit::Read& data, bool forceMips) {
+  // per-thread scratch: textures are loaded concurrently
+  thread_local std::vector<uint8_t> raw;
   try {
-    std::vector<uint8_t> raw;
     data.seek(0, zenkit::Whence::END);
     raw.resize(data.tell());
     data.seek(0, zenkit::Whence::BEG);
@@ -426,31 +412,19 @@ Texture2d *Resources::implLoadTexture(std::string&& name, zenkit::Read& data, bo
     Tempest::Pixmap    pm(rd);
 
     const bool useMipmap = forceMips || (pm.mipCount()>1); // do not generate mips, if original texture has has none
-    std::unique_ptr<Texture2d> t{new Texture2d(dev.texture(pm, useMipmap))};
-    Texture2d* ret=t.get();
-    texCache[std::move(name)] = std::move(t);
-    return ret;
+    return std::unique_ptr<Texture2d>{new Texture2d(loadTexturePm(pm, useMipmap))};
     }
   catch(...){
     return nullptr;
     }
   }
 
-ProtoMesh* Resources::implLoadMesh(std::string_view name) {
-  if(name.size()==0)
-    return nullptr;
-
+std::unique_ptr<ProtoMesh> Resources::implLoadMesh(std::string_view name) {
   auto cname = std::string(name);
-  auto it    = aniMeshCache.find(cname);
-  if(it!=aniMeshCache.end())
-    return it->second.get();
-
-  auto  t   = implLoadMeshMain(cname);
-  auto  ret = t.get();
-  aniMeshCache[cname] = std::move(t);
-  if(ret==nullptr)
+  auto t     = implLoadMeshMain(cname);
+  if(t==nullptr)
     Log::e("unable to load mesh \"",cname,"\"");
-  return ret;
+  return t;
   }
 
 std::unique_ptr<ProtoMesh> Resources::implLoadMeshMain(std::string name) {
@@ -571,14 +545,9 @@ std::unique_ptr<ProtoMesh> Resources::implLoadMeshMain(std::string name) {
   return nullptr;
   }
 
-PfxEmitterMesh* Resources::implLoadEmiterMesh(std::string_view name) {
+std::unique_ptr<PfxEmitterMesh> Resources::implLoadEmiterMesh(std::string_view name) {
   // TODO: reuse code from Resources::implLoadMeshMain
   auto cname = std::string(name);
-  auto it    = emiMeshCache.find(cname);
-  if(it!=emiMeshCache.end())
-    return it->second.get();
-
-  auto& ret = emiMeshCache[cname];
 
   if(FileExt::hasExt(cname,"3DS")) {
     FileExt::exchangeExt(cname,"3DS","MRM");
@@ -593,8 +562,7 @@ PfxEmitterMesh* Resources::implLoadEmiterMesh(std::string_view name) {
       return nullptr;
 
     PackedMesh packed(zmsh,PackedMesh::PK_Visual);
-    ret = std::unique_ptr<PfxEmitterMesh>(new PfxEmitterMesh(packed));
-    return ret.get();
+    return std::unique_ptr<PfxEmitterMesh>(new PfxEmitterMesh(packed));
     }
 
   if(FileExt::hasExt(name,"MDM")) {
@@ -608,27 +576,13 @@ PfxEmitterMesh* Resources::implLoadEmiterMesh(std::string_view name) {
     auto reader = entry->open_read();
     mdm.load(reader.get());
 
-    ret = std::unique_ptr<PfxEmitterMesh>(new PfxEmitterMesh(std::move(mdm)));
-    return ret.get();
+    return std::unique_ptr<PfxEmitterMesh>(new PfxEmitterMesh(std::move(mdm)));
     }
 
   return nullptr;
   }
 
-ProtoMesh* Resources::implDecalMesh(const zenkit::VisualDecal& decal) {
-  DecalK key;
-  key.mat         = Material(decal);
-  key.sX          = decal.dimension.x;
-  key.sY          = decal.dimension.y;
-  key.decal2Sided = decal.two_sided;
-
-  if(key.mat.tex==nullptr)
-    return nullptr;
-
-  auto it = decalMeshCache.find(key);
-  if(it!=decalMeshCache.end())
-    return it->second.get();
-
+std::unique_ptr<ProtoMesh> Resources::implDecalMesh(const DecalK& key) {
   Resources::Vertex vbo[8] = {
     {{-1.f, -1.f, 0.f},{0,0,-1},{0,1}, 0xFFFFFFFF},
     {{ 1.f, -1.f, 0.f},{0,0,-1},{1,1}, 0xFFFFFFFF},
@@ -651,11 +605,7 @@ ProtoMesh* Resources::implDecalMesh(const zenkit::VisualDecal& decal) {
     cibo = { 0,1,2, 0,2,3, 4,6,5, 4,7,6 }; else
     cibo = { 0,1,2, 0,2,3 };
 
-  std::unique_ptr<ProtoMesh> t{new ProtoMesh(key.mat, std::move(cvbo), std::move(cibo))};
-
-  auto ret = t.get();
-  decalMeshCache[key] = std::move(t);
-  return ret;
+  return std::unique_ptr<ProtoMesh>{new ProtoMesh(key.mat, std::move(cvbo), std::move(cibo))};
   }
 
 std::unique_ptr<Animation> Resources::implLoadAnimation(std::string name) {
@@ -698,6 +648,8 @@ Tempest::Sound Resources::implLoadSoundBuffer(std::string_view name) {
   if(name.empty())
     return Tempest::Sound();
 
+  // per-thread scratch: sounds are loaded concurrently
+  thread_local std::vector<uint8_t> fBuff;
   if(!getFileData(name,fBuff))
     return Tempest::Sound();
   try {
@@ -778,14 +730,27 @@ GthFont &Resources::implLoadFont(std::string_view name, FontType type) {
   }
 
 const Texture2d *Resources::loadTexture(std::string_view name, bool forceMips) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadTexture(name,forceMips);
+  if(name.empty())
+    return nullptr;
+  return inst->texCache.get(std::string(name),[name,forceMips](){
+    return inst->implLoadTexture(name,forceMips);
+    });
+  }
+
+const Texture2d* Resources::loadTextureStreamed(std::string_view name) {
+  if(auto t = inst->texStream->load(name))
+    return t;
+  return loadTexture(name);
+  }
+
+TextureStreaming& Resources::textureStreaming() {
+  return *inst->texStream;
   }
 
 const Texture2d* Resources::loadTexture(Tempest::Color color) {
   if(color==Color())
     return nullptr;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   auto& cache = inst->pixCache;
   auto it = cache.find(color);
   if(it!=cache.end())
@@ -795,7 +760,7 @@ const Texture2d* Resources::loadTexture(Tempest::Color color) {
   Pixmap p2(1,1,TextureFormat::RGBA8);
   std::memcpy(p2.data(),iv,4);
 
-  auto t       = std::make_unique<Texture2d>(inst->dev.texture(p2));
+  auto t       = std::make_unique<Texture2d>(loadTexturePm(p2));
   auto ret     = t.get();
   cache[color] = std::move(t);
   return ret;
@@ -856,31 +821,71 @@ std::vector<const Texture2d*> Resources::loadTextureAnim(std::string_view name)
     }
   }
 
-Texture2d Resources::loadTexturePm(const Pixmap &pm) {
+Texture2d Resources::loadTexturePm(const Pixmap &pm, bool mips) {
+  std::lock_guard<std::mutex> g(inst->devSync);
   if(pm.isEmpty()) {
     Pixmap p2(1,1,TextureFormat::R8);
     std::memset(p2.data(),0,1);
     return inst->dev.texture(p2);
     }
-  return inst->dev.texture(pm);
+  return inst->dev.texture(pm,mips);
   }
 
-Material Resources::loadMaterial(const zenkit::Material& src, bool enableAlphaTest) {
-  return Material(src,enableAlphaTest);
+Material Resources::loadMaterial(const zenkit::Material& src, bool enableAlphaTest, bool streamed) {
+  return Material(src,enableAlphaTest,streamed);
   }
 
 const ProtoMesh* Resources::loadMesh(std::string_view name) {
   if(name.size()==0)
     return nullptr;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadMesh(name);
+  return inst->aniMeshCache.get(std::string(name),[name](){
+    return inst->implLoadMesh(name);
+    });
+  }
+
+Resources::LoadStats Resources::stressLoadMeshes(const std::vector<std::string>& names, size_t numThreads, bool cold) {
+  using clock = std::chrono::steady_clock;
+  ResourceCache<std::string,ProtoMesh> coldCache;
+  auto get = [cold,&coldCache](const std::string& name) -> const ProtoMesh* {
+    if(!cold)
+      return loadMesh(name);
+    return coldCache.get(name,[&name](){
+      return inst->implLoadMesh(name);
+      });
+    };
+
+  std::atomic<size_t>      loaded{0}, mismatch{0};
+  std::vector<std::thread> th;
+  auto t0 = clock::now();
+  for(size_t t=0; t<numThreads; ++t) {
+    th.emplace_back([&names,&loaded,&mismatch,&get,t,numThreads]() {
+      const size_t off = (names.size()*t)/numThreads;
+      for(size_t i=0; i<names.size(); ++i) {
+        auto& name = names[(i+off)%names.size()];
+        auto  mesh = get(name);
+        if(mesh!=nullptr)
+          loaded.fetch_add(1);
+        if(mesh!=get(name))
+          mismatch.fetch_add(1);
+        }
+      });
+    }
+  for(auto& i:th)
+    i.join();
+
+  LoadStats ret;
+  ret.loaded   = loaded.load()/std::max<size_t>(numThreads,1);
+  ret.mismatch = mismatch.load();
+  ret.timeMs   = uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(clock::now()-t0).count());
+  return ret;
   }
 
 const PfxEmitterMesh* Resources::loadEmiterMesh(std::string_view name) {
   if(name.empty())
     return nullptr;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadEmiterMesh(name);
+  return inst->emiMeshCache.get(std::string(name),[name](){
+    return inst->implLoadEmiterMesh(name);
+    });
   }
 
 const Skeleton* Resources::loadSkeleton(std::string_view name) {
@@ -892,77 +897,84 @@ const Skeleton* Resources::loadSkeleton(std::string_view name) {
 
 const Animation* Resources::loadAnimation(std::string_view name) {
   auto cname = std::string(name);
-
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  auto& cache = inst->animCache;
-  auto it=cache.find(cname);
-  if(it!=cache.end())
-    return it->second.get();
-  auto t       = inst->implLoadAnimation(cname);
-  auto ret     = t.get();
-  cache[cname] = std::move(t);
-  return ret;
+  return inst->animCache.get(cname,[&cname](){
+    return inst->implLoadAnimation(cname);
+    });
   }
 
 Tempest::Sound Resources::loadSoundBuffer(std::string_view name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
   return inst->implLoadSoundBuffer(name);
   }
 
 Dx8::PatternList Resources::loadDxMusic(std::string_view name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   return inst->implLoadDxMusic(name);
   }
 
 DmSegment* Resources::loadMusicSegment(char const* name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   return inst->implLoadMusicSegment(name);
   }
 
 const ProtoMesh* Resources::decalMesh(const zenkit::VisualDecal& decal) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implDecalMesh(decal);
+  DecalK key;
+  key.mat         = Material(decal);
+  key.sX          = decal.dimension.x;
+  key.sY          = decal.dimension.y;
+  key.decal2Sided = decal.two_sided;
+
+  if(key.mat.tex==nullptr)
+    return nullptr;
+  return inst->decalMeshCache.get(key,[&key](){
+    return inst->implDecalMesh(key);
+    });
   }
 
 const Resources::VobTree* Resources::loadVobBundle(std::string_view name) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-  return inst->implLoadVobBundle(name);
+  return inst->zenCache.get(std::string(name),[name](){
+    return inst->implLoadVobBundle(name);
+    });
   }
 
 void Resources::resetRecycled(uint8_t fId) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   inst->recycledId = fId;
   inst->recycled[fId].ds.clear();
   inst->recycled[fId].ssbo.clear();
   inst->recycled[fId].img.clear();
+  inst->recycled[fId].tex.clear();
   }
 
 void Resources::recycle(Tempest::DescriptorSet&& ds) {
   if(ds.isEmpty())
     return;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   inst->recycled[inst->recycledId].ds.emplace_back(std::move(ds));
   }
 
 void Resources::recycle(Tempest::StorageBuffer&& ssbo) {
   if(ssbo.isEmpty())
     return;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   inst->recycled[inst->recycledId].ssbo.emplace_back(std::move(ssbo));
   }
 
 void Resources::recycle(Tempest::StorageImage&& img) {
   if(img.isEmpty())
     return;
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
+  std::lock_guard<std::mutex> g(inst->sync);
   inst->recycled[inst->recycledId].img.emplace_back(std::move(img));
   }
 
-const Resources::VobTree* Resources::implLoadVobBundle(std::string_view filename) {
+void Resources::recycle(Tempest::Texture2d&& tex) {
+  if(tex.isEmpty())
+    return;
+  std::lock_guard<std::mutex> g(inst->sync);
+  inst->recycled[inst->recycledId].tex.emplace_back(std::move(tex));
+  }
+
+std::unique_ptr<Resources::VobTree> Resources::implLoadVobBundle(std::string_view filename) {
   auto cname = std::string(filename);
-  auto i     = zenCache.find(cname);
-  if(i!=zenCache.end())
-    return i->second.get();
 
   std::vector<std::shared_ptr<zenkit::VirtualObject>> bundle;
   try {
@@ -982,27 +994,17 @@ const Resources::VobTree* Resources::implLoadVobBundle(std::string_view filename
     Log::e("unable to load Zen-file: \"",cname,"\"");
     }
 
-  auto ret = zenCache.insert(std::make_pair(filename,std::make_unique<VobTree>(std::move(bundle))));
-  return ret.first->second.get();
+  return std::make_unique<VobTree>(std::move(bundle));
   }
 
 const AttachBinder *Resources::bindMesh(const ProtoMesh &anim, const Skeleton &s) {
-  std::lock_guard<std::recursive_mutex> g(inst->sync);
-
   if(anim.submeshId.size()==0){
     static AttachBinder empty;
     return &empty;
     }
-  BindK k = BindK(&s,&anim);
-
-  auto it = inst->bindCache.find(k);
-  if(it!=inst->bindCache.end())
-    return it->second.get();
-
-  std::unique_ptr<AttachBinder> ret(new AttachBinder(s,anim));
-  auto p = ret.get();
-  inst->bindCache[k] = std::move(ret);
-  return p;
+  return inst->bindCache.get(BindK(&s,&anim),[&anim,&s](){
+    return std::unique_ptr<AttachBinder>(new AttachBinder(s,anim));
+    });
   }
 
 Tempest::VertexBuffer<Resources::Vertex> Resources::sphere(int passCount, float R){
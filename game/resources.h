@@ -14,6 +14,7 @@
 
 #include "graphics/material.h"
 #include "sound/soundfx.h"
+#include "utils/resourcecache.h"
 
 struct DmSegment;
 struct DmLoader;
@@ -26,6 +27,7 @@ class AttachBinder;
 class PhysicMeshShape;
 class PfxEmitterMesh;
 class GthFont;
+class TextureStreaming;
 
 namespace Dx8 {
 class DirectMusic;
@@ -97,11 +99,14 @@ class Resources final {
     static auto                      fallbackImage() -> const Tempest::StorageImage&;
     static auto                      fallbackImage3d() -> const Tempest::StorageImage&;
     static const Tempest::Texture2d* loadTexture(std::string_view name, bool forceMips = false);
+    // low mips first, full mip-chain is streamed in later; falls back to loadTexture
+    static const Tempest::Texture2d* loadTextureStreamed(std::string_view name);
     static const Tempest::Texture2d* loadTexture(Tempest::Color color);
     static const Tempest::Texture2d* loadTexture(std::string_view name, int32_t v, int32_t c);
-    static       Tempest::Texture2d  loadTexturePm(const Tempest::Pixmap& pm);
+    static       Tempest::Texture2d  loadTexturePm(const Tempest::Pixmap& pm, bool mips = true);
     static auto                      loadTextureAnim(std::string_view name) -> std::vector<const Tempest::Texture2d*>;
-    static       Material            loadMaterial(const zenkit::Material& src, bool enableAlphaTest);
+    static       Material            loadMaterial(const zenkit::Material& src, bool enableAlphaTest, bool streamed = false);
+    static auto                      textureStreaming() -> TextureStreaming&;
 
     static const AttachBinder*       bindMesh       (const ProtoMesh& anim, const Skeleton& s);
     static const ProtoMesh*          loadMesh       (std::string_view name);
@@ -117,13 +122,13 @@ class Resources final {
     static const VobTree*            loadVobBundle(std::string_view name);
 
     template<class V>
-    static Tempest::VertexBuffer<V>  vbo(const V* data,size_t sz){ return inst->dev.vbo(data,sz); }
+    static Tempest::VertexBuffer<V>  vbo(const V* data,size_t sz){ std::lock_guard<std::mutex> g(inst->devSync); return inst->dev.vbo(data,sz); }
 
     template<class V>
-    static Tempest::IndexBuffer<V>   ibo(const V* data,size_t sz){ return inst->dev.ibo(data,sz); }
+    static Tempest::IndexBuffer<V>   ibo(const V* data,size_t sz){ std::lock_guard<std::mutex> g(inst->devSync); return inst->dev.ibo(data,sz); }
 
-    static Tempest::StorageBuffer    ssbo(const void* data, size_t size)         { return inst->dev.ssbo(data,size); }
-    static Tempest::StorageBuffer    ssbo(Tempest::Uninitialized_t, size_t size) { return inst->dev.ssbo(Tempest::Uninitialized,size); }
+    static Tempest::StorageBuffer    ssbo(const void* data, size_t size)         { std::lock_guard<std::mutex> g(inst->devSync); return inst->dev.ssbo(data,size); }
+    static Tempest::StorageBuffer    ssbo(Tempest::Uninitialized_t, size_t size) { std::lock_guard<std::mutex> g(inst->devSync); return inst->dev.ssbo(Tempest::Uninitialized,size); }
 
     template<class V, class I>
     static Tempest::AccelerationStructure
@@ -132,6 +137,7 @@ class Resources final {
                                           size_t offset, size_t size){
       if(!inst->dev.properties().raytracing.rayQuery)
         return Tempest::AccelerationStructure();
+      std::lock_guard<std::mutex> g(inst->devSync);
       return inst->dev.blas(b,i,offset,size);
       }
 
@@ -139,6 +145,7 @@ class Resources final {
     static void recycle(Tempest::DescriptorSet&& ds);
     static void recycle(Tempest::StorageBuffer&& ssbo);
     static void recycle(Tempest::StorageImage&& img);
+    static void recycle(Tempest::Texture2d&& tex);
 
     static std::vector<uint8_t>      getFileData(std::string_view name);
     static bool                      getFileData(std::string_view name, std::vector<uint8_t>& dat);
@@ -148,6 +155,15 @@ class Resources final {
 
     static const zenkit::Vfs&        vdfsIndex();
 
+    struct LoadStats final {
+      size_t   loaded   = 0;
+      size_t   mismatch = 0;
+      uint64_t timeMs   = 0;
+      };
+    // concurrency stress: every thread loads all meshes, starting at own offset;
+    // cold - meshes go into a private cache, so each key is actually loaded under contention
+    static LoadStats                 stressLoadMeshes(const std::vector<std::string>& names, size_t numThreads, bool cold);
+
     static const Tempest::VertexBuffer<VertexFsq>& fsqVbo();
     static const Tempest::IndexBuffer<uint16_t>&   cubeIbo();
 
@@ -174,23 +190,21 @@ class Resources final {
         }
       };
 
-    using TextureCache = std::unordered_map<std::string,std::unique_ptr<Tempest::Texture2d>>;
-
     int64_t               vdfTimestamp(const std::u16string& name);
     void                  detectVdf(std::vector<Archive>& ret, const std::u16string& root);
 
-    Tempest::Texture2d*   implLoadTexture(std::string_view cname, bool forceMips);
-    Tempest::Texture2d*   implLoadTexture(std::string &&name, zenkit::Read& data, bool forceMips);
-    ProtoMesh*            implLoadMesh(std::string_view name);
-    std::unique_ptr<ProtoMesh> implLoadMeshMain(std::string name);
-    std::unique_ptr<Animation> implLoadAnimation(std::string name);
-    ProtoMesh*            implDecalMesh(const zenkit::VisualDecal& decal);
-    Tempest::Sound        implLoadSoundBuffer(std::string_view name);
-    Dx8::PatternList      implLoadDxMusic(std::string_view name);
-    DmSegment*            implLoadMusicSegment(char const* name);
-    GthFont&              implLoadFont(std::string_view fname, FontType type);
-    PfxEmitterMesh*       implLoadEmiterMesh(std::string_view name);
-    const VobTree*        implLoadVobBundle(std::string_view name);
+    std::unique_ptr<Tempest::Texture2d> implLoadTexture(std::string_view cname, bool forceMips);
+    std::unique_ptr<Tempest::Texture2d> implLoadTexture(zenkit::Read& data, bool forceMips);
+    std::unique_ptr<ProtoMesh>      implLoadMesh(std::string_view name);
+    std::unique_ptr<ProtoMesh>      implLoadMeshMain(std::string name);
+    std::unique_ptr<Animation>      implLoadAnimation(std::string name);
+    std::unique_ptr<ProtoMesh>      implDecalMesh(const DecalK& key);
+    Tempest::Sound                  implLoadSoundBuffer(std::string_view name);
+    Dx8::PatternList                implLoadDxMusic(std::string_view name);
+    DmSegment*                      implLoadMusicSegment(char const* name);
+    GthFont&                        implLoadFont(std::string_view fname, FontType type);
+    std::unique_ptr<PfxEmitterMesh> implLoadEmiterMesh(std::string_view name);
+    std::unique_ptr<VobTree>        implLoadVobBundle(std::string_view name);
 
     Tempest::VertexBuffer<Vertex> sphere(int passCount, float R);
 
@@ -224,12 +238,12 @@ class Resources final {
     Tempest::Device&                  dev;
     Tempest::SoundDevice              sound;
 
-    std::recursive_mutex              sync;
+    std::mutex                        sync; // pixCache, music and recycle queues; asset caches have own locks
+    std::mutex                        devSync; // device object creation: assets are loaded from many threads
     std::unique_ptr<Dx8::DirectMusic> dxMusic;
     DmLoader*                         dmLoader = nullptr;
     zenkit::Vfs                       gothicAssets;
 
-    std::vector<uint8_t>              fBuff, ddsBuf;
     Tempest::VertexBuffer<VertexFsq>  fsq;
     Tempest::IndexBuffer<uint16_t>    cube;
 
@@ -237,20 +251,23 @@ class Resources final {
       std::vector<Tempest::DescriptorSet> ds;
       std::vector<Tempest::StorageBuffer> ssbo;
       std::vector<Tempest::StorageImage>  img;
+      std::vector<Tempest::Texture2d>     tex;
       };
     DeleteQueue recycled[MaxFramesInFlight];
     uint8_t     recycledId = 0;
 
-    TextureCache                                                      texCache;
+    ResourceCache<std::string,Tempest::Texture2d>                     texCache;
     std::map<Tempest::Color,std::unique_ptr<Tempest::Texture2d>,Less> pixCache;
-    std::unordered_map<std::string,std::unique_ptr<ProtoMesh>>        aniMeshCache;
-    std::unordered_map<DecalK,std::unique_ptr<ProtoMesh>,Hash>        decalMeshCache;
-    std::unordered_map<std::string,std::unique_ptr<Skeleton>>         skeletonCache;
-    std::unordered_map<std::string,std::unique_ptr<Animation>>        animCache;
-    std::unordered_map<BindK,std::unique_ptr<AttachBinder>,Hash>      bindCache;
-    std::unordered_map<std::string,std::unique_ptr<PfxEmitterMesh>>   emiMeshCache;
-    std::unordered_map<std::string,std::unique_ptr<VobTree>>          zenCache;
+    ResourceCache<std::string,ProtoMesh>                              aniMeshCache;
+    ResourceCache<DecalK,ProtoMesh,Hash>                              decalMeshCache;
+    ResourceCache<std::string,Animation>                              animCache;
+    ResourceCache<BindK,AttachBinder,Hash>                            bindCache;
+    ResourceCache<std::string,PfxEmitterMesh>                         emiMeshCache;
+    ResourceCache<std::string,VobTree>                                zenCache;
 
     std::recursive_mutex                                              syncFont;
     std::unordered_map<FontK,std::unique_ptr<GthFont>,Hash>           gothicFnt;
+
+    // last: pending stream jobs are done, before the rest is destroyed
+    std::unique_ptr<TextureStreaming>                                 texStream;
   };
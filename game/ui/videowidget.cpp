@@ -6,13 +6,101 @@
 #include <Tempest/Application>
 #include <Tempest/Platform>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 #include "bink/video.h"
 #include "utils/fileutil.h"
+#include "utils/workers.h"
 #include "gamemusic.h"
 #include "gothic.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define VIDEO_SSE2 1
+#include <emmintrin.h>
+#endif
+
 using namespace Tempest;
 
+// BT.601 limited range to rgb, fixed point 3.13
+enum : int32_t {
+  YuvShift = 13,
+  YuvY     = 9535,  // 1.164
+  YuvRV    = 13074, // 1.596
+  YuvGV    = 6660,  // 0.813
+  YuvGU    = 3203,  // 0.391
+  YuvBU    = 16531, // 2.018
+  };
+
+static uint8_t clampRgb(int32_t v) {
+  return uint8_t(std::clamp(v >> YuvShift, 0, 255));
+  }
+
+static void yuvToRgbaRow(const uint8_t* py, const uint8_t* pu, const uint8_t* pv, uint8_t* dst, uint32_t w) {
+  uint32_t x = 0;
+#if defined(VIDEO_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i c16  = _mm_set1_epi16(16);
+  const __m128i c128 = _mm_set1_epi16(128);
+  const __m128i cy   = _mm_set1_epi16(int16_t(YuvY));
+  const __m128i cr   = _mm_setr_epi16(0,int16_t(YuvRV),0,int16_t(YuvRV),0,int16_t(YuvRV),0,int16_t(YuvRV));
+  const __m128i cg   = _mm_setr_epi16(int16_t(-YuvGU),int16_t(-YuvGV),int16_t(-YuvGU),int16_t(-YuvGV),
+                                      int16_t(-YuvGU),int16_t(-YuvGV),int16_t(-YuvGU),int16_t(-YuvGV));
+  const __m128i cb   = _mm_setr_epi16(int16_t(YuvBU),0,int16_t(YuvBU),0,int16_t(YuvBU),0,int16_t(YuvBU),0);
+  const __m128i a255 = _mm_set1_epi8(char(0xFF));
+  for(; x+8<=w; x+=8) {
+    // 8 pixels, 4 chroma samples
+    int32_t u4 = 0, v4 = 0;
+    std::memcpy(&u4,pu+x/2,4);
+    std::memcpy(&v4,pv+x/2,4);
+    const __m128i y  = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(py+x)),zero),c16);
+    const __m128i u  = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(u4),zero),c128);
+    const __m128i v  = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v4),zero),c128);
+    const __m128i uv = _mm_unpacklo_epi16(u,v);
+
+    // chroma terms per sample, then duplicated to pixel pairs
+    const __m128i r4 = _mm_madd_epi16(uv,cr);
+    const __m128i g4 = _mm_madd_epi16(uv,cg);
+    const __m128i b4 = _mm_madd_epi16(uv,cb);
+
+    const __m128i ylo = _mm_mullo_epi16(y,cy);
+    const __m128i yhi = _mm_mulhi_epi16(y,cy);
+    const __m128i y0  = _mm_unpacklo_epi16(ylo,yhi);
+    const __m128i y1  = _mm_unpackhi_epi16(ylo,yhi);
+
+    auto channel = [&](__m128i c4) {
+      const __m128i c0 = _mm_shuffle_epi32(c4,_MM_SHUFFLE(1,1,0,0));
+      const __m128i c1 = _mm_shuffle_epi32(c4,_MM_SHUFFLE(3,3,2,2));
+      const __m128i v0 = _mm_srai_epi32(_mm_add_epi32(y0,c0),YuvShift);
+      const __m128i v1 = _mm_srai_epi32(_mm_add_epi32(y1,c1),YuvShift);
+      // saturation to 0..255
+      return _mm_packus_epi16(_mm_packs_epi32(v0,v1),zero);
+      };
+    const __m128i r  = channel(r4);
+    const __m128i g  = channel(g4);
+    const __m128i b  = channel(b4);
+
+    const __m128i rg = _mm_unpacklo_epi8(r,g);
+    const __m128i ba = _mm_unpacklo_epi8(b,a255);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x*4+ 0),_mm_unpacklo_epi16(rg,ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+x*4+16),_mm_unpackhi_epi16(rg,ba));
+    }
+#endif
+  for(; x<w; ++x) {
+    const int32_t Y = (int32_t(py[x])-16)*YuvY;
+    const int32_t U = int32_t(pu[x/2])-128;
+    const int32_t V = int32_t(pv[x/2])-128;
+    uint8_t* rgb = dst+x*4;
+    rgb[0] = clampRgb(Y + YuvRV*V);
+    rgb[1] = clampRgb(Y - YuvGV*V - YuvGU*U);
+    rgb[2] = clampRgb(Y + YuvBU*U);
+    rgb[3] = 255;
+    }
+  }
+
 struct VideoWidget::Input : Bink::Video::Input {
   Input(Tempest::RFile& fin):fin(fin) {}
 
@@ -87,6 +175,14 @@ void VideoWidget::Sound::renderSound(int16_t *out, size_t n) {
   }
 
 struct VideoWidget::Context {
+  // frame, decoded ahead of presentation
+  struct Frame {
+    Pixmap                          pm;
+    std::vector<std::vector<float>> audio;
+    size_t                          id = 0;
+    };
+  static constexpr size_t MaxQueue = 3;
+
   Context(const std::u16string& path) : fin(path), input(fin), vid(&input) {
     sndCtx.resize(vid.audioCount());
     for(size_t i=0; i<sndCtx.size(); ++i) {
@@ -99,70 +195,186 @@ struct VideoWidget::Context {
     sndDev.setGlobalVolume(volume);
     for(size_t i=0; i<vid.audioCount(); ++i)
       sndCtx[i]->play();
+
+    decoder = std::thread([this]() { decodeLoop(); });
     }
 
   ~Context() {
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    stop = true;
+    }
+    queueFree.notify_all();
+    decoder.join();
     }
 
-  void advance() {
-    auto& f = vid.nextFrame();
-    if(pm.w()!=f.width() || pm.h()!=f.height())
-      pm = Pixmap(f.width(),f.height(),TextureFormat::RGBA8);
+  void decodeLoop() {
+    Workers::setThreadName("Video decoder");
+    while(true) {
+      Frame fr;
+      {
+      std::unique_lock<std::mutex> lck(sync);
+      queueFree.wait(lck,[this]() { return stop || queue.size()<MaxQueue; });
+      if(stop || vid.currentFrame()>=vid.frameCount())
+        break;
+      if(!spare.empty()) {
+        fr = std::move(spare.back());
+        spare.pop_back();
+        }
+      }
 
-    yuvToRgba(f,pm);
-    for(size_t i=0; i<vid.audioCount(); ++i)
-      sndCtx[i]->pushSamples(f.audio(uint8_t(i)).samples);
+      try {
+        auto& f = vid.nextFrame();
+        if(fr.pm.w()!=f.width() || fr.pm.h()!=f.height())
+          fr.pm = Pixmap(f.width(),f.height(),TextureFormat::RGBA8);
+        yuvToRgba(f,fr.pm);
+        fr.audio.resize(vid.audioCount());
+        for(size_t i=0; i<vid.audioCount(); ++i)
+          fr.audio[i] = f.audio(uint8_t(i)).samples;
+        fr.id = vid.currentFrame();
+        }
+      catch(const Bink::VideoDecodingException& e) { // video exception is recoverable
+        Log::e("video decoding error. frame: ",vid.currentFrame(),", what: \"", e.what(), "\"");
+        continue;
+        }
+      catch(...) {
+        Log::e("video decoding error. frame: ",vid.currentFrame());
+        break;
+        }
+
+      {
+      std::lock_guard<std::mutex> guard(sync);
+      queue.push_back(std::move(fr));
+      }
+      queueReady.notify_one();
+      }
 
-    uint64_t destTick = frameTime+(1000*vid.fps().den*vid.currentFrame())/vid.fps().num;
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    eof = true;
+    }
+    queueReady.notify_all();
+    }
+
+  bool advance() {
+    Frame fr;
+    {
+    std::unique_lock<std::mutex> lck(sync);
+    queueReady.wait(lck,[this]() { return !queue.empty() || eof; });
+    if(queue.empty())
+      return false;
+    fr = std::move(queue.front());
+    queue.pop_front();
+    }
+    queueFree.notify_one();
+
+    for(size_t i=0; i<sndCtx.size() && i<fr.audio.size(); ++i)
+      sndCtx[i]->pushSamples(fr.audio[i]);
+    std::swap(pm,fr.pm);
+    const size_t id = fr.id;
+    {
+    std::lock_guard<std::mutex> guard(sync);
+    spare.push_back(std::move(fr));
+    }
+
+    uint64_t destTick = frameTime+(1000*vid.fps().den*id)/vid.fps().num;
     uint64_t tick     = Application::tickCount();
     if(tick<destTick) {
       Application::sleep(uint32_t(destTick-tick));
       }
+    return true;
     }
 
-  void yuvToRgba(const Bink::Frame& f,Pixmap& pm) {
-    auto planeY = f.plane(0);
-    auto planeU = f.plane(1);
-    auto planeV = f.plane(2);
-    auto dst    = reinterpret_cast<uint8_t*>(pm.data());
-
-    const uint32_t w = pm.w();
-    for(uint32_t y=0; y<pm.h(); ++y)
-      for(uint32_t x=0; x<w; ++x) {
-        uint8_t* rgb = &dst[(x+y*w)*4];
-        float Y = planeY.at(x,  y  );
-        float U = planeU.at(x/2,y/2);
-        float V = planeV.at(x/2,y/2);
-
-        float r = 1.164f * (Y - 16.f) + 1.596f * (V - 128.f);
-        float g = 1.164f * (Y - 16.f) - 0.813f * (V - 128.f) - 0.391f * (U - 128.f);
-        float b = 1.164f * (Y - 16.f) + 2.018f * (U - 128.f);
-
-        r = std::max(0.f,std::min(r,255.f));
-        g = std::max(0.f,std::min(g,255.f));
-        b = std::max(0.f,std::min(b,255.f));
-
-        rgb[0] = uint8_t(r);
-        rgb[1] = uint8_t(g);
-        rgb[2] = uint8_t(b);
-        rgb[3] = 255;
-        }
-    }
-
-  bool isEof() const {
-    return vid.currentFrame()>=vid.frameCount();
+  bool isEof() {
+    std::lock_guard<std::mutex> guard(sync);
+    return eof && queue.empty();
     }
 
   Tempest::RFile       fin;
   Input                input;
-  Bink::Video          vid;
+  Bink::Video          vid; // owned by decoder thread
   Pixmap               pm;
   uint64_t             frameTime = 0;
 
+  std::thread             decoder;
+  std::mutex              sync;
+  std::condition_variable queueReady, queueFree;
+  std::deque<Frame>       queue;
+  std::vector<Frame>      spare;
+  bool                    stop = false;
+  bool                    eof  = false;
+
   Tempest::SoundDevice      sndDev;
   std::vector<std::unique_ptr<SoundContext>> sndCtx;
   };
 
+std::u16string VideoWidget::videoPath(std::string_view filename) {
+  auto path  = Gothic::nestedPath({u"_work",u"Data",u"Video"},Dir::FT_Dir);
+  auto fname = TextCodec::toUtf16(std::string(filename).c_str());
+  auto f     = FileUtil::caseInsensitiveSegment(path,fname.c_str(),Dir::FT_File);
+  if(!FileUtil::exists(f)) {
+    // some api-calls are missing extension
+    f = FileUtil::caseInsensitiveSegment(path,(fname+u".bik").c_str(),Dir::FT_File);
+    }
+  return f;
+  }
+
+void VideoWidget::yuvToRgba(const Bink::Frame& f, Pixmap& pm) {
+  auto&          planeY = f.plane(0);
+  auto&          planeU = f.plane(1);
+  auto&          planeV = f.plane(2);
+  auto           dst    = reinterpret_cast<uint8_t*>(pm.data());
+  const uint32_t w      = pm.w();
+  const uint32_t h      = pm.h();
+
+  // bands of even height: chroma row is shared by two rows
+  static constexpr uint32_t Band = 32;
+  Workers::parallelTasks((h+Band-1)/Band, [&](size_t id) {
+    const uint32_t y0 = uint32_t(id)*Band;
+    const uint32_t y1 = std::min(y0+Band,h);
+    for(uint32_t y=y0; y<y1; ++y)
+      yuvToRgbaRow(planeY.row(y),planeU.row(y/2),planeV.row(y/2),dst+size_t(y)*w*4,w);
+    });
+  }
+
+bool VideoWidget::benchmark(std::string_view filename, BenchStats& st) {
+  using clock = std::chrono::steady_clock;
+  auto us = [](clock::time_point a, clock::time_point b) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(b-a).count());
+    };
+
+  st = BenchStats();
+  try {
+    Tempest::RFile fin(videoPath(filename));
+    Input          input(fin);
+    Bink::Video    vid(&input);
+    Pixmap         pm;
+    while(vid.currentFrame()<vid.frameCount()) {
+      const auto t0 = clock::now();
+      try {
+        auto& f = vid.nextFrame();
+        const auto t1 = clock::now();
+        if(pm.w()!=f.width() || pm.h()!=f.height())
+          pm = Pixmap(f.width(),f.height(),TextureFormat::RGBA8);
+        yuvToRgba(f,pm);
+        const auto t2 = clock::now();
+        st.decode  += us(t0,t1);
+        st.convert += us(t1,t2);
+        st.width    = f.width();
+        st.height   = f.height();
+        st.frames++;
+        }
+      catch(const Bink::VideoDecodingException&) {
+        st.errors++;
+        }
+      }
+    }
+  catch(...) {
+    return false;
+    }
+  return true;
+  }
+
 VideoWidget::VideoWidget() {
   setCursorShape(CursorShape::Hidden);
   }
@@ -205,16 +417,8 @@ void VideoWidget::tick() {
     hasPendingVideo.store(false);
   }
 
-  auto path  = Gothic::nestedPath({u"_work",u"Data",u"Video"},Dir::FT_Dir);
-  auto fname = TextCodec::toUtf16(filename.c_str());
-  auto f     = FileUtil::caseInsensitiveSegment(path,fname.c_str(),Dir::FT_File);
-  if(!FileUtil::exists(f)) {
-    // some api-calls are missing extension
-    f = FileUtil::caseInsensitiveSegment(path,(fname+u".bik").c_str(),Dir::FT_File);
-    }
-
   try {
-    ctx.reset(new Context(f));
+    ctx.reset(new Context(videoPath(filename)));
     if(!active) {
       active       = true;
       restoreMusic = GameMusic::inst().isEnabled();
@@ -260,16 +464,14 @@ void VideoWidget::paint(Tempest::Device& device, uint8_t fId) {
   if(ctx==nullptr)
     return;
   try {
-    ctx->advance();
+    if(!ctx->advance())
+      return;
     tex[fId] = device.texture(ctx->pm,false);
     frame    = &tex[fId];
     update();
     }
-  catch(const Bink::VideoDecodingException& e) { // video exception is recoverable
-    Log::e("video decoding error. frame: ",ctx->vid.currentFrame(),", what: \"", e.what(), "\"");
-    }
   catch(...) {
-    Log::e("video decoding error. frame: ",ctx->vid.currentFrame());
+    Log::e("unable to present video frame");
     ctx.reset();
     }
   }
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <Tempest/Widget>
+#include <Tempest/Pixmap>
 
 #include <queue>
 
 #include "resources.h"
 
+namespace Bink {
+class Frame;
+}
+
 class VideoWidget : public Tempest::Widget {
   public:
     VideoWidget();
@@ -14,6 +19,17 @@ class VideoWidget : public Tempest::Widget {
     void pushVideo(std::string_view filename);
     bool isActive() const;
 
+    struct BenchStats {
+      size_t   frames  = 0;
+      size_t   errors  = 0;
+      uint32_t width   = 0;
+      uint32_t height  = 0;
+      uint64_t decode  = 0; // us
+      uint64_t convert = 0; // us
+      };
+    // decodes whole video as fast as possible, without presentation
+    static bool benchmark(std::string_view filename, BenchStats& st);
+
     void tick();
     void paint(Tempest::Device& device, uint8_t fId);
     void paintEvent(Tempest::PaintEvent &event) override;
@@ -31,6 +47,9 @@ class VideoWidget : public Tempest::Widget {
 
     void  stopVideo();
 
+    static std::u16string videoPath(std::string_view filename);
+    static void           yuvToRgba(const Bink::Frame& f, Tempest::Pixmap& pm);
+
     std::unique_ptr<Context>      ctx;
     Tempest::Texture2d            tex[Resources::MaxFramesInFlight];
     Tempest::Texture2d*           frame  = nullptr;
@@ -0,0 +1,96 @@
+#include "mappedfile.h"
+
+#include <Tempest/Platform>
+#include <Tempest/TextCodec>
+
+#ifdef __WINDOWS__
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+  close();
+  }
+
+#ifdef __WINDOWS__
+bool MappedFile::open(const std::u16string& path) {
+  close();
+  HANDLE f = CreateFileW(reinterpret_cast<const WCHAR*>(path.c_str()), GENERIC_READ, FILE_SHARE_READ,
+                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if(f==INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fsz = {};
+  if(!GetFileSizeEx(f,&fsz) || fsz.QuadPart<=0) {
+    CloseHandle(f);
+    return false;
+    }
+
+  HANDLE m = CreateFileMappingW(f, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  if(m==nullptr) {
+    CloseHandle(f);
+    return false;
+    }
+
+  void* p = MapViewOfFile(m, FILE_MAP_COPY, 0, 0, 0);
+  if(p==nullptr) {
+    CloseHandle(m);
+    CloseHandle(f);
+    return false;
+    }
+
+  file    = f;
+  mapping = m;
+  ptr     = reinterpret_cast<uint8_t*>(p);
+  sz      = size_t(fsz.QuadPart);
+  return true;
+  }
+
+void MappedFile::close() {
+  if(ptr!=nullptr)
+    UnmapViewOfFile(ptr);
+  if(mapping!=nullptr)
+    CloseHandle(mapping);
+  if(file!=nullptr)
+    CloseHandle(file);
+  ptr     = nullptr;
+  sz      = 0;
+  mapping = nullptr;
+  file    = nullptr;
+  }
+#else
+bool MappedFile::open(const std::u16string& path) {
+  close();
+  const std::string p  = Tempest::TextCodec::toUtf8(path);
+  const int         fd = ::open(p.c_str(), O_RDONLY);
+  if(fd<0)
+    return false;
+
+  struct stat st = {};
+  if(fstat(fd,&st)!=0 || st.st_size<=0) {
+    ::close(fd);
+    return false;
+    }
+
+  void* m = mmap(nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  // mapping holds it's own reference to the file
+  ::close(fd);
+  if(m==MAP_FAILED)
+    return false;
+
+  ptr = reinterpret_cast<uint8_t*>(m);
+  sz  = size_t(st.st_size);
+  return true;
+  }
+
+void MappedFile::close() {
+  if(ptr!=nullptr)
+    munmap(ptr,sz);
+  ptr = nullptr;
+  sz  = 0;
+  }
+#endif
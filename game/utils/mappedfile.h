@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Tempest/Platform>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Private (copy-on-write) read-write mapping of a whole file: pages are loaded on demand,
+// writes to the mapping are never stored back to disk.
+class MappedFile final {
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+    ~MappedFile();
+
+    bool     open(const std::u16string& path);
+    void     close();
+
+    uint8_t* data()       { return ptr; }
+    size_t   size() const { return sz;  }
+
+  private:
+    uint8_t* ptr = nullptr;
+    size_t   sz  = 0;
+#ifdef __WINDOWS__
+    void*    file    = nullptr;
+    void*    mapping = nullptr;
+#endif
+  };
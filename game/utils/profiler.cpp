@@ -0,0 +1,212 @@
+#include "profiler.h"
+
+#if defined(OPENGOTHIC_PROFILER)
+#include <Tempest/File>
+#include <Tempest/Log>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+using namespace Tempest;
+
+namespace {
+// closed zones per thread, older ones are overwritten
+constexpr size_t RingSize  = 1<<16;
+constexpr size_t MaxFrames = 256;
+
+struct Ring final {
+  std::string                        name;
+  uint32_t                           depth = 0;
+  std::atomic<uint64_t>              head{0};
+  std::unique_ptr<Profiler::Event[]> events{new Profiler::Event[RingSize]};
+  };
+
+struct State final {
+  std::mutex                         sync;
+  std::vector<std::unique_ptr<Ring>> threads;
+  std::atomic<uint64_t>              frameId{0};
+  std::atomic<uint64_t>              frames[MaxFrames];
+  };
+}
+
+static State& state() {
+  // never destroyed: worker threads may still close zones at exit
+  static State* st = new State();
+  return *st;
+  }
+
+static thread_local Ring* current = nullptr;
+
+static Ring& ring() {
+  if(current!=nullptr)
+    return *current;
+  auto& st = state();
+  std::lock_guard<std::mutex> guard(st.sync);
+  st.threads.emplace_back(new Ring());
+  current       = st.threads.back().get();
+  current->name = "Thread " + std::to_string(st.threads.size()-1);
+  return *current;
+  }
+
+static uint64_t now() {
+  auto t = std::chrono::steady_clock::now().time_since_epoch();
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(t).count());
+  }
+
+// events of a thread, that are closed not earlier than 'from'; events are ordered by end
+static Profiler::Thread collect(const Ring& r, uint64_t from) {
+  Profiler::Thread ret;
+  ret.name = r.name;
+
+  const uint64_t head = r.head.load(std::memory_order_acquire);
+  const uint64_t tail = head>RingSize ? head-RingSize : 0;
+  uint64_t       i    = head;
+  for(; i>tail; --i) {
+    auto& e = r.events[(i-1)%RingSize];
+    if(e.end<from)
+      break;
+    ret.events.push_back(e);
+    }
+
+  // writer may have wrapped around while copying: drop overwritten slots
+  const uint64_t head2 = r.head.load(std::memory_order_acquire);
+  const uint64_t valid = head2>=RingSize ? head2-RingSize+1 : 0;
+  const size_t   cnt   = size_t(head - std::max(i,valid));
+  ret.events.resize(std::min(ret.events.size(),cnt));
+  std::reverse(ret.events.begin(),ret.events.end());
+  return ret;
+  }
+
+Profiler::Zone::Zone(const char* name):name(name) {
+  auto& r = ring();
+  depth = r.depth++;
+  begin = now();
+  }
+
+Profiler::Zone::~Zone() {
+  const uint64_t end = now();
+  auto&          r   = *current;
+  r.depth--;
+
+  const uint64_t h = r.head.load(std::memory_order_relaxed);
+  auto&          e = r.events[h%RingSize];
+  e.name  = name;
+  e.begin = begin;
+  e.end   = end;
+  e.depth = depth;
+  r.head.store(h+1,std::memory_order_release);
+  }
+
+void Profiler::frameMark() {
+  auto&          st = state();
+  const uint64_t id = st.frameId.load(std::memory_order_relaxed);
+  st.frames[id%MaxFrames].store(now(),std::memory_order_relaxed);
+  st.frameId.store(id+1,std::memory_order_release);
+  }
+
+void Profiler::setThreadName(const char* name) {
+  auto& r  = ring();
+  auto& st = state();
+  std::lock_guard<std::mutex> guard(st.sync);
+  r.name = name;
+  }
+
+Profiler::Capture Profiler::capture(uint32_t frames) {
+  Capture ret;
+  auto&          st = state();
+  const uint64_t id = st.frameId.load(std::memory_order_acquire);
+  const uint64_t n  = std::min<uint64_t>({frames+1u, id, MaxFrames});
+  if(n<2)
+    return ret;
+  for(uint64_t i=id-n; i<id; ++i)
+    ret.frames.push_back(st.frames[i%MaxFrames].load(std::memory_order_relaxed));
+
+  std::lock_guard<std::mutex> guard(st.sync);
+  for(auto& r:st.threads) {
+    auto th = collect(*r,ret.frames.front());
+    if(!th.events.empty())
+      ret.threads.push_back(std::move(th));
+    }
+  return ret;
+  }
+
+static void writeEscaped(std::string& out, const char* str) {
+  for(; *str; ++str) {
+    if(*str=='"' || *str=='\\')
+      out.push_back('\\');
+    out.push_back(*str);
+    }
+  }
+
+bool Profiler::exportTrace(std::string_view file) {
+  auto&          st = state();
+  const uint64_t id = st.frameId.load(std::memory_order_acquire);
+
+  std::vector<Thread> threads;
+  {
+  std::lock_guard<std::mutex> guard(st.sync);
+  for(auto& r:st.threads)
+    threads.push_back(collect(*r,0));
+  }
+
+  uint64_t origin = uint64_t(-1);
+  for(auto& th:threads)
+    for(auto& e:th.events)
+      origin = std::min(origin,e.begin);
+  if(origin==uint64_t(-1))
+    return false;
+
+  std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  char        buf[128] = {};
+  bool        first    = true;
+  auto sep = [&]() {
+    if(!first)
+      out += ",\n";
+    first = false;
+    };
+
+  for(size_t t=0; t<threads.size(); ++t) {
+    sep();
+    std::snprintf(buf,sizeof(buf),"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"",unsigned(t));
+    out += buf;
+    writeEscaped(out,threads[t].name.c_str());
+    out += "\"}}";
+
+    for(auto& e:threads[t].events) {
+      if(e.begin<origin)
+        continue;
+      sep();
+      out += "{\"name\":\"";
+      writeEscaped(out,e.name);
+      std::snprintf(buf,sizeof(buf),"\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    unsigned(t),double(e.begin-origin)/1000.0,double(e.end-e.begin)/1000.0);
+      out += buf;
+      }
+    }
+
+  for(uint64_t i=(id>MaxFrames ? id-MaxFrames : 0); i<id; ++i) {
+    const uint64_t f = st.frames[i%MaxFrames].load(std::memory_order_relaxed);
+    if(f<origin)
+      continue;
+    sep();
+    std::snprintf(buf,sizeof(buf),"{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":%.3f}",
+                  double(f-origin)/1000.0);
+    out += buf;
+    }
+  out += "\n]}\n";
+
+  try {
+    WFile fout{std::string(file)};
+    fout.write(out.data(),out.size());
+    }
+  catch(...) {
+    Log::e("profiler: unable to write \"",file,"\"");
+    return false;
+    }
+  return true;
+  }
+#endif
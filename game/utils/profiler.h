@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(OPENGOTHIC_PROFILER)
+#define PROFILE_CONCAT_(a,b) a##b
+#define PROFILE_CONCAT(a,b)  PROFILE_CONCAT_(a,b)
+// scoped zone, name must be a string literal
+#define PROFILE_ZONE(name)   Profiler::Zone PROFILE_CONCAT(profileZone,__LINE__)(name)
+// begin of frame, called once per frame by main thread
+#define PROFILE_FRAME()      Profiler::frameMark()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+#endif
+
+// CPU frame profiler: each thread writes closed zones into own ring buffer, without locks.
+// Built only with OPENGOTHIC_PROFILER, otherwise instrumentation compiles to nothing.
+class Profiler final {
+  public:
+    struct Event final {
+      const char* name  = nullptr;
+      uint64_t    begin = 0; // ns
+      uint64_t    end   = 0; // ns
+      uint32_t    depth = 0;
+      };
+
+    struct Thread final {
+      std::string        name;
+      std::vector<Event> events;
+      };
+
+    struct Capture final {
+      std::vector<uint64_t> frames; // begin of each frame, last one is end of capture
+      std::vector<Thread>   threads;
+      };
+
+#if defined(OPENGOTHIC_PROFILER)
+    static constexpr bool enabled = true;
+
+    class Zone final {
+      public:
+        explicit Zone(const char* name);
+        ~Zone();
+
+      private:
+        const char* name  = nullptr;
+        uint64_t    begin = 0;
+        uint32_t    depth = 0;
+      };
+
+    static void    frameMark();
+    static void    setThreadName(const char* name);
+    // zones of last complete frames
+    static Capture capture(uint32_t frames);
+    // Chrome trace / Perfetto json of everything in ring buffers
+    static bool    exportTrace(std::string_view file);
+#else
+    static constexpr bool enabled = false;
+
+    static void    frameMark() {}
+    static void    setThreadName(const char*) {}
+    static Capture capture(uint32_t) { return Capture(); }
+    static bool    exportTrace(std::string_view) { return false; }
+#endif
+  };
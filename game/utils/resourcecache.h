@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Concurrent, load-once cache: shards are locked only for a lookup, load of a key
+// happens outside of shard lock, with other threads waiting on that key only.
+// Failed load (nullptr) is cached; exception leaves key unloaded, so next call retries.
+template<class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+class ResourceCache final {
+  public:
+    ResourceCache() = default;
+    ResourceCache(const ResourceCache&) = delete;
+    ResourceCache& operator = (const ResourceCache&) = delete;
+
+    template<class F>
+    V* get(const K& key, F&& load) {
+      Entry& e = entry(key);
+      std::call_once(e.once, [&e, &load]() { e.value = load(); });
+      return e.value.get();
+      }
+
+    // not thread-safe against concurrent get
+    void clear() {
+      for(auto& s:shards) {
+        std::lock_guard<std::mutex> guard(s.sync);
+        s.data.clear();
+        }
+      }
+
+  private:
+    static constexpr size_t NumShards = 16;
+
+    struct Entry final {
+      std::once_flag     once;
+      std::unique_ptr<V> value;
+      };
+
+    struct alignas(64) Shard final {
+      std::mutex                                       sync;
+      std::unordered_map<K,std::unique_ptr<Entry>,Hash,Eq> data;
+      };
+
+    Entry& entry(const K& key) {
+      const size_t h = Hash()(key);
+      auto&        s = shards[(h ^ (h>>16)) % NumShards];
+      std::lock_guard<std::mutex> guard(s.sync);
+      auto& e = s.data[key];
+      if(e==nullptr)
+        e = std::make_unique<Entry>();
+      return *e;
+      }
+
+    Shard shards[NumShards];
+  };
@@ -1,4 +1,5 @@
 #include "workers.h"
+#include "utils/profiler.h"
 #include "utils/string_frm.h"
 
 #include <Tempest/Platform>
@@ -11,6 +12,7 @@
 
 #if defined(_MSC_VER)
 void Workers::setThreadName(const char* threadName) {
+  Profiler::setThreadName(threadName);
   const DWORD MS_VC_EXCEPTION = 0x406D1388;
   DWORD dwThreadID = GetCurrentThreadId();
 #pragma pack(push,8)
@@ -35,6 +37,7 @@ void Workers::setThreadName(const char* threadName) {
   }
 #elif defined(__WINDOWS__)
 void Workers::setThreadName(const char* threadName) {
+  Profiler::setThreadName(threadName);
 #if defined(__GNUC__)
   pthread_setname_np(pthread_self(), threadName);
 #endif
@@ -52,10 +55,13 @@ void Workers::setThreadName(const char* threadName) {
   }
 #elif defined(__GNUC__) && !defined(__clang__)
 void Workers::setThreadName(const char* threadName){
+  Profiler::setThreadName(threadName);
   pthread_setname_np(pthread_self(), threadName);
   }
 #else
-void Workers::setThreadName(const char* threadName) { (void)threadName; }
+void Workers::setThreadName(const char* threadName) {
+  Profiler::setThreadName(threadName);
+  }
 #endif
 
 using namespace Tempest;
@@ -63,23 +69,39 @@ using namespace Tempest;
 const size_t Workers::taskPerThread = 128;
 const size_t Workers::taskPerStep   = 16;
 
+static uint32_t            threadCountOverride = 0;
+static thread_local size_t workerId            = size_t(-1);
+
 Workers::Workers() {
-  size_t id=0;
-  for(auto& i:th) {
-    i = std::thread([this,id]() noexcept {
+  const uint32_t count = threadCount();
+  // main thread also does tasks
+  const uint32_t thCount = count>1 ? count-1 : 0;
+
+  queues.reset(new Queue[thCount]);
+  threads.resize(thCount);
+  for(size_t id=0; id<threads.size(); ++id) {
+    threads[id] = std::thread([this,id]() noexcept {
       threadFunc(id);
       });
-    ++id;
     }
   }
 
 Workers::~Workers() {
-  running  = false;
-  workSet  = nullptr;
-  workSize = MAX_THREADS;
-  execWork(minWorkSize<void,void>());
-  for(auto& i:th)
+  // queued jobs are run, not dropped: fire-and-forget work, such as cache writes, must complete
+  while(queued.load()>0) {
+    if(!runOne())
+      std::this_thread::yield();
+    }
+  {
+  std::unique_lock<std::mutex> lck(sync);
+  running.store(false);
+  }
+  workWait.notify_all();
+  for(auto& i:threads)
     i.join();
+  // jobs, scheduled by last running ones
+  while(runOne())
+    ;
   }
 
 Workers &Workers::inst() {
@@ -87,13 +109,30 @@ Workers &Workers::inst() {
   return w;
   }
 
-uint8_t Workers::maxThreads() {
+void Workers::setThreadCount(uint32_t count) {
+  threadCountOverride = count;
+  }
+
+uint32_t Workers::threadCount() {
+  if(threadCountOverride>0)
+    return threadCountOverride;
   int32_t th = int32_t(std::thread::hardware_concurrency());
   if(th<=0)
     th = 1;
-  if(th>MAX_THREADS)
-    return MAX_THREADS;
-  return uint8_t(th);
+  return uint32_t(th);
+  }
+
+uint8_t Workers::maxThreads() {
+  return uint8_t(std::min<uint32_t>(threadCount(), 255));
+  }
+
+bool Workers::Task::isDone() const {
+  return job==nullptr || job->done.load(std::memory_order_acquire);
+  }
+
+void Workers::Task::wait() const {
+  if(job!=nullptr)
+    inst().wait(*job);
   }
 
 void Workers::threadFunc(size_t id) {
@@ -101,99 +140,171 @@ void Workers::threadFunc(size_t id) {
   string_frm tname("Workers [",int(id),"]");
   setThreadName(tname.c_str());
   }
+  workerId = id;
 
   while(true) {
-    {
+    if(runOne())
+      continue;
+
     std::unique_lock<std::mutex> lck(sync);
-    workWait.wait(lck, [this]() { return workTbd>0; });
-    --workTbd;
+    sleeping.fetch_add(1);
+    workWait.wait(lck, [this]() { return queued.load()>0 || !running.load(); });
+    sleeping.fetch_sub(1);
+    if(!running.load())
+      return;
     }
+  }
 
-    if(!running) {
-      taskDone.fetch_add(1);
-      return;
-      }
+void Workers::submit(std::shared_ptr<Job> job, std::initializer_list<Task> deps) {
+  for(auto& d:deps) {
+    if(d.job==nullptr)
+      continue;
+    std::lock_guard<std::mutex> guard(d.job->sync);
+    if(d.job->done.load(std::memory_order_acquire))
+      continue;
+    job->deps.fetch_add(1);
+    job->prev.push_back(d.job);
+    d.job->next.push_back(job);
+    }
+  // release the guard-reference taken at construction
+  if(job->deps.fetch_sub(1)==1)
+    schedule(std::move(job));
+  }
 
-    if(workSet==nullptr) {
-      auto idx = progressIt.fetch_add(1);
-      workFunc(workSet+idx, 1);
-      } else {
-      taskLoop();
-      }
+void Workers::schedule(std::shared_ptr<Job> job) {
+  Queue& q = (workerId<threads.size()) ? queues[workerId] : global;
+  {
+  std::lock_guard<std::mutex> guard(q.sync);
+  q.jobs.push_back(std::move(job));
+  }
+  queued.fetch_add(1);
 
-    taskDone.fetch_add(1);
-    // if(size_t(taskDone.fetch_add(1)+1)==taskCount)
-    //   std::this_thread::yield();
+  if(sleeping.load()>0) {
+    std::lock_guard<std::mutex> guard(sync);
+    workWait.notify_one();
     }
   }
 
-uint32_t Workers::taskLoop() {
-  uint32_t count = 0;
-  while(true) {
-    size_t b = size_t(progressIt.fetch_add(taskPerStep));
-    size_t e = std::min(b+taskPerStep, workSize);
-    if(e<=b)
-      break;
-
-    void* d = workSet + b*workEltSize;
-    workFunc(d,e-b);
-    count += uint32_t(e-b);
+std::shared_ptr<Workers::Job> Workers::pop(Queue& q, bool back) {
+  std::lock_guard<std::mutex> guard(q.sync);
+  if(q.jobs.empty())
+    return nullptr;
+  std::shared_ptr<Job> ret;
+  if(back) {
+    ret = std::move(q.jobs.back());
+    q.jobs.pop_back();
+    } else {
+    ret = std::move(q.jobs.front());
+    q.jobs.pop_front();
     }
-  return count;
+  queued.fetch_sub(1);
+  return ret;
   }
 
-void Workers::execWork(uint32_t& minElts) {
-  if(workSize==0)
-    return;
+bool Workers::runOne() {
+  if(queued.load()<=0)
+    return false;
 
-  if(workSet!=nullptr) {
-    const auto maxTheads = maxThreads();
-    taskCount = uint32_t((workSize+taskPerThread-1)/taskPerThread);
-    taskCount--; // main thread also do tasks
-    if(taskCount>maxTheads)
-      taskCount = maxTheads;
-    if(taskCount<=0)
-      taskCount = 1;
-    } else {
-    taskCount = uint32_t(workSize);
-    }
+  std::shared_ptr<Job> job;
+  if(workerId<threads.size())
+    job = pop(queues[workerId],true);
+  if(job==nullptr)
+    job = pop(global,false);
 
-  if(running && taskCount==1) {
-    workFunc(workSet, workSize);
-    return;
+  const size_t cnt = threads.size();
+  const size_t off = stealIt.fetch_add(1);
+  for(size_t i=0; job==nullptr && i<cnt; ++i) {
+    size_t victim = (off+i)%cnt;
+    if(victim!=workerId)
+      job = pop(queues[victim],false);
     }
 
-  minElts = std::max<uint32_t>(minElts, taskPerThread);
+  if(job==nullptr)
+    return false;
+  // already taken by a thread, that waits for it
+  if(!job->claimed.exchange(true))
+    execute(*job);
+  return true;
+  }
 
-  if(workSet!=nullptr && workSize<=minElts && true) {
-    workFunc(workSet, workSize);
-    if(minElts > workSize*2)
-      minElts = 0;
-    return;
+bool Workers::help(Job& job) {
+  // waiter helps only with awaited job and its dependencies, never with unrelated ones:
+  // those can be long, or re-enter locks, that waiting thread is holding
+  if(job.deps.load()==0) {
+    if(job.claimed.exchange(true))
+      return false;
+    execute(job);
+    return true;
     }
+  std::vector<std::shared_ptr<Job>> prev;
+  {
+  std::lock_guard<std::mutex> guard(job.sync);
+  prev = job.prev;
+  }
+  for(auto& i:prev) {
+    if(!i->done.load(std::memory_order_acquire) && help(*i))
+      return true;
+    }
+  return false;
+  }
 
-  progressIt.store(0);
-  taskDone.store(0);
+void Workers::execute(Job& job) {
+  {
+  PROFILE_ZONE("Workers::job");
+  job.func();
+  }
+  job.func = nullptr;
 
+  std::vector<std::shared_ptr<Job>> next;
   {
-  std::unique_lock<std::mutex> lck(sync);
-  workTbd = int32_t(taskCount);
+  std::lock_guard<std::mutex> guard(job.sync);
+  job.done.store(true, std::memory_order_release);
+  next = std::move(job.next);
+  job.prev.clear();
   }
-  workWait.notify_all();
+  job.done.notify_all();
 
-  uint32_t cnt = 0;
-  if(workSet==nullptr) {
-    std::this_thread::yield();
-    } else {
-    cnt = taskLoop(); (void)cnt;
+  for(auto& i:next) {
+    if(i->deps.fetch_sub(1)==1)
+      schedule(std::move(i));
     }
+  }
 
-  while(true) {
-    int expect = int(taskCount);
-    if(taskDone.load()==expect) {
-      taskDone.store(0);
-      break;
+void Workers::wait(Job& job) {
+  uint32_t spin = 0;
+  while(!job.done.load(std::memory_order_acquire)) {
+    // run awaited job in place, if nobody started it yet; this also makes nested parallelism deadlock-free
+    if(help(job)) {
+      spin = 0;
+      continue;
+      }
+    if(spin<64) {
+      ++spin;
+      std::this_thread::yield();
+      continue;
       }
-    std::this_thread::yield();
+    // job or its dependencies are in progress on another thread
+    job.done.wait(false, std::memory_order_acquire);
     }
   }
+
+void Workers::execParallel(size_t taskCount, const std::function<void()>& body) {
+  // main thread also does tasks
+  taskCount = std::min(taskCount, threads.size()+1);
+  if(taskCount<=1) {
+    body();
+    return;
+    }
+
+  std::vector<std::shared_ptr<Job>> jobs(taskCount-1);
+  for(auto& i:jobs) {
+    i = std::make_shared<Job>();
+    i->deps.store(0);
+    i->func = [&body]() { body(); };
+    schedule(i);
+    }
+
+  body();
+  for(auto& i:jobs)
+    wait(*i);
+  }
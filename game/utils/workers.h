@@ -3,32 +3,66 @@
 #include <thread>
 #include <mutex>
 #include <vector>
+#include <deque>
+#include <memory>
 #include <functional>
 #include <atomic>
 #include <algorithm>
 #include <condition_variable>
+#include <initializer_list>
+#include <type_traits>
 #include <new>
 
 class Workers final {
+  private:
+    struct Job;
+
   public:
     Workers();
     ~Workers();
 
+    // Handle to a scheduled job. Can be used as dependency for other jobs.
+    class Task {
+      public:
+        Task() = default;
+
+        bool isDone() const;
+        void wait()   const;
+
+      protected:
+        std::shared_ptr<Job> job;
+      friend class Workers;
+      };
+
+    template<class T>
+    class Future : public Task {
+      public:
+        Future() = default;
+        const T& get() const { wait(); return *value; }
+
+      private:
+        std::shared_ptr<T> value;
+      friend class Workers;
+      };
+
     static void setThreadName(const char* threadName);
+    // must be called before first use of worker-pool; 0 - use hardware concurrency
+    static void setThreadCount(uint32_t count);
 
     template<class T,class F>
     static void parallelFor(T* b, T* e, const F& func) {
-      inst().runParallelFor(b,std::distance(b,e),func);
+      inst().runParallelFor(b,size_t(std::distance(b,e)),taskPerStep,func);
       }
 
     template<class T,class F>
     static void parallelFor(std::vector<T>& data, const F& func) {
-      inst().runParallelFor(data.data(),data.size(),func);
+      inst().runParallelFor(data.data(),data.size(),taskPerStep,func);
       }
 
     template<class T,class F>
     static void parallelTasks(std::vector<T>& data, const F& func) {
-      inst().runParallelFor(data.data(),data.size(),func);
+      // heavy elements: balance one by one
+      inst().runParallelFor(data.data(),data.size(),1,func);
       }
 
     template<class F>
@@ -36,65 +70,116 @@ class Workers final {
       inst().runParallelTasks<F>(taskCount,func);
       }
 
-    static uint8_t maxThreads();
+    // Schedules func to be executed, once all of dependencies are complete. Safe to call from within a job.
+    template<class F, class R = std::invoke_result_t<F>>
+    static auto async(F&& func, std::initializer_list<Task> deps = {}) -> std::conditional_t<std::is_void_v<R>, Task, Future<R>> {
+      auto job = std::make_shared<Job>();
+      if constexpr(std::is_void_v<R>) {
+        job->func = std::forward<F>(func);
+        Task ret;
+        ret.job = job;
+        inst().submit(std::move(job),deps);
+        return ret;
+        } else {
+        Future<R> ret;
+        ret.job   = job;
+        ret.value = std::make_shared<R>();
+        job->func = [func = std::forward<F>(func), value = ret.value]() mutable { *value = func(); };
+        inst().submit(std::move(job),deps);
+        return ret;
+        }
+      }
+
+    static uint8_t  maxThreads();
+    static uint32_t threadCount();
 
   private:
-    enum { MAX_THREADS=16 };
+    struct Job {
+      std::function<void()>             func;
+      std::atomic<uint32_t>             deps{1};
+      std::atomic<bool>                 claimed{false};
+      std::atomic<bool>                 done{false};
+      std::mutex                        sync;
+      std::vector<std::shared_ptr<Job>> next;
+      std::vector<std::shared_ptr<Job>> prev; // unfinished dependencies, for waiter to help with
+      };
+
+    // mutex-protected work-stealing deque: owner works LIFO on back, thieves take FIFO from front
+    struct alignas(64) Queue {
+      std::mutex                        sync;
+      std::deque<std::shared_ptr<Job>>  jobs;
+      };
 
     void            threadFunc(size_t id);
-    void            execWork(uint32_t& minWorkSize);
-    uint32_t        taskLoop();
+    void            submit(std::shared_ptr<Job> job, std::initializer_list<Task> deps);
+    void            schedule(std::shared_ptr<Job> job);
+    bool            runOne();
+    bool            help(Job& job);
+    void            execute(Job& job);
+    void            wait(Job& job);
+    auto            pop(Queue& q, bool back) -> std::shared_ptr<Job>;
+    void            execParallel(size_t taskCount, const std::function<void()>& body);
     static Workers& inst();
 
     template<class T,class F>
-    static uint32_t&  minWorkSize() {
-      static uint32_t data = 0;
-      return data;
-      }
-
-
-    template<class T,class F>
-    void runParallelFor(T* data, size_t sz, const F& func) {
-      workSet     = reinterpret_cast<uint8_t*>(data);
-      workSize    = sz;
-      workEltSize = sizeof(T);
-
-      workFunc = [&func](void* data, size_t sz) {
-        T* tdata = reinterpret_cast<T*>(data);
-        for(size_t i=0;i<sz;++i)
-          func(tdata[i]);
+    void runParallelFor(T* data, size_t sz, size_t step, const F& func) {
+      if(sz==0)
+        return;
+      if(sz<=step || (step>1 && sz<=taskPerThread) || threads.empty()) {
+        for(size_t i=0; i<sz; ++i)
+          func(data[i]);
+        return;
+        }
+
+      std::atomic<size_t> progressIt{0};
+      auto body = [&]() {
+        while(true) {
+          size_t b = progressIt.fetch_add(step);
+          if(b>=sz)
+            break;
+          size_t e = std::min(b+step, sz);
+          for(size_t i=b; i<e; ++i)
+            func(data[i]);
+          }
         };
 
-      execWork(minWorkSize<T,F>());
+      const size_t taskCount = (step>1) ? (sz+taskPerThread-1)/taskPerThread : sz;
+      execParallel(taskCount, body);
       }
 
     template<class F>
     void runParallelTasks(size_t taskCount, const F& func) {
-      workSet     = nullptr;
-      workSize    = taskCount;
-      workEltSize = 1;
-
-      workFunc = [&func](void* data, size_t sz) {
-        func(reinterpret_cast<uintptr_t>(data));
+      if(taskCount==0)
+        return;
+      if(taskCount==1 || threads.empty()) {
+        for(size_t i=0; i<taskCount; ++i)
+          func(i);
+        return;
+        }
+
+      std::atomic<size_t> progressIt{0};
+      auto body = [&]() {
+        while(true) {
+          size_t id = progressIt.fetch_add(1);
+          if(id>=taskCount)
+            break;
+          func(id);
+          }
         };
-      execWork(minWorkSize<void,F>());
+      execParallel(taskCount, body);
       }
 
     static const size_t               taskPerThread;
     static const size_t               taskPerStep;
-    bool                              running=true;
+    std::atomic_bool                  running{true};
 
-    std::thread                       th[MAX_THREADS];
+    std::vector<std::thread>          threads;
+    std::unique_ptr<Queue[]>          queues;
+    Queue                             global;
+    std::atomic<uint32_t>             stealIt{0};
 
     std::mutex                        sync;
     std::condition_variable           workWait;
-    int32_t                           workTbd = 0;
-
-    uint8_t*                          workSet=nullptr;
-    size_t                            workSize=0, workEltSize=0;
-    std::function<void(void*,size_t)> workFunc;
-
-    std::atomic_int                   progressIt{0};
-    uint32_t                          taskCount = 0;
-    std::atomic_int                   taskDone{0};
+    std::atomic<int32_t>              queued{0};
+    std::atomic<int32_t>              sleeping{0};
   };
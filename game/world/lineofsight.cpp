@@ -0,0 +1,121 @@
+#include "lineofsight.h"
+
+#include "physics/dynamicworld.h"
+#include "world/objects/npc.h"
+#include "world.h"
+
+#include <functional>
+
+size_t LineOfSight::KeyHash::operator()(const Key& k) const {
+  const size_t ha = std::hash<const Npc*>()(k.a);
+  const size_t hb = std::hash<const Npc*>()(k.b);
+  return ha ^ (hb*size_t(0x9E3779B9)) ^ (size_t(k.t)<<1);
+  }
+
+LineOfSight::LineOfSight(World& owner):owner(owner) {
+  }
+
+void LineOfSight::reset() {
+  last = cur;
+  cur  = Stats();
+  invalidate();
+  }
+
+void LineOfSight::invalidate() {
+  cache.clear();
+  rays.clear();
+  pending = 0;
+  }
+
+LineOfSight::Key LineOfSight::mkKey(const Npc& a, const Npc& b, Target t) {
+  // ray goes from eyes of a to specific point of b, so order matters
+  Key k;
+  k.a = &a;
+  k.b = &b;
+  k.t = t;
+  return k;
+  }
+
+LineOfSight::Ray LineOfSight::mkRay(const Key& k, const Tempest::Vec3& from, const Tempest::Vec3& to) {
+  Ray r;
+  r.from = from;
+  r.to   = to;
+  r.posA = k.a->position();
+  r.posB = k.b->position();
+  return r;
+  }
+
+bool LineOfSight::isStale(const Ray& r, const Key& k) {
+  // npc's can move in between of perception calls within same tick
+  const float eps = 1.f;
+  return (k.a->position()-r.posA).quadLength()>eps*eps ||
+         (k.b->position()-r.posB).quadLength()>eps*eps;
+  }
+
+void LineOfSight::request(const Npc& a, const Npc& b, Target t, const Tempest::Vec3& from, const Tempest::Vec3& to) {
+  const Key k   = mkKey(a,b,t);
+  auto      ins = cache.try_emplace(k,rays.size());
+  if(!ins.second) {
+    if(!isStale(rays[ins.first->second],k))
+      return;
+    ins.first->second = rays.size();
+    }
+  rays.push_back(mkRay(k,from,to));
+  }
+
+void LineOfSight::flush() {
+  if(pending>=rays.size())
+    return;
+
+  const size_t count = rays.size()-pending;
+  segments.resize(count);
+  results .resize(count);
+  for(size_t i=0; i<count; ++i) {
+    segments[i].from = rays[pending+i].from;
+    segments[i].to   = rays[pending+i].to;
+    }
+  owner.physic()->rayBatch(segments,results);
+  for(size_t i=0; i<count; ++i)
+    rays[pending+i].visible = !results[i].hasCol;
+
+  cur.cast  += count;
+  stat.cast += count;
+  pending    = rays.size();
+  }
+
+bool LineOfSight::test(const Npc& a, const Npc& b, Target t, const Tempest::Vec3& from, const Tempest::Vec3& to) {
+  cur.requested++;
+  stat.requested++;
+
+  const Key k   = mkKey(a,b,t);
+  auto      ins = cache.try_emplace(k,rays.size());
+  if(!ins.second) {
+    if(!isStale(rays[ins.first->second],k)) {
+      auto& r = rays[ins.first->second];
+      if(r.uses>0) {
+        cur.deduplicated++;
+        stat.deduplicated++;
+        }
+      r.uses++;
+      if(ins.first->second>=pending)
+        flush();
+      return r.visible;
+      }
+    ins.first->second = rays.size();
+    }
+
+  // miss: cast right away, but keep result for rest of the tick
+  flush();
+  Ray r = mkRay(k,from,to);
+  r.visible = cast(from,to);
+  r.uses    = 1;
+  rays.push_back(r);
+  pending = rays.size();
+  return r.visible;
+  }
+
+bool LineOfSight::cast(const Tempest::Vec3& from, const Tempest::Vec3& to) {
+  cur.cast++;
+  stat.cast++;
+  return !owner.physic()->ray(from,to).hasCol;
+  }
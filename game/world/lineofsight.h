@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Tempest/Point>
+
+#include "physics/dynamicworld.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class World;
+class Npc;
+
+// Per-tick cache of npc-to-npc visibility rays.
+// Rays go from head of a to a point of b, so (a,b) and (b,a) are different entries for every target.
+// Cached result is dropped, if any of two npc's has moved since ray was cast.
+class LineOfSight final {
+  public:
+    explicit LineOfSight(World& owner);
+
+    // point on target npc, ray is cast to
+    enum Target : uint8_t {
+      T_Mid,
+      T_Center,
+      T_Head,
+      };
+
+    // requested: calls of test; deduplicated: tests, that reused ray of an earlier test
+    struct Stats final {
+      uint64_t requested    = 0;
+      uint64_t deduplicated = 0;
+      uint64_t cast         = 0;
+      };
+
+    // begin new tick: drops cached results
+    void         reset();
+    // npc has been removed from world: cached pointers are no longer valid
+    void         invalidate();
+
+    // enqueue ray for next flush; prefetch only, is not counted as a query
+    void         request(const Npc& a, const Npc& b, Target t, const Tempest::Vec3& from, const Tempest::Vec3& to);
+    // cast all enqueued rays in parallel; physics must not be modified concurrently
+    void         flush();
+    // cached result, or immediate ray on cache miss
+    bool         test(const Npc& a, const Npc& b, Target t, const Tempest::Vec3& from, const Tempest::Vec3& to);
+
+    const Stats& lastTick() const { return last;  }
+    const Stats& total()    const { return stat;  }
+
+  private:
+    struct Key final {
+      const Npc* a = nullptr;
+      const Npc* b = nullptr;
+      Target     t = T_Mid;
+      bool operator == (const Key& other) const { return a==other.a && b==other.b && t==other.t; }
+      };
+
+    struct KeyHash final {
+      size_t operator()(const Key& k) const;
+      };
+
+    struct Ray final {
+      Tempest::Vec3 from, to;
+      Tempest::Vec3 posA, posB; // npc positions of Key::a and Key::b at request time
+      bool          visible = false;
+      uint32_t      uses    = 0;  // number of tests, served by this ray
+      };
+
+    static Key   mkKey(const Npc& a, const Npc& b, Target t);
+    static Ray   mkRay(const Key& k, const Tempest::Vec3& from, const Tempest::Vec3& to);
+    static bool  isStale(const Ray& r, const Key& k);
+    bool         cast(const Tempest::Vec3& from, const Tempest::Vec3& to);
+
+    World&                                   owner;
+    std::unordered_map<Key,size_t,KeyHash>   cache;
+    std::vector<Ray>                         rays;
+    std::vector<DynamicWorld::RaySegment>    segments;
+    std::vector<DynamicWorld::RayLandResult> results;
+    size_t                                   pending = 0; // rays[pending..] are not cast yet
+    Stats                                    cur, last, stat;
+  };
@@ -203,8 +203,8 @@ void Interactive::setVisual(const zenkit::VirtualObject& vob) {
   setAnim(Interactive::Active); // setup default anim
   }
 
-void Interactive::updateAnimation(uint64_t dt) {
-  if(visual.updateAnimation(nullptr,world,dt))
+void Interactive::updateAnimation(uint64_t dt, Pose::LodTier lod) {
+  if(visual.updateAnimation(nullptr,world,dt,lod))
     animChanged = true;
   }
 
@@ -1039,8 +1039,14 @@ float Interactive::extendedSearchRadius() const {
   float x = bbox[1].x-bbox[0].x;
   float y = bbox[1].y-bbox[0].y;
   float z = bbox[1].z-bbox[0].z;
+  float r = std::max(x,std::max(y,z));
 
-  return std::max(x,std::max(y,z));
+  // npc distance is measured to nearest attach point (or display position): they can stick out of bbox
+  r = std::max(r,displayOffset.length());
+  for(auto& i:attPos)
+    if(i.isAttachPoint())
+      r = std::max(r,(worldPos(i)-position()).length());
+  return r;
   }
 
 std::string_view Interactive::Pos::posTag() const {
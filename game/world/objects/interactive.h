@@ -33,7 +33,7 @@ class Interactive : public Vob {
     void                postValidate();
 
     void                resetPositionToTA(int32_t state);
-    void                updateAnimation(uint64_t dt);
+    void                updateAnimation(uint64_t dt, Pose::LodTier lod = Pose::LodFull);
     void                tick(uint64_t dt);
     void                onKeyInput(KeyCodec::Action act);
 
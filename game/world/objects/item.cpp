@@ -139,12 +139,12 @@ void Item::setAsEquipped(bool e) {
 
 void Item::setPhysicsEnable(World& world) {
   setPhysicsEnable(view);
-  world.invalidateVobIndex();
+  world.invalidateVobIndex(*this);
   }
 
 void Item::setPhysicsDisable() {
   physic = DynamicWorld::Item();
-  world.invalidateVobIndex();
+  world.invalidateVobIndex(*this);
   }
 
 void Item::setPhysicsEnable(const MeshObjects::Mesh& view) {
@@ -169,6 +169,12 @@ bool Item::isDynamic() const {
   return !physic.isEmpty();
   }
 
+float Item::extendedSearchRadius() const {
+  // distance from position() to midPosition()
+  auto b = view.bounds();
+  return ((b.bbox[1]-b.bbox[0])*0.5f).length();
+  }
+
 std::string_view Item::displayName() const {
   return hitem->name;
   }
@@ -325,5 +331,5 @@ void Item::moveEvent() {
   view  .setObjMatrix(transform());
   physic.setObjMatrix(transform());
   if(!isDynamic())
-    world.invalidateVobIndex();
+    world.invalidateVobIndex(*this);
   }
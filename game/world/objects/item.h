@@ -44,6 +44,7 @@ class Item : public Vob {
     void    setPhysicsEnable (World& w);
     void    setPhysicsDisable();
     bool    isDynamic() const override;
+    float   extendedSearchRadius() const override;
 
     uint8_t slot() const       { return itSlot;  }
     void    setSlot(uint8_t s) { itSlot = s;     }
@@ -370,6 +370,7 @@ bool Npc::setPosition(float ix, float iy, float iz) {
   z = iz;
   durtyTranform |= TR_Pos;
   physic.setPosition(Vec3{x,y,z});
+  owner.invalidateNpcIndex(*this);
   return true;
   }
 
@@ -382,6 +383,7 @@ void Npc::setViewPosition(const Tempest::Vec3& pos) {
   y = pos.y;
   z = pos.z;
   durtyTranform |= TR_Pos;
+  owner.invalidateNpcIndex(*this);
   }
 
 int Npc::aiOutputOrderId() const {
@@ -1932,6 +1934,27 @@ void Npc::takeDrownDamage() {
   changeAttribute(Attribute::ATR_HITPOINTS, -attribute(Attribute::ATR_HITPOINTSMAX), false);
   }
 
+void Npc::prefetchPerception(const Npc& pl) const {
+  // enqueue visibility rays, that perceptionProcess is about to test
+  if(processPolicy()!=Npc::AiNormal)
+    return;
+  if(hasPerc(PERC_ASSESSPLAYER))
+    requestSenseNpc(pl,false);
+
+  const bool enemy = hasPerc(PERC_ASSESSENEMY);
+  const bool body  = hasPerc(PERC_ASSESSBODY);
+  if(!enemy && !body)
+    return;
+  owner.detectNpcNear([this,enemy,body](Npc& n){
+    if(&n==this)
+      return;
+    if(enemy && !n.isDown() && isEnemy(n))
+      requestSenseNpc(n,true);
+    else if(body && n.isDead())
+      requestSenseNpc(n,true);
+    });
+  }
+
 Npc *Npc::updateNearestEnemy() {
   if(aiPolicy!=ProcessPolicy::AiNormal)
     return nullptr;
@@ -2166,6 +2189,14 @@ void Npc::tick(uint64_t dt) {
   implAiTick(dt);
   }
 
+size_t Npc::prefetchTick(uint64_t dt) {
+  return mvAlgo.prefetch(dt);
+  }
+
+size_t Npc::takePrefetchHits() {
+  return mvAlgo.takePrefetchHits();
+  }
+
 void Npc::nextAiAction(AiQueue& queue, uint64_t dt) {
   if(isInAir())
     return;
@@ -4182,10 +4213,10 @@ void Npc::stopWalking() {
 
 bool Npc::canSeeNpc(const Npc &oth, bool freeLos) const {
   const auto mid = oth.bounds().midTr;
-  if(canSeeNpc(mid,freeLos))
+  if(canRayHitNpc(oth,LineOfSight::T_Mid,mid,freeLos))
     return true;
   const auto ppos = oth.physic.position();
-  if(oth.isDown() && canSeeNpc(ppos,freeLos)) {
+  if(oth.isDown() && canRayHitNpc(oth,LineOfSight::T_Center,ppos,freeLos)) {
     // mid of dead npc may endedup inside a wall; extra check for physical center
     return true;
     }
@@ -4194,7 +4225,7 @@ bool Npc::canSeeNpc(const Npc &oth, bool freeLos) const {
   if(oth.visual.visualSkeleton()->BIP01_HEAD==size_t(-1))
     return false;
   auto head = oth.visual.mapHeadBone();
-  if(canSeeNpc(head,freeLos))
+  if(canRayHitNpc(oth,LineOfSight::T_Head,head,freeLos))
     return true;
   return false;
   }
@@ -4214,26 +4245,43 @@ bool Npc::canSeeNpc(const Vec3 pos, bool freeLos) const {
   }
 
 bool Npc::canRayHitPoint(const Tempest::Vec3 pos, bool freeLos, float extRange) const {
+  if(!isInSight(pos,freeLos,extRange))
+    return false;
+  // npc eyesight height
+  auto head = visual.mapHeadBone();
+  return !owner.physic()->ray(head, pos).hasCol;
+  }
+
+bool Npc::canRayHitNpc(const Npc& oth, LineOfSight::Target t, const Tempest::Vec3 pos, bool freeLos, float extRange) const {
+  if(!isInSight(pos,freeLos,extRange))
+    return false;
+  auto head = visual.mapHeadBone();
+  return owner.lineOfSight().test(*this,oth,t,head,pos);
+  }
+
+bool Npc::isInSight(const Tempest::Vec3 pos, bool freeLos, float extRange) const {
   const float range = float(hnpc->senses_range) + extRange;
   if(qDistTo(pos)>range*range)
     return false;
+  if(freeLos)
+    return true;
 
   static const double ref = std::cos(100*M_PI/180.0); // spec requires +-100 view angle range
-  const DynamicWorld* w   = owner.physic();
-  // npc eyesight height
-  auto head = visual.mapHeadBone();
-  if(freeLos) {
-    return !w->ray(head, pos).hasCol;
-    }
-
   float dx  = x-pos.x, dz=z-pos.z;
   float dir = angleDir(dx,dz);
   float da  = float(M_PI)*(visual.viewDirection()-dir)/180.f;
-  if(double(std::cos(da))<=ref) {
-    if(!w->ray(head, pos).hasCol)
-      return true;
-    }
-  return false;
+  return double(std::cos(da))<=ref;
+  }
+
+void Npc::requestSenseNpc(const Npc& oth, bool freeLos) const {
+  // same conditions as canSenseNpc, but only enqueues the ray
+  if((hnpc->senses & int32_t(SensesBit::SENSE_SEE))==0)
+    return;
+  const auto mid = oth.bounds().midTr;
+  if(!isInSight(mid,freeLos,0))
+    return;
+  auto head = visual.mapHeadBone();
+  owner.lineOfSight().request(*this,oth,LineOfSight::T_Mid,head,mid);
   }
 
 SensesBit Npc::canSenseNpc(const Npc &oth, bool freeLos, float extRange) const {
@@ -4242,10 +4290,14 @@ SensesBit Npc::canSenseNpc(const Npc &oth, bool freeLos, float extRange) const {
   // NOTE1: https://github.com/Try/OpenGothic/pull/589#issuecomment-2045897394
   // NOTE2: interacting with chest(lockpicking) or some MOBSI should not produce 'noise'
   const bool isNoisy = (st!=BodyState::BS_SNEAK && st!=BS_MOBINTERACT && oth.isPlayer());
-  return canSenseNpc(mid,freeLos,isNoisy,extRange);
+  return implSenseNpc(&oth,mid,freeLos,isNoisy,extRange);
   }
 
 SensesBit Npc::canSenseNpc(const Tempest::Vec3 pos, bool freeLos, bool isNoisy, float extRange) const {
+  return implSenseNpc(nullptr,pos,freeLos,isNoisy,extRange);
+  }
+
+SensesBit Npc::implSenseNpc(const Npc* oth, const Tempest::Vec3 pos, bool freeLos, bool isNoisy, float extRange) const {
   const float range = float(hnpc->senses_range)+extRange;
   if(qDistTo(pos)>range*range)
     return SensesBit::SENSE_NONE;
@@ -4257,8 +4309,12 @@ SensesBit Npc::canSenseNpc(const Tempest::Vec3 pos, bool freeLos, bool isNoisy,
     ret = ret | SensesBit::SENSE_HEAR;
     }
 
-  if((hnpc->senses & int32_t(SensesBit::SENSE_SEE))!=0 && canRayHitPoint(pos, freeLos, extRange)) {
-    ret = ret | SensesBit::SENSE_SEE;
+  if((hnpc->senses & int32_t(SensesBit::SENSE_SEE))!=0) {
+    // npc-to-npc rays go through per-tick cache
+    const bool see = (oth!=nullptr) ? canRayHitNpc(*oth,LineOfSight::T_Mid,pos,freeLos,extRange)
+                                    : canRayHitPoint(pos,freeLos,extRange);
+    if(see)
+      ret = ret | SensesBit::SENSE_SEE;
     }
 
   return ret & SensesBit(hnpc->senses);
@@ -4346,7 +4402,7 @@ void Npc::updateTransform() {
   updateAnimation(0);
   }
 
-void Npc::updateAnimation(uint64_t dt) {
+void Npc::updateAnimation(uint64_t dt, Pose::LodTier lod) {
   const auto camera = Gothic::inst().camera();
   if(isPlayer() && camera!=nullptr && camera->isFree())
     dt = 0;
@@ -4379,7 +4435,7 @@ void Npc::updateAnimation(uint64_t dt) {
     durtyTranform = 0;
     }
 
-  bool syncAtt = visual.updateAnimation(this,owner,dt);
+  bool syncAtt = visual.updateAnimation(this,owner,dt,lod);
   if(syncAtt)
     visual.syncAttaches();
   }
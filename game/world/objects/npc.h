@@ -12,6 +12,7 @@
 #include "physics/dynamicworld.h"
 #include "world/aiqueue.h"
 #include "world/fplock.h"
+#include "world/lineofsight.h"
 #include "world/waypath.h"
 
 #include <cstdint>
@@ -112,6 +113,10 @@ class Npc final {
     void       setWalkMode(WalkBit m);
     auto       walkMode() const { return wlkMode; }
     void       tick(uint64_t dt);
+    // read-only part of tick, safe to run in parallel for many npc's; returns number of rays cast
+    size_t     prefetchTick(uint64_t dt);
+    size_t     takePrefetchHits();
+    void       prefetchPerception(const Npc& pl) const;
     void       tickAnimationTags();
     bool       startClimb(JumpStatus jump);
 
@@ -130,7 +135,7 @@ class Npc final {
     float      qDistTo(const Interactive& p) const;
     float      qDistTo(const Item& p) const;
 
-    void       updateAnimation(uint64_t dt);
+    void       updateAnimation(uint64_t dt, Pose::LodTier lod = Pose::LodFull);
     void       updateTransform();
 
     std::string_view displayName() const;
@@ -491,6 +496,10 @@ class Npc final {
     void      commitDamage();
     Npc*      updateNearestEnemy();
     Npc*      updateNearestBody();
+    bool      isInSight(const Tempest::Vec3 pos, bool freeLos, float extRange) const;
+    bool      canRayHitNpc(const Npc& oth, LineOfSight::Target t, const Tempest::Vec3 pos, bool freeLos, float extRange=0.f) const;
+    void      requestSenseNpc(const Npc& oth, bool freeLos) const;
+    auto      implSenseNpc(const Npc* oth, const Tempest::Vec3 pos, bool freeLos, bool isNoisy, float extRange) const -> SensesBit;
     bool      checkHealth(bool onChange, bool forceKill);
     void      onNoHealth(bool death, HitSound sndMask);
     bool      hasAutoroll() const;
@@ -20,11 +20,17 @@ PfxEmitter::PfxEmitter(World& world, std::string_view name)
   :PfxEmitter(world,Gothic::inst().loadParticleFx(name)) {
   }
 
-PfxEmitter::PfxEmitter(World& world, const ParticleFx* decl)
-  :PfxEmitter(world.view()->pfxGroup,decl) {
+PfxEmitter::PfxEmitter(World& world, const ParticleFx* decl) {
+  // no view in headless mode
+  if(auto wview = world.view())
+    init(wview->pfxGroup,decl);
   }
 
 PfxEmitter::PfxEmitter(PfxObjects& owner, const ParticleFx* decl) {
+  init(owner,decl);
+  }
+
+void PfxEmitter::init(PfxObjects& owner, const ParticleFx* decl) {
   if(decl==nullptr || (decl->visMaterial.tex==nullptr && !decl->hasTrails()))
     return;
   std::lock_guard<std::recursive_mutex> guard(owner.sync);
@@ -35,6 +41,8 @@ PfxEmitter::PfxEmitter(PfxObjects& owner, const ParticleFx* decl) {
   }
 
 PfxEmitter::PfxEmitter(World& world, const zenkit::VirtualObject& vob) {
+  if(world.view()==nullptr)
+    return;
   auto& owner = world.view()->pfxGroup;
   if(FileExt::hasExt(vob.visual->name,"PFX")) {
     auto decl = Gothic::inst().loadParticleFx(vob.visual->name);
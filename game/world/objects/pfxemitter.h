@@ -45,6 +45,7 @@ class PfxEmitter {
 
   private:
     PfxEmitter(PfxBucket &b,size_t id);
+    void     init(PfxObjects& owner, const ParticleFx* decl);
 
     PfxBucket* bucket = nullptr;
     size_t     id     = size_t(-1);
@@ -2,131 +2,373 @@
 
 #include "world/objects/vob.h"
 
+#include <cmath>
+
+static const float CellSize = 1000.f;
+
+static uint64_t cellKey(int32_t x, int32_t z) {
+  return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(z));
+  }
+
+static int32_t cellCoord(float v) {
+  return int32_t(std::clamp(std::floor(v/CellSize), -1e6f, 1e6f));
+  }
+
+static int32_t cellX(uint64_t key) {
+  return int32_t(uint32_t(key >> 32));
+  }
+
+static int32_t cellZ(uint64_t key) {
+  return int32_t(uint32_t(key & 0xFFFFFFFF));
+  }
+
 void BaseSpaceIndex::clear() {
   arr.clear();
-  index.clear();
+  slots.clear();
+  slotId.clear();
+  grid.clear();
   dynamic.clear();
+  maxRadius = 0;
+  dirty     = false;
   }
 
 void BaseSpaceIndex::invalidate() {
-  index.clear();
+  grid.clear();
   dynamic.clear();
+  dirty = true;
   }
 
 void BaseSpaceIndex::add(Vob* v) {
+  if(slotId.find(v)!=slotId.end())
+    return;
+  const uint32_t id = uint32_t(arr.size());
   arr.push_back(v);
-  index.reserve(arr.size());
-  index.clear();
-  dynamic.clear();
+  slots.emplace_back();
+  slotId[v] = id;
+  if(!dirty)
+    bin(id);
   }
 
 void BaseSpaceIndex::del(Vob* v) {
-  for(size_t i=0;i<arr.size();++i) {
-    if(arr[i]==v) {
-      arr[i] = arr.back();
-      arr.pop_back();
-      index.clear();
-      dynamic.clear();
-      return;
+  auto it = slotId.find(v);
+  if(it==slotId.end())
+    return;
+
+  const uint32_t id = it->second;
+  if(!dirty)
+    unbin(id);
+  slotId.erase(it);
+
+  const uint32_t last = uint32_t(arr.size()-1);
+  if(id!=last) {
+    arr  [id] = arr  [last];
+    slots[id] = slots[last];
+    rebind(id);
+    }
+  arr.pop_back();
+  slots.pop_back();
+  }
+
+bool BaseSpaceIndex::update(Vob* v) {
+  auto it = slotId.find(v);
+  if(it==slotId.end())
+    return false;
+  if(dirty)
+    return true;
+
+  const uint32_t id = it->second;
+  auto&          s  = slots[id];
+  if(!s.dynamic && !v->isDynamic()) {
+    auto pos = v->position();
+    if(cellKey(cellCoord(pos.x),cellCoord(pos.z))==s.cell) {
+      // same cell - just refresh cached bounds
+      s.pos     = pos;
+      s.radius  = v->extendedSearchRadius();
+      maxRadius = std::max(maxRadius,s.radius);
+      return true;
       }
     }
+  unbin(id);
+  bin(id);
+  return true;
   }
 
 bool BaseSpaceIndex::hasObject(const Vob* v) const {
   if(v==nullptr)
     return false;
-  for(size_t i=0;i<arr.size();++i)
-    if(arr[i]==v)
-      return true;
-  return false;
+  return slotId.find(v)!=slotId.end();
   }
 
-void BaseSpaceIndex::find(const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, Vob*)) {
-  if(index.size()==0)
-    buildIndex();
-  for(auto& i:dynamic)
-    (*func)(ctx,i);
-  implFind(index.data(),index.size(),0,p,R,ctx,func);
+void BaseSpaceIndex::find(const Query* q, size_t count, const void* ctx, void (*func)(const void*, size_t, Vob*)) {
+  if(dirty)
+    rebuild();
+
+  // dynamic objects are moved by physics: test them with actual position
+  for(auto id:dynamic) {
+    Vob*        v   = arr[id];
+    const auto  pos = v->position();
+    const float r   = v->extendedSearchRadius();
+    for(size_t i=0; i<count; ++i) {
+      const float R = q[i].R+r;
+      if((pos-q[i].pos).quadLength()<=R*R)
+        func(ctx,i,v);
+      }
+    }
+
+  if(grid.empty())
+    return;
+
+  if(count==1) {
+    const uint32_t qId = 0;
+    const float    ext = q[0].R+maxRadius;
+    const int32_t  x0  = cellCoord(q[0].pos.x-ext), x1 = cellCoord(q[0].pos.x+ext);
+    const int32_t  z0  = cellCoord(q[0].pos.z-ext), z1 = cellCoord(q[0].pos.z+ext);
+    if(int64_t(x1-x0+1)*int64_t(z1-z0+1) > int64_t(grid.size())) {
+      // query is larger than occupied area
+      for(auto& c:grid)
+        testCell(c.first,q,&qId,1,ctx,func);
+      return;
+      }
+    for(int32_t x=x0; x<=x1; ++x)
+      for(int32_t z=z0; z<=z1; ++z)
+        testCell(cellKey(x,z),q,&qId,1,ctx,func);
+    return;
+    }
+
+  // batch: group queries by cell, so each cell is looked up once
+  std::vector<std::pair<uint64_t,uint32_t>> cellQ;
+  for(size_t i=0; i<count; ++i) {
+    const float   ext = q[i].R+maxRadius;
+    const int32_t x0  = cellCoord(q[i].pos.x-ext), x1 = cellCoord(q[i].pos.x+ext);
+    const int32_t z0  = cellCoord(q[i].pos.z-ext), z1 = cellCoord(q[i].pos.z+ext);
+    if(int64_t(x1-x0+1)*int64_t(z1-z0+1) > int64_t(grid.size())) {
+      for(auto& c:grid)
+        cellQ.emplace_back(c.first,uint32_t(i));
+      continue;
+      }
+    for(int32_t x=x0; x<=x1; ++x)
+      for(int32_t z=z0; z<=z1; ++z)
+        cellQ.emplace_back(cellKey(x,z),uint32_t(i));
+    }
+  std::sort(cellQ.begin(),cellQ.end());
+
+  std::vector<uint32_t> qId;
+  for(size_t i=0; i<cellQ.size();) {
+    const uint64_t key = cellQ[i].first;
+    qId.clear();
+    for(; i<cellQ.size() && cellQ[i].first==key; ++i)
+      qId.push_back(cellQ[i].second);
+    testCell(key,q,qId.data(),qId.size(),ctx,func);
+    }
   }
 
-void BaseSpaceIndex::buildIndex() {
-  size_t cnt = 0;
-  index.resize(arr.size());
-  dynamic.clear();
-  for(size_t i=0; i<arr.size(); ++i) {
-    if(arr[i]->isDynamic()) {
-      dynamic.push_back(arr[i]);
-      } else {
-      index[cnt] = arr[i];
-      ++cnt;
+void BaseSpaceIndex::testCell(uint64_t key, const Query* q, const uint32_t* qId, size_t qCount,
+                              const void* ctx, void (*func)(const void*, size_t, Vob*)) {
+  auto it = grid.find(key);
+  if(it==grid.end())
+    return;
+  for(auto id:it->second) {
+    auto& s = slots[id];
+    for(size_t i=0; i<qCount; ++i) {
+      auto&       qi = q[qId[i]];
+      const float R  = qi.R+s.radius;
+      if((s.pos-qi.pos).quadLength()<=R*R)
+        func(ctx,qId[i],arr[id]);
       }
     }
-  index.resize(cnt);
-  buildIndex(index.data(),index.size(),0);
   }
 
-void BaseSpaceIndex::buildIndex(Vob** v, size_t cnt, uint8_t depth) {
-  depth%=3;
-  sort(v,cnt,depth);
-  size_t mid = cnt/2;
-  if(mid>0) {
-    // [0..mid)
-    buildIndex(v,mid,uint8_t(depth+1u));
+void BaseSpaceIndex::rebuild() {
+  grid.clear();
+  dynamic.clear();
+  maxRadius = 0;
+  dirty     = false;
+  for(uint32_t i=0; i<arr.size(); ++i)
+    bin(i);
+  }
+
+void BaseSpaceIndex::bin(uint32_t id) {
+  Vob*  v = arr[id];
+  auto& s = slots[id];
+  s.dynamic = v->isDynamic();
+  if(s.dynamic) {
+    s.cellPos = uint32_t(dynamic.size());
+    dynamic.push_back(id);
+    return;
     }
-  if(mid+1<cnt) {
-    // (mid..cnt)
-    buildIndex(v+mid+1,cnt-mid-1,uint8_t(depth+1u));
+  s.pos     = v->position();
+  s.radius  = v->extendedSearchRadius();
+  s.cell    = cellKey(cellCoord(s.pos.x),cellCoord(s.pos.z));
+  maxRadius = std::max(maxRadius,s.radius);
+
+  auto& cell = grid[s.cell];
+  s.cellPos = uint32_t(cell.size());
+  cell.push_back(id);
+  }
+
+void BaseSpaceIndex::unbin(uint32_t id) {
+  auto& s    = slots[id];
+  auto& list = s.dynamic ? dynamic : grid[s.cell];
+
+  const uint32_t moved = list.back();
+  list[s.cellPos] = moved;
+  slots[moved].cellPos = s.cellPos;
+  list.pop_back();
+
+  if(!s.dynamic && list.empty())
+    grid.erase(s.cell);
+  }
+
+void BaseSpaceIndex::rebind(uint32_t id) {
+  // slot was moved to position 'id': patch references to it
+  auto& s = slots[id];
+  slotId[arr[id]] = id;
+  if(dirty)
+    return;
+  if(s.dynamic)
+    dynamic[s.cellPos] = id; else
+    grid[s.cell][s.cellPos] = id;
+  }
+
+
+void BasePointIndex::clear() {
+  slots.clear();
+  slotId.clear();
+  grid.clear();
+  }
+
+void BasePointIndex::add(void* v, const Tempest::Vec3& pos) {
+  if(slotId.find(v)!=slotId.end())
+    return;
+  const uint32_t id = uint32_t(slots.size());
+  slots.emplace_back();
+  slots[id].obj = v;
+  slots[id].pos = pos;
+  slotId[v] = id;
+  bin(id);
+  }
+
+void BasePointIndex::del(const void* v) {
+  auto it = slotId.find(v);
+  if(it==slotId.end())
+    return;
+
+  const uint32_t id = it->second;
+  unbin(id);
+  slotId.erase(it);
+
+  const uint32_t last = uint32_t(slots.size()-1);
+  if(id!=last) {
+    slots[id] = slots[last];
+    slotId[slots[id].obj] = id;
+    grid[slots[id].cell][slots[id].cellPos] = id;
     }
+  slots.pop_back();
   }
 
-void BaseSpaceIndex::sort(Vob** v, size_t cnt, uint8_t component) {
-  bool (*predicate)(const Vob* a, const Vob* b) = nullptr;
-  switch(component) {
-    case 0:
-      predicate = [](const Vob* a, const Vob* b){ return a->position().x < b->position().x; };
-      break;
-    case 1:
-      predicate = [](const Vob* a, const Vob* b){ return a->position().y < b->position().y; };
-      break;
-    case 2:
-      predicate = [](const Vob* a, const Vob* b){ return a->position().z < b->position().z; };
-      break;
+bool BasePointIndex::update(const void* v, const Tempest::Vec3& pos) {
+  auto it = slotId.find(v);
+  if(it==slotId.end())
+    return false;
+
+  const uint32_t id = it->second;
+  auto&          s  = slots[id];
+  s.pos = pos;
+  if(cellKey(cellCoord(pos.x),cellCoord(pos.z))!=s.cell) {
+    unbin(id);
+    bin(id);
     }
-  std::sort(v,v+cnt,predicate);
+  return true;
+  }
+
+bool BasePointIndex::hasObject(const void* v) const {
+  if(v==nullptr)
+    return false;
+  return slotId.find(v)!=slotId.end();
   }
 
-void BaseSpaceIndex::implFind(Vob** v, size_t cnt, uint8_t depth,
-                              const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, Vob*)) {
-  if(cnt==0)
+void BasePointIndex::find(const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, void*)) {
+  if(grid.empty() || R<=0)
     return;
 
-  auto mid = cnt/2;
-  auto pos = v[mid]->position();
-  auto qR  = (R+675.0);//v[mid]->extendedSearchRadius());
+  const int32_t x0 = cellCoord(p.x-R), x1 = cellCoord(p.x+R);
+  const int32_t z0 = cellCoord(p.z-R), z1 = cellCoord(p.z+R);
+  if(int64_t(x1-x0+1)*int64_t(z1-z0+1) > int64_t(grid.size())) {
+    // query is larger than occupied area
+    for(auto& c:grid)
+      testCell(c.second,p,R,ctx,func);
+    return;
+    }
 
-  if((pos-p).quadLength()<=qR*qR) {
-    func(ctx,v[mid]);
+  for(int32_t x=x0; x<=x1; ++x)
+    for(int32_t z=z0; z<=z1; ++z) {
+      auto it = grid.find(cellKey(x,z));
+      if(it!=grid.end())
+        testCell(it->second,p,R,ctx,func);
+      }
+  }
+
+void BasePointIndex::sweep(const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, void*, float)) {
+  if(grid.empty() || R<=0)
+    return;
+
+  const int32_t x0 = cellCoord(p.x-R), x1 = cellCoord(p.x+R);
+  const int32_t z0 = cellCoord(p.z-R), z1 = cellCoord(p.z+R);
+  if(int64_t(x1-x0+1)*int64_t(z1-z0+1) > int64_t(grid.size())) {
+    // query is larger than occupied area
+    for(auto& c:grid)
+      sweepCell(c.first,c.second,p,R,ctx,func);
+    return;
     }
 
-  depth%=3;
-  switch(depth) {
-    case 0:
-      if(p.x-qR<=pos.x)
-        implFind(v,mid,uint8_t(depth+1u),p,R, ctx,func);
-      if(p.x+qR>=pos.x)
-        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R, ctx,func);
-      break;
-    case 1:
-      if(p.y-qR<=pos.y)
-        implFind(v,mid,uint8_t(depth+1u),p,R, ctx,func);
-      if(p.y+qR>=pos.y)
-        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R, ctx,func);
-      break;
-    case 2:
-      if(p.z-qR<=pos.z)
-        implFind(v,mid,uint8_t(depth+1u),p,R, ctx,func);
-      if(p.z+qR>=pos.z)
-        implFind(v+mid+1,cnt-mid-1,uint8_t(depth+1u),p,R, ctx,func);
-      break;
+  for(int32_t x=x0; x<=x1; ++x)
+    for(int32_t z=z0; z<=z1; ++z) {
+      auto it = grid.find(cellKey(x,z));
+      if(it!=grid.end())
+        sweepCell(it->first,it->second,p,R,ctx,func);
+      }
+  }
+
+void BasePointIndex::sweepCell(uint64_t key, const std::vector<uint32_t>& cell, const Tempest::Vec3& p, float R,
+                               const void* ctx, void (*func)(const void*, void*, float)) {
+  // distance from p to cell rectangle on XZ plane: lower bound for distance to any object in cell
+  const float cx = float(cellX(key))*CellSize;
+  const float cz = float(cellZ(key))*CellSize;
+  const float dx = std::max({cx-p.x, p.x-(cx+CellSize), 0.f});
+  const float dz = std::max({cz-p.z, p.z-(cz+CellSize), 0.f});
+  if(dx*dx+dz*dz>=R*R)
+    return;
+  for(auto id:cell)
+    func(ctx,slots[id].obj,(slots[id].pos-p).quadLength());
+  }
+
+void BasePointIndex::testCell(const std::vector<uint32_t>& cell, const Tempest::Vec3& p, float R,
+                              const void* ctx, void (*func)(const void*, void*)) {
+  const float qR = R*R;
+  for(auto id:cell) {
+    auto& s = slots[id];
+    if((s.pos-p).quadLength()<qR)
+      func(ctx,s.obj);
     }
   }
+
+void BasePointIndex::bin(uint32_t id) {
+  auto& s    = slots[id];
+  s.cell     = cellKey(cellCoord(s.pos.x),cellCoord(s.pos.z));
+  auto& cell = grid[s.cell];
+  s.cellPos  = uint32_t(cell.size());
+  cell.push_back(id);
+  }
+
+void BasePointIndex::unbin(uint32_t id) {
+  auto& s    = slots[id];
+  auto& list = grid[s.cell];
+
+  const uint32_t moved = list.back();
+  list[s.cellPos] = moved;
+  slots[moved].cellPos = s.cellPos;
+  list.pop_back();
+
+  if(list.empty())
+    grid.erase(s.cell);
+  }
@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <array>
 #include <memory>
+#include <limits>
+#include <unordered_map>
 #include <Tempest/Point>
 
 #include "utils/workers.h"
@@ -13,6 +15,11 @@ class Vob;
 
 class BaseSpaceIndex {
   public:
+    struct Query final {
+      Tempest::Vec3 pos;
+      float         R = 0;
+      };
+
     void   clear();
     size_t size() const { return arr.size(); }
     void   invalidate();
@@ -21,23 +28,38 @@ class BaseSpaceIndex {
     BaseSpaceIndex() = default;
     void               add(Vob* v);
     void               del(Vob* v);
+    bool               update(Vob* v);
     bool               hasObject(const Vob* v) const;
 
-    void               find(const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, Vob*));
+    void               find(const Query* q, size_t count, const void* ctx, void (*func)(const void*, size_t, Vob*));
     template<class Func>
     void               parallelFor(Func f);
     Vob**              data() { return arr.data(); }
     Vob*const*         data() const { return arr.data(); }
 
   private:
-    std::vector<Vob*>  arr;
-    std::vector<Vob*>  index;
-    std::vector<Vob*>  dynamic;
-
-    void               buildIndex();
-    void               buildIndex(Vob** v, size_t cnt, uint8_t depth);
-    void               sort(Vob** v, size_t cnt, uint8_t component);
-    void               implFind(Vob** v, size_t cnt, uint8_t depth, const Tempest::Vec3& p, float R, const void* ctx, void(*func)(const void*, Vob*));
+    // loose uniform grid on XZ plane: object is stored in a cell of it's position, queries are extended by max radius
+    struct Slot final {
+      Tempest::Vec3 pos;
+      float         radius  = 0;
+      uint64_t      cell    = 0;
+      uint32_t      cellPos = 0;
+      bool          dynamic = false;
+      };
+
+    std::vector<Vob*>                                  arr;
+    std::vector<Slot>                                  slots;
+    std::unordered_map<const Vob*,uint32_t>            slotId;
+    std::unordered_map<uint64_t,std::vector<uint32_t>> grid;
+    std::vector<uint32_t>                              dynamic;
+    float                                              maxRadius = 0;
+    bool                                               dirty     = false;
+
+    void               rebuild();
+    void               bin(uint32_t id);
+    void               unbin(uint32_t id);
+    void               rebind(uint32_t id);
+    void               testCell(uint64_t key, const Query* q, const uint32_t* qId, size_t qCount, const void* ctx, void (*func)(const void*, size_t, Vob*));
   };
 
 template<class Func>
@@ -59,6 +81,11 @@ class SpaceIndex final : public BaseSpaceIndex {
       BaseSpaceIndex::del(v);
       }
 
+    // object has moved or changed it's dynamic state; returns false, if object is not in this index
+    bool update(Vob* v) {
+      return BaseSpaceIndex::update(v);
+      }
+
     bool hasObject(const T* v) const {
       return BaseSpaceIndex::hasObject(v);
       }
@@ -69,17 +96,106 @@ class SpaceIndex final : public BaseSpaceIndex {
     T*const*  begin() const  { return reinterpret_cast<T*const*>(data()); }
     T*const*  end()   const  { return begin()+size();                     }
 
+    // calls f(obj) for every object within distance R + obj.extendedSearchRadius() from p
     template<class Func>
     void find(const Tempest::Vec3& p, float R, const Func& f) {
-      return BaseSpaceIndex::find(p,R,&f,[](const void* ctx, Vob* v){
+      const Query q = {p,R};
+      return BaseSpaceIndex::find(&q,1,&f,[](const void* ctx, size_t, Vob* v){
         auto& f = *reinterpret_cast<const Func*>(ctx);
         f(*reinterpret_cast<T*>(v));
         });
       }
 
+    // batched version: calls f(queryId, obj) for every query and every object matching that query
+    template<class Func>
+    void find(const Query* q, size_t count, const Func& f) {
+      return BaseSpaceIndex::find(q,count,&f,[](const void* ctx, size_t id, Vob* v){
+        auto& f = *reinterpret_cast<const Func*>(ctx);
+        f(id,*reinterpret_cast<T*>(v));
+        });
+      }
+
     template<class F>
     void parallelFor(F func) {
       BaseSpaceIndex::parallelFor([&func](Vob* v){ func(*reinterpret_cast<T*>(v)); });
       }
   };
 
+
+// spatial hash for moving point-like objects (npc's): object is re-binned by owner on every position change
+class BasePointIndex {
+  public:
+    void   clear();
+    size_t size() const { return slots.size(); }
+
+  protected:
+    BasePointIndex() = default;
+    void               add(void* v, const Tempest::Vec3& pos);
+    void               del(const void* v);
+    bool               update(const void* v, const Tempest::Vec3& pos);
+    bool               hasObject(const void* v) const;
+
+    void               find (const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, void*));
+    void               sweep(const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, void*, float));
+
+  private:
+    struct Slot final {
+      void*         obj     = nullptr;
+      Tempest::Vec3 pos;
+      uint64_t      cell    = 0;
+      uint32_t      cellPos = 0;
+      };
+
+    std::vector<Slot>                                  slots;
+    std::unordered_map<const void*,uint32_t>           slotId;
+    std::unordered_map<uint64_t,std::vector<uint32_t>> grid;
+
+    void               bin(uint32_t id);
+    void               unbin(uint32_t id);
+    void               testCell(const std::vector<uint32_t>& cell, const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, void*));
+    void               sweepCell(uint64_t key, const std::vector<uint32_t>& cell, const Tempest::Vec3& p, float R, const void* ctx, void (*func)(const void*, void*, float));
+  };
+
+
+template<class T>
+class PointIndex final : public BasePointIndex {
+  public:
+    PointIndex()=default;
+
+    void add(T* v, const Tempest::Vec3& pos) {
+      BasePointIndex::add(v,pos);
+      }
+
+    void del(const T* v) {
+      BasePointIndex::del(v);
+      }
+
+    // object has moved; returns false, if object is not in this index
+    bool update(const T* v, const Tempest::Vec3& pos) {
+      return BasePointIndex::update(v,pos);
+      }
+
+    bool hasObject(const T* v) const {
+      return BasePointIndex::hasObject(v);
+      }
+
+    // calls f(obj) for every object strictly closer than R to p
+    template<class Func>
+    void find(const Tempest::Vec3& p, float R, const Func& f) {
+      BasePointIndex::find(p,R,&f,[](const void* ctx, void* v){
+        auto& f = *reinterpret_cast<const Func*>(ctx);
+        f(*reinterpret_cast<T*>(v));
+        });
+      }
+
+    // calls f(obj, quadDist) for every object within cells, that intersect R-circle around p (on XZ plane);
+    // quadDist may be larger than R*R for objects near border of the circle
+    template<class Func>
+    void sweep(const Tempest::Vec3& p, float R, const Func& f) {
+      BasePointIndex::sweep(p,R,&f,[](const void* ctx, void* v, float qDist){
+        auto& f = *reinterpret_cast<const Func*>(ctx);
+        f(*reinterpret_cast<T*>(v),qDist);
+        });
+      }
+  };
+
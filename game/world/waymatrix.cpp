@@ -2,15 +2,20 @@
 
 #include <Tempest/Log>
 #include <algorithm>
+#include <functional>
 #include <limits>
 
 #include "utils/dbgpainter.h"
 #include "utils/versioninfo.h"
 #include "world/objects/interactive.h"
 #include "world.h"
+#include "gothic.h"
 
 using namespace Tempest;
 
+static const size_t  pathCacheSize = 512;
+static const float   infDist       = std::numeric_limits<float>::infinity();
+
 WayMatrix::WayMatrix(World &world, const zenkit::WayNet& dat)
   :world(world) {
   // scripting doc says 20m, but number seems to be incorrect
@@ -26,8 +31,6 @@ WayMatrix::WayMatrix(World &world, const zenkit::WayNet& dat)
     }
 
   edges = dat.edges;
-  stk[0].reserve(256);
-  stk[1].reserve(256);
   }
 
 void WayMatrix::buildIndex() {
@@ -57,6 +60,10 @@ void WayMatrix::buildIndex() {
     }
 
   calculateLadderPoints();
+
+  buildGraph();
+  buildLandmarks(size_t(std::max(0,Gothic::settingsGetI("INTERNAL","pathLandmarks"))));
+  invalidatePathCache();
   }
 
 const WayPoint *WayMatrix::findWayPoint(const Vec3& at, const std::function<bool(const WayPoint&)>& filter) const {
@@ -282,89 +289,314 @@ const WayPoint *WayMatrix::findFreePoint(float x, float y, float z, const FpInde
   return ret;
   }
 
-WayPath WayMatrix::wayTo(const WayPoint** begin, size_t beginSz, const Tempest::Vec3 exactBegin, const WayPoint& end) const {
-  if(beginSz==0)
-    return WayPath();
+void WayMatrix::buildGraph() {
+  adjOffset.resize(wayPoints.size()+1);
+  adj.clear();
+  for(size_t i=0; i<wayPoints.size(); ++i) {
+    adjOffset[i] = uint32_t(adj.size());
+    for(auto& c:wayPoints[i].connections()) {
+      Edge e;
+      e.to  = pointId(*c.point);
+      if(e.to==uint32_t(-1))
+        continue;
+      // exact length, instead of truncated Conn::len: euclidean heuristic has to stay a lower bound
+      e.len = (c.point->position()-wayPoints[i].position()).length();
+      adj.push_back(e);
+      }
+    }
+  adjOffset[wayPoints.size()] = uint32_t(adj.size());
+  }
 
-  intptr_t endId = std::distance<const WayPoint*>(&wayPoints[0],&end);
-  if(endId<0 || size_t(endId)>=wayPoints.size()){
-    if(end.name.find("FP_")==0) {
-      WayPath ret;
-      ret.add(end);
-      return ret;
+void WayMatrix::buildLandmarks(size_t count) {
+  const size_t n = wayPoints.size();
+  landmarkDist.clear();
+  landmarkCount = 0;
+  if(count==0 || n==0)
+    return;
+
+  // farthest-point selection: each next landmark is the waypoint, most distant from already selected ones
+  uint32_t seed = 0;
+  for(uint32_t i=0; i<n; ++i)
+    if(adjOffset[i+1]-adjOffset[i] > adjOffset[seed+1]-adjOffset[seed])
+      seed = i;
+
+  std::vector<float> minDist(n);
+  distances(seed,minDist.data());
+
+  landmarkDist.resize(count*n);
+  for(size_t l=0; l<count; ++l) {
+    uint32_t next = uint32_t(-1);
+    for(uint32_t i=0; i<n; ++i) {
+      if(minDist[i]==infDist || minDist[i]<=0)
+        continue;
+      if(next==uint32_t(-1) || minDist[i]>minDist[next])
+        next = i;
       }
-    return WayPath();
+    if(next==uint32_t(-1))
+      break;
+
+    float* dist = &landmarkDist[l*n];
+    distances(next,dist);
+    for(size_t i=0; i<n; ++i)
+      minDist[i] = std::min(minDist[i],dist[i]);
+    landmarkCount = l+1;
     }
+  landmarkDist.resize(landmarkCount*n);
+  }
+
+void WayMatrix::invalidatePathCache() {
+  std::lock_guard<std::mutex> guard(cacheSync);
+  cache.clear();
+  cacheIndex.clear();
+  }
 
-  pathGen++;
-  if(pathGen==1){
-    // new cycle
-    for(auto& i:wayPoints)
-      i.pathGen=0;
+uint32_t WayMatrix::pointId(const WayPoint& p) const {
+  if(wayPoints.empty())
+    return uint32_t(-1);
+  intptr_t id = std::distance<const WayPoint*>(wayPoints.data(),&p);
+  if(id<0 || size_t(id)>=wayPoints.size())
+    return uint32_t(-1);
+  return uint32_t(id);
+  }
+
+void WayMatrix::distances(uint32_t src, float* dist) const {
+  std::fill(dist, dist+wayPoints.size(), infDist);
+
+  std::vector<std::pair<float,uint32_t>> open;
+  auto cmp = std::greater<std::pair<float,uint32_t>>();
+  dist[src] = 0;
+  open.emplace_back(0,src);
+  while(!open.empty()) {
+    std::pop_heap(open.begin(),open.end(),cmp);
+    const auto [d,n] = open.back();
+    open.pop_back();
+    if(d>dist[n])
+      continue;
+    for(uint32_t i=adjOffset[n]; i<adjOffset[n+1]; ++i) {
+      auto&       e  = adj[i];
+      const float nd = d+e.len;
+      if(nd<dist[e.to]) {
+        dist[e.to] = nd;
+        open.emplace_back(nd,e.to);
+        std::push_heap(open.begin(),open.end(),cmp);
+        }
+      }
     }
+  }
 
-  std::vector<const WayPoint*> *front=&stk[0], *back=&stk[1];
-  stk[0].clear();
-  stk[1].clear();
+float WayMatrix::heuristic(uint32_t n, const uint32_t* dst, const float* dstOffset, size_t dstSz) const {
+  // lower bound of distance to the nearest of destinations: max of euclidean and landmark bounds
+  const size_t size = wayPoints.size();
+  const auto   pos  = wayPoints[n].position();
+
+  float ret = infDist;
+  for(size_t i=0; i<dstSz; ++i) {
+    float h = (wayPoints[dst[i]].position()-pos).length();
+    for(size_t l=0; l<landmarkCount; ++l) {
+      const float* dist = &landmarkDist[l*size];
+      if(dist[n]==infDist || dist[dst[i]]==infDist)
+        continue;
+      h = std::max(h, std::abs(dist[n]-dist[dst[i]]));
+      }
+    ret = std::min(ret, h+dstOffset[i]);
+    }
+  return ret;
+  }
+
+bool WayMatrix::findPaths(CachedPath& ret) const {
+  // A* backwards: from destination, until every start candidate is settled.
+  // Heuristic is consistent, so distance of a node is final, once it's popped
+  auto  sc = acquireScratch();
+  auto& s  = *sc;
+  if(s.visit.size()!=wayPoints.size()) {
+    s.g     .resize(wayPoints.size());
+    s.parent.resize(wayPoints.size());
+    s.visit .assign(wayPoints.size(),0);
+    s.gen   = 0;
+    }
+  if(++s.gen==0) {
+    std::fill(s.visit.begin(),s.visit.end(),0);
+    s.gen = 1;
+    }
 
-  end.pathLen = 0;
-  end.pathGen = pathGen;
-  front->push_back(&end);
+  const uint32_t           dst    = ret.dst;
+  const uint32_t*          src    = ret.src.data();
+  const size_t             srcSz  = ret.src.size();
+  const std::vector<float> offset(srcSz,0.f);
+  ret.cost.assign(srcSz,infDist);
+
+  auto cmp = std::greater<std::tuple<float,float,uint32_t>>();
+  s.open.clear();
+  s.g     [dst] = 0;
+  s.parent[dst] = dst;
+  s.visit [dst] = s.gen;
+  s.open.emplace_back(heuristic(dst,src,offset.data(),srcSz),0,dst);
+
+  size_t settled = 0;
+  while(!s.open.empty() && settled<srcSz) {
+    std::pop_heap(s.open.begin(),s.open.end(),cmp);
+    const auto [f,g,n] = s.open.back();
+    s.open.pop_back();
+    if(g>s.g[n])
+      continue;
+    auto at = std::lower_bound(ret.src.begin(),ret.src.end(),n);
+    if(at!=ret.src.end() && *at==n && ret.cost[size_t(at-ret.src.begin())]==infDist) {
+      ret.cost[size_t(at-ret.src.begin())] = g;
+      ++settled;
+      }
+    for(uint32_t i=adjOffset[n]; i<adjOffset[n+1]; ++i) {
+      auto&       e  = adj[i];
+      const float ng = g+e.len;
+      if(s.visit[e.to]==s.gen && s.g[e.to]<=ng)
+        continue;
+      s.g     [e.to] = ng;
+      s.parent[e.to] = n;
+      s.visit [e.to] = s.gen;
+      s.open.emplace_back(ng+heuristic(e.to,src,offset.data(),srcSz),ng,e.to);
+      std::push_heap(s.open.begin(),s.open.end(),cmp);
+      }
+    }
 
-  while(front->size()>0) {
-    bool done = true;
-    for(size_t i=0; i<beginSz; ++i)
-      if(begin[i]->pathGen!=pathGen) {
-        done = false;
+  ret.path.resize(srcSz);
+  for(size_t r=0; r<srcSz; ++r) {
+    auto& path = ret.path[r];
+    path.clear();
+    if(ret.cost[r]==infDist)
+      continue;
+    for(uint32_t i=src[r]; ; i=s.parent[i]) {
+      path.push_back(i);
+      if(i==dst)
         break;
-        }
-    if(done)
-      break;
+      }
+    }
+  releaseScratch(std::move(sc));
+  return settled>0;
+  }
 
-    for(auto& wp:*front) {
-      int32_t l0 = wp->pathLen;
-
-      for(auto i:wp->connections()){
-        auto& w  = *i.point;
-        int32_t l1 = l0+i.len;
-        if(w.pathGen!=pathGen || w.pathLen>l1){
-          w.pathLen = l1;
-          w.pathGen = pathGen;
-          back->push_back(&w);
-          }
-        }
+bool WayMatrix::pickStart(const CachedPath& c, const std::vector<uint32_t>& src, const std::vector<float>& srcOffset,
+                          std::vector<uint32_t>& path) {
+  // nearest start, including offset from exact position
+  float  best   = infDist;
+  size_t bestId = size_t(-1);
+  for(size_t i=0; i<src.size(); ++i) {
+    auto at = std::lower_bound(c.src.begin(),c.src.end(),src[i]);
+    if(at==c.src.end() || *at!=src[i])
+      continue;
+    const size_t id = size_t(at-c.src.begin());
+    if(c.cost[id]+srcOffset[i]<best) {
+      best   = c.cost[id]+srcOffset[i];
+      bestId = id;
       }
-    std::swap(front,back);
-    back->clear();
     }
+  if(bestId==size_t(-1))
+    return false;
+  path = c.path[bestId];
+  return true;
+  }
 
-  const WayPoint* first = begin[0];
-  for(size_t i=0; i<beginSz; ++i) {
-    int32_t iLen = begin[i]->pathLen + int((exactBegin - begin[i]->position()).length());
-    int32_t fLen = first   ->pathLen + int((exactBegin - first   ->position()).length());
-    if(iLen<fLen)
-      first = begin[i];
+bool WayMatrix::findCached(const std::vector<uint32_t>& candidates, uint32_t dst,
+                           const std::vector<uint32_t>& src, const std::vector<float>& srcOffset,
+                           std::vector<uint32_t>& path) const {
+  std::lock_guard<std::mutex> guard(cacheSync);
+  auto it = cacheIndex.find(cacheKey(candidates,dst));
+  if(it==cacheIndex.end())
+    return false;
+  auto& c = *it->second;
+  if(c.dst!=dst || c.src!=candidates)
+    return false;
+  cache.splice(cache.begin(),cache,it->second);
+  if(!pickStart(c,src,srcOffset,path))
+    path.clear();
+  return true;
+  }
+
+void WayMatrix::storeCached(CachedPath&& c) const {
+  std::lock_guard<std::mutex> guard(cacheSync);
+  c.key = cacheKey(c.src,c.dst);
+  if(cacheIndex.find(c.key)!=cacheIndex.end())
+    return;
+  if(cache.size()>=pathCacheSize) {
+    cacheIndex.erase(cache.back().key);
+    cache.pop_back();
     }
+  cache.push_front(std::move(c));
+  cacheIndex[cache.front().key] = cache.begin();
+  }
 
-  WayPath ret;
-  ret.add(*first);
-  const WayPoint* current = first;
-  while(current!=&end) {
-    int32_t l0 = current->pathLen, l1=l0;
-
-    const WayPoint* next=nullptr;
-    for(auto i:current->connections()){
-      if(i.point->pathGen==pathGen && i.point->pathLen+i.len<=l0 && i.point->pathLen<l1){
-        next = i.point;
-        l1   = i.point->pathLen;
-        }
+uint64_t WayMatrix::cacheKey(const std::vector<uint32_t>& src, uint32_t dst) {
+  // FNV-1a over destination and sorted start candidates
+  uint64_t h = 14695981039346656037ull;
+  auto     mix = [&h](uint32_t v) {
+    h = (h ^ v) * 1099511628211ull;
+    };
+  mix(dst);
+  for(auto i:src)
+    mix(i);
+  return h;
+  }
+
+std::unique_ptr<WayMatrix::Scratch> WayMatrix::acquireScratch() const {
+  std::lock_guard<std::mutex> guard(scratchSync);
+  if(scratchPool.empty())
+    return std::make_unique<Scratch>();
+  auto ret = std::move(scratchPool.back());
+  scratchPool.pop_back();
+  return ret;
+  }
+
+void WayMatrix::releaseScratch(std::unique_ptr<Scratch>&& s) const {
+  std::lock_guard<std::mutex> guard(scratchSync);
+  scratchPool.emplace_back(std::move(s));
+  }
+
+WayPath WayMatrix::wayTo(const WayPoint** begin, size_t beginSz, const Tempest::Vec3 exactBegin, const WayPoint& end) const {
+  if(beginSz==0)
+    return WayPath();
+
+  const uint32_t endId = pointId(end);
+  if(endId==uint32_t(-1)) {
+    if(end.name.find("FP_")==0) {
+      WayPath ret;
+      ret.add(end);
+      return ret;
       }
-    if(next==nullptr)
+    return WayPath();
+    }
+
+  std::vector<uint32_t> src;
+  std::vector<float>    srcOffset;
+  for(size_t i=0; i<beginSz; ++i) {
+    const uint32_t id = pointId(*begin[i]);
+    if(id==uint32_t(-1))
+      continue;
+    src.push_back(id);
+    srcOffset.push_back((exactBegin - begin[i]->position()).length());
+    }
+  if(src.empty())
+    return WayPath();
+
+  // cache is keyed by whole set of start candidates and keeps route of each of them:
+  // start is picked per query, by offsets from exact position
+  std::vector<uint32_t> candidates = src;
+  std::sort(candidates.begin(),candidates.end());
+  candidates.erase(std::unique(candidates.begin(),candidates.end()),candidates.end());
+
+  std::vector<uint32_t> path;
+  if(!findCached(candidates,endId,src,srcOffset,path)) {
+    CachedPath c;
+    c.dst = endId;
+    c.src = std::move(candidates);
+    const bool found = findPaths(c) && pickStart(c,src,srcOffset,path);
+    storeCached(std::move(c));
+    if(!found)
       return WayPath();
-    ret.add(*next);
-    current=next;
     }
+  if(path.empty())
+    return WayPath();
 
+  WayPath ret;
+  for(auto i:path)
+    ret.add(wayPoints[i]);
   ret.reverse();
   return ret;
   }
@@ -6,6 +6,11 @@
 #include <zenkit/world/WayNet.hh>
 
 #include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 #include <functional>
 
 #include "waypath.h"
@@ -52,11 +57,61 @@ class WayMatrix final {
       };
     mutable std::vector<FpIndex>          fpIndex;
 
-    mutable uint16_t                      pathGen=0;
-    mutable std::vector<const WayPoint*>  stk[2];
+    // compact copy of waynet connections, built by buildIndex
+    struct Edge final {
+      uint32_t to  = 0;
+      float    len = 0;
+      };
+    std::vector<uint32_t>  adjOffset;
+    std::vector<Edge>      adj;
+
+    // ALT heuristic: graph distances from each landmark to every waypoint
+    size_t                 landmarkCount = 0;
+    std::vector<float>     landmarkDist;
+
+    // per-query search state; pooled, so queries can run concurrently
+    struct Scratch final {
+      std::vector<float>    g;
+      std::vector<uint32_t> parent;
+      std::vector<uint32_t> visit;
+      uint32_t              gen = 0;
+      std::vector<std::tuple<float,float,uint32_t>> open;
+      };
+    mutable std::mutex                            scratchSync;
+    mutable std::vector<std::unique_ptr<Scratch>> scratchPool;
+
+    // routes from every start candidate to destination; actual start is chosen per query, by exact position
+    struct CachedPath final {
+      uint64_t                           key = 0;
+      uint32_t                           dst = 0;
+      std::vector<uint32_t>              src;  // sorted start candidates
+      std::vector<float>                 cost; // graph distance from src[i] to dst
+      std::vector<std::vector<uint32_t>> path; // from src[i] to dst
+      };
+    mutable std::mutex                                                    cacheSync;
+    mutable std::list<CachedPath>                                         cache; // most recent first
+    mutable std::unordered_map<uint64_t,std::list<CachedPath>::iterator> cacheIndex;
 
     void                   adjustWaypoints(std::vector<WayPoint> &wp);
     void                   calculateLadderPoints();
+    void                   buildGraph();
+    void                   buildLandmarks(size_t count);
+    void                   invalidatePathCache();
+
+    uint32_t               pointId(const WayPoint& p) const;
+    void                   distances(uint32_t src, float* dist) const;
+    float                  heuristic(uint32_t n, const uint32_t* dst, const float* dstOffset, size_t dstSz) const;
+    bool                   findPaths(CachedPath& ret) const;
+    bool                   findCached(const std::vector<uint32_t>& candidates, uint32_t dst,
+                                      const std::vector<uint32_t>& src, const std::vector<float>& srcOffset,
+                                      std::vector<uint32_t>& path) const;
+    void                   storeCached(CachedPath&& c) const;
+    static bool            pickStart(const CachedPath& c, const std::vector<uint32_t>& src, const std::vector<float>& srcOffset,
+                                     std::vector<uint32_t>& path);
+    static uint64_t        cacheKey(const std::vector<uint32_t>& src, uint32_t dst);
+
+    std::unique_ptr<Scratch> acquireScratch() const;
+    void                     releaseScratch(std::unique_ptr<Scratch>&& s) const;
 
     const FpIndex&         findFpIndex(std::string_view name) const;
     const WayPoint*        findFreePoint(float x, float y, float z, const FpIndex &ind,
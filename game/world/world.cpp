@@ -1,23 +1,32 @@
 #include "world.h"
 
+#include <chrono>
 #include <functional>
 #include <future>
 #include <cctype>
 
+#include <Tempest/Application>
 #include <Tempest/Log>
 #include <Tempest/Painter>
 
 #include "graphics/mesh/submesh/packedmesh.h"
+#include "graphics/mesh/animation.h"
 #include "graphics/visualfx.h"
+#include "graphics/objvisual.h"
 #include "world/objects/globalfx.h"
 #include "world/objects/npc.h"
 #include "world/objects/item.h"
 #include "world/objects/interactive.h"
 #include "world/triggers/abstracttrigger.h"
 #include "world/triggers/cscamera.h"
+#include "world/worldcache.h"
 #include "game/globaleffects.h"
 #include "game/serialize.h"
 #include "utils/string_frm.h"
+#include "utils/fileext.h"
+#include "utils/workers.h"
+#include "utils/profiler.h"
+#include "commandline.h"
 #include "gothic.h"
 #include "focus.h"
 #include "resources.h"
@@ -63,6 +72,91 @@ const char* materialTag(zenkit::MaterialGroup src) {
   return "UD";
   }
 
+namespace {
+// assets, referenced by static vob-tree: loaded ahead of vob instantiation
+struct VobAssets final {
+  std::vector<std::string>                                meshes;
+  std::vector<std::string>                                textures;
+  std::vector<std::shared_ptr<const zenkit::VisualDecal>> decals;
+
+  size_t size() const { return meshes.size()+textures.size()+decals.size(); }
+  };
+}
+
+static VobAssets collectVobAssets(const std::vector<std::shared_ptr<zenkit::VirtualObject>>& roots) {
+  // must mirror resource keys of ObjVisual::setVisual
+  VobAssets                                 ret;
+  std::vector<const zenkit::VirtualObject*> stk;
+  for(auto& i:roots)
+    stk.push_back(i.get());
+  while(!stk.empty()) {
+    auto vob = stk.back();
+    stk.pop_back();
+    for(auto& i:vob->children)
+      stk.push_back(i.get());
+    if(vob->visual==nullptr || vob->visual->name.empty())
+      continue;
+
+    auto& name = vob->visual->name;
+    if(FileExt::hasExt(name,"ZEN"))
+      continue;
+    switch(vob->visual->type) {
+      case zenkit::VisualType::MESH:
+      case zenkit::VisualType::MULTI_RESOLUTION_MESH:
+        ret.meshes.push_back(name);
+        break;
+      case zenkit::VisualType::MODEL:
+      case zenkit::VisualType::MORPH_MESH: {
+        auto visual = name;
+        FileExt::exchangeExt(visual,"ASC","MDL");
+        ret.meshes.push_back(std::move(visual));
+        break;
+        }
+      case zenkit::VisualType::DECAL:
+        if(vob->sprite_camera_facing_mode!=zenkit::SpriteAlignment::NONE)
+          ret.textures.push_back(name);
+        else if(auto decal = std::dynamic_pointer_cast<const zenkit::VisualDecal>(vob->visual))
+          ret.decals.push_back(std::move(decal));
+        break;
+      case zenkit::VisualType::PARTICLE_EFFECT:
+      case zenkit::VisualType::AI_CAMERA:
+      case zenkit::VisualType::UNKNOWN:
+        break;
+      }
+    }
+
+  for(auto* v:{&ret.meshes,&ret.textures}) {
+    std::sort(v->begin(),v->end());
+    v->erase(std::unique(v->begin(),v->end()),v->end());
+    }
+  return ret;
+  }
+
+static void prefetchVobAssets(VobAssets& assets) {
+  // resource caches are load-once and thread-safe: main thread will find everything in place
+  Workers::parallelTasks(assets.meshes,  [](const std::string& name)  { Resources::loadMesh(name);    });
+  Workers::parallelTasks(assets.textures,[](const std::string& name)  { Resources::loadTexture(name); });
+  Workers::parallelTasks(assets.decals,  [](const std::shared_ptr<const zenkit::VisualDecal>& d) { Resources::decalMesh(*d); });
+  }
+
+// parts of static vobs, that don't touch world containers: built in parallel, linked by vob constructors
+struct World::VobPrebuilt final {
+  struct Part final {
+    const zenkit::VirtualObject* vob = nullptr;
+    PhysicMesh                   physic;
+    LightSource                  light;
+    bool                         hasLight = false;
+    };
+
+  std::vector<Part>                                      parts;
+  std::unordered_map<const zenkit::VirtualObject*,Part*> index;
+
+  Part* find(const zenkit::VirtualObject& vob) {
+    auto i = index.find(&vob);
+    return i==index.end() ? nullptr : i->second;
+    }
+  };
+
 World::World(GameSession& game, std::string_view file, bool startup, std::function<void(int)> loadProgress)
   :wname(std::move(file)), game(game), wsound(game,*this), wobj(*this) {
   const auto* entry = Resources::vdfsIndex().find(wname);
@@ -73,21 +167,46 @@ World::World(GameSession& game, std::string_view file, bool startup, std::functi
     }
 
   try {
-    auto          buf = entry->open_read();
+    const auto    time0 = Tempest::Application::tickCount();
+    // cache key reads whole zen-file once more: compute it off the main thread, while zen is parsed
+    auto          hash  = Workers::async([name = wname]() { return WorldCache::key(name); });
+    auto          buf   = entry->open_read();
     zenkit::World world;
     world.load(buf.get(), version().game == 1 ? zenkit::GameVersion::GOTHIC_1
                                               : zenkit::GameVersion::GOTHIC_2);
 
     loadProgress(20);
     auto& worldMesh = world.world_mesh;
+    auto  time      = Tempest::Application::tickCount();
+    auto  timeParse = time-time0;
+
+    // stage 1: decode referenced assets, while landscape is being processed
+    // job owns it's data: it may outlive this scope, if loading throws
+    auto assets   = std::make_shared<VobAssets>(collectVobAssets(world.world_vobs));
+    auto assetFut = Workers::async([assets]() {
+      const auto t = Tempest::Application::tickCount();
+      prefetchVobAssets(*assets);
+      return Tempest::Application::tickCount()-t;
+      });
+
+    // meshlets and bvh are taken from disk cache, if it's up to date
+    const uint64_t cacheKey = hash.get();
+    auto           cache    = WorldCache::open(wname,cacheKey);
+    auto           cacheOut = cache==nullptr ? std::make_shared<WorldCache::Writer>() : nullptr;
 
     auto wdynamicFut = std::async(std::launch::async, [&]() {
       Workers::setThreadName("Loading: BVH thread");
-      return std::unique_ptr<DynamicWorld>(new DynamicWorld(*this,worldMesh));
+      return std::unique_ptr<DynamicWorld>(new DynamicWorld(*this,worldMesh,cache));
       });
     auto wviewFut = std::async(std::launch::async, [&]() {
       Workers::setThreadName("Loading: PackedMesh thread");
-      PackedMesh vmesh(worldMesh,PackedMesh::PK_VisualLnd);
+      if(CommandLine::inst().isHeadless())
+        return std::unique_ptr<WorldView>(); // nothing to draw - no gpu side of world
+      PackedMesh vmesh;
+      if(cache==nullptr || !cache->loadVisual(vmesh,worldMesh))
+        vmesh = PackedMesh(worldMesh,PackedMesh::PK_VisualLnd);
+      if(cacheOut!=nullptr)
+        cacheOut->addVisual(vmesh);
       return std::unique_ptr<WorldView>(new WorldView(*this,vmesh));
       });
 
@@ -99,6 +218,7 @@ World::World(GameSession& game, std::string_view file, bool startup, std::functi
       bsp.leaf_node_indices = std::move(world.world_bsp_tree.leaf_node_indices);
       bsp.sectorsData.resize(bsp.sectors.size());
       world.world_bsp_tree  = zenkit::BspTree();
+      buildBspIndex();
     }
     loadProgress(50);
 
@@ -108,13 +228,43 @@ World::World(GameSession& game, std::string_view file, bool startup, std::functi
     wdynamic = wdynamicFut.get();
     loadProgress(70);
 
+    if(cacheOut!=nullptr) {
+      wdynamic->storeCache(*cacheOut);
+      Workers::async([cacheOut, name = wname, cacheKey]() {
+        cacheOut->write(name,cacheKey);
+        });
+      }
+
+    const auto timeLoad = assetFut.get();
+    const auto timeLand = Tempest::Application::tickCount()-time;
+    loadProgress(75);
+
+    // stage 2: build collision bodies and light sources of vobs in parallel, unlinked from world
+    time = Tempest::Application::tickCount();
+    prebuildVobs(world.world_vobs);
+    const auto timeBuild = Tempest::Application::tickCount()-time;
+    loadProgress(80);
+
+    // stage 3: instantiate vobs; constructors register in world containers and pick up prebuilt parts,
+    // so this pass is serial
+    time = Tempest::Application::tickCount();
     globFx.reset(new GlobalEffects(*this));
     wmatrix.reset(new WayMatrix(*this,world.world_way_net));
     for(auto& vob:world.world_vobs)
       wobj.addRoot(vob,startup);
-
+    const size_t numParts = vobPrebuilt->index.size();
+    vobPrebuilt.reset();
+    loadProgress(90);
     wmatrix->buildIndex();
+    const auto timeLink = Tempest::Application::tickCount()-time;
     loadProgress(100);
+
+    size_t animRaw = 0, animPacked = 0;
+    Animation::memoryStatistic(animRaw,animPacked);
+    Tempest::Log::i("world load [",wname,"]: parse ",timeParse,"ms, landscape ",timeLand,"ms",
+                    " (assets ",timeLoad,"ms, ",assets->size()," items), vobs build ",timeBuild,"ms (",numParts," parts),",
+                    " link ",timeLink,"ms");
+    Tempest::Log::i("animations: ",animRaw/1024,"Kb -> ",animPacked/1024,"Kb compressed");
     }
   catch(...) {
     Tempest::Log::e("unable to load landscape mesh");
@@ -254,39 +404,70 @@ MeshObjects::Mesh World::addView(std::string_view visual) const {
   }
 
 MeshObjects::Mesh World::addView(std::string_view visual, int32_t headTex, int32_t teetTex, int32_t bodyColor) const {
-  return view()->addView(visual,headTex,teetTex,bodyColor);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addView(visual,headTex,teetTex,bodyColor);
   }
 
 MeshObjects::Mesh World::addView(const zenkit::IItem& itm) {
-  return view()->addView(itm.visual,itm.material,0,itm.material);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addView(itm.visual,itm.material,0,itm.material);
   }
 
 MeshObjects::Mesh World::addView(const ProtoMesh* visual) {
-  return view()->addView(visual);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addView(visual);
   }
 
 MeshObjects::Mesh World::addAtachView(const ProtoMesh::Attach& visual, const int32_t version) {
-  return view()->addAtachView(visual,version);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addAtachView(visual,version);
   }
 
 MeshObjects::Mesh World::addStaticView(const ProtoMesh* visual, bool staticDraw) {
-  return view()->addStaticView(visual,staticDraw);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addStaticView(visual,staticDraw);
   }
 
 MeshObjects::Mesh World::addStaticView(std::string_view visual) {
-  return view()->addStaticView(visual);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addStaticView(visual);
   }
 
 MeshObjects::Mesh World::addDecalView(const zenkit::VisualDecal& decal) {
-  return view()->addDecalView(decal);
+  if(wview==nullptr)
+    return MeshObjects::Mesh();
+  return wview->addDecalView(decal);
   }
 
 LightGroup::Light World::addLight(const zenkit::VLight& vob) {
-  return view()->addLight(vob);
+  if(wview==nullptr)
+    return LightGroup::Light();
+  if(auto p = vobPrebuilt==nullptr ? nullptr : vobPrebuilt->find(vob); p!=nullptr && p->hasLight) {
+    p->hasLight = false;
+    return wview->addLight(std::move(p->light));
+    }
+  return wview->addLight(vob);
   }
 
 LightGroup::Light World::addLight(std::string_view preset) {
-  return view()->addLight(preset);
+  if(wview==nullptr)
+    return LightGroup::Light();
+  return wview->addLight(preset);
+  }
+
+PhysicMesh World::takeVobPhysic(const zenkit::VirtualObject& vob) {
+  auto p = vobPrebuilt==nullptr ? nullptr : vobPrebuilt->find(vob);
+  if(p==nullptr)
+    return PhysicMesh();
+  PhysicMesh ret = std::move(p->physic);
+  ret.attach();
+  return ret;
   }
 
 void World::updateAnimation(uint64_t dt) {
@@ -309,9 +490,66 @@ Npc *World::findNpcByInstance(size_t instance, size_t n) {
   return wobj.findNpcByInstance(instance,n);
   }
 
-std::string_view World::roomAt(const Tempest::Vec3& p) {
+void World::prebuildVobs(const std::vector<std::shared_ptr<zenkit::VirtualObject>>& roots) {
+  vobPrebuilt.reset(new VobPrebuilt());
+  auto& parts = vobPrebuilt->parts;
+
+  std::vector<const zenkit::VirtualObject*> stk;
+  for(auto& i:roots)
+    stk.push_back(i.get());
+  while(!stk.empty()) {
+    auto vob = stk.back();
+    stk.pop_back();
+    for(auto& i:vob->children)
+      stk.push_back(i.get());
+    parts.emplace_back();
+    parts.back().vob = vob;
+    }
+
+  // bodies are created at final transform, but linked into collision world only by vob constructor
+  Workers::parallelFor(parts,[this](VobPrebuilt::Part& p) {
+    p.physic = ObjVisual::mkStaticPhysic(*p.vob,*this);
+    if(wview!=nullptr && p.vob->type==zenkit::VirtualObjectType::zCVobLight) {
+      p.light    = LightGroup::mkSource(reinterpret_cast<const zenkit::VLight&>(*p.vob));
+      p.hasLight = true;
+      }
+    });
+
+  for(auto& i:parts)
+    if(i.hasLight || !i.physic.isEmpty())
+      vobPrebuilt->index[i.vob] = &i;
+  }
+
+void World::buildBspIndex() {
+  // leaf can be referenced by many sectors: such leaf doesn't belong to any room
+  static const uint32_t none = uint32_t(-1);
+  bsp.leafSector.assign(bsp.nodes.size(),none);
+  std::vector<uint8_t> shared(bsp.nodes.size());
+  for(size_t i=0; i<bsp.sectors.size(); ++i) {
+    for(auto r:bsp.sectors[i].node_indices) {
+      if(r>=bsp.leaf_node_indices.size())
+        continue;
+      size_t idx = bsp.leaf_node_indices[r];
+      if(idx>=bsp.nodes.size())
+        continue;
+      if(bsp.leafSector[idx]==none && !shared[idx])
+        bsp.leafSector[idx] = uint32_t(i); else
+        shared[idx] = 1;
+      }
+    }
+  for(size_t i=0; i<bsp.nodes.size(); ++i)
+    if(shared[i])
+      bsp.leafSector[i] = none;
+
+  bsp.sectorByName.clear();
+  bsp.sectorByName.reserve(bsp.sectors.size());
+  for(size_t i=0; i<bsp.sectors.size(); ++i)
+    bsp.sectorByName.emplace(bsp.sectors[i].name,i);
+  }
+
+const zenkit::BspNode* World::bspLeaf(const Tempest::Vec3& p) const {
   if(bsp.nodes.empty())
-    return "";
+    return nullptr;
 
   const auto* node=&bsp.nodes[0];
 
@@ -328,44 +566,33 @@ std::string_view World::roomAt(const Tempest::Vec3& p) {
   if(node->bbox.min.x <= p.x && p.x <node->bbox.max.x &&
      node->bbox.min.y <= p.y && p.y <node->bbox.max.y &&
      node->bbox.min.z <= p.z && p.z <node->bbox.max.z) {
-    return roomAt(*node);
+    return node;
     }
+  return nullptr;
+  }
 
+std::string_view World::roomAt(const Tempest::Vec3& p) {
+  if(auto node = bspLeaf(p))
+    return roomAt(*node);
   return "";
   }
 
 std::string_view World::roomAt(const zenkit::BspNode& node) {
-  const std::string* ret=nullptr;
-  size_t       count=0;
-  auto         id = &node-bsp.nodes.data();(void)id;
-
-  for(auto& i:bsp.sectors) {
-    for(auto r:i.node_indices)
-      if(r<bsp.leaf_node_indices.size()){
-        size_t idx = bsp.leaf_node_indices[r];
-        if(idx>=bsp.nodes.size())
-          continue;
-        if(&bsp.nodes[idx]==&node) {
-          ret = &i.name;
-          count++;
-          }
-        }
-    }
-  if(count==1) {
+  const size_t id = size_t(&node-bsp.nodes.data());
+  if(id<bsp.leafSector.size() && bsp.leafSector[id]!=uint32_t(-1)) {
     // TODO: portals
-    return *ret;
+    return bsp.sectors[bsp.leafSector[id]].name;
     }
-  static std::string empty;
-  return empty;
+  return "";
   }
 
 World::BspSector* World::portalAt(std::string_view tag) {
   if(tag.empty())
     return nullptr;
 
-  for(size_t i=0;i<bsp.sectors.size();++i)
-    if(bsp.sectors[i].name==tag)
-      return &bsp.sectorsData[i];
+  auto it = bsp.sectorByName.find(tag);
+  if(it!=bsp.sectorByName.end())
+    return &bsp.sectorsData[it->second];
   return nullptr;
   }
 
@@ -374,15 +601,34 @@ void World::scaleTime(uint64_t& dt) {
   }
 
 void World::tick(uint64_t dt) {
+  PROFILE_ZONE("World::tick");
   static bool doTicks=true;
   if(!doTicks)
     return;
+  using clock = std::chrono::steady_clock;
+  auto us = [](clock::time_point a, clock::time_point b) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(b-a).count());
+    };
+
+  const auto t0 = clock::now();
   wobj.tick(dt,dt);
+  const auto t1 = clock::now();
   wdynamic->tick(dt);
-  wview->tick(dt);
+  const auto t2 = clock::now();
+  if(wview!=nullptr)
+    wview->tick(dt);
+  const auto t3 = clock::now();
   if(auto pl = player())
     wsound.tick(*pl);
+  const auto t4 = clock::now();
   globFx->tick(dt);
+  const auto t5 = clock::now();
+
+  tickStat.objects = us(t0,t1);
+  tickStat.physics = us(t1,t2);
+  tickStat.view    = us(t2,t3);
+  tickStat.sound   = us(t3,t4);
+  tickStat.effects = us(t4,t5);
   }
 
 uint64_t World::tickCount() const {
@@ -426,14 +672,14 @@ Focus World::findFocus(const Npc &pl, const Focus& def) {
   WorldObjects::SearchOpt optMob {policy.mob_range1,  policy.mob_range2,  policy.mob_azi,  collAlgo};
   WorldObjects::SearchOpt optItm {policy.item_range1, policy.item_range2, policy.item_azi, collAlgo, collType};
 
+  auto ws    = pl.weaponState();
+  bool bow   = (ws==WeaponState::Bow || ws==WeaponState::CBow);
+  if(bow)
+    optMob.flags = WorldObjects::SearchFlg(WorldObjects::FcOverride | WorldObjects::NoRay);
+
   auto n     = policy.npc_prio <0 ? nullptr : wobj.findNpcNear    (pl,def.npc,        optNpc);
   auto it    = policy.item_prio<0 ? nullptr : wobj.findItem       (pl,def.item,       optItm);
-  auto inter = policy.mob_prio <0 ? nullptr : wobj.findInteractive(pl,def.interactive,optMob);
-  auto ws = pl.weaponState();
-  if(ws==WeaponState::Bow || ws==WeaponState::CBow) {
-    optMob.flags = WorldObjects::SearchFlg(WorldObjects::FcOverride | WorldObjects::NoRay);
-    inter = wobj.findInteractive(pl,def.interactive,optMob);
-    }
+  auto inter = (policy.mob_prio<0 && !bow) ? nullptr : wobj.findInteractive(pl,def.interactive,optMob);
 
   if(policy.npc_prio>=policy.item_prio &&
      policy.npc_prio>=policy.mob_prio) {
@@ -782,6 +1028,8 @@ bool World::isInSfxRange(const Tempest::Vec3& pos) const {
   }
 
 bool World::isInPfxRange(const Tempest::Vec3& p) const {
+  if(wview==nullptr)
+    return false;
   return wview->isInPfxRange(p);
   }
 
@@ -818,8 +1066,20 @@ void World::addSound(const zenkit::VirtualObject& vob) {
     }
   }
 
-void World::invalidateVobIndex() {
-  wobj.invalidateVobIndex();
+void World::invalidateVobIndex(Vob& vob) {
+  wobj.invalidateVobIndex(vob);
+  }
+
+void World::invalidateNpcIndex(Npc& npc) {
+  wobj.invalidateNpcIndex(npc);
+  }
+
+LineOfSight& World::lineOfSight() {
+  return wobj.lineOfSight();
+  }
+
+const WorldObjects::PrefetchStats& World::npcPrefetch() const {
+  return wobj.prefetchStats();
   }
 
 const zenkit::IFocus& World::searchPolicy(const Npc& pl, TargetCollect& collAlgo, TargetType& collType, WorldObjects::SearchFlg& opt) const {
@@ -1008,11 +1268,8 @@ int32_t World::guildOfRoom(std::string_view portalName) {
     return -1;
 
   auto name = portalName.substr(b,e-b);
-
-  for(size_t i=0;i<bsp.sectors.size();++i) {
-    auto& s = bsp.sectors[i].name;
-    if(s==name)
-      return bsp.sectorsData[i].guild;
-    }
+  auto it   = bsp.sectorByName.find(name);
+  if(it!=bsp.sectorByName.end())
+    return bsp.sectorsData[it->second].guild;
   return GIL_NONE;
   }
@@ -5,6 +5,7 @@
 #include <Tempest/Matrix4x4>
 #include <string>
 #include <functional>
+#include <unordered_map>
 
 #include <zenkit/World.hh>
 
@@ -27,6 +28,7 @@ class ParticleFx;
 class Interactive;
 class VersionInfo;
 class GlobalFx;
+class PhysicMesh;
 
 class World final {
   public:
@@ -100,6 +102,7 @@ class World final {
     MeshObjects::Mesh    addDecalView (const zenkit::VisualDecal& decal);
     LightGroup::Light    addLight(const zenkit::VLight& vob);
     LightGroup::Light    addLight(std::string_view preset);
+    PhysicMesh           takeVobPhysic(const zenkit::VirtualObject& vob);
 
     void                 updateAnimation(uint64_t dt);
     void                 resetPositionToTA();
@@ -110,8 +113,18 @@ class World final {
     Item*                findItemByInstance(size_t instance, size_t n = 0);
     std::string_view     roomAt(const Tempest::Vec3& arr);
 
+    // time of last tick per subsystem, us
+    struct TickStats final {
+      uint64_t objects = 0;
+      uint64_t physics = 0;
+      uint64_t view    = 0;
+      uint64_t sound   = 0;
+      uint64_t effects = 0;
+      };
+
     void                 scaleTime(uint64_t& dt);
     void                 tick(uint64_t dt);
+    auto                 tickStats() const -> const TickStats& { return tickStat; }
     uint64_t             tickCount() const;
     void                 setDayTime(int32_t h,int32_t min);
     gtime                time() const;
@@ -183,7 +196,10 @@ class World final {
     void                 addFreePoint  (const Tempest::Vec3& pos, const Tempest::Vec3& dir, std::string_view name);
     void                 addSound      (const zenkit::VirtualObject& vob);
 
-    void                 invalidateVobIndex();
+    void                 invalidateVobIndex(Vob& vob);
+    void                 invalidateNpcIndex(Npc& npc);
+    LineOfSight&         lineOfSight();
+    auto                 npcPrefetch() const -> const WorldObjects::PrefetchStats&;
 
   private:
     const zenkit::IFocus& searchPolicy(const Npc& pl, TargetCollect& collAlgo, TargetType& collType, WorldObjects::SearchFlg& opt) const;
@@ -201,6 +217,10 @@ class World final {
       std::vector<zenkit::BspSector>      sectors;
       std::vector<std::uint64_t>          leaf_node_indices;
       std::vector<BspSector>              sectorsData;
+
+      // reverse index, built once on load
+      std::vector<uint32_t>                       leafSector; // node -> sector, or uint32_t(-1)
+      std::unordered_map<std::string_view,size_t> sectorByName;
       } bsp;
 
     Npc*                                  npcPlayer=nullptr;
@@ -210,8 +230,14 @@ class World final {
     std::unique_ptr<GlobalEffects>        globFx;
     WorldSound                            wsound;
     WorldObjects                          wobj;
+    struct VobPrebuilt;
+    std::unique_ptr<VobPrebuilt>          vobPrebuilt; // only while loading
     std::unique_ptr<Npc>                  lvlInspector;
+    TickStats                             tickStat;
 
+    void         buildBspIndex();
+    void         prebuildVobs(const std::vector<std::shared_ptr<zenkit::VirtualObject>>& roots);
+    auto         bspLeaf(const Tempest::Vec3& p) const -> const zenkit::BspNode*;
     auto         roomAt(const zenkit::BspNode &node) -> std::string_view;
     auto         portalAt(std::string_view tag) -> BspSector*;
 
@@ -0,0 +1,380 @@
+#include "worldcache.h"
+
+#include <Tempest/Application>
+#include <Tempest/Log>
+#include <Tempest/Platform>
+#include <Tempest/TextCodec>
+
+#include <zenkit/World.hh>
+
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#ifdef __WINDOWS__
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "graphics/mesh/submesh/packedmesh.h"
+#include "physics/dynamicworld.h"
+#include "physics/physics.h"
+#include "utils/fileext.h"
+#include "gothic.h"
+#include "resources.h"
+#include "build.h"
+
+// bump, if layout of cache or packing of landscape/physics has changed
+static constexpr uint32_t CacheVersion = 3;
+static constexpr size_t   Alignment    = 64;
+static const char         Magic[8]     = {'O','G','W','C','A','C','H','E'};
+
+struct WorldCache::Header final {
+  char     magic[8]     = {};
+  uint32_t version      = 0;
+  uint32_t sectionCount = 0;
+  uint64_t key          = 0;
+  };
+
+struct WorldCache::SectionDesc final {
+  uint64_t offset = 0;
+  uint64_t size   = 0;
+  uint64_t hash   = 0;
+  };
+
+namespace {
+struct LndSubMesh final {
+  uint32_t material  = 0;
+  uint32_t padding   = 0;
+  uint64_t iboOffset = 0;
+  uint64_t iboLength = 0;
+  };
+}
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t size) {
+  auto* b = reinterpret_cast<const uint8_t*>(data);
+  for(size_t i=0; i<size; ++i) {
+    h ^= b[i];
+    h *= 0x100000001b3ull;
+    }
+  return h;
+  }
+
+static uint64_t wordHash(uint64_t h, const void* data, size_t size) {
+  // word-wise variant of fnv1a: sections are tens of megabytes, content check must be cheap
+  auto*  b = reinterpret_cast<const uint8_t*>(data);
+  size_t i = 0;
+  for(; i+8<=size; i+=8) {
+    uint64_t w = 0;
+    std::memcpy(&w,b+i,8);
+    h ^= w;
+    h *= 0x100000001b3ull;
+    h ^= h>>29;
+    }
+  return fnv1a(h,b+i,size-i);
+  }
+
+static uint64_t sectionHash(const void* data, size_t size) {
+  return wordHash(0xcbf29ce484222325ull ^ size, data, size);
+  }
+
+static uint64_t processId() {
+#ifdef __WINDOWS__
+  return uint64_t(GetCurrentProcessId());
+#else
+  return uint64_t(getpid());
+#endif
+  }
+
+static size_t alignUp(size_t v) {
+  return (v+Alignment-1) & ~(Alignment-1);
+  }
+
+uint64_t WorldCache::key(std::string_view world) {
+  const auto* entry = Resources::vdfsIndex().find(world);
+  if(entry==nullptr)
+    return 0;
+
+  const uint8_t game = Gothic::inst().version().game;
+  uint64_t      h    = 0xcbf29ce484222325ull;
+  h = fnv1a(h, appBuild, std::strlen(appBuild));
+  h = fnv1a(h, &CacheVersion, sizeof(CacheVersion));
+  h = fnv1a(h, &game, sizeof(game));
+
+  // chunks are multiple of word size: only tail of file is hashed byte-wise
+  auto                 rd = entry->open_read();
+  std::vector<uint8_t> buf(1024*1024);
+  while(true) {
+    const size_t sz = rd->read(buf.data(),buf.size());
+    if(sz==0)
+      break;
+    h = wordHash(h,buf.data(),sz);
+    }
+  return h==0 ? 1 : h;
+  }
+
+std::u16string WorldCache::path(std::string_view world) {
+  // vdfs is case-insensitive, file-system might be not
+  std::string name = std::string(world);
+  for(auto& c:name)
+    c = char(std::toupper(uint8_t(c)));
+  std::u16string ret = u"cache/";
+  ret += Tempest::TextCodec::toUtf16(name);
+  ret += u".wcache";
+  return ret;
+  }
+
+std::shared_ptr<WorldCache> WorldCache::open(std::string_view world, uint64_t key) {
+  if(key==0)
+    return nullptr;
+  auto ret = std::make_shared<WorldCache>();
+  if(!ret->file.open(path(world)))
+    return nullptr;
+  if(!ret->validate(key)) {
+    Tempest::Log::i("world cache is out of date: \"",world,"\"");
+    return nullptr;
+    }
+  return ret;
+  }
+
+bool WorldCache::validate(uint64_t key) {
+  const size_t tableEnd = sizeof(Header) + sizeof(SectionDesc)*S_Count;
+  if(file.size()<tableEnd)
+    return false;
+
+  Header hdr;
+  std::memcpy(&hdr,file.data(),sizeof(hdr));
+  if(std::memcmp(hdr.magic,Magic,sizeof(Magic))!=0 || hdr.version!=CacheVersion ||
+     hdr.sectionCount!=S_Count || hdr.key!=key)
+    return false;
+
+  table = reinterpret_cast<const SectionDesc*>(file.data()+sizeof(Header));
+  for(size_t i=0; i<S_Count; ++i) {
+    auto& s = table[i];
+    if(s.size==0)
+      continue;
+    if(s.offset%Alignment!=0 || s.offset<tableEnd || s.offset>file.size() || s.size>file.size()-s.offset)
+      return false;
+    }
+  return true;
+  }
+
+bool WorldCache::checkHash(Section s) const {
+  auto& sec = table[s];
+  return sectionHash(file.data()+sec.offset, size_t(sec.size))==sec.hash;
+  }
+
+template<class T>
+bool WorldCache::read(Section s, std::vector<T>& out) const {
+  static_assert(std::is_trivially_copyable_v<T>);
+  auto& sec = table[s];
+  if(sec.size%sizeof(T)!=0 || !checkHash(s))
+    return false;
+  out.resize(size_t(sec.size/sizeof(T)));
+  if(sec.size>0)
+    std::memcpy(out.data(), file.data()+sec.offset, size_t(sec.size));
+  return true;
+  }
+
+bool WorldCache::loadVisual(PackedMesh& out, const zenkit::Mesh& mesh) const {
+  if(table==nullptr || table[S_LndBbox].size!=sizeof(out.mBbox) || !checkHash(S_LndBbox))
+    return false;
+
+  std::vector<LndSubMesh> sub;
+  if(!read(S_LndVertices,  out.vertices)      ||
+     !read(S_LndIndices,   out.indices)       ||
+     !read(S_LndIndices8,  out.indices8)      ||
+     !read(S_LndBounds,    out.meshletBounds) ||
+     !read(S_LndSubMeshes, sub))
+    return false;
+  std::memcpy(out.mBbox, file.data()+table[S_LndBbox].offset, sizeof(out.mBbox));
+
+  out.subMeshes.resize(sub.size());
+  out.materialId.resize(sub.size());
+  for(size_t i=0; i<sub.size(); ++i) {
+    auto& s = sub[i];
+    if(s.material>=mesh.materials.size() || s.iboOffset+s.iboLength>out.indices.size())
+      return false;
+    out.subMeshes[i].material  = mesh.materials[s.material];
+    out.subMeshes[i].iboOffset = size_t(s.iboOffset);
+    out.subMeshes[i].iboLength = size_t(s.iboLength);
+    out.materialId[i]          = s.material;
+    }
+  return true;
+  }
+
+btOptimizedBvh* WorldCache::takeBvh(Section s) {
+  if(table==nullptr || taken[s] || table[s].size==0 || table[s].size>(std::numeric_limits<unsigned>::max)())
+    return nullptr;
+  taken[s] = true;
+  // bullet trusts offsets within serialized tree: corrupted file must not get there
+  if(!checkHash(s)) {
+    Tempest::Log::e("world cache: corrupted bvh section");
+    return nullptr;
+    }
+  // mapping is private: pointer fix-up by bullet doesn't touch the file
+  void* data = file.data()+table[s].offset;
+  return btOptimizedBvh::deSerializeInPlace(data,unsigned(table[s].size),false);
+  }
+
+void WorldCache::Writer::add(Section s, const void* data, size_t size) {
+  auto& dst = sections[s];
+  dst.resize(size);
+  if(size>0)
+    std::memcpy(dst.data(),data,size);
+  present[s] = true;
+  }
+
+void WorldCache::Writer::addVisual(const PackedMesh& pkg) {
+  std::vector<LndSubMesh> sub(pkg.subMeshes.size());
+  for(size_t i=0; i<sub.size(); ++i) {
+    sub[i].material  = pkg.materialId[i];
+    sub[i].iboOffset = pkg.subMeshes[i].iboOffset;
+    sub[i].iboLength = pkg.subMeshes[i].iboLength;
+    }
+  add(S_LndVertices,  pkg.vertices.data(),      pkg.vertices.size()*sizeof(pkg.vertices[0]));
+  add(S_LndIndices,   pkg.indices.data(),       pkg.indices.size()*sizeof(pkg.indices[0]));
+  add(S_LndIndices8,  pkg.indices8.data(),      pkg.indices8.size()*sizeof(pkg.indices8[0]));
+  add(S_LndBounds,    pkg.meshletBounds.data(), pkg.meshletBounds.size()*sizeof(pkg.meshletBounds[0]));
+  add(S_LndSubMeshes, sub.data(),               sub.size()*sizeof(sub[0]));
+  add(S_LndBbox,      pkg.mBbox,                sizeof(pkg.mBbox));
+  }
+
+void WorldCache::Writer::addBvh(Section s, btOptimizedBvh& bvh) {
+  // bullet requires 16-byte aligned buffer for serialization
+  const unsigned         size = bvh.calculateSerializeBufferSize();
+  std::vector<btVector3> buf((size+sizeof(btVector3)-1)/sizeof(btVector3));
+  if(!bvh.serializeInPlace(buf.data(),size,false))
+    return;
+  add(s,buf.data(),size);
+  }
+
+bool WorldCache::Writer::write(std::string_view world, uint64_t key) const {
+  if(key==0)
+    return false;
+  for(size_t i=0; i<S_LndBbox+1; ++i)
+    if(!present[i])
+      return false;
+
+  Header hdr;
+  std::memcpy(hdr.magic,Magic,sizeof(Magic));
+  hdr.version      = CacheVersion;
+  hdr.sectionCount = S_Count;
+  hdr.key          = key;
+
+  SectionDesc table[S_Count] = {};
+  size_t      offset         = alignUp(sizeof(Header)+sizeof(table));
+  for(size_t i=0; i<S_Count; ++i) {
+    if(sections[i].empty())
+      continue;
+    table[i].offset = offset;
+    table[i].size   = sections[i].size();
+    table[i].hash   = sectionHash(sections[i].data(),sections[i].size());
+    offset = alignUp(offset+sections[i].size());
+    }
+
+  // write next to destination and rename, so readers never observe partial file;
+  // temp name is unique per process and thread: same world may be written concurrently
+  const std::filesystem::path dst = path(world);
+  const size_t                tid = std::hash<std::thread::id>()(std::this_thread::get_id());
+  const std::filesystem::path tmp = std::filesystem::path(dst).concat("."+std::to_string(processId())+
+                                                                      "."+std::to_string(tid)+".tmp");
+  try {
+    std::filesystem::create_directories(dst.parent_path());
+    {
+    std::ofstream fout(tmp, std::ios::binary | std::ios::trunc);
+    fout.write(reinterpret_cast<const char*>(&hdr),   sizeof(hdr));
+    fout.write(reinterpret_cast<const char*>(table),  sizeof(table));
+
+    static const char zero[Alignment] = {};
+    size_t pos = sizeof(hdr)+sizeof(table);
+    for(size_t i=0; i<S_Count; ++i) {
+      if(sections[i].empty())
+        continue;
+      fout.write(zero, std::streamsize(table[i].offset-pos));
+      fout.write(reinterpret_cast<const char*>(sections[i].data()), std::streamsize(sections[i].size()));
+      pos = size_t(table[i].offset+table[i].size);
+      }
+    if(!fout)
+      throw std::runtime_error("write error");
+    }
+    std::filesystem::rename(tmp,dst);
+    }
+  catch(const std::exception& e) {
+    std::error_code ec;
+    std::filesystem::remove(tmp,ec);
+    Tempest::Log::e("unable to write world cache: \"",world,"\", reason: ",e.what());
+    return false;
+    }
+  return true;
+  }
+
+bool WorldCache::prebuild(std::string_view name) {
+  const auto* entry = Resources::vdfsIndex().find(name);
+  if(entry==nullptr)
+    return false;
+
+  const uint64_t key = WorldCache::key(name);
+  if(WorldCache::open(name,key)!=nullptr)
+    return true;
+
+  zenkit::World world;
+  try {
+    auto buf = entry->open_read();
+    world.load(buf.get(), Gothic::inst().version().game==1 ? zenkit::GameVersion::GOTHIC_1
+                                                           : zenkit::GameVersion::GOTHIC_2);
+    }
+  catch(...) {
+    // not a world, but a vob-bundle or broken file
+    return true;
+    }
+  auto& mesh = world.world_mesh;
+  if(mesh.polygons.vertex_indices.empty())
+    return true;
+
+  Writer wr;
+  auto physicFut = std::async(std::launch::async, [&]() {
+    DynamicWorld::buildCache(mesh,wr);
+    });
+  {
+  PackedMesh vmesh(mesh,PackedMesh::PK_VisualLnd);
+  wr.addVisual(vmesh);
+  }
+  physicFut.get();
+  return wr.write(name,key);
+  }
+
+size_t WorldCache::prebuildAll() {
+  std::vector<std::string> worlds;
+  auto collect = [&worlds](const zenkit::VfsNode& node, auto& self) -> void {
+    for(auto& i:node.children()) {
+      if(i.type()==zenkit::VfsNodeType::DIRECTORY) {
+        self(i,self);
+        continue;
+        }
+      std::string name = std::string(i.name());
+      if(FileExt::hasExt(name,"ZEN"))
+        worlds.push_back(std::move(name));
+      }
+    };
+  collect(Resources::vdfsIndex().root(),collect);
+
+  size_t failed = 0;
+  for(auto& w:worlds) {
+    const auto time = Tempest::Application::tickCount();
+    if(!prebuild(w)) {
+      Tempest::Log::e("world cache: unable to prebuild \"",w,"\"");
+      ++failed;
+      continue;
+      }
+    Tempest::Log::i("world cache: \"",w,"\" - ",Tempest::Application::tickCount()-time,"ms");
+    }
+  return failed;
+  }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zenkit/Mesh.hh>
+
+#include "utils/mappedfile.h"
+
+class PackedMesh;
+class btOptimizedBvh;
+
+// On-disk cache of derived landscape data: meshlets of visual mesh and BVH of collision meshes.
+// File is a table of 64-byte aligned sections, mapped into memory; BVH is used in place, without copy.
+// Each section has a content hash, checked right before the section is used.
+class WorldCache final {
+  public:
+    enum Section : uint32_t {
+      S_LndVertices,
+      S_LndIndices,
+      S_LndIndices8,
+      S_LndSubMeshes,
+      S_LndBounds,
+      S_LndBbox,
+      S_LandBvh,
+      S_WaterBvh,
+      S_Count
+      };
+
+    class Writer final {
+      public:
+        void addVisual(const PackedMesh& pkg);
+        void addBvh   (Section s, btOptimizedBvh& bvh);
+        bool write    (std::string_view world, uint64_t key) const;
+
+      private:
+        void add(Section s, const void* data, size_t size);
+
+        std::vector<uint8_t> sections[S_Count];
+        bool                 present [S_Count] = {};
+      };
+
+    // content hash of zen-file, engine and cache-format versions; 0 - world not found
+    // thread-safe: can be computed, while zen is being parsed
+    static uint64_t key(std::string_view world);
+    // returns nullptr, if there is no cache for this key
+    static auto     open(std::string_view world, uint64_t key) -> std::shared_ptr<WorldCache>;
+    // rebuild cache of every world in vdfs; returns number of failed worlds
+    static size_t   prebuildAll();
+
+    bool            loadVisual(PackedMesh& out, const zenkit::Mesh& mesh) const;
+    // deserializes bvh in place; result is owned by cache, each section can be taken only once
+    btOptimizedBvh* takeBvh(Section s);
+
+  private:
+    struct Header;
+    struct SectionDesc;
+
+    static std::u16string path(std::string_view world);
+    static bool           prebuild(std::string_view world);
+    bool                  validate(uint64_t key);
+    bool                  checkHash(Section s) const;
+
+    template<class T>
+    bool                  read(Section s, std::vector<T>& out) const;
+
+    MappedFile            file;
+    const SectionDesc*    table = nullptr;
+    bool                  taken[S_Count] = {};
+  };
@@ -11,8 +11,11 @@
 #include "world/triggers/triggerworldstart.h"
 #include "world/triggers/abstracttrigger.h"
 #include "world.h"
+#include "graphics/dynamic/frustrum.h"
 #include "utils/workers.h"
+#include "utils/profiler.h"
 #include "utils/dbgpainter.h"
+#include "camera.h"
 #include "gothic.h"
 
 #include <Tempest/Painter>
@@ -58,8 +61,45 @@ WorldObjects::SearchOpt::SearchOpt(float rangeMin, float rangeMax, float azi, Ta
   :rangeMin(rangeMin),rangeMax(rangeMax),azi(azi),collectAlgo(collectAlgo),collectType(collectType),flags(flags) {
   }
 
-WorldObjects::WorldObjects(World& owner):owner(owner){
+struct WorldObjects::AnimLod {
+  AnimLod(const WorldObjects& owner) : nearDist(owner.animLodNear*owner.animLodNear), farDist(owner.animLodFar*owner.animLodFar) {
+    auto camera = Gothic::inst().camera();
+    if(camera==nullptr || nearDist<=0)
+      return;
+    origin = camera->originLwc();
+    frustrum.make(camera->viewProj(),0,0);
+    enabled = true;
+    }
+
+  Pose::LodTier tier(const Tempest::Vec3& pos, float R) const {
+    if(!enabled)
+      return Pose::LodFull;
+    const float dist    = (pos-origin).quadLength();
+    const bool  visible = frustrum.testPoint(pos,R);
+    if(visible) {
+      if(dist<nearDist)
+        return Pose::LodFull;
+      if(dist<farDist)
+        return Pose::LodReduced;
+      return Pose::LodDistant;
+      }
+    // culled, but may still cast visible shadow
+    if(dist<nearDist)
+      return Pose::LodReduced;
+    return Pose::LodRootOnly;
+    }
+
+  const float   nearDist = 0;
+  const float   farDist  = 0;
+  Tempest::Vec3 origin;
+  Frustrum      frustrum;
+  bool          enabled  = false;
+  };
+
+WorldObjects::WorldObjects(World& owner):owner(owner),los(owner){
   npcNear.reserve(512);
+  npcActive.reserve(512);
+  setupAnimationLod();
   }
 
 WorldObjects::~WorldObjects() {
@@ -82,6 +122,13 @@ void WorldObjects::load(Serialize &fin) {
   for(size_t i=0; i<npcArr.size(); ++i) {
     npcArr[i]->load(fin,i);
     }
+  npcIndex.clear();
+  npcActive.clear();
+  los.invalidate();
+  for(auto& i:npcArr) {
+    npcIndex.add(i.get(),i->position());
+    npcActive.push_back(i.get());
+    }
 
   fin.setEntry("worlds/",fin.worldName(),"/items");
   fin.read(sz);
@@ -142,8 +189,10 @@ void WorldObjects::save(Serialize &fout) {
   }
 
 void WorldObjects::tick(uint64_t dt, uint64_t dtPlayer) {
+  PROFILE_ZONE("WorldObjects::tick");
   auto passive=std::move(sndPerc);
   sndPerc.clear();
+  los.reset();
 
   bool needSort = false;
   for(size_t i=1; i<npcArr.size(); ++i) {
@@ -164,6 +213,20 @@ void WorldObjects::tick(uint64_t dt, uint64_t dtPlayer) {
   auto       camera  = Gothic::inst().camera();
   const bool freeCam = (camera!=nullptr && camera->isFree());
   const auto pl      = owner.player();
+
+  // phase 1: ground and water rays of npc's, that are close enough to move, in parallel.
+  // Only landscape and static objects are hit, and those do not change during phase 2
+  std::atomic<uint64_t> cast{0};
+  owner.physic()->updateAabbs();
+  Workers::parallelFor(npcActive,[pl,freeCam,dt,dtPlayer,&cast](Npc* i) {
+    if(freeCam && pl==i)
+      return;
+    if(size_t n = i->prefetchTick(pl==i ? dtPlayer : dt))
+      cast.fetch_add(n,std::memory_order_relaxed);
+    });
+  pfStat.cast += cast.load();
+
+  // phase 2: serial tick in handle-id order; prefetched ray is taken only on exact match of query
   for(size_t i=0; i<npcArr.size(); ++i) {
     auto& npc = *npcArr[i];
     uint64_t d = (pl==&npc ? dtPlayer : dt);
@@ -171,6 +234,8 @@ void WorldObjects::tick(uint64_t dt, uint64_t dtPlayer) {
       continue;
     npc.tick(d);
     }
+  for(auto i:npcActive)
+    pfStat.used += i->takePrefetchHits();
 
   for(auto& i:routines) {
     auto s = i.stateByTime(owner.time());
@@ -209,25 +274,44 @@ void WorldObjects::tick(uint64_t dt, uint64_t dtPlayer) {
   const float nearDist              = 3000*3000;
   const float farDist               = 6000*6000;
 
+  // only cells within far distance are visited: everyone outside of it is AiFar2,
+  // so it's enough to demote npc's, that were closer on previous tick
+  for(auto npc:npcActive)
+    if(npc!=pl)
+      npc->setProcessPolicy(Npc::ProcessPolicy::AiFar2);
+  npcActive.clear();
+
   auto plPos = pl->position();
-  for(auto& i:npcArr) {
-    float dist = (i->position()-plPos).quadLength();
+  npcIndex.sweep(plPos,6000,[this,pl,nearDist,farDist](Npc& npc, float dist){
     if(dist<nearDist){
-      npcNear.push_back(i.get());
-      if(i.get()!=pl)
-        i->setProcessPolicy(Npc::ProcessPolicy::AiNormal);
+      npcNear.push_back(&npc);
+      npcActive.push_back(&npc);
+      if(&npc!=pl)
+        npc.setProcessPolicy(Npc::ProcessPolicy::AiNormal);
       } else
     if(dist<farDist) {
-      i->setProcessPolicy(Npc::ProcessPolicy::AiFar);
-      } else {
-      i->setProcessPolicy(Npc::ProcessPolicy::AiFar2);
+      npcActive.push_back(&npc);
+      npc.setProcessPolicy(Npc::ProcessPolicy::AiFar);
       }
-    }
+    });
+  // keep handle-id order of npcArr
+  std::stable_sort(npcNear.begin(),npcNear.end(),[](const Npc* a, const Npc* b){
+    return a->handle().id<b->handle().id;
+    });
   tickNear(dt);
   for(CollisionZone* z:collisionZn)
     z->tick(dt);
   tickTriggers(dt);
 
+  // visibility rays of this tick perception: cast in one parallel batch
+  for(auto& ptr:npcNear) {
+    Npc& i = *ptr;
+    if(i.isPlayer() || i.isDead() || i.percNextTime()>owner.tickCount())
+      continue;
+    i.prefetchPerception(*pl);
+    }
+  los.flush();
+
   for(auto& ptr:npcNear) {
     Npc& i = *ptr;
     if(i.isPlayer() || i.isDead())
@@ -301,6 +385,8 @@ Npc* WorldObjects::addNpc(size_t npcInstance, std::string_view at) {
     npc->attachToPoint(pos);
     npc->updateTransform();
     npcArr.emplace_back(npc);
+    npcIndex.add(npc,npc->position());
+    npcActive.push_back(npc);
     } else {
     auto& point = owner.deadPoint();
     npc->attachToPoint(nullptr);
@@ -324,6 +410,8 @@ Npc* WorldObjects::addNpc(size_t npcInstance, const Vec3& pos) {
   npc->updateTransform();
 
   npcArr.emplace_back(npc);
+  npcIndex.add(npc,npc->position());
+  npcActive.push_back(npc);
   return npc;
   }
 
@@ -345,6 +433,8 @@ Npc* WorldObjects::insertPlayer(std::unique_ptr<Npc> &&npc, std::string_view at)
   npc->attachToPoint(pos);
   npc->updateTransform();
   npcArr.emplace_back(std::move(npc));
+  npcIndex.add(npcArr.back().get(),npcArr.back()->position());
+  npcActive.push_back(npcArr.back().get());
   return npcArr.back().get();
   }
 
@@ -354,6 +444,9 @@ std::unique_ptr<Npc> WorldObjects::takeNpc(const Npc* ptr) {
     if(&npc==ptr){
       auto ret=std::move(npcArr[i]);
       npcArr.erase(npcArr.begin() + int32_t(i));
+      npcIndex.del(ret.get());
+      npcActive.erase(std::remove(npcActive.begin(),npcActive.end(),ret.get()),npcActive.end());
+      los.invalidate();
       return ret;
       }
     }
@@ -419,19 +512,35 @@ bool WorldObjects::execTriggerEvent(const TriggerEvent& e) {
   }
 
 void WorldObjects::updateAnimation(uint64_t dt) {
+  PROFILE_ZONE("WorldObjects::updateAnimation");
   static bool doAnim=true;
   if(!doAnim)
     return;
   if(dt==0)
     return;
-  Workers::parallelTasks(npcArr,[dt](std::unique_ptr<Npc>& i){
-    i->updateAnimation(dt);
+
+  const AnimLod lod(*this);
+  Pose::resetLodStatistic();
+  Workers::parallelTasks(npcArr,[dt,&lod](std::unique_ptr<Npc>& i){
+    if(i->isPlayer()) {
+      i->updateAnimation(dt);
+      return;
+      }
+    i->updateAnimation(dt,lod.tier(i->position()+Vec3(0,100,0),200));
     });
-  interactiveObj.parallelFor([dt](Interactive& i){
-    i.updateAnimation(dt);
+  interactiveObj.parallelFor([dt,&lod](Interactive& i){
+    i.updateAnimation(dt,lod.tier(i.position(),300));
     });
   }
 
+void WorldObjects::setupAnimationLod() {
+  // distances in centimeters, zero - LOD is disabled
+  animLodNear = float(Gothic::settingsGetI("INTERNAL","animLodNear"));
+  animLodFar  = float(Gothic::settingsGetI("INTERNAL","animLodFar"));
+  animLodFar  = std::max(animLodNear,animLodFar);
+  Pose::setLodInterval(uint64_t(std::max(1,Gothic::settingsGetI("INTERNAL","animLodRate"))));
+  }
+
 bool WorldObjects::isTargeted(Npc& dst) {
   std::atomic_flag flg = ATOMIC_FLAG_INIT;
   Workers::parallelFor(npcArr,[&dst,&flg](std::unique_ptr<Npc>& i) {
@@ -488,22 +597,31 @@ void WorldObjects::detectNpcNear(const std::function<void(Npc&)>& f) {
 
 void WorldObjects::detectNpc(const float x, const float y, const float z,
                              const float r, const std::function<void(Npc&)>& f) {
-  float maxDist=r*r;
-  for(auto& i:npcArr) {
-    auto qDist = (i->position()-Vec3(x,y,z)).quadLength();
-    if(qDist<maxDist)
-      f(*i);
-    }
+  // callback may move npc's around: collect first, then report in handle-id order, as npcArr does
+  // callback may also call detectNpc recursively: scratch buffer is taken for duration of the call
+  std::vector<Npc*> ret = std::move(npcScratch);
+  ret.clear();
+  npcIndex.find(Vec3(x,y,z),r,[&ret](Npc& npc){
+    ret.push_back(&npc);
+    });
+  std::sort(ret.begin(),ret.end(),[](const Npc* a, const Npc* b){
+    return a->handle().id<b->handle().id;
+    });
+  for(auto i:ret)
+    f(*i);
+  if(ret.capacity()>npcScratch.capacity())
+    npcScratch = std::move(ret);
   }
 
 void WorldObjects::detectItem(const float x, const float y, const float z,
                               const float r, const std::function<void(Item&)>& f) {
-  float maxDist=r*r;
-  for(auto& i:itemArr) {
-    auto qDist = (i->position()-Vec3(x,y,z)).quadLength();
+  const float                   maxDist = r*r;
+  const SpaceIndex<Item>::Query q       = {Vec3(x,y,z), r};
+  items.find(&q,1,[&](size_t, Item& i){
+    auto qDist = (i.position()-q.pos).quadLength();
     if(qDist<maxDist)
-      f(*i);
-    }
+      f(i);
+    });
   }
 
 void WorldObjects::addTrigger(AbstractTrigger* tg) {
@@ -711,9 +829,13 @@ void WorldObjects::addRoot(const std::shared_ptr<zenkit::VirtualObject>& vob, bo
   rootVobs.emplace_back(std::move(p));
   }
 
-void WorldObjects::invalidateVobIndex() {
-  items.invalidate();
-  interactiveObj.invalidate();
+void WorldObjects::invalidateVobIndex(Vob& vob) {
+  if(!items.update(&vob))
+    interactiveObj.update(&vob);
+  }
+
+void WorldObjects::invalidateNpcIndex(Npc& npc) {
+  npcIndex.update(&npc,npc.position());
   }
 
 Interactive* WorldObjects::validateInteractive(Interactive *def) {
@@ -721,12 +843,7 @@ Interactive* WorldObjects::validateInteractive(Interactive *def) {
   }
 
 Npc *WorldObjects::validateNpc(Npc *def) {
-  if(def==nullptr)
-    return nullptr;
-  for(auto& i:npcArr)
-    if(i.get()==def)
-      return def;
-  return nullptr;
+  return npcIndex.hasObject(def) ? def : nullptr;
   }
 
 Item *WorldObjects::validateItem(Item *def) {
@@ -740,25 +857,11 @@ bool WorldObjects::testFocusNpc(const Npc &pl, Npc* def, const SearchOpt& opt) {
   }
 
 Interactive* WorldObjects::findInteractive(const Npc &pl, Interactive* def, const SearchOpt& opt) {
-  def = validateInteractive(def);
-  if(def && testObj(*def,pl,opt))
-    return def;
-  if(owner.view()==nullptr)
-    return nullptr;
-  if(!bool(opt.collectType&TARGET_TYPE_ALL))
-    return nullptr;
-
-  Interactive* ret  = nullptr;
-  float        rlen = opt.rangeMax*opt.rangeMax;
-  interactiveObj.find(pl.position(),opt.rangeMax,[&](Interactive& n){
-    float nlen = rlen;
-    if(testObj(n,pl,opt,nlen)){
-      rlen = nlen;
-      ret  = &n;
-      }
-    return false;
-    });
-  return ret;
+  if(!bool(opt.collectType&TARGET_TYPE_ALL)) {
+    def = validateInteractive(def);
+    return (def && testObj(*def,pl,opt)) ? def : nullptr;
+    }
+  return findObj(interactiveObj,def,pl,opt);
   }
 
 Npc* WorldObjects::findNpcNear(const Npc& pl, Npc* def, const SearchOpt& opt) {
@@ -777,25 +880,11 @@ Npc* WorldObjects::findNpcNear(const Npc& pl, Npc* def, const SearchOpt& opt) {
   }
 
 Item *WorldObjects::findItem(const Npc &pl, Item *def, const SearchOpt& opt) {
-  def = validateItem(def);
-  if(def && testObj(*def,pl,opt))
-    return def;
-  if(owner.view()==nullptr)
-    return nullptr;
-  if(!bool(opt.collectType&(TARGET_TYPE_ALL|TARGET_TYPE_ITEMS)))
-    return nullptr;
-
-  Item* ret  = nullptr;
-  float rlen = opt.rangeMax*opt.rangeMax;
-  items.find(pl.position(),opt.rangeMax,[&](Item& n){
-    float nlen = rlen;
-    if(testObj(n,pl,opt,nlen)){
-      rlen = nlen;
-      ret  = &n;
-      }
-    return false;
-    });
-  return ret;
+  if(!bool(opt.collectType&(TARGET_TYPE_ALL|TARGET_TYPE_ITEMS))) {
+    def = validateItem(def);
+    return (def && testObj(*def,pl,opt)) ? def : nullptr;
+    }
+  return findObj(items,def,pl,opt);
   }
 
 void WorldObjects::marchInteractives(DbgPainter &p) const {
@@ -943,8 +1032,10 @@ void WorldObjects::resetPositionToTA() {
   for(auto& r:routines)
     r.curState = 0;
 
-  for(auto& i:npcInvalid)
+  for(auto& i:npcInvalid) {
+    npcIndex.add(i.get(),i->position());
     npcArr.push_back(std::move(i));
+    }
   npcInvalid.clear();
 
   for(size_t i=0;i<npcArr.size();) {
@@ -952,6 +1043,8 @@ void WorldObjects::resetPositionToTA() {
     if(n.resetPositionToTA()){
       ++i;
       } else {
+      npcIndex.del(npcArr[i].get());
+      los.invalidate();
       npcInvalid.emplace_back(std::move(npcArr[i]));
       npcArr.erase(npcArr.begin()+int(i));
 
@@ -1051,6 +1144,28 @@ auto WorldObjects::findObj(T &src,const Npc &pl, const SearchOpt& opt) -> typena
   return ret;
   }
 
+template<class T>
+T* WorldObjects::findObj(SpaceIndex<T>& index, T* def, const Npc &pl, const SearchOpt& opt) {
+  def = index.hasObject(def) ? def : nullptr;
+  if(def && testObj(*def,pl,opt))
+    return def;
+  if(owner.view()==nullptr)
+    return nullptr;
+
+  // same distance metric, as Npc::qDistTo
+  const typename SpaceIndex<T>::Query q = {pl.position()+Vec3(0,pl.translateY(),0), opt.rangeMax};
+  T*    ret  = nullptr;
+  float rlen = opt.rangeMax*opt.rangeMax;
+  index.find(&q,1,[&](size_t, T& n){
+    float nlen = rlen;
+    if(testObj(n,pl,opt,nlen)){
+      rlen = nlen;
+      ret  = &n;
+      }
+    });
+  return ret;
+  }
+
 template<class T>
 bool WorldObjects::testObj(T &src, const Npc &pl, const WorldObjects::SearchOpt &opt) {
   float rlen = opt.rangeMax*opt.rangeMax;
@@ -7,6 +7,7 @@
 
 #include "bullet.h"
 #include "spaceindex.h"
+#include "lineofsight.h"
 #include "game/gametime.h"
 #include "game/perceptionmsg.h"
 #include "game/constants.h"
@@ -59,6 +60,7 @@ class WorldObjects final {
     void           removeNpc(Npc& npc);
 
     void           updateAnimation(uint64_t dt);
+    void           setupAnimationLod();
 
     bool           isTargeted(Npc& npc);
     Npc*           findHero();
@@ -113,7 +115,15 @@ class WorldObjects final {
     void           addInteractive(Interactive*         obj);
     void           addStatic     (StaticObj*           obj);
     void           addRoot       (const std::shared_ptr<zenkit::VirtualObject>& vob, bool startup);
-    void           invalidateVobIndex();
+    void           invalidateVobIndex(Vob& vob);
+    void           invalidateNpcIndex(Npc& npc);
+    LineOfSight&   lineOfSight() { return los; }
+
+    struct PrefetchStats final {
+      uint64_t cast = 0; // rays of parallel phase of npc tick
+      uint64_t used = 0; // of them, consumed by serial phase
+      };
+    auto           prefetchStats() const -> const PrefetchStats& { return pfStat; }
 
     Interactive*   validateInteractive(Interactive *def);
     Npc*           validateNpc        (Npc         *def);
@@ -155,7 +165,11 @@ class WorldObjects final {
       uint64_t timeUntil = 0;
       };
 
+    struct AnimLod;
+
     World&                             owner;
+    float                              animLodNear = 0;
+    float                              animLodFar  = 0;
 
     std::vector<CollisionZone*>        collisionZn;
     std::vector<std::unique_ptr<Vob>>  rootVobs;
@@ -174,6 +188,11 @@ class WorldObjects final {
     std::vector<std::unique_ptr<Npc>>  npcInvalid; // dead or invalid TA
     std::vector<std::unique_ptr<Npc>>  npcRemoved; // removed, but may have a dangling references in game
     std::vector<Npc*>                  npcNear;
+    std::vector<Npc*>                  npcActive; // npc's, that are not known to be AiFar2
+    std::vector<Npc*>                  npcScratch;
+    PointIndex<Npc>                    npcIndex;
+    LineOfSight                        los;
+    PrefetchStats                      pfStat;
 
     std::vector<AbstractTrigger*>      triggers;
     std::vector<AbstractTrigger*>      triggersTk;
@@ -185,6 +204,9 @@ class WorldObjects final {
     template<class T>
     auto findObj(T &src, const Npc &pl, const SearchOpt& opt) -> typename std::remove_reference<decltype(src[0])>::type;
 
+    template<class T>
+    T*   findObj(SpaceIndex<T>& index, T* def, const Npc &pl, const SearchOpt& opt);
+
     template<class T>
     bool testObj(T &src, const Npc &pl, const SearchOpt& opt);
     template<class T>
@@ -325,7 +325,8 @@ bool WorldSound::setMusic(std::string_view zone, GameMusic::Tags tags) {
 
   string_frm name(zone,'_',(isDay ? "DAY" : "NGT"),'_',smode);
   if(auto* theme = Gothic::musicDef()[name]) {
-    GameMusic::inst().setMusic(*theme,tags);
+    if(GameMusic::isAvailable())
+      GameMusic::inst().setMusic(*theme,tags);
     return true;
     }
   return false;
@@ -74,6 +74,7 @@ struct Cluster {
   uint  firstMeshlet;
   int   meshletCount;
   uint  instanceId;
+  vec4  cone;
   };
 
 struct Bucket {
@@ -0,0 +1,242 @@
+// Standalone benchmark of skeletal animation kernels on every animation from vdf archives: no window or gpu is required.
+// usage: anim-bench <anims.vdf> [...]; exit code is 1, if any instruction set of batched kernels deviates from reference.
+
+#include <Tempest/Matrix4x4>
+
+#include <zenkit/ModelAnimation.hh>
+#include <zenkit/ModelHierarchy.hh>
+#include <zenkit/Vfs.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "graphics/mesh/animmath.h"
+#include "graphics/mesh/packedanimation.h"
+#include "utils/fileext.h"
+
+namespace {
+struct Skeleton final {
+  std::vector<size_t>             parent;
+  std::vector<Tempest::Matrix4x4> tr;
+  };
+
+struct Anim final {
+  const Skeleton*       skeleton = nullptr;
+  std::vector<uint32_t> nodeIndex;
+  std::vector<uint8_t>  has;
+  PackedAnimation       samples;
+  };
+
+struct Scratch final {
+  AnimSampleBatch                      a, b;
+  alignas(16) float                    local[AnimSampleBatch::MaxSize][16];
+  zenkit::AnimationSample              base [AnimSampleBatch::MaxSize] = {};
+  Tempest::Matrix4x4                   tr   [AnimSampleBatch::MaxSize];
+  };
+}
+
+static std::unique_ptr<Skeleton> loadSkeleton(const zenkit::Vfs& vfs, const std::string& name) {
+  const auto* entry = vfs.find(name);
+  if(entry==nullptr)
+    return nullptr;
+
+  zenkit::ModelHierarchy mdh;
+  auto reader = entry->open_read();
+  mdh.load(reader.get());
+  if(mdh.nodes.empty() || mdh.nodes.size()>AnimSampleBatch::MaxSize)
+    return nullptr;
+
+  // same as game skeleton; only ordered ones are evaluated by batched kernels
+  std::unique_ptr<Skeleton> sk(new Skeleton());
+  sk->parent.resize(mdh.nodes.size());
+  sk->tr    .resize(mdh.nodes.size());
+  for(size_t i=0; i<mdh.nodes.size(); ++i) {
+    auto& s = mdh.nodes[i];
+    sk->parent[i] = s.parent_index==-1 ? size_t(-1) : size_t(s.parent_index);
+    if(sk->parent[i]!=size_t(-1) && sk->parent[i]>=i)
+      return nullptr;
+    std::memcpy(reinterpret_cast<void*>(&sk->tr[i]),reinterpret_cast<const void*>(&s.transform),sizeof(sk->tr[i]));
+    if(sk->parent[i]==size_t(-1))
+      sk->tr[i].translate(mdh.root_translation.x,mdh.root_translation.y,mdh.root_translation.z);
+    }
+  return sk;
+  }
+
+static bool loadAnim(const zenkit::Vfs& vfs, const std::string& name, const Skeleton& sk, Anim& ret) {
+  const auto* entry = vfs.find(name);
+  if(entry==nullptr)
+    return false;
+
+  zenkit::ModelAnimation p;
+  auto reader = entry->open_read();
+  p.load(reader.get());
+  if(p.frame_count<2 || p.node_indices.empty() || p.node_indices.size()>AnimSampleBatch::MaxSize)
+    return false;
+
+  ret.skeleton  = &sk;
+  ret.nodeIndex = p.node_indices;
+  ret.has.resize(sk.tr.size());
+  for(auto i:ret.nodeIndex) {
+    if(i>=sk.tr.size())
+      return false;
+    ret.has[i] = 1;
+    }
+  ret.samples = PackedAnimation(p.samples,p.node_indices.size());
+  return !ret.samples.isEmpty() && ret.samples.frameCount()>=2;
+  }
+
+// reference: per-bone path, as before batching
+static void poseReference(const Anim& an, size_t frame, Scratch& s) {
+  auto&        sk        = *an.skeleton;
+  const size_t numFrames = an.samples.frameCount();
+  for(size_t i=0; i<an.nodeIndex.size(); ++i)
+    s.base[an.nodeIndex[i]] = mix(an.samples.sample(i,frame),an.samples.sample(i,(frame+1)%numFrames),0.5f);
+  for(size_t i=0; i<sk.tr.size(); ++i) {
+    auto mat = an.has[i] ? mkMatrix(s.base[i]) : sk.tr[i];
+    if(sk.parent[i]!=size_t(-1))
+      s.tr[i] = s.tr[sk.parent[i]]*mat; else
+      s.tr[i] = mat;
+    }
+  }
+
+// same as Pose: batched decode, blend and matrices, at currently selected instruction set
+static void poseBatch(const Anim& an, size_t frame, Scratch& s) {
+  static const Tempest::Matrix4x4 ident = Tempest::Matrix4x4::mkIdentity();
+
+  auto&        sk        = *an.skeleton;
+  const size_t numFrames = an.samples.frameCount();
+  const size_t numTracks = an.nodeIndex.size();
+  const size_t numBones  = sk.tr.size();
+  an.samples.sample(frame,s.a,numTracks);
+  an.samples.sample((frame+1)%numFrames,s.b,numTracks);
+  mixBatch(s.a,s.a,s.b,0.5f,numTracks);
+  for(size_t i=0; i<numTracks; ++i)
+    s.base[an.nodeIndex[i]] = s.a.get(i);
+  for(size_t i=0; i<numBones; ++i)
+    s.b.set(i,s.base[i]);
+  mkMatrixBatch(s.local,s.b,numBones);
+  for(size_t i=0; i<numBones; ++i) {
+    const float* mat = an.has[i] ? s.local[i] : sk.tr[i].data();
+    if(sk.parent[i]!=size_t(-1))
+      mulMatrix(s.tr[i],s.tr[sk.parent[i]].data(),mat); else
+      mulMatrix(s.tr[i],ident.data(),mat);
+    }
+  }
+
+int main(int argc, const char** argv) {
+  using clock = std::chrono::steady_clock;
+
+  if(argc<2) {
+    std::printf("usage: anim-bench <anims.vdf> [...]\n");
+    return 1;
+    }
+
+  zenkit::Vfs vfs;
+  for(int i=1; i<argc; ++i) {
+    try {
+      vfs.mount_disk(argv[i], zenkit::VfsOverwriteBehavior::OLDER);
+      }
+    catch(const std::exception& e) {
+      std::printf("%s: %s\n", argv[i], e.what());
+      return 1;
+      }
+    }
+
+  std::vector<std::string> names;
+  auto collect = [&names](const zenkit::VfsNode& node, auto& self) -> void {
+    for(auto& i:node.children()) {
+      if(i.type()==zenkit::VfsNodeType::DIRECTORY) {
+        self(i,self);
+        continue;
+        }
+      std::string name = std::string(i.name());
+      if(FileExt::hasExt(name,"MAN") && name.find('-')!=std::string::npos)
+        names.push_back(std::move(name));
+      }
+    };
+  collect(vfs.root(),collect);
+  std::sort(names.begin(),names.end());
+
+  // model name is prefix of animation: HUMANS-S_RUNL.MAN -> HUMANS.MDH
+  std::map<std::string,std::unique_ptr<Skeleton>> skeletons;
+  std::vector<Anim>                               anims;
+  for(auto& name:names) {
+    const std::string mdh = name.substr(0,name.find('-'))+".MDH";
+    try {
+      auto sk = skeletons.find(mdh);
+      if(sk==skeletons.end())
+        sk = skeletons.emplace(mdh,loadSkeleton(vfs,mdh)).first;
+      if(sk->second==nullptr)
+        continue;
+      Anim an;
+      if(loadAnim(vfs,name,*sk->second,an))
+        anims.push_back(std::move(an));
+      }
+    catch(const std::exception& e) {
+      std::printf("%s: %s\n", name.c_str(), e.what());
+      }
+    }
+  if(anims.empty()) {
+    std::printf("anim-bench: no animations of ordered skeletons found\n");
+    return 1;
+    }
+
+  size_t bones = 0;
+  for(auto& an:anims)
+    bones += an.samples.frameCount()*an.skeleton->tr.size();
+  const size_t passes = std::max<size_t>(1,2000000/bones);
+
+  std::printf("anim-bench: %zu animations, %zu bones x %zu passes, best supported: %s\n",
+              anims.size(), bones, passes, animSimdName(animSimdSupported()));
+
+  // last pose of every animation, as reference
+  std::unique_ptr<Scratch>                     s(new Scratch());
+  std::vector<std::vector<Tempest::Matrix4x4>> ref(anims.size());
+  auto t0 = clock::now();
+  for(size_t p=0; p<passes; ++p)
+    for(size_t i=0; i<anims.size(); ++i) {
+      auto& an = anims[i];
+      for(size_t f=0; f<an.samples.frameCount(); ++f)
+        poseReference(an,f,*s);
+      if(p+1==passes)
+        ref[i].assign(s->tr,s->tr+an.skeleton->tr.size());
+      }
+  auto t1 = clock::now();
+  const double refRate = double(bones*passes)/std::chrono::duration<double>(t1-t0).count();
+  std::printf("  reference: %zuK bones/s\n", size_t(refRate/1000.0));
+
+  int ret = 0;
+  for(uint8_t lvl=0; lvl<=uint8_t(animSimdSupported()); ++lvl) {
+    setAnimSimd(AnimSimd(lvl));
+    float err = 0;
+    auto  t0  = clock::now();
+    for(size_t p=0; p<passes; ++p)
+      for(size_t i=0; i<anims.size(); ++i) {
+        auto& an = anims[i];
+        for(size_t f=0; f<an.samples.frameCount(); ++f)
+          poseBatch(an,f,*s);
+        if(p+1!=passes)
+          continue;
+        for(size_t b=0; b<ref[i].size(); ++b)
+          for(size_t r=0; r<16; ++r) {
+            const float x = ref[i][b].data()[r], y = s->tr[b].data()[r];
+            err = std::max(err,std::abs(x-y)/std::max(1.f,std::abs(x)));
+            }
+        }
+    auto t1 = clock::now();
+    const double rate = double(bones*passes)/std::chrono::duration<double>(t1-t0).count();
+    std::printf("  %-9s  %zuK bones/s (x%.2f), error %g%s\n", animSimdName(animSimd()), size_t(rate/1000.0),
+                rate/refRate, double(err), err<1e-4f ? "" : " - MISMATCH");
+    if(!(err<1e-4f))
+      ret = 1;
+    }
+  setAnimSimd(animSimdSupported());
+  return ret;
+  }
@@ -0,0 +1,133 @@
+// Standalone decoding benchmark of bink videos: no game data, window or gpu is required.
+// usage: bink-bench <file.bik> [...]; exit code is 1, if any of videos fails to decode,
+// or if concurrent luma/chroma decoding produces other frames than sequential one.
+
+#include <bink/video.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+namespace {
+class Input final : public Bink::Video::Input {
+  public:
+    explicit Input(const char* path):fin(path,std::ios::binary) {
+      if(!fin)
+        throw std::runtime_error("unable to open file");
+      }
+
+    void read(void* dest, size_t count) override {
+      if(!fin.read(reinterpret_cast<char*>(dest),std::streamsize(count)))
+        throw std::runtime_error("unexpected end of file");
+      }
+    void seek(size_t pos) override {
+      fin.clear();
+      fin.seekg(std::streamoff(pos));
+      }
+    void skip(size_t count) override {
+      fin.seekg(std::streamoff(count),std::ios::cur);
+      }
+
+  private:
+    std::ifstream fin;
+  };
+}
+
+namespace {
+struct Pass final {
+  std::vector<uint64_t> sum;    // per frame; 0 - decoding error
+  size_t                errors = 0;
+  size_t                split  = 0; // frames, decoded with concurrent chroma
+  uint32_t              w = 0, h = 0;
+  double                sec = 0;
+  };
+}
+
+static uint64_t checksum(const Bink::Frame& f) {
+  // fnv1a over visible pixels of every plane; chroma is half-sized
+  uint64_t h = 0xcbf29ce484222325ull;
+  for(uint8_t p=0; p<4; ++p) {
+    const uint32_t w  = (p==1 || p==2) ? f.width()/2  : f.width();
+    const uint32_t hp = (p==1 || p==2) ? f.height()/2 : f.height();
+    auto&          pl = f.plane(p);
+    for(uint32_t y=0; y<hp; ++y) {
+      const uint8_t* row = pl.row(y);
+      for(uint32_t x=0; x<w; ++x) {
+        h ^= row[x];
+        h *= 0x100000001b3ull;
+        }
+      }
+    }
+  return h==0 ? 1 : h;
+  }
+
+static Pass decode(const char* path, bool split) {
+  using clock = std::chrono::steady_clock;
+
+  Pass        ret;
+  Input       input(path);
+  Bink::Video vid(&input);
+  vid.setPlaneSplit(split);
+  while(vid.currentFrame()<vid.frameCount()) {
+    const auto t0 = clock::now();
+    try {
+      auto& f = vid.nextFrame();
+      ret.sec += std::chrono::duration<double>(clock::now()-t0).count();
+      ret.w    = f.width();
+      ret.h    = f.height();
+      ret.sum.push_back(checksum(f));
+      if(vid.isPlaneSplit())
+        ret.split++;
+      }
+    catch(const Bink::VideoDecodingException&) {
+      ret.sec += std::chrono::duration<double>(clock::now()-t0).count();
+      ret.sum.push_back(0);
+      ret.errors++;
+      }
+    }
+  return ret;
+  }
+
+static bool bench(const char* path) {
+  Pass seq, par;
+  try {
+    seq = decode(path,false);
+    par = decode(path,true);
+    }
+  catch(const std::exception& e) {
+    std::printf("%s: %s\n", path, e.what());
+    return false;
+    }
+
+  // sequential decoding is reference: split one must produce same pixels on every frame
+  size_t mismatch = size_t(-1);
+  for(size_t i=0; i<std::max(seq.sum.size(),par.sum.size()); ++i) {
+    if(i>=seq.sum.size() || i>=par.sum.size() || seq.sum[i]!=par.sum[i]) {
+      mismatch = i;
+      break;
+      }
+    }
+
+  const size_t frames = par.sum.size()-par.errors;
+  std::printf("%s: %zu frames %ux%u, %zu errors, decode %.1f fps, sequential %.1f fps, %zu split frames",
+              path, frames, unsigned(par.w), unsigned(par.h), par.errors,
+              double(par.sum.size())/std::max(par.sec,1e-6), double(seq.sum.size())/std::max(seq.sec,1e-6), par.split);
+  if(mismatch!=size_t(-1))
+    std::printf(", checksum MISMATCH at frame %zu\n", mismatch); else
+    std::printf(", checksums match\n");
+  return frames>0 && par.errors==0 && seq.errors==0 && mismatch==size_t(-1);
+  }
+
+int main(int argc, const char** argv) {
+  if(argc<2) {
+    std::printf("usage: bink-bench <file.bik> [...]\n");
+    return 1;
+    }
+  int ret = 0;
+  for(int i=1; i<argc; ++i)
+    if(!bench(argv[i]))
+      ret = 1;
+  return ret;
+  }
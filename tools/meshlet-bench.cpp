@@ -0,0 +1,151 @@
+// Standalone benchmark of meshlet packing on every mesh from vdf archives: no window or gpu is required.
+// usage: meshlet-bench [-g1] <meshes.vdf> [...]; exit code is 1, if any packed mesh violates meshlet layout.
+// -g1: archives are from Gothic 1, affects only parsing of worlds (.ZEN)
+
+#include <zenkit/MorphMesh.hh>
+#include <zenkit/MultiResolutionMesh.hh>
+#include <zenkit/Vfs.hh>
+#include <zenkit/World.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "graphics/mesh/submesh/packedmesh.h"
+#include "utils/fileext.h"
+
+namespace {
+struct Result final {
+  PackedMesh::MeshletStats stats;
+  size_t                   meshes = 0;
+  size_t                   bad    = 0;
+  double                   ms     = 0;
+  };
+}
+
+// every meshlet owns MaxVert vertices and MaxInd indices; indices must not leave own meshlet
+static size_t broken(const PackedMesh& m) {
+  if(m.indices.size()%PackedMesh::MaxInd!=0 || m.indices.size()/PackedMesh::MaxInd!=m.vertices.size()/PackedMesh::MaxVert)
+    return 1;
+  size_t ret = 0;
+  for(size_t i=0; i<m.indices.size(); i+=PackedMesh::MaxInd) {
+    const size_t base = (i/PackedMesh::MaxInd)*PackedMesh::MaxVert;
+    for(size_t r=i; r<i+PackedMesh::MaxInd; ++r)
+      if(m.indices[r]<base || m.indices[r]>=base+PackedMesh::MaxVert) {
+        ++ret;
+        break;
+        }
+    }
+  return ret;
+  }
+
+template<class Mesh>
+static void pack(const Mesh& mesh, PackedMesh::PkgType type, Result& ret) {
+  using clock = std::chrono::steady_clock;
+  auto t0 = clock::now();
+  PackedMesh packed(mesh,type);
+  auto t1 = clock::now();
+  ret.ms    += std::chrono::duration<double,std::milli>(t1-t0).count();
+  ret.stats += packed.meshletStats;
+  ret.bad   += broken(packed);
+  ret.meshes++;
+  }
+
+static void report(const char* what, const Result& r) {
+  if(r.meshes==0)
+    return;
+  const double n = double(std::max<size_t>(r.stats.meshlets,1));
+  // tightness: radius of bounding sphere relative to half-diagonal of meshlet aabb; lower is better
+  std::printf("  %-9s  %zu meshes, %zums, %zu meshlets, %.1f vert, %.1f prim per meshlet, tightness %.3f, cones %d%%%s\n",
+              what, r.meshes, size_t(r.ms), r.stats.meshlets,
+              double(r.stats.vertices)/n, double(r.stats.primitives)/n,
+              r.stats.radius/std::max(r.stats.halfDiagonal,1e-6), int(double(r.stats.cones)*100.0/n),
+              r.bad==0 ? "" : " - MISMATCH");
+  if(r.bad>0)
+    std::printf("  %-9s  %zu meshlets out of bounds\n", what, r.bad);
+  }
+
+int main(int argc, const char** argv) {
+  auto version = zenkit::GameVersion::GOTHIC_2;
+  int  first   = 1;
+  if(argc>1 && std::strcmp(argv[1],"-g1")==0) {
+    version = zenkit::GameVersion::GOTHIC_1;
+    first   = 2;
+    }
+
+  if(argc<=first) {
+    std::printf("usage: meshlet-bench [-g1] <meshes.vdf> [...]\n");
+    return 1;
+    }
+
+  zenkit::Vfs vfs;
+  for(int i=first; i<argc; ++i) {
+    try {
+      vfs.mount_disk(argv[i], zenkit::VfsOverwriteBehavior::OLDER);
+      }
+    catch(const std::exception& e) {
+      std::printf("%s: %s\n", argv[i], e.what());
+      return 1;
+      }
+    }
+
+  // same packing, as in game: MRM - static objects, MMB - morph meshes, ZEN - landscape
+  std::vector<std::string> names;
+  auto collect = [&names](const zenkit::VfsNode& node, auto& self) -> void {
+    for(auto& i:node.children()) {
+      if(i.type()==zenkit::VfsNodeType::DIRECTORY) {
+        self(i,self);
+        continue;
+        }
+      std::string name = std::string(i.name());
+      if(FileExt::hasExt(name,"MRM") || FileExt::hasExt(name,"MMB") || FileExt::hasExt(name,"ZEN"))
+        names.push_back(std::move(name));
+      }
+    };
+  collect(vfs.root(),collect);
+  std::sort(names.begin(),names.end());
+
+  Result objects, morph, landscape;
+  for(auto& name:names) {
+    const auto* entry = vfs.find(name);
+    if(entry==nullptr)
+      continue;
+    try {
+      auto reader = entry->open_read();
+      if(FileExt::hasExt(name,"MRM")) {
+        zenkit::MultiResolutionMesh zmsh;
+        zmsh.load(reader.get());
+        if(!zmsh.sub_meshes.empty())
+          pack(zmsh,PackedMesh::PK_Visual,objects);
+        }
+      else if(FileExt::hasExt(name,"MMB")) {
+        zenkit::MorphMesh zmm;
+        zmm.load(reader.get());
+        if(!zmm.mesh.sub_meshes.empty())
+          pack(zmm.mesh,PackedMesh::PK_VisualMorph,morph);
+        }
+      else {
+        zenkit::World zen;
+        zen.load(reader.get(),version);
+        pack(zen.world_mesh,PackedMesh::PK_VisualLnd,landscape);
+        }
+      }
+    catch(const std::exception& e) {
+      std::printf("%s: %s\n", name.c_str(), e.what());
+      }
+    }
+
+  if(objects.meshes+morph.meshes+landscape.meshes==0) {
+    std::printf("meshlet-bench: no meshes found\n");
+    return 1;
+    }
+
+  std::printf("meshlet-bench: %zu files\n", names.size());
+  report("objects",  objects);
+  report("morph",    morph);
+  report("landscape",landscape);
+  return (objects.bad+morph.bad+landscape.bad)==0 ? 0 : 1;
+  }